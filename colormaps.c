@@ -2507,6 +2507,44 @@ void hsl_to_rgb_palette(double h, double s, double l, double rgb[3], int palette
     }
 }
 
+void hsl_to_rgb_batch(int n, double hsl[], double rgb[], int palette)
+/* color conversion from HSL to RGB of n colors, hsl and rgb contain 3n values and must not overlap */
+/* HSLuv colors are converted by blocks by hsluv2rgb_batch, other palettes one by one */
+{
+    int i, k, nb;
+    double l, luv[3 * HSLUV_BATCH];
+
+    if (palette != COL_HSLUV)
+    {
+        for (i = 0; i < n; i++)
+            hsl_to_rgb_palette(hsl[3 * i], hsl[3 * i + 1], hsl[3 * i + 2], &rgb[3 * i], palette);
+        return;
+    }
+
+    for (i = 0; i < n; i += HSLUV_BATCH)
+    {
+        nb = n - i;
+        if (nb > HSLUV_BATCH)
+            nb = HSLUV_BATCH;
+        for (k = 0; k < nb; k++)
+        {
+            luv[3 * k] = hsl[3 * (i + k)];
+            luv[3 * k + 1] = 100.0 * hsl[3 * (i + k) + 1];
+            luv[3 * k + 2] = hsl[3 * (i + k) + 2];
+        }
+        hsluv2rgb_batch(nb, luv, &rgb[3 * i]);
+
+        /* same scaling as hsl_to_rgb_palette */
+        for (k = 3 * i; k < 3 * (i + nb); k += 3)
+        {
+            l = hsl[k + 2];
+            rgb[k] = 2.0 * l * rgb[k] * 100.0;
+            rgb[k + 1] = 2.0 * l * rgb[k + 1] * 100.0;
+            rgb[k + 2] = 2.0 * l * rgb[k + 2] * 100.0;
+        }
+    }
+}
+
 void amp_to_rgb_palette(double h, double rgb[3], int palette) /* color conversion from amplitude in [0,1] to RGB */
 {
     int color_hue, i;
@@ -229,4 +229,129 @@ void color_scheme_asym_palette(int scheme, int palette, double value, double sca
     }
 }
 
+int color_scheme_hsl(int scheme, int asym, double value, double scale, int time, double hsl[3])
+/* hue, saturation and luminosity giving the color of color_scheme_palette (color_scheme_asym_palette */
+/* if asym is 1) with palette COL_HSLUV, to be converted by hsl_to_rgb_batch - returns 0 for unknown scheme */
+{
+    double amplitude;
+    int intpart;
+
+    hsl[1] = 0.9;
+    switch (scheme) {
+        case (C_LUM):
+        {
+            hsl[0] = COLORHUE + (double)time*COLORDRIFT/(double)NSTEPS;
+            if (hsl[0] < 0.0) hsl[0] += 360.0;
+            if (hsl[0] >= 360.0) hsl[0] -= 360.0;
+            amplitude = color_amplitude(value, scale, time);
+            hsl[2] = LUMMEAN + amplitude*LUMAMP;
+            intpart = (int)hsl[2];
+            hsl[2] -= (double)intpart;
+            return(1);
+        }
+        case (C_HUE):
+        {
+            hsl[2] = 0.5;
+            if (asym) hsl[0] = HUEMEAN + 0.8*color_amplitude_asym(value, scale, time)*HUEAMP;
+            else hsl[0] = HUEMEAN + color_amplitude(value, scale, time)*HUEAMP;
+            if (hsl[0] < 0.0) hsl[0] += 360.0;
+            if (hsl[0] >= 360.0) hsl[0] -= 360.0;
+            return(1);
+        }
+        /* amp_to_rgb_palette(a, rgb, COL_HSLUV) is the color of hue 360*(1-a) */
+        case (C_ONEDIM):
+        {
+            amplitude = color_amplitude(value, scale, time);
+            if (!asym) amplitude = 0.5*(1.0 + amplitude);
+            hsl[0] = 360.0*(1.0 - amplitude);
+            hsl[2] = 0.5;
+            return(1);
+        }
+        case (C_ONEDIM_LINEAR):
+        {
+            if (asym) return(0);
+            amplitude = color_amplitude_linear(value, scale, time);
+            if (amplitude > 1.0) amplitude -= 1.0;
+            else if (amplitude < 0.0) amplitude += 1.0;
+            hsl[0] = 360.0*(1.0 - amplitude);
+            hsl[2] = 0.5;
+            return(1);
+        }
+    }
+    return(0);
+}
+
+/* colour tables for phase plots: phase and luminosity are quantized, so that */
+/* complex fields are coloured by a table lookup instead of HSL conversions   */
+
+#define PHASE_LUT_HUES 360      /* number of hues in phase table (1 degree steps) */
+#define PHASE_LUT_LUMS 128      /* number of luminosities in phase table, for luminosity in [0, 0.5] */
+#define AMP_LUT_SIZE 1024       /* number of colors in table of amp_to_rgb_palette */
+
+float phase_lut[PHASE_LUT_HUES*PHASE_LUT_LUMS*3];
+float amp_lut[AMP_LUT_SIZE*3];
+int phase_lut_ready = 0, amp_lut_palette = -1;
+
+void init_phase_lut()
+/* table of hsl_to_rgb(hue, 0.9, lum), to be called before parallel loops using phase_color */
+{
+    int h, l, k;
+    double rgb[3];
+
+    if (phase_lut_ready) return;
+    for (h=0; h<PHASE_LUT_HUES; h++)
+        for (l=0; l<PHASE_LUT_LUMS; l++)
+        {
+            hsl_to_rgb(360.0*(double)h/(double)PHASE_LUT_HUES, 0.9, 0.5*(double)l/(double)(PHASE_LUT_LUMS-1), rgb);
+            for (k=0; k<3; k++) phase_lut[3*(h*PHASE_LUT_LUMS+l)+k] = rgb[k];
+        }
+    phase_lut_ready = 1;
+}
+
+void phase_color(double phase, double lum, double rgb[3])
+/* color of given phase in [0, 2 Pi) and luminosity in [0, 0.5], from table */
+{
+    int h, l;
+    float *color;
+
+    h = (int)(phase*(double)PHASE_LUT_HUES/DPI + 0.5);
+    if (h >= PHASE_LUT_HUES) h -= PHASE_LUT_HUES;
+    if (h < 0) h = 0;
+    l = (int)(lum*2.0*(double)(PHASE_LUT_LUMS-1) + 0.5);
+    if (l < 0) l = 0;
+    if (l >= PHASE_LUT_LUMS) l = PHASE_LUT_LUMS-1;
+    color = &phase_lut[3*(h*PHASE_LUT_LUMS+l)];
+    rgb[0] = color[0];
+    rgb[1] = color[1];
+    rgb[2] = color[2];
+}
 
+void init_amp_lut(int palette)
+/* table of amp_to_rgb_palette, to be called before parallel loops using amp_color */
+{
+    int n, k;
+    double rgb[3];
+
+    if (palette == amp_lut_palette) return;
+    for (n=0; n<AMP_LUT_SIZE; n++)
+    {
+        amp_to_rgb_palette(((double)n + 0.5)/(double)AMP_LUT_SIZE, rgb, palette);
+        for (k=0; k<3; k++) amp_lut[3*n+k] = rgb[k];
+    }
+    amp_lut_palette = palette;
+}
+
+void amp_color(double value, double rgb[3])
+/* color of value in [0,1] from table of amp_to_rgb_palette */
+{
+    int n;
+    float *color;
+
+    n = (int)(value*(double)AMP_LUT_SIZE);
+    if (n < 0) n = 0;
+    if (n >= AMP_LUT_SIZE) n = AMP_LUT_SIZE-1;
+    color = &amp_lut[3*n];
+    rgb[0] = color[0];
+    rgb[1] = color[1];
+    rgb[2] = color[2];
+}
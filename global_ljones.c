@@ -169,6 +169,41 @@ typedef struct
     double xc, yc;              /* center of circle */
 } t_tracer;
 
+/* tracer trajectories, see draw_trails() */
+
+#define TRAIL_CHUNK 64          /* max number of segments and of frames of a chunk of trajectory */
+#define TRAIL_NCHUNKS (TRAJECTORY_LENGTH/TRAIL_CHUNK + 3)   /* number of chunks of a trajectory */
+
+typedef struct
+{
+    float xc, yc;               /* position of tracer particle */
+    int time;                   /* frame at which position was recorded */
+} t_trail_point;
+
+typedef struct
+{
+    t_trail_point point[TRAIL_CHUNK + 1];   /* first point is last point of previous chunk */
+    int npoints;                /* number of points */
+    int compiled;               /* has value 1 if list contains the chunk */
+    GLuint list;                /* display list of chunk, recorded once it is closed */
+} t_trail_chunk;
+
+typedef struct
+{
+    t_trail_chunk chunk[TRAIL_NCHUNKS];     /* ring buffer of chunks */
+    int first, nchunks;         /* oldest chunk and number of chunks in use */
+    int time;                   /* frame of last point, -1 if trajectory is empty */
+    double error;               /* deviation accumulated by merging points into last point */
+} t_trail;
+
+typedef struct
+{
+    double rgb[3];              /* color of particle in a given plot */
+    double radius;              /* drawn radius */
+    short int nsides;           /* number of sides of drawn polygon */
+    short int width;            /* width of boundary */
+} t_particle_view;
+
 
 int ncircles, nobstacles, counter = 0;
 
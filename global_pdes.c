@@ -103,6 +103,29 @@
 #define BC_ABS_REFLECT 4   /* absorbing boundary conditions, except reflecting at y=0, for comparisons */
 // #define BC_OSCILL_ABSORB 5  /* oscillating boundary condition on the left, absorbing on other walls */ 
 
+/* Embedded boundary conditions on curved walls (option CUT_CELLS) */
+
+#define CUT_DIRICHLET 1  /* field vanishes on the wall (for heat, takes the value of the outer cell) */
+#define CUT_NEUMANN 2    /* normal derivative of field vanishes on the wall */
+
+/* Time-harmonic steady state (option HELMHOLTZ) */
+
+#define HELM_START 1     /* start time steps on the periodic orbit */
+#define HELM_ORBIT 2     /* render the periodic orbit without time steps */
+
+/* Wave sources */
+
+#define S_POINT 0        /* circular wave emitted by a point */
+#define S_LINE 1         /* wave emitted by a segment */
+#define S_PLANAR 2       /* planar wave, emitted by a line */
+
+#define SOURCE_SUPPORT 37.0   /* exp(-SOURCE_SUPPORT) is below double precision, sets support radius of sources */
+
+/* Interpolation kernels for resampled rendering */
+
+#define R_BILINEAR 0     /* bilinear interpolation */
+#define R_BICUBIC 1      /* bicubic (Catmull-Rom) interpolation */
+
 /* For debugging purposes only */
 // #define FLOOR 0         /* set to 1 to limit wave amplitude to VMAX */
 // #define VMAX 10.0       /* max value of wave amplitude */
@@ -170,6 +193,16 @@ typedef struct
     double posi, posj;     /* (i,j) coordinates of vertex */
 } t_vertex;
 
+typedef struct
+{
+    int type;                   /* type of source, see list above */
+    double x1, y1, x2, y2;      /* position of point source, or endpoints of segment/points on line */
+    double amplitude;           /* amplitude of wave */
+    double variance;            /* variance of Gaussian envelope */
+    double wavelength;          /* wavelength of wave */
+    double radius;              /* support radius, beyond which the wave is negligible */
+} t_source;
+
 
 // double circlex[NMAXCIRCLES], circley[NMAXCIRCLES], circlerad[NMAXCIRCLES];      /* position and radius of circular scatterers */
 // short int circleactive[NMAXCIRCLES];                                      /* tells which circular scatters are active */
@@ -114,6 +114,7 @@
 /* Boundary conditions, see list in global_pdes.c  */
 
 #define B_COND 1
+#define CUT_CELLS 0 /* set to CUT_DIRICHLET or CUT_NEUMANN for embedded curved walls */
 
 /* Parameters for length and speed of simulation */
 
@@ -179,6 +180,7 @@
 
 #include "global_pdes.c"
 #include "sub_wave.c"
+#include "sub_wave_cut.c" /* embedded boundary for curved walls */
 
 double courant2; /* Courant parameter squared */
 double dx2;      /* spatial step size squared */
@@ -194,12 +196,18 @@ void init_gaussian(double x, double y, double mean, double amplitude, double sca
 
     scale2 = scalex * scalex;
     printf("Initialising field\n");
+    if (!init_fractal_xyin(xy_in, 0, NX))
+        for (i = 0; i < NX; i++)
+            for (j = 0; j < NY; j++)
+            {
+                ij_to_xy(i, j, xy);
+                xy_in[i][j] = xy_in_billiard(xy[0], xy[1]);
+            }
+
     for (i = 0; i < NX; i++)
         for (j = 0; j < NY; j++)
         {
             ij_to_xy(i, j, xy);
-            xy_in[i][j] = xy_in_billiard(xy[0], xy[1]);
-
             in = xy_in[i][j];
             if (in == 1)
             {
@@ -454,7 +462,7 @@ void draw_wave(double *phi[NX], short int *xy_in[NX], double scale, int time)
 void evolve_wave_half(double *phi_in[NX], double *phi_out[NX], short int *xy_in[NX])
 /* time step of field evolution */
 {
-    int i, j, iplus, iminus, jplus, jminus;
+    int i, j, k, iplus, iminus, jplus, jminus;
     double delta1, delta2, x, y;
 
 #pragma omp parallel for private(i, j, iplus, iminus, jplus, jminus, delta1, delta2, x, y)
@@ -541,6 +549,19 @@ void evolve_wave_half(double *phi_in[NX], double *phi_out[NX], short int *xy_in[
         }
     }
 
+    /* modified stencil near curved walls */
+    if (cut_active)
+    {
+#pragma omp parallel for private(k, i, j, x)
+        for (k = 0; k < cut_ncells; k++)
+        {
+            i = cut_cells[k].i;
+            j = cut_cells[k].j;
+            x = phi_in[i][j];
+            phi_out[i][j] = x + intstep * (cut_laplacian(phi_in, &cut_cells[k]) - SPEED * (phi_in[i + 1][j] - x));
+        }
+    }
+
     //     printf("phi(0,0) = %.3lg, psi(0,0) = %.3lg\n", phi[NX/2][NY/2], psi[NX/2][NY/2]);
 }
 
@@ -687,6 +708,13 @@ void animation()
     init_gaussian(-1.0, 0.0, 0.1, 0.0, 0.01, phi, xy_in);
     //     init_gaussian(x, y, mean, amplitude, scalex, phi, xy_in)
 
+    if (CUT_CELLS)
+    {
+        init_cut_cells(xy_in, CUT_CELLS, 1);
+        if (intstep * cut_wmax > 1.0)
+            printf("Warning: DT should be below %.3lg for stability of embedded boundary\n", DT / (intstep * cut_wmax));
+    }
+
     if (SCALE)
     {
         var = compute_variance(phi, xy_in);
@@ -764,6 +792,8 @@ void animation()
             save_frame();
         s = system("mv wave*.tif tif_heat/");
     }
+    if (CUT_CELLS)
+        free_cut_cells();
     for (i = 0; i < NX; i++)
     {
         free(phi[i]);
@@ -407,6 +407,93 @@ hsluv2rgb(double h, double s, double l, double* pr, double* pg, double* pb)
     *pb = tmp.c;
 }
 
+/* Batch conversion: each block of HSLUV_BATCH colours is converted in three
+ * passes. The first one computes the sine and cosine of the hue once, and
+ * uses them both for the chroma bound and for lch2luv(); the bounds of the
+ * gamut only depend on lightness, and are only recomputed when lightness
+ * changes. The second pass (luv2xyz() and the matrix of xyz2rgb()) has no
+ * branches, so that it is vectorised. The last one applies from_linear().
+ */
+void
+hsluv2rgb_batch(int n, const double* hsl, double* rgb)
+{
+    double lum[HSLUV_BATCH], u[HSLUV_BATCH], v[HSLUV_BATCH];
+    double lin_r[HSLUV_BATCH], lin_g[HSLUV_BATCH], lin_b[HSLUV_BATCH];
+    double bounds_l = 0.0;
+    Bounds bounds[6];
+    int have_bounds = 0;
+    int start, nb, k, i;
+
+    for(start = 0; start < n; start += HSLUV_BATCH) {
+        nb = (n - start < HSLUV_BATCH ? n - start : HSLUV_BATCH);
+
+        /* hsluv2lch() and lch2luv() */
+        for(k = 0; k < nb; k++) {
+            double h = hsl[3 * (start + k)];
+            double s = hsl[3 * (start + k) + 1];
+            double l = hsl[3 * (start + k) + 2];
+            double hrad = h * 0.01745329251994329577; /* (2 * pi / 360) */
+            double sin_h = sin(hrad);
+            double cos_h = cos(hrad);
+            double c = 0.0;
+
+            /* White and black: disambiguate chroma */
+            if(!(l > 99.9999999 || l < 0.00000001)) {
+                double min_len = DBL_MAX;
+
+                if(!have_bounds || l != bounds_l) {
+                    get_bounds(l, bounds);
+                    bounds_l = l;
+                    have_bounds = 1;
+                }
+                for(i = 0; i < 6; i++) {
+                    double len = bounds[i].b / (sin_h - bounds[i].a * cos_h);
+
+                    if(len >= 0  &&  len < min_len)
+                        min_len = len;
+                }
+                c = min_len / 100.0 * s;
+            }
+
+            lum[k] = l;
+            /* Grays: disambiguate hue */
+            if(s < 0.00000001) {
+                u[k] = c;
+                v[k] = 0.0;
+            } else {
+                u[k] = cos_h * c;
+                v[k] = sin_h * c;
+            }
+        }
+
+        /* luv2xyz() and linear part of xyz2rgb() */
+        #pragma omp simd
+        for(k = 0; k < nb; k++) {
+            int black = (lum[k] <= 0.00000001);
+            double l = (black ? 1.0 : lum[k]);
+            double var_u = u[k] / (13.0 * l) + ref_u;
+            double var_v = v[k] / (13.0 * l) + ref_v;
+            double t = (l + 16.0) / 116.0;
+            double y = (l <= 8.0 ? l / kappa : t * t * t);
+            double x = -(9.0 * y * var_u) / ((var_u - 4.0) * var_v - var_u * var_v);
+            double z = (9.0 * y - (15.0 * var_v * y) - (var_v * x)) / (3.0 * var_v);
+
+            x = (black ? 0.0 : x);
+            y = (black ? 0.0 : y);
+            z = (black ? 0.0 : z);
+            lin_r[k] = m[0].a * x + m[0].b * y + m[0].c * z;
+            lin_g[k] = m[1].a * x + m[1].b * y + m[1].c * z;
+            lin_b[k] = m[2].a * x + m[2].b * y + m[2].c * z;
+        }
+
+        for(k = 0; k < nb; k++) {
+            rgb[3 * (start + k)] = from_linear(lin_r[k]);
+            rgb[3 * (start + k) + 1] = from_linear(lin_g[k]);
+            rgb[3 * (start + k) + 2] = from_linear(lin_b[k]);
+        }
+    }
+}
+
 void
 hpluv2rgb(double h, double s, double l, double* pr, double* pg, double* pb)
 {
@@ -46,6 +46,24 @@ extern "C" {
  */
 void hsluv2rgb(double h, double s, double l, double* pr, double* pg, double* pb);
 
+/**
+ * Number of colours converted together by hsluv2rgb_batch().
+ */
+#define HSLUV_BATCH 64
+
+/**
+ * Convert n HSLuv colours to RGB, with the same results as hsluv2rgb().
+ *
+ * Colours are converted by blocks of HSLUV_BATCH, which is faster than
+ * n calls of hsluv2rgb(), in particular when consecutive colours have the
+ * same lightness.
+ *
+ * @param n Number of colours.
+ * @param hsl Hue, saturation and lightness of each colour (3n values).
+ * @param[out] rgb Red, green and blue components of each colour (3n values).
+ */
+void hsluv2rgb_batch(int n, const double* hsl, double* rgb);
+
 /**
  * Convert RGB to HSLuv.
  *
@@ -32,16 +32,50 @@
 #include <GL/glu.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <stddef.h>
 #include <tiffio.h> /* Sam Leffler's libtiff library. */
 #include <omp.h>
 
 #define MOVIE 0        /* set to 1 to generate movie */
 #define DOUBLE_MOVIE 0 /* set to 1 to produce movies for wave height and energy simultaneously */
+#define HEADLESS 0     /* set to 1 to run the simulation without window, e.g. to save a dump file */
+#define TELEMETRY 1    /* set to 1 to publish the progress of the run in shared memory, read with telemetry */
+#define ASYNC_RENDER 0 /* set to 1 to compute the next frames in a separate process while frames are drawn */
+#define RENDER_QUEUE 3 /* number of frames the simulation may compute ahead of drawing, for ASYNC_RENDER */
 
 #define TIME_LAPSE 1        /* set to 1 to add a time-lapse movie at the end */
                             /* so far incompatible with double movie */
 #define TIME_LAPSE_FACTOR 3 /* factor of time-lapse movie */
 
+#define SAVE_DUMP_FILE 0           /* set to 1 to save particle configurations, to re-render them with lj_render */
+#define DUMP_FILE "lj_dump.bin"    /* name of file containing particle configurations */
+
+#define STRUCTURE_ANALYSIS 0       /* set to 1 to save g(r), hexatic order and solid cluster sizes */
+#define ANALYSIS_FILE "lj_structure.bin"  /* name of file containing structure analysis */
+#define ANALYSIS_STEPS 1000        /* number of time steps between structure analyses */
+#define GR_BINS 100                /* number of bins of radial distribution function */
+#define GR_RMAX 8.0                /* max distance for radial distribution function, in units of MU */
+#define PSI6_THRESHOLD 0.7         /* local hexatic order above which particles count as solid */
+
+#define SAVE_OBSERVABLES 0         /* set to 1 to save observables of each frame, see sub_ljobservables.c */
+#define OBSERVABLES_FILE "lj_observables.bin"  /* name of file containing observables */
+
+/* Parameters of SIR epidemic model */
+
+#define SIR_MODEL 0                /* set to 1 to simulate an SIR epidemic of moving agents instead of molecular dynamics */
+#define SIR_AGENTS 200000          /* number of agents */
+#define SIR_INITIAL_INFECTED 10    /* number of initially infected agents */
+#define SIR_PROTECTED 0.0          /* fraction of agents that cannot be infected */
+#define SIR_SPEED 0.0005           /* distance travelled by an agent in one time step */
+#define SIR_TURN_RATE 0.02         /* probability per time step of changing direction */
+#define SIR_INFECTION_RADIUS 0.004 /* distance below which agents are in contact */
+#define SIR_INFECTION_RATE 0.05    /* probability of infection per infected contact and time step */
+#define SIR_RECOVERY_RATE 0.001    /* probability of recovery per time step */
+#define SIR_SEED 1                 /* seed of random number generator */
+#define SIR_POINT_SIZE 1.0         /* size of points representing agents */
+#define SIR_COUNTS_FILE "sir_counts.dat"  /* name of file containing numbers of S, I, R agents */
+
 /* General geometrical parameters */
 
 #define WINWIDTH 1280 /* window width */
@@ -254,6 +288,7 @@
 #define TRAJECTORY_LENGTH 8000   /* length of recorded trajectory */
 #define TRACER_PARTICLE_MASS 4.0 /* relative mass of tracer particle */
 #define TRAJECTORY_WIDTH 3       /* width of tracer particle trajectory */
+#define TRAJECTORY_TOLERANCE 0.002  /* max deviation of simplified trajectory, set to 0 to keep all positions */
 
 #define POSITION_DEPENDENT_TYPE 0 /* set to 1 to make particle type depend on initial position */
 #define POSITION_Y_DEPENDENCE 0   /* set to 1 for the separation between particles to be vertical */
@@ -280,6 +315,8 @@
 #define HASHY 18             /* size of hashgrid in y direction */
 #define HASHMAX 100          /* maximal number of particles per hashgrid cell */
 #define HASHGRID_PADDING 0.1 /* padding of hashgrid outside simulation window */
+#define REORDER_PARTICLES 0   /* set to 1 to renumber particles along a Hilbert curve when memory locality degrades */
+#define REORDER_THRESHOLD 2.0 /* factor by which neighbour index spread may grow before reordering */
 
 #define DRAW_COLOR_SCHEME 0   /* set to 1 to plot the color scheme */
 #define COLORBAR_RANGE 8.0    /* scale of color scheme bar */
@@ -299,6 +336,11 @@ double vxwall = 0.0; /* x speed of wall (for BC_RECTANGLE_WALL b.c.) */
 #include "global_ljones.c"
 #include "sub_lj.c"
 #include "sub_hashgrid.c"
+#include "sub_ljdump.c"
+#include "sub_ljanalysis.c"
+#include "sub_ljobservables.c"
+#include "sub_sir.c"
+#include "sub_telemetry.c"
 
 /*********************/
 /* animation part    */
@@ -432,13 +474,16 @@ double gravity_schedule(int i, int j)
 double evolve_particles(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HASHX * HASHY],
                         double qx[NMAXCIRCLES], double qy[NMAXCIRCLES], double qangle[NMAXCIRCLES],
                         double px[NMAXCIRCLES], double py[NMAXCIRCLES], double pangle[NMAXCIRCLES],
-                        double beta, int *nactive, int *nsuccess, int *nmove)
+                        double beta, int *nactive, int *nsuccess, int *nmove, int observe, int couple)
+/* time step of thermostat algorithm, returns kinetic energy of particles coupled to thermostat */
+/* if observe is 1, observables are evaluated in the last pass over particles, in which      */
+/* particles are also coupled to the thermostat according to their position if couple is 1  */
 {
     double a, totalenergy = 0.0;
     static double b = 0.25 * SIGMA * SIGMA * DT_PARTICLE / MU_XI, xi = 0.0;
     int j, move;
 
-#pragma omp parallel for private(j, xi, totalenergy, a, move)
+#pragma omp parallel for private(j) reduction(+ : totalenergy)
     for (j = 0; j < ncircles; j++)
         if (particle[j].active)
         {
@@ -453,6 +498,8 @@ double evolve_particles(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HA
             particle[j].energy = (px[j] * px[j] + py[j] * py[j]) * particle[j].mass_inv;
             if ((COUPLE_ANGLE_TO_THERMOSTAT) && (particle[j].thermostat))
                 particle[j].energy += pangle[j] * pangle[j] * particle[j].inertia_moment_inv;
+            if (particle[j].thermostat)
+                totalenergy += particle[j].energy;
 
             qx[j] = particle[j].xc + 0.5 * DT_PARTICLE * px[j] * particle[j].mass_inv;
             qy[j] = particle[j].yc + 0.5 * DT_PARTICLE * py[j] * particle[j].mass_inv;
@@ -467,14 +514,6 @@ double evolve_particles(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HA
                 pangle[j] *= exp(-0.5 * DT_PARTICLE * xi);
         }
 
-    /* compute kinetic energy */
-    //     *nactive = 0;
-    for (j = 0; j < ncircles; j++)
-        if ((particle[j].active) && (particle[j].thermostat))
-        {
-            totalenergy += particle[j].energy;
-            //             *nactive++;
-        }
     totalenergy *= DIMENSION_FACTOR; /* normalize energy to take number of degrees of freedom into account */
     if (THERMOSTAT)
     {
@@ -484,6 +523,11 @@ double evolve_particles(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HA
     }
 
     move = 0;
+    if (observe)
+        reset_observables();
+
+    /* resampled particles are moved in the hashgrid, which is not done in parallel */
+#pragma omp parallel for if (!RESAMPLE_Y) private(j) reduction(+ : move)
     for (j = 0; j < ncircles; j++)
         if (particle[j].active)
         {
@@ -546,8 +590,17 @@ double evolve_particles(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HA
             //                     compute_relative_positions(particle, hashgrid);
             //                     update_hashgrid(particle, hashgrid, 0);   /* REDUNDANT ? */
             //                 }
+
+            if (observe)
+            {
+                if (couple)
+                    particle[j].thermostat = (particle[j].xc > xshift + PARTIAL_THERMO_SHIFT);
+                observe_particle(&particle[j]);
+            }
         }
 
+    if (observe)
+        reduce_observables();
     return (totalenergy);
 }
 
@@ -585,96 +638,189 @@ void evolve_wall(double fboundary)
     //     printf("fboundary = %.3lg, xwall = %.3lg, vxwall = %.3lg\n", fboundary, xwall, vxwall);
 }
 
-void animation()
+/*********************/
+/* simulation core   */
+/*********************/
+
+/* The simulation is initialised and advanced by the functions below, which make no     */
+/* OpenGL calls, so that it can also run without window (option HEADLESS). Particles,   */
+/* obstacles and trajectories are observed by reading the arrays of t_lj_sim directly,  */
+/* and the quantities of the last frame by reading its other fields.                   */
+
+typedef struct
+{
+    t_particle *particle;       /* particles */
+    t_obstacle *obstacle;       /* obstacles */
+    t_trail *trail;             /* trajectories of tracer particles */
+    t_hashgrid *hashgrid;       /* hashgrid */
+    double *qx, *qy, *px, *py, *qangle, *pangle;    /* variables of thermostat algorithm */
+    double *pressure;           /* pressures, for RECORD_PRESSURES */
+    int tracer_n[N_TRACER_PARTICLES];   /* indices of tracer particles */
+    int frame;                  /* number of frames computed */
+    int pending;                /* has value 1 if configuration changes of last frame are pending */
+    int nactive, nadd_particle, nmove, nsuccess;
+    int wall;                   /* has value 1 if wall is present, for BC_RECTANGLE_WALL */
+    double krepel, beta, gravity, xmincontainer, xmaxcontainer; /* scheduled parameters */
+    double totalenergy, mean_energy;        /* energies in last frame */
+    double fboundary, pleft, pright;        /* forces on boundary in last frame */
+    double observable[OBS_MAXNUMBER];       /* observables of last frame */
+} t_lj_sim;
+
+int obs_energy, obs_max_energy, obs_thermostat, obs_neighbours, obs_left[2];   /* indices of observables */
+
+void init_lj_observables()
+/* register observables evaluated at each frame, further observables can be added here */
+{
+    if (nobservables > 0)
+        return;
+    obs_energy = register_observable("mean_energy", OBS_MEAN, map_kinetic_energy);
+    obs_max_energy = register_observable("max_energy", OBS_MAX, map_kinetic_energy);
+    obs_thermostat = register_observable("thermostat", OBS_SUM, map_thermostat);
+    obs_neighbours = register_observable("neighbours", OBS_MEAN, map_neighbours);
+    obs_left[0] = register_observable("left_fraction_0", OBS_MEAN, map_left_type0);
+    obs_left[1] = register_observable("left_fraction_1", OBS_MEAN, map_left_type1);
+}
+
+void alloc_lj_sim(t_lj_sim *sim)
+/* allocate particles, obstacles, trajectories and hashgrid */
 {
-    double time, scale, diss, rgb[3], dissip, gradient[2], x, y, dx, dy, dt, xleft, xright, a, b,
-        length, fx, fy, force[2], totalenergy = 0.0, krepel = KREPEL, pos[2], prop, vx,
-                                  beta = BETA, xi = 0.0, xmincontainer = BCXMIN, xmaxcontainer = BCXMAX, torque, torque_ij,
-                                  fboundary = 0.0, pleft = 0.0, pright = 0.0, entropy[2], mean_energy, gravity = GRAVITY;
-    double *qx, *qy, *px, *py, *qangle, *pangle, *pressure;
-    int i, j, k, n, m, s, ij[2], i0, iplus, iminus, j0, jplus, jminus, p, q, p1, q1, p2, q2, total_neighbours = 0,
-                                                                                             min_nb, max_nb, close, wrapx = 0, wrapy = 0, nactive = 0, nadd_particle = 0, nmove = 0, nsuccess = 0,
-                                                                                             tracer_n[N_TRACER_PARTICLES], traj_position = 0, traj_length = 0, move = 0, old, m0, floor, nthermo, wall = 0;
-    static int imin, imax;
-    static short int first = 1;
-    t_particle *particle;
-    t_obstacle *obstacle;
-    t_tracer *trajectory;
-    t_hashgrid *hashgrid;
-    char message[100];
-
-    particle = (t_particle *)malloc(NMAXCIRCLES * sizeof(t_particle)); /* particles */
+    int j;
+
+    sim->particle = (t_particle *)malloc(NMAXCIRCLES * sizeof(t_particle)); /* particles */
     if (ADD_FIXED_OBSTACLES)
-        obstacle = (t_obstacle *)malloc(NMAXOBSTACLES * sizeof(t_obstacle)); /* obstacles */
+        sim->obstacle = (t_obstacle *)malloc(NMAXOBSTACLES * sizeof(t_obstacle)); /* obstacles */
 
     if (TRACER_PARTICLE)
-        trajectory = (t_tracer *)malloc(TRAJECTORY_LENGTH * N_TRACER_PARTICLES * sizeof(t_tracer));
+    {
+        sim->trail = (t_trail *)malloc(N_TRACER_PARTICLES * sizeof(t_trail));
+        for (j = 0; j < N_TRACER_PARTICLES; j++)
+            init_trail(&sim->trail[j]);
+    }
 
-    hashgrid = (t_hashgrid *)malloc(HASHX * HASHY * sizeof(t_hashgrid)); /* hashgrid */
+    sim->hashgrid = (t_hashgrid *)malloc(HASHX * HASHY * sizeof(t_hashgrid)); /* hashgrid */
 
-    qx = (double *)malloc(NMAXCIRCLES * sizeof(double));
-    qy = (double *)malloc(NMAXCIRCLES * sizeof(double));
-    px = (double *)malloc(NMAXCIRCLES * sizeof(double));
-    py = (double *)malloc(NMAXCIRCLES * sizeof(double));
-    qangle = (double *)malloc(NMAXCIRCLES * sizeof(double));
-    pangle = (double *)malloc(NMAXCIRCLES * sizeof(double));
-    pressure = (double *)malloc(N_PRESSURES * sizeof(double));
+    sim->qx = (double *)malloc(NMAXCIRCLES * sizeof(double));
+    sim->qy = (double *)malloc(NMAXCIRCLES * sizeof(double));
+    sim->px = (double *)malloc(NMAXCIRCLES * sizeof(double));
+    sim->py = (double *)malloc(NMAXCIRCLES * sizeof(double));
+    sim->qangle = (double *)malloc(NMAXCIRCLES * sizeof(double));
+    sim->pangle = (double *)malloc(NMAXCIRCLES * sizeof(double));
+    sim->pressure = (double *)malloc(N_PRESSURES * sizeof(double));
+}
+
+void init_lj_sim(t_lj_sim *sim)
+/* allocate particles, and initialise configuration and output files */
+{
+    int i;
+
+    alloc_lj_sim(sim);
+    init_lj_observables();
+
+    sim->frame = 0;
+    sim->pending = 0;
+    sim->nadd_particle = 0;
+    sim->nmove = 0;
+    sim->nsuccess = 0;
+    sim->wall = 0;
+    sim->krepel = KREPEL;
+    sim->beta = BETA;
+    sim->gravity = GRAVITY;
+    sim->xmincontainer = BCXMIN;
+    sim->xmaxcontainer = BCXMAX;
+    sim->totalenergy = 0.0;
+    sim->mean_energy = 0.0;
+    sim->fboundary = 0.0;
+    sim->pleft = 0.0;
+    sim->pright = 0.0;
+    for (i = 0; i < nobservables; i++)
+        sim->observable[i] = 0.0;
 
     /* initialise positions and radii of circles */
-    init_particle_config(particle);
-    init_hashgrid(hashgrid);
+    init_particle_config(sim->particle);
+    init_hashgrid(sim->hashgrid);
 
     xshift = OBSTACLE_XMIN;
 
     if (ADD_FIXED_OBSTACLES)
-        init_obstacle_config(obstacle);
+        init_obstacle_config(sim->obstacle);
 
     if (RECORD_PRESSURES)
         for (i = 0; i < N_PRESSURES; i++)
-            pressure[i] = 0.0;
+            sim->pressure[i] = 0.0;
 
-    printf("1\n");
+    sim->nactive = initialize_configuration(sim->particle, sim->hashgrid, sim->obstacle, sim->px, sim->py, sim->pangle, sim->tracer_n);
 
-    nactive = initialize_configuration(particle, hashgrid, obstacle, px, py, pangle, tracer_n);
+    update_hashgrid(sim->particle, sim->hashgrid, 1);
+    compute_relative_positions(sim->particle, sim->hashgrid);
 
-    //     xi = 0.0;
+    if (SAVE_DUMP_FILE)
+        open_dump_file(DUMP_FILE, TRACER_PARTICLE * N_TRACER_PARTICLES, RECORD_PRESSURES * N_PRESSURES);
+    if (STRUCTURE_ANALYSIS)
+        open_analysis_file(ANALYSIS_FILE);
+    if (SAVE_OBSERVABLES)
+        open_observables_file(OBSERVABLES_FILE);
+}
 
-    //     for (i=0; i<ncircles; i++)
-    //     {
-    //         printf("Particle %i at (%.3f, %.3f) of energy %.3f\n", i, particle[i].xc, particle[i].yc, particle[i].energy);
-    //     }
-    sleep(1);
+void update_lj_configuration(t_lj_sim *sim)
+/* add particles and reorder them, after the last frame has been observed */
+{
+    t_particle *particle = sim->particle;
+    t_hashgrid *hashgrid = sim->hashgrid;
+    double *qx = sim->qx, *qy = sim->qy, *px = sim->px, *py = sim->py, *qangle = sim->qangle, *pangle = sim->pangle;
+    int *tracer_n = sim->tracer_n;
+    int i = sim->frame - 1; /* last frame */
 
-    update_hashgrid(particle, hashgrid, 1);
-    compute_relative_positions(particle, hashgrid);
+    /* add a particle */
+    if ((ADD_PARTICLES) && ((i - INITIAL_TIME - ADD_TIME + 1) % ADD_PERIOD == 0) && (i < NSTEPS - FINAL_NOADD_PERIOD))
+        sim->nadd_particle = add_particles(particle, px, py, sim->nadd_particle);
 
-    blank();
-    //     glColor3f(0.0, 0.0, 0.0);
+    update_hashgrid(particle, hashgrid, 1);
 
-    glutSwapBuffers();
+    if (REORDER_PARTICLES)
+        update_particle_order(particle, hashgrid, px, py, pangle, qx, qy, qangle, tracer_n);
 
-    sleep(SLEEP1);
+    sim->pending = 0;
+}
 
-    for (i = 0; i <= INITIAL_TIME + NSTEPS; i++)
+void step_lj_sim(t_lj_sim *sim, int nframes)
+/* advance simulation by nframes frames of NVID time steps */
+/* the configuration is only changed at the start of the next step, so that the last */
+/* frame can be drawn and saved to the dump file consistently                         */
+{
+    t_particle *particle = sim->particle;
+    t_obstacle *obstacle = sim->obstacle;
+    t_hashgrid *hashgrid = sim->hashgrid;
+    double *qx = sim->qx, *qy = sim->qy, *px = sim->px, *py = sim->py, *qangle = sim->qangle, *pangle = sim->pangle;
+    double *pressure = sim->pressure;
+    int *tracer_n = sim->tracer_n;
+    int i, j, n, frame, nthermo, floor, couple;
+    t_dump_frame dump;
+
+    for (frame = 0; frame < nframes; frame++)
     {
+        if (sim->pending)
+            update_lj_configuration(sim);
+
+        i = sim->frame;
         printf("Computing frame %d\n", i);
 
         if (INCREASE_KREPEL)
-            krepel = repel_schedule(i);
+            sim->krepel = repel_schedule(i);
         if (INCREASE_BETA)
-            beta = temperature_schedule(i);
+            sim->beta = temperature_schedule(i);
         if (DECREASE_CONTAINER_SIZE)
         {
-            xmincontainer = container_size_schedule(i);
+            sim->xmincontainer = container_size_schedule(i);
             if (SYMMETRIC_DECREASE)
-                xmaxcontainer = -container_size_schedule(i);
+                sim->xmaxcontainer = -container_size_schedule(i);
         }
 
-        blank();
+        /* particles are coupled to thermostat according to their position at the end of the frame */
+        couple = ((PARTIAL_THERMO_COUPLING) && (i > N_T_AVERAGE));
 
-        fboundary = 0.0;
-        pleft = 0.0;
-        pright = 0.0;
+        sim->fboundary = 0.0;
+        sim->pleft = 0.0;
+        sim->pright = 0.0;
         if (RECORD_PRESSURES)
             for (j = 0; j < N_PRESSURES; j++)
                 pressure[j] = 0.0;
@@ -683,17 +829,19 @@ void animation()
         {
             if (MOVE_OBSTACLE)
             {
-                xmincontainer = obstacle_schedule_smooth(i, n);
-                xshift = xmincontainer;
+                sim->xmincontainer = obstacle_schedule_smooth(i, n);
+                xshift = sim->xmincontainer;
             }
             if (INCREASE_GRAVITY)
-                gravity = gravity_schedule(i, n);
+                sim->gravity = gravity_schedule(i, n);
             if ((BOUNDARY_COND == BC_RECTANGLE_WALL) && (i < INITIAL_TIME + WALL_TIME))
-                wall = 1;
+                sim->wall = 1;
             else
-                wall = 0;
+                sim->wall = 0;
 
             compute_relative_positions(particle, hashgrid);
+            if ((STRUCTURE_ANALYSIS) && ((i * NVID + n) % ANALYSIS_STEPS == 0))
+                analyse_structure(i * NVID + n, particle);
             update_hashgrid(particle, hashgrid, 0);
 
             /* compute forces on particles */
@@ -705,14 +853,14 @@ void animation()
                     particle[j].torque = 0.0;
 
                     /* compute force from other particles */
-                    compute_particle_force(j, krepel, particle, hashgrid);
+                    compute_particle_force(j, sim->krepel, particle, hashgrid);
 
                     /* take care of boundary conditions */
-                    fboundary += compute_boundary_force(j, particle, obstacle, xmincontainer, xmaxcontainer, &pleft, &pright, pressure, wall);
+                    sim->fboundary += compute_boundary_force(j, particle, obstacle, sim->xmincontainer, sim->xmaxcontainer, &sim->pleft, &sim->pright, pressure, sim->wall);
 
                     /* add gravity */
                     if (INCREASE_GRAVITY)
-                        particle[j].fy -= gravity;
+                        particle[j].fy -= sim->gravity;
                     else
                         particle[j].fy -= GRAVITY;
 
@@ -734,29 +882,33 @@ void animation()
                 }
 
             /* timestep of thermostat algorithm */
-            totalenergy = evolve_particles(particle, hashgrid, qx, qy, qangle, px, py, pangle, beta, &nactive, &nsuccess, &nmove);
+            sim->totalenergy = evolve_particles(particle, hashgrid, qx, qy, qangle, px, py, pangle, sim->beta, &sim->nactive,
+                                                &sim->nsuccess, &sim->nmove, (n == NVID - 1), couple);
 
             /* evolution of lid coordinate */
             if (BOUNDARY_COND == BC_RECTANGLE_LID)
-                evolve_lid(fboundary);
+                evolve_lid(sim->fboundary);
             if (BOUNDARY_COND == BC_RECTANGLE_WALL)
             {
                 if (i < INITIAL_TIME + WALL_TIME)
-                    evolve_wall(fboundary);
+                    evolve_wall(sim->fboundary);
                 else
                     xwall = 0.0;
             }
         } /* end of for (n=0; n<NVID; n++) */
 
-        //         if ((PARTIAL_THERMO_COUPLING))
-        if ((PARTIAL_THERMO_COUPLING) && (i > N_T_AVERAGE))
+        memcpy(sim->observable, observable_value, nobservables * sizeof(double));
+        if (SAVE_OBSERVABLES)
+            write_observables(i, sim->nactive);
+
+        if (couple)
         {
-            nthermo = partial_thermostat_coupling(particle, xshift + PARTIAL_THERMO_SHIFT);
-            printf("%i particles coupled to thermostat out of %i active\n", nthermo, nactive);
-            mean_energy = compute_mean_energy(particle);
+            nthermo = (int)sim->observable[obs_thermostat];
+            printf("%i particles coupled to thermostat out of %i active\n", nthermo, sim->nactive);
+            sim->mean_energy = sim->observable[obs_energy];
         }
         else
-            mean_energy = totalenergy / (double)ncircles;
+            sim->mean_energy = sim->totalenergy / (double)ncircles;
 
         if (CENTER_PX)
             center_momentum(px);
@@ -784,72 +936,424 @@ void animation()
         if ((TRACER_PARTICLE) && (i > INITIAL_TIME))
         {
             for (j = 0; j < N_TRACER_PARTICLES; j++)
-            {
-                trajectory[j * TRAJECTORY_LENGTH + traj_position].xc = particle[tracer_n[j]].xc;
-                trajectory[j * TRAJECTORY_LENGTH + traj_position].yc = particle[tracer_n[j]].yc;
-            }
-            traj_position++;
-            if (traj_position >= TRAJECTORY_LENGTH)
-                traj_position = 0;
-            traj_length++;
-            if (traj_length >= TRAJECTORY_LENGTH)
-                traj_length = TRAJECTORY_LENGTH - 1;
-            //             for (j=0; j<traj_length; j++)
-            //                 printf("Trajectory[%i] = (%.3lg, %.3lg)\n", j, trajectory[j].xc, trajectory[j].yc);
+                add_trail_point(&sim->trail[j], particle[tracer_n[j]].xc, particle[tracer_n[j]].yc, i);
         }
 
-        printf("Mean kinetic energy: %.3f\n", totalenergy / (double)ncircles);
-        printf("Boundary force: %.3f\n", fboundary / (double)(ncircles * NVID));
+        printf("Mean kinetic energy: %.3f\n", sim->totalenergy / (double)ncircles);
+        printf("Boundary force: %.3f\n", sim->fboundary / (double)(ncircles * NVID));
         if (RESAMPLE_Y)
-            printf("%i succesful moves out of %i trials\n", nsuccess, nmove);
+            printf("%i succesful moves out of %i trials\n", sim->nsuccess, sim->nmove);
         if (INCREASE_GRAVITY)
-            printf("Gravity: %.3f\n", gravity);
+            printf("Gravity: %.3f\n", sim->gravity);
 
-        total_neighbours = 0;
-        min_nb = 100;
-        max_nb = 0;
-        for (j = 0; j < ncircles; j++)
-            if (particle[j].active)
+        //         printf("Mean number of neighbours: %.3f\n", sim->observable[obs_neighbours]);
+
+        if ((SAVE_DUMP_FILE) && (i >= INITIAL_TIME))
+        {
+            dump.frame = i - INITIAL_TIME;
+            dump.wall = sim->wall;
+            dump.beta = sim->beta;
+            dump.mean_energy = sim->mean_energy;
+            dump.krepel = sim->krepel;
+            dump.xmincontainer = sim->xmincontainer;
+            dump.xmaxcontainer = sim->xmaxcontainer;
+            dump.boundary_force = sim->fboundary / (double)(ncircles * NVID);
+            dump.gravity = sim->gravity;
+            dump.pleft = sim->pleft;
+            dump.pright = sim->pright;
+            dump.xshift = xshift;
+            dump.ylid = ylid;
+            dump.xwall = xwall;
+            write_dump_frame(&dump, particle, tracer_n, TRACER_PARTICLE * N_TRACER_PARTICLES,
+                             pressure, RECORD_PRESSURES * N_PRESSURES);
+        }
+
+        sim->frame++;
+        sim->pending = 1;
+    }
+}
+
+void free_lj_arrays(t_lj_sim *sim)
+/* free arrays allocated by alloc_lj_sim() */
+{
+    free(sim->particle);
+    if (ADD_FIXED_OBSTACLES)
+        free(sim->obstacle);
+    if (TRACER_PARTICLE)
+        free(sim->trail);
+    free(sim->hashgrid);
+    free(sim->qx);
+    free(sim->qy);
+    free(sim->px);
+    free(sim->py);
+    free(sim->qangle);
+    free(sim->pangle);
+    free(sim->pressure);
+}
+
+void free_lj_sim(t_lj_sim *sim)
+/* free particles, and close output files */
+{
+    if (SAVE_DUMP_FILE)
+        close_dump_file();
+    if (STRUCTURE_ANALYSIS)
+        close_analysis_file();
+    if (SAVE_OBSERVABLES)
+        close_observables_file();
+
+    free_lj_arrays(sim);
+}
+
+void publish_lj_telemetry(t_lj_sim *sim, int frame)
+/* end of frame for telemetry - frame is the number of frames computed so far */
+{
+    telemetry_value(0, "energy", sim->mean_energy);
+    telemetry_value(1, "temperature", 1.0 / sim->beta);
+    telemetry_value(2, "krepel", sim->krepel);
+    telemetry_value(3, "fboundary", sim->fboundary / (double)(ncircles * NVID));
+    telemetry_value(4, "active", (double)sim->nactive);
+    telemetry_frame(frame, (long)frame * (long)NVID, (double)frame * (double)NVID * DT_PARTICLE);
+}
+
+void headless_run()
+/* run the simulation without window, e.g. to save a dump file for lj_render */
+{
+    t_lj_sim sim;
+    int i;
+
+    if (SIR_MODEL)
+    {
+        printf("HEADLESS runs are not available for SIR_MODEL\n");
+        return;
+    }
+    if ((!SAVE_DUMP_FILE) && (!STRUCTURE_ANALYSIS))
+        printf("Warning: HEADLESS run saves neither dump file nor structure analysis\n");
+
+    init_lj_sim(&sim);
+    if (TELEMETRY)
+        telemetry_open("lennardjones", INITIAL_TIME + NSTEPS + 1);
+    for (i = 0; i <= INITIAL_TIME + NSTEPS; i++)
+    {
+        telemetry_phase(TM_COMPUTE);
+        step_lj_sim(&sim, 1);
+        publish_lj_telemetry(&sim, sim.frame);
+    }
+    telemetry_close();
+    printf("%i active particles\n", sim.nactive);
+    free_lj_sim(&sim);
+}
+
+/*********************/
+/* concurrent drawing */
+/*********************/
+
+/* With ASYNC_RENDER, the simulation runs in a child process, which publishes at each  */
+/* frame boundary a snapshot of the state needed for drawing into one of RENDER_QUEUE  */
+/* slots in shared memory, and then computes the next frame while the window process   */
+/* draws and saves this one. Slot numbers are passed through two pipes, so that the     */
+/* simulation waits when it is RENDER_QUEUE frames ahead. Neighbour lists of particles  */
+/* are not copied, they are recomputed by the window process when bonds are drawn, so */
+/* that bonds join the positions of the frame, as in lj_render.                         */
+/* The child is forked before the window process uses OpenMP, whose thread pool does    */
+/* not survive fork().                                                                  */
+
+#define SNAP_HEAD (offsetof(t_particle, hashneighbour))             /* size of fields before neighbour lists */
+#define SNAP_TAIL (sizeof(t_particle) - offsetof(t_particle, type)) /* size of fields after neighbour lists */
+#define SNAP_PARTICLE (SNAP_HEAD + SNAP_TAIL)
+
+typedef struct
+{
+    int frame, ncircles, nactive, wall;
+    int traj_time;              /* frame of last tracer positions, -1 if none */
+    double krepel, beta, gravity, xmincontainer, xmaxcontainer;
+    double totalenergy, mean_energy, fboundary, pleft, pright;
+    double xshift, xspeed, ylid, xwall;     /* global variables used by drawing routines */
+    double pressure[N_PRESSURES];
+    double observable[OBS_MAXNUMBER];
+    t_tracer tracer[N_TRACER_PARTICLES];    /* last positions of tracer particles */
+} t_lj_snapshot;
+
+typedef struct
+{
+    char *data;                 /* RENDER_QUEUE slots in shared memory */
+    size_t slot_size;           /* size of a slot: snapshot, followed by ncircles particles */
+    int filled[2], empty[2];    /* pipes passing numbers of filled and empty slots */
+    pid_t pid;                  /* simulation process */
+} t_render_queue;
+
+void send_lj_snapshot(t_render_queue *queue, t_lj_sim *sim)
+/* copy state of last frame into an empty slot, waiting for one if necessary */
+{
+    int i, j, slot;
+    char *p;
+    t_lj_snapshot *snap;
+    t_trail_chunk *chunk;
+
+    if (read(queue->empty[0], &slot, sizeof(int)) != sizeof(int))
+        return; /* window process has stopped */
+    snap = (t_lj_snapshot *)(queue->data + slot * queue->slot_size);
+
+    snap->frame = sim->frame - 1;
+    snap->ncircles = ncircles;
+    snap->nactive = sim->nactive;
+    snap->wall = sim->wall;
+    snap->krepel = sim->krepel;
+    snap->beta = sim->beta;
+    snap->gravity = sim->gravity;
+    snap->xmincontainer = sim->xmincontainer;
+    snap->xmaxcontainer = sim->xmaxcontainer;
+    snap->totalenergy = sim->totalenergy;
+    snap->mean_energy = sim->mean_energy;
+    snap->fboundary = sim->fboundary;
+    snap->pleft = sim->pleft;
+    snap->pright = sim->pright;
+    snap->xshift = xshift;
+    snap->xspeed = xspeed;
+    snap->ylid = ylid;
+    snap->xwall = xwall;
+    if (RECORD_PRESSURES)
+        memcpy(snap->pressure, sim->pressure, N_PRESSURES * sizeof(double));
+    memcpy(snap->observable, sim->observable, OBS_MAXNUMBER * sizeof(double));
+
+    /* trajectories grow by at most one point per frame, which is passed to the window process */
+    snap->traj_time = -1;
+    if (TRACER_PARTICLE)
+    {
+        snap->traj_time = sim->trail[0].time;
+        for (j = 0; j < N_TRACER_PARTICLES; j++)
+            if (sim->trail[j].nchunks > 0)
             {
-                total_neighbours += particle[j].neighb;
-                if (particle[j].neighb > max_nb)
-                    max_nb = particle[j].neighb;
-                if (particle[j].neighb < min_nb)
-                    min_nb = particle[j].neighb;
+                chunk = &sim->trail[j].chunk[(sim->trail[j].first + sim->trail[j].nchunks - 1) % TRAIL_NCHUNKS];
+                snap->tracer[j].xc = chunk->point[chunk->npoints - 1].xc;
+                snap->tracer[j].yc = chunk->point[chunk->npoints - 1].yc;
             }
-        //         printf("Mean number of neighbours: %.3f\n", (double)total_neighbours/(double)ncircles);
-        //         printf("Min number of neighbours: %i\n", min_nb);
-        //         printf("Max number of neighbours: %i\n", max_nb);
+    }
 
-        if (TRACER_PARTICLE)
-            draw_trajectory(trajectory, traj_position, traj_length);
-        draw_particles(particle, PLOT);
-        draw_container(xmincontainer, xmaxcontainer, obstacle, wall);
+    p = (char *)(snap + 1);
+#pragma omp parallel for private(i)
+    for (i = 0; i < ncircles; i++)
+    {
+        memcpy(p + i * SNAP_PARTICLE, &sim->particle[i], SNAP_HEAD);
+        memcpy(p + i * SNAP_PARTICLE + SNAP_HEAD, &sim->particle[i].type, SNAP_TAIL);
+    }
+
+    if (write(queue->filled[1], &slot, sizeof(int)) != sizeof(int))
+        printf("Error: cannot pass frame %i to window process\n", snap->frame);
+}
 
-        /* add a particle */
-        if ((ADD_PARTICLES) && ((i - INITIAL_TIME - ADD_TIME + 1) % ADD_PERIOD == 0) && (i < NSTEPS - FINAL_NOADD_PERIOD))
-            nadd_particle = add_particles(particle, px, py, nadd_particle);
+void receive_lj_snapshot(t_render_queue *queue, t_lj_sim *sim)
+/* copy state of next frame into sim and into global variables, waiting for it if necessary */
+{
+    int i, j, slot;
+    char *p;
+    t_lj_snapshot *snap;
 
-        update_hashgrid(particle, hashgrid, 1);
+    if (read(queue->filled[0], &slot, sizeof(int)) != sizeof(int))
+    {
+        printf("Error: simulation process has stopped\n");
+        exit(1);
+    }
+    snap = (t_lj_snapshot *)(queue->data + slot * queue->slot_size);
+
+    sim->frame = snap->frame + 1;
+    ncircles = snap->ncircles;
+    sim->nactive = snap->nactive;
+    sim->wall = snap->wall;
+    sim->krepel = snap->krepel;
+    sim->beta = snap->beta;
+    sim->gravity = snap->gravity;
+    sim->xmincontainer = snap->xmincontainer;
+    sim->xmaxcontainer = snap->xmaxcontainer;
+    sim->totalenergy = snap->totalenergy;
+    sim->mean_energy = snap->mean_energy;
+    sim->fboundary = snap->fboundary;
+    sim->pleft = snap->pleft;
+    sim->pright = snap->pright;
+    xshift = snap->xshift;
+    xspeed = snap->xspeed;
+    ylid = snap->ylid;
+    xwall = snap->xwall;
+    if (RECORD_PRESSURES)
+        memcpy(sim->pressure, snap->pressure, N_PRESSURES * sizeof(double));
+    memcpy(sim->observable, snap->observable, OBS_MAXNUMBER * sizeof(double));
+
+    if ((TRACER_PARTICLE) && (snap->traj_time > sim->trail[0].time))
+        for (j = 0; j < N_TRACER_PARTICLES; j++)
+            add_trail_point(&sim->trail[j], snap->tracer[j].xc, snap->tracer[j].yc, snap->traj_time);
+
+    p = (char *)(snap + 1);
+#pragma omp parallel for private(i)
+    for (i = 0; i < ncircles; i++)
+    {
+        memcpy(&sim->particle[i], p + i * SNAP_PARTICLE, SNAP_HEAD);
+        memcpy(&sim->particle[i].type, p + i * SNAP_PARTICLE + SNAP_HEAD, SNAP_TAIL);
+        sim->particle[i].hash_nneighb = 0;
+    }
 
-        print_parameters(beta, mean_energy, krepel, xmaxcontainer - xmincontainer,
-                         fboundary / (double)(ncircles * NVID), 0, pressure, gravity);
-        if ((BOUNDARY_COND == BC_EHRENFEST) || (BOUNDARY_COND == BC_RECTANGLE_WALL))
-            print_ehrenfest_parameters(particle, pleft, pright);
-        else if (PRINT_PARTICLE_NUMBER)
-            print_particle_number(ncircles);
+    /* the slot can be reused as soon as it has been copied */
+    if (write(queue->empty[1], &slot, sizeof(int)) != sizeof(int))
+        printf("Error: cannot release frame %i\n", snap->frame);
 
-        if ((i > INITIAL_TIME + WALL_TIME) && (PRINT_ENTROPY))
+    if ((PLOT == P_BONDS) || ((DOUBLE_MOVIE) && (PLOT_B == P_BONDS)))
+    {
+        update_hashgrid(sim->particle, sim->hashgrid, 0);
+        compute_relative_positions(sim->particle, sim->hashgrid);
+    }
+}
+
+void start_render_queue(t_render_queue *queue, t_lj_sim *sim)
+/* fork simulation process, which computes all frames and passes them through queue; */
+/* sim receives the arrays into which the window process copies the frames           */
+{
+    int i, slot;
+
+    queue->slot_size = sizeof(t_lj_snapshot) + NMAXCIRCLES * SNAP_PARTICLE;
+    queue->slot_size = (queue->slot_size + 63) / 64 * 64;
+    queue->data = (char *)mmap(NULL, RENDER_QUEUE * queue->slot_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if ((queue->data == MAP_FAILED) || (pipe(queue->filled) < 0) || (pipe(queue->empty) < 0))
+    {
+        printf("Error: cannot create queue of frames\n");
+        exit(1);
+    }
+    for (slot = 0; slot < RENDER_QUEUE; slot++)
+        if (write(queue->empty[1], &slot, sizeof(int)) != sizeof(int))
+            exit(1);
+
+    fflush(stdout);
+    queue->pid = fork();
+    if (queue->pid < 0)
+    {
+        printf("Error: cannot start simulation process\n");
+        exit(1);
+    }
+    if (queue->pid == 0)
+    {
+        close(queue->filled[0]);
+        close(queue->empty[1]);
+
+        init_lj_sim(sim);
+        for (i = 0; i <= INITIAL_TIME + NSTEPS; i++)
         {
-            compute_entropy(particle, entropy);
-            printf("Entropy 1 = %.5lg, Entropy 2 = %.5lg\n", entropy[0], entropy[1]);
-            print_entropy(entropy);
+            step_lj_sim(sim, 1);
+            send_lj_snapshot(queue, sim);
+        }
+        free_lj_sim(sim);
+        close(queue->filled[1]);
+
+        /* wait until the window process has released all slots and closed the queue */
+        while (read(queue->empty[0], &slot, sizeof(int)) == sizeof(int));
+        close(queue->empty[0]);
+        fflush(stdout);
+        _exit(0); /* do not run exit handlers of the window system */
+    }
+
+    close(queue->filled[1]);
+    close(queue->empty[0]);
+
+    alloc_lj_sim(sim);
+    init_lj_observables();
+    init_hashgrid(sim->hashgrid);
+    if (ADD_FIXED_OBSTACLES)
+        init_obstacle_config(sim->obstacle);
+    sim->pending = 0;
+
+    printf("Simulation running in process %i, up to %i frames ahead\n", (int)queue->pid, RENDER_QUEUE);
+}
+
+void stop_render_queue(t_render_queue *queue, t_lj_sim *sim)
+/* wait for simulation process, and free window process arrays */
+{
+    int status;
+
+    close(queue->filled[0]);
+    close(queue->empty[1]);
+    waitpid(queue->pid, &status, 0);
+    munmap(queue->data, RENDER_QUEUE * queue->slot_size);
+    free_lj_arrays(sim);
+}
+
+/*********************/
+/* window front-end  */
+/*********************/
+
+void animation()
+{
+    double entropy[2];
+    int i, s;
+    int view_plot[2] = {PLOT, PLOT_B}, nviews;
+    static t_layer hud_layer[1];
+    t_particle_view *view[2];
+    t_lj_sim sim;
+    t_render_queue queue;
+
+    view[0] = (t_particle_view *)malloc(NMAXCIRCLES * sizeof(t_particle_view)); /* particle colors for PLOT */
+    if (DOUBLE_MOVIE)
+        view[1] = (t_particle_view *)malloc(NMAXCIRCLES * sizeof(t_particle_view)); /* particle colors for PLOT_B */
+
+    printf("1\n");
+
+    if (ASYNC_RENDER)
+        start_render_queue(&queue, &sim);
+    else
+        init_lj_sim(&sim);
+
+    sleep(1);
+
+    blank();
+    //     glColor3f(0.0, 0.0, 0.0);
+
+    glutSwapBuffers();
+
+    sleep(SLEEP1);
+
+    /* with ASYNC_RENDER, the computing phase is the time spent waiting for snapshots */
+    if (TELEMETRY)
+        telemetry_open("lennardjones", INITIAL_TIME + NSTEPS + 1);
+
+    for (i = 0; i <= INITIAL_TIME + NSTEPS; i++)
+    {
+        telemetry_phase(TM_COMPUTE);
+        if (ASYNC_RENDER)
+            receive_lj_snapshot(&queue, &sim);
+        else
+            step_lj_sim(&sim, 1);
+
+        telemetry_phase(TM_DRAW);
+        blank();
+
+        /* colors of particles for both movies of DOUBLE_MOVIE are computed in one sweep */
+        nviews = 1 + ((MOVIE) && (DOUBLE_MOVIE) && (i >= INITIAL_TIME));
+        compute_particle_views(sim.particle, nviews, view_plot, view);
+
+        if (TRACER_PARTICLE)
+            draw_trails(sim.trail);
+        draw_particle_view(sim.particle, PLOT, view[0]);
+        draw_container(sim.xmincontainer, sim.xmaxcontainer, sim.obstacle, sim.wall);
+
+        /* text is recorded in a layer, which is replayed for the second movie */
+        if (begin_layer(hud_layer, 1, (unsigned long)i))
+        {
+            print_parameters(sim.beta, sim.mean_energy, sim.krepel, sim.xmaxcontainer - sim.xmincontainer,
+                             sim.fboundary / (double)(ncircles * NVID), 0, sim.pressure, sim.gravity);
+            if ((BOUNDARY_COND == BC_EHRENFEST) || (BOUNDARY_COND == BC_RECTANGLE_WALL))
+                print_ehrenfest_parameters(sim.particle, sim.pleft, sim.pright);
+            else if (PRINT_PARTICLE_NUMBER)
+                print_particle_number(ncircles);
+
+            if ((i > INITIAL_TIME + WALL_TIME) && (PRINT_ENTROPY))
+            {
+                compute_mixing_entropy(sim.observable[obs_left[0]], sim.observable[obs_left[1]], entropy);
+                printf("Entropy 1 = %.5lg, Entropy 2 = %.5lg\n", entropy[0], entropy[1]);
+                print_entropy(entropy);
+            }
+            end_layer(hud_layer, 1);
         }
 
         glutSwapBuffers();
 
         if (MOVIE)
         {
+            telemetry_phase(TM_SAVE);
             if (i >= INITIAL_TIME)
             {
                 save_frame_lj();
@@ -863,16 +1367,21 @@ void animation()
 
             if ((i >= INITIAL_TIME) && (DOUBLE_MOVIE))
             {
+                blank();
                 if (TRACER_PARTICLE)
-                    draw_trajectory(trajectory, traj_position, traj_length);
-                draw_particles(particle, PLOT_B);
-                draw_container(xmincontainer, xmaxcontainer, obstacle, wall);
-                print_parameters(beta, mean_energy, krepel, xmaxcontainer - xmincontainer,
-                                 fboundary / (double)(ncircles * NVID), 0, pressure, gravity);
-                if (BOUNDARY_COND == BC_EHRENFEST)
-                    print_ehrenfest_parameters(particle, pleft, pright);
-                else if (PRINT_PARTICLE_NUMBER)
-                    print_particle_number(ncircles);
+                    draw_trails(sim.trail);
+                draw_particle_view(sim.particle, PLOT_B, view[1]);
+                draw_container(sim.xmincontainer, sim.xmaxcontainer, sim.obstacle, sim.wall);
+                if (begin_layer(hud_layer, 1, (unsigned long)i))
+                {
+                    print_parameters(sim.beta, sim.mean_energy, sim.krepel, sim.xmaxcontainer - sim.xmincontainer,
+                                     sim.fboundary / (double)(ncircles * NVID), 0, sim.pressure, sim.gravity);
+                    if (BOUNDARY_COND == BC_EHRENFEST)
+                        print_ehrenfest_parameters(sim.particle, sim.pleft, sim.pright);
+                    else if (PRINT_PARTICLE_NUMBER)
+                        print_particle_number(ncircles);
+                    end_layer(hud_layer, 1);
+                }
                 glutSwapBuffers();
                 save_frame_lj_counter(NSTEPS + MID_FRAMES + 1 + counter);
                 counter++;
@@ -887,20 +1396,27 @@ void animation()
                 s = system("mv lj*.tif tif_ljones/");
             }
         }
+        publish_lj_telemetry(&sim, i + 1);
     }
+    telemetry_close();
+
+    /* configuration changes of last frame */
+    if ((!ASYNC_RENDER) && (sim.pending))
+        update_lj_configuration(&sim);
 
     if (MOVIE)
     {
         if (DOUBLE_MOVIE)
         {
+            blank();
             if (TRACER_PARTICLE)
-                draw_trajectory(trajectory, traj_position, traj_length);
-            draw_particles(particle, PLOT);
-            draw_container(xmincontainer, xmaxcontainer, obstacle, wall);
-            print_parameters(beta, mean_energy, krepel, xmaxcontainer - xmincontainer,
-                             fboundary / (double)(ncircles * NVID), 0, pressure, gravity);
+                draw_trails(sim.trail);
+            draw_particles(sim.particle, PLOT);
+            draw_container(sim.xmincontainer, sim.xmaxcontainer, sim.obstacle, sim.wall);
+            print_parameters(sim.beta, sim.mean_energy, sim.krepel, sim.xmaxcontainer - sim.xmincontainer,
+                             sim.fboundary / (double)(ncircles * NVID), 0, sim.pressure, sim.gravity);
             if (BOUNDARY_COND == BC_EHRENFEST)
-                print_ehrenfest_parameters(particle, pleft, pright);
+                print_ehrenfest_parameters(sim.particle, sim.pleft, sim.pright);
             else if (PRINT_PARTICLE_NUMBER)
                 print_particle_number(ncircles);
             glutSwapBuffers();
@@ -909,14 +1425,15 @@ void animation()
             save_frame_lj();
         if (DOUBLE_MOVIE)
         {
+            blank();
             if (TRACER_PARTICLE)
-                draw_trajectory(trajectory, traj_position, traj_length);
-            draw_particles(particle, PLOT_B);
-            draw_container(xmincontainer, xmaxcontainer, obstacle, wall);
-            print_parameters(beta, mean_energy, krepel, xmaxcontainer - xmincontainer,
-                             fboundary / (double)(ncircles * NVID), 0, pressure, gravity);
+                draw_trails(sim.trail);
+            draw_particles(sim.particle, PLOT_B);
+            draw_container(sim.xmincontainer, sim.xmaxcontainer, sim.obstacle, sim.wall);
+            print_parameters(sim.beta, sim.mean_energy, sim.krepel, sim.xmaxcontainer - sim.xmincontainer,
+                             sim.fboundary / (double)(ncircles * NVID), 0, sim.pressure, sim.gravity);
             if (BOUNDARY_COND == BC_EHRENFEST)
-                print_ehrenfest_parameters(particle, pleft, pright);
+                print_ehrenfest_parameters(sim.particle, sim.pleft, sim.pright);
             else if (PRINT_PARTICLE_NUMBER)
                 print_particle_number(ncircles);
             glutSwapBuffers();
@@ -930,21 +1447,15 @@ void animation()
         s = system("mv lj*.tif tif_ljones/");
     }
 
-    printf("%i active particles\n", nactive);
+    printf("%i active particles\n", sim.nactive);
 
-    free(particle);
-    if (ADD_FIXED_OBSTACLES)
-        free(obstacle);
-    if (TRACER_PARTICLE)
-        free(trajectory);
-    free(hashgrid);
-    free(qx);
-    free(qy);
-    free(px);
-    free(py);
-    free(qangle);
-    free(pangle);
-    free(pressure);
+    if (ASYNC_RENDER)
+        stop_render_queue(&queue, &sim);
+    else
+        free_lj_sim(&sim);
+    free(view[0]);
+    if (DOUBLE_MOVIE)
+        free(view[1]);
 }
 
 void display(void)
@@ -956,7 +1467,10 @@ void display(void)
     blank();
     glutSwapBuffers();
 
-    animation();
+    if (SIR_MODEL)
+        sir_animation();
+    else
+        animation();
     sleep(SLEEP2);
 
     glPopMatrix();
@@ -966,6 +1480,12 @@ void display(void)
 
 int main(int argc, char **argv)
 {
+    if (HEADLESS)
+    {
+        headless_run();
+        return 0;
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
     glutInitWindowSize(WINWIDTH, WINHEIGHT);
@@ -0,0 +1,556 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Re-rendering of particle configurations saved by lennardjones                */
+/*                                                                               */
+/*  october 2026, based on lennardjones.c by N. Berglund                         */
+/*                                                                               */
+/*  Reads the binary file written by lennardjones with SAVE_DUMP_FILE set to 1,  */
+/*  and produces the movie frames without re-running the molecular dynamics.     */
+/*  Parameters defining the geometry (boundary conditions, obstacles, window)    */
+/*  have to agree with those of the simulation, while plot type, color scheme   */
+/*  and DOUBLE_MOVIE can be changed freely.                                      */
+/*  Frames are split into RENDER_PROCESSES contiguous blocks, each rendered by   */
+/*  its own process and window.                                                  */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o lj_render lj_render.c                                                 */
+/* -L/usr/X11R6/lib -ltiff -lm -lGL -lGLU -lX11 -lXmu -lglut -O3 -fopenmp        */
+/*                                                                               */
+/*  create subfolder tif_ljones, and create movie using                          */
+/*  ffmpeg -i lj.%05d.tif -vcodec libx264 lj.mp4                                 */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <GL/glut.h>
+#include <GL/glu.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <tiffio.h> /* Sam Leffler's libtiff library. */
+#include <omp.h>
+
+#define DOUBLE_MOVIE 0 /* set to 1 to produce movies for wave height and energy simultaneously */
+
+#define TIME_LAPSE 1        /* set to 1 to add a time-lapse movie at the end */
+                            /* so far incompatible with double movie */
+#define TIME_LAPSE_FACTOR 3 /* factor of time-lapse movie */
+
+#define DUMP_FILE "lj_dump.bin"    /* file containing particle configurations, saved by lennardjones */
+#define RENDER_PROCESSES 4         /* number of processes rendering frames in parallel */
+
+/* General geometrical parameters */
+
+#define WINWIDTH 1280 /* window width */
+#define WINHEIGHT 720 /* window height */
+
+#define XMIN -2.0
+#define XMAX 2.0 /* x interval */
+#define YMIN -1.125
+#define YMAX 1.125 /* y interval for 9/16 aspect ratio */
+
+#define INITXMIN -1.9
+#define INITXMAX 1.9 /* x interval for initial condition */
+#define INITYMIN -1.0
+#define INITYMAX 1.0 /* y interval for initial condition */
+
+#define BCXMIN -2.0
+#define BCXMAX 2.0 /* x interval for boundary condition */
+#define BCYMIN -1.125
+#define BCYMAX 1.125 /* y interval for boundary condition */
+
+#define OBSXMIN -2.0
+#define OBSXMAX 2.0 /* x interval for motion of obstacle */
+
+#define CIRCLE_PATTERN 8 /* pattern of circles, see list in global_ljones.c */
+
+#define ADD_FIXED_OBSTACLES 1 /* set to 1 do add fixed circular obstacles */
+#define OBSTACLE_PATTERN 2    /* pattern of obstacles, see list in global_ljones.c */
+
+#define TWO_TYPES 0         /* set to 1 to have two types of particles */
+#define TPYE_PROPORTION 0.8 /* proportion of particles of first type */
+#define SYMMETRIZE_FORCE 1  /* set to 1 to symmetrize two-particle interaction, only needed if particles are not all the same */
+#define CENTER_PX 0         /* set to 1 to center horizontal momentum */
+#define CENTER_PY 0         /* set to 1 to center vertical momentum */
+#define CENTER_PANGLE 0     /* set to 1 to center angular momentum */
+
+#define INTERACTION 1              /* particle interaction, see list in global_ljones.c */
+#define INTERACTION_B 1            /* particle interaction for second type of particle, see list in global_ljones.c */
+#define SPIN_INTER_FREQUENCY 5.0   /* angular frequency of spin-spin interaction */
+#define SPIN_INTER_FREQUENCY_B 2.0 /* angular frequency of spin-spin interaction for second particle type */
+
+#define P_PERCOL 0.25       /* probability of having a circle in C_RAND_PERCOL arrangement */
+#define NPOISSON 100        /* number of points for Poisson C_RAND_POISSON arrangement */
+#define PDISC_DISTANCE 5.75 /* minimal distance in Poisson disc process, controls density of particles */
+// #define PDISC_DISTANCE 2.25  /* minimal distance in Poisson disc process, controls density of particles */
+#define PDISC_CANDIDATES 100 /* number of candidates in construction of Poisson disc process */
+#define RANDOM_POLY_ANGLE 0  /* set to 1 to randomize angle of polygons */
+
+#define LAMBDA 2.0            /* parameter controlling the dimensions of domain */
+#define MU 0.015              /* parameter controlling radius of particles */
+#define MU_B 0.0254           /* parameter controlling radius of particles of second type */
+#define NPOLY 3               /* number of sides of polygon */
+#define APOLY 0.125           /* angle by which to turn polygon, in units of Pi/2 */
+#define MDEPTH 4              /* depth of computation of Menger gasket */
+#define MRATIO 3              /* ratio defining Menger gasket */
+#define MANDELLEVEL 1000      /* iteration level for Mandelbrot set */
+#define MANDELLIMIT 10.0      /* limit value for approximation of Mandelbrot set */
+#define FOCI 1                /* set to 1 to draw focal points of ellipse */
+#define NGRIDX 30             /* number of grid point for grid of disks */
+#define NGRIDY 20             /* number of grid point for grid of disks */
+#define EHRENFEST_RADIUS 0.9  /* radius of container for Ehrenfest urn configuration */
+#define EHRENFEST_WIDTH 0.035 /* width of tube for Ehrenfest urn configuration */
+
+#define X_SHOOTER -0.2
+#define Y_SHOOTER -0.6
+#define X_TARGET 0.4
+#define Y_TARGET 0.7 /* shooter and target positions in laser fight */
+
+/* Parameters for length and speed of simulation */
+
+#define NSTEPS 5100 /* number of frames of movie */
+// #define NSTEPS 2750      /* number of frames of movie */
+#define NVID 200          /* number of iterations between images displayed on screen */
+#define NSEG 250          /* number of segments of boundary */
+#define INITIAL_TIME 20   /* time after which to start saving frames */
+#define BOUNDARY_WIDTH 1  /* width of particle boundary */
+#define LINK_WIDTH 2      /* width of links between particles */
+#define CONTAINER_WIDTH 4 /* width of container boundary */
+
+#define PAUSE 1000     /* number of frames after which to pause */
+#define PSLEEP 1       /* sleep time during pause */
+#define SLEEP1 1       /* initial sleeping time */
+#define SLEEP2 1       /* final sleeping time */
+#define MID_FRAMES 20  /* number of still frames between parts of two-part movie */
+#define END_FRAMES 100 /* number of still frames at end of movie */
+
+/* Boundary conditions, see list in global_ljones.c */
+
+#define BOUNDARY_COND 14
+
+/* Plot type, see list in global_ljones.c  */
+
+#define PLOT 5
+#define PLOT_B 4 /* plot type for second movie */
+
+#define COLOR_BONDS 1 /* set to 1 to color bonds according to length */
+
+/* Color schemes */
+
+#define COLOR_PALETTE 10 /* Color palette, see list in global_ljones.c  */
+
+#define BLACK 1 /* background */
+
+#define COLOR_SCHEME 3 /* choice of color scheme, see list in global_ljones.c  */
+
+#define SCALE 0         /* set to 1 to adjust color scheme to variance of field */
+#define SLOPE 0.5       /* sensitivity of color on wave amplitude */
+#define ATTENUATION 0.0 /* exponential attenuation coefficient of contrast with time */
+
+#define COLORHUE 260   /* initial hue of water color for scheme C_LUM */
+#define COLORDRIFT 0.0 /* how much the color hue drifts during the whole simulation */
+#define LUMMEAN 0.5    /* amplitude of luminosity variation for scheme C_LUM */
+#define LUMAMP 0.3     /* amplitude of luminosity variation for scheme C_LUM */
+#define HUEMEAN 220.0  /* mean value of hue for color scheme C_HUE */
+#define HUEAMP -50.0   /* amplitude of variation of hue for color scheme C_HUE */
+
+/* particle properties */
+
+#define ENERGY_HUE_MIN 330.0   /* color of original particle */
+#define ENERGY_HUE_MAX 50.0    /* color of saturated particle */
+#define PARTICLE_HUE_MIN 359.0 /* color of original particle */
+#define PARTICLE_HUE_MAX 0.0   /* color of saturated particle */
+#define PARTICLE_EMAX 1.0e3    /* energy of particle with hottest color */
+#define HUE_TYPE0 280.0        /* hue of particles of type 0 */
+#define HUE_TYPE1 135.0        /* hue of particles of type 1 */
+#define HUE_TYPE2 70.0         /* hue of particles of type 1 */
+#define HUE_TYPE3 210.0        /* hue of particles of type 1 */
+
+#define RANDOM_RADIUS 0                /* set to 1 for random circle radius */
+#define DT_PARTICLE 5.0e-7             /* time step for particle displacement */
+#define KREPEL 12.0                    /* constant in repelling force between particles */
+#define EQUILIBRIUM_DIST 5.0           /* Lennard-Jones equilibrium distance */
+#define EQUILIBRIUM_DIST_B 5.0         /* Lennard-Jones equilibrium distance for second type of particle */
+#define REPEL_RADIUS 20.0              /* radius in which repelling force acts (in units of particle radius) */
+#define DAMPING 0.0                    /* damping coefficient of particles */
+#define PARTICLE_MASS 1.0              /* mass of particle of radius MU */
+#define PARTICLE_MASS_B 1.0            /* mass of particle of radius MU */
+#define PARTICLE_INERTIA_MOMENT 0.2    /* moment of inertia of particle */
+#define PARTICLE_INERTIA_MOMENT_B 0.02 /* moment of inertia of second type of particle */
+#define V_INITIAL 10.0                 /* initial velocity range */
+#define OMEGA_INITIAL 10.0             /* initial angular velocity range */
+
+#define THERMOSTAT 1             /* set to 1 to switch on thermostat */
+#define SIGMA 5.0                /* noise intensity in thermostat */
+#define BETA 0.0001              /* initial inverse temperature */
+#define MU_XI 0.01               /* friction constant in thermostat */
+#define KSPRING_BOUNDARY 5.0e9   /* confining harmonic potential outside simulation region */
+#define KSPRING_OBSTACLE 5.0e8   /* harmonic potential of obstacles */
+#define NBH_DIST_FACTOR 4.0      /* radius in which to count neighbours */
+#define GRAVITY 0.0              /* gravity acting on all particles */
+#define INCREASE_GRAVITY 0       /* set to 1 to increase gravity during the simulation */
+#define GRAVITY_FACTOR 100.0     /* factor by which to increase gravity */
+#define GRAVITY_RESTORE_TIME 750 /* time at end of simulation with gravity restored to initial value */
+
+#define ROTATION 0                   /* set to 1 to include rotation of particles */
+#define COUPLE_ANGLE_TO_THERMOSTAT 0 /* set to 1 to couple angular degrees of freedom to thermostat */
+#define DIMENSION_FACTOR 1.0         /* scaling factor taking into account number of degrees of freedom */
+#define KTORQUE 50.0                 /* force constant in angular dynamics */
+#define KTORQUE_B 10.0               /* force constant in angular dynamics */
+#define KTORQUE_DIFF 150.0           /* force constant in angular dynamics for different particles */
+#define DRAW_SPIN 0                  /* set to 1 to draw spin vectors of particles */
+#define DRAW_SPIN_B 0                /* set to 1 to draw spin vectors of particles */
+#define DRAW_CROSS 1                 /* set to 1 to draw cross on particles of second type */
+#define SPIN_RANGE 7.0               /* range of spin-spin interaction */
+#define SPIN_RANGE_B 5.0             /* range of spin-spin interaction for second type of particle */
+#define QUADRUPOLE_RATIO 0.6         /* anisotropy in quadrupole potential */
+
+#define INCREASE_BETA 0        /* set to 1 to increase BETA during simulation */
+#define BETA_FACTOR 20.0       /* factor by which to change BETA during simulation */
+#define N_TOSCILLATIONS 1.5    /* number of temperature oscillations in BETA schedule */
+#define NO_OSCILLATION 0       /* set to 1 to have exponential BETA change only */
+#define FINAL_CONSTANT_PHASE 0 /* final phase in which temperature is constant */
+
+#define DECREASE_CONTAINER_SIZE 0 /* set to 1 to decrease size of container */
+#define SYMMETRIC_DECREASE 0      /* set tp 1 to decrease container symmetrically */
+#define COMPRESSION_RATIO 0.3     /* final size of container */
+#define RESTORE_CONTAINER_SIZE 1  /* set to 1 to restore container to initial size at end of simulation */
+#define RESTORE_TIME 700          /* time before end of sim at which to restore size */
+
+#define MOVE_OBSTACLE 0           /* set to 1 to have a moving obstacle */
+#define CENTER_VIEW_ON_OBSTACLE 0 /* set to 1 to center display on moving obstacle */
+#define RESAMPLE_Y 0              /* set to 1 to resample y coordinate of moved particles (for shock waves) */
+#define NTRIALS 2000              /* number of trials when resampling */
+#define OBSTACLE_RADIUS 0.12      /* radius of obstacle for circle boundary conditions */
+#define FUNNEL_WIDTH 0.25         /* funnel width for funnel boundary conditions */
+#define OBSTACLE_XMIN 0.0         /* initial position of obstacle */
+#define OBSTACLE_XMAX 3.0         /* final position of obstacle */
+#define RECORD_PRESSURES 0        /* set to 1 to record pressures on obstacle */
+#define N_PRESSURES 100           /* number of intervals to record pressure */
+#define N_P_AVERAGE 100           /* size of pressure averaging window */
+#define N_T_AVERAGE 50            /* size of temperature averaging window */
+#define MAX_PRESSURE 3.0e10       /* pressure shown in "hottest" color */
+#define PARTIAL_THERMO_COUPLING 0 /* set to 1 to couple only particles to the right of obstacle to thermostat */
+#define PARTIAL_THERMO_SHIFT 0.5  /* distance from obstacle at the right of which particles are coupled to thermostat */
+
+#define INCREASE_KREPEL 0    /* set to 1 to increase KREPEL during simulation */
+#define KREPEL_FACTOR 1000.0 /* factor by which to change KREPEL during simulation */
+
+#define PART_AT_BOTTOM 0         /* set to 1 to include "seed" particles at bottom */
+#define MASS_PART_BOTTOM 10000.0 /* mass of particles at bottom */
+#define NPART_BOTTOM 100         /* number of particles at the bottom */
+
+#define ADD_PARTICLES 0        /* set to 1 to add particles */
+#define ADD_TIME 25            /* time at which to add first particle */
+#define ADD_PERIOD 20          /* time interval between adding further particles */
+#define FINAL_NOADD_PERIOD 250 /* final period where no particles are added */
+#define SAFETY_FACTOR 2.0      /* no particles are added at distance less than MU*SAFETY_FACTOR of other particles */
+
+#define TRACER_PARTICLE 1        /* set to 1 to have a tracer particle */
+#define N_TRACER_PARTICLES 3     /* number of tracer particles */
+#define TRAJECTORY_LENGTH 8000   /* length of recorded trajectory */
+#define TRACER_PARTICLE_MASS 4.0 /* relative mass of tracer particle */
+#define TRAJECTORY_WIDTH 3       /* width of tracer particle trajectory */
+#define TRAJECTORY_TOLERANCE 0.002  /* max deviation of simplified trajectory, set to 0 to keep all positions */
+
+#define POSITION_DEPENDENT_TYPE 0 /* set to 1 to make particle type depend on initial position */
+#define POSITION_Y_DEPENDENCE 0   /* set to 1 for the separation between particles to be vertical */
+#define PRINT_ENTROPY 0           /* set to 1 to compute entropy */
+
+#define PRINT_PARTICLE_NUMBER 0 /* set to 1 to print total number of particles */
+
+#define EHRENFEST_COPY 0 /* set to 1 to add equal number of larger particles (for Ehrenfest model) */
+
+#define LID_MASS 1000.0   /* mass of lid for BC_RECTANGLE_LID b.c. */
+#define LID_WIDTH 0.1     /* width of lid for BC_RECTANGLE_LID b.c. */
+#define WALL_MASS 2000.0  /* mass of wall for BC_RECTANGLE_WALL b.c. */
+#define WALL_FRICTION 0.0 /* friction on wall for BC_RECTANGLE_WALL b.c. */
+#define WALL_WIDTH 0.1    /* width of wall for BC_RECTANGLE_WALL b.c. */
+#define WALL_VMAX 100.0   /* max speed of wall */
+#define WALL_TIME 500     /* time during which to keep wall */
+
+#define FLOOR_FORCE 1 /* set to 1 to limit force on particle to FMAX */
+#define FMAX 1.0e9    /* maximal force */
+#define FLOOR_OMEGA 1 /* set to 1 to limit particle momentum to PMAX */
+#define PMAX 1000.0   /* maximal force */
+
+#define HASHX 34             /* size of hashgrid in x direction */
+#define HASHY 18             /* size of hashgrid in y direction */
+#define HASHMAX 100          /* maximal number of particles per hashgrid cell */
+#define HASHGRID_PADDING 0.1 /* padding of hashgrid outside simulation window */
+#define REORDER_THRESHOLD 2.0 /* factor by which neighbour index spread may grow before reordering */
+
+#define DRAW_COLOR_SCHEME 0   /* set to 1 to plot the color scheme */
+#define COLORBAR_RANGE 8.0    /* scale of color scheme bar */
+#define COLORBAR_RANGE_B 12.0 /* scale of color scheme bar for 2nd part */
+#define ROTATE_COLOR_SCHEME 0 /* set to 1 to draw color scheme horizontally */
+
+#define NO_WRAP_BC ((BOUNDARY_COND != BC_PERIODIC) && (BOUNDARY_COND != BC_PERIODIC_CIRCLE) && (BOUNDARY_COND != BC_PERIODIC_TRIANGLE) && (BOUNDARY_COND != BC_KLEIN) && (BOUNDARY_COND != BC_PERIODIC_FUNNEL) && (BOUNDARY_COND != BC_BOY) && (BOUNDARY_COND != BC_GENUS_TWO))
+#define PERIODIC_BC ((BOUNDARY_COND == BC_PERIODIC) || (BOUNDARY_COND == BC_PERIODIC_CIRCLE) || (BOUNDARY_COND == BC_PERIODIC_FUNNEL) || (BOUNDARY_COND == BC_PERIODIC_TRIANGLE))
+
+double xshift = 0.0; /* x shift of shown window */
+double xspeed = 0.0; /* x speed of obstacle */
+double ylid = 0.9;   /* y coordinate of lid (for BC_RECTANGLE_LID b.c.) */
+double vylid = 0.0;  /* y speed coordinate of lid (for BC_RECTANGLE_LID b.c.) */
+double xwall = 0.0;  /* x coordinate of wall (for BC_RECTANGLE_WALL b.c.) */
+double vxwall = 0.0; /* x speed of wall (for BC_RECTANGLE_WALL b.c.) */
+
+#include "global_ljones.c"
+#include "sub_lj.c"
+#include "sub_hashgrid.c"
+#include "sub_ljdump.c"
+
+/*********************/
+/* rendering part    */
+/*********************/
+
+t_dump_reader reader;
+int process_number = 0;
+
+void set_frame_globals(t_dump_frame *frame)
+/* restore global variables used by drawing routines */
+{
+    xshift = frame->xshift;
+    ylid = frame->ylid;
+    xwall = frame->xwall;
+}
+
+void load_frame(int f, t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HASHX * HASHY])
+/* copy frame f into particle array, and recompute neighbours if bonds are drawn */
+{
+    set_frame_globals(dump_frame(&reader, f));
+    read_dump_frame(&reader, f, particle);
+
+    if ((PLOT == P_BONDS) || ((DOUBLE_MOVIE) && (PLOT_B == P_BONDS)))
+    {
+        update_hashgrid(particle, hashgrid, 0);
+        compute_relative_positions(particle, hashgrid);
+    }
+}
+
+void add_tracer_positions(int f, t_trail trail[N_TRACER_PARTICLES])
+/* update tracer particle trajectories in the same way as lennardjones */
+{
+    int j;
+    float *tracers;
+
+    if ((!TRACER_PARTICLE) || (f <= 0) || (reader.header->ntracers < N_TRACER_PARTICLES))
+        return;
+
+    tracers = dump_tracers(&reader, f);
+    for (j = 0; j < N_TRACER_PARTICLES; j++)
+        add_trail_point(&trail[j], (double)tracers[2 * j], (double)tracers[2 * j + 1], f);
+}
+
+void draw_frame(int f, int plot, t_particle particle[NMAXCIRCLES], t_obstacle obstacle[NMAXOBSTACLES],
+                t_trail trail[N_TRACER_PARTICLES], double pressure[N_PRESSURES])
+/* draw frame f, with the same sequence of calls as lennardjones */
+{
+    double entropy[2];
+    t_dump_frame *frame;
+
+    frame = dump_frame(&reader, f);
+
+    blank();
+    if (TRACER_PARTICLE)
+        draw_trails(trail);
+    draw_particles(particle, plot);
+    draw_container(frame->xmincontainer, frame->xmaxcontainer, obstacle, frame->wall);
+
+    print_parameters(frame->beta, frame->mean_energy, frame->krepel, frame->xmaxcontainer - frame->xmincontainer,
+                     frame->boundary_force, 0, pressure, frame->gravity);
+    if ((BOUNDARY_COND == BC_EHRENFEST) || (BOUNDARY_COND == BC_RECTANGLE_WALL))
+        print_ehrenfest_parameters(particle, frame->pleft, frame->pright);
+    else if (PRINT_PARTICLE_NUMBER)
+        print_particle_number(frame->ncircles);
+
+    if ((f > WALL_TIME) && (PRINT_ENTROPY))
+    {
+        compute_entropy(particle, entropy);
+        print_entropy(entropy);
+    }
+}
+
+void load_pressures(int f, double pressure[N_PRESSURES])
+{
+    int j;
+    float *p;
+
+    for (j = 0; j < N_PRESSURES; j++)
+        pressure[j] = 0.0;
+    if ((RECORD_PRESSURES) && (reader.header->npressures == N_PRESSURES))
+    {
+        p = dump_pressures(&reader, f);
+        for (j = 0; j < N_PRESSURES; j++)
+            pressure[j] = (double)p[j];
+    }
+}
+
+void render_frames(int fmin, int fmax)
+/* render frames fmin to fmax-1 of dump file */
+{
+    int f, j, nframes;
+    double *pressure;
+    t_particle *particle;
+    t_obstacle *obstacle;
+    t_trail *trail;
+    t_hashgrid *hashgrid;
+    t_dump_frame *frame;
+
+    nframes = reader.nframes;
+
+    particle = (t_particle *)malloc(NMAXCIRCLES * sizeof(t_particle));
+    if (ADD_FIXED_OBSTACLES)
+        obstacle = (t_obstacle *)malloc(NMAXOBSTACLES * sizeof(t_obstacle));
+    if (TRACER_PARTICLE)
+    {
+        trail = (t_trail *)malloc(N_TRACER_PARTICLES * sizeof(t_trail));
+        for (j = 0; j < N_TRACER_PARTICLES; j++)
+            init_trail(&trail[j]);
+    }
+    hashgrid = (t_hashgrid *)malloc(HASHX * HASHY * sizeof(t_hashgrid));
+    pressure = (double *)malloc(N_PRESSURES * sizeof(double));
+
+    init_hashgrid(hashgrid);
+    if (ADD_FIXED_OBSTACLES)
+        init_obstacle_config(obstacle);
+
+    /* rebuild tracer trajectories and averaged quantities from preceding frames */
+    f = fmin - TRAJECTORY_LENGTH;
+    if (f < 0)
+        f = 0;
+    for (; f < fmin; f++)
+    {
+        add_tracer_positions(f, trail);
+        if (f >= fmin - N_P_AVERAGE - N_T_AVERAGE)
+        {
+            frame = dump_frame(&reader, f);
+            load_pressures(f, pressure);
+            print_parameters(frame->beta, frame->mean_energy, frame->krepel, frame->xmaxcontainer - frame->xmincontainer,
+                             frame->boundary_force, 0, pressure, frame->gravity);
+        }
+    }
+    blank();
+
+    for (f = fmin; f < fmax; f++)
+    {
+        printf("Process %i rendering frame %i\n", process_number, f);
+
+        load_frame(f, particle, hashgrid);
+        load_pressures(f, pressure);
+        add_tracer_positions(f, trail);
+
+        draw_frame(f, PLOT, particle, obstacle, trail, pressure);
+        glutSwapBuffers();
+        save_frame_lj_counter(f + 1);
+        if ((TIME_LAPSE) && (f % TIME_LAPSE_FACTOR == 0) && (!DOUBLE_MOVIE))
+            save_frame_lj_counter(NSTEPS + END_FRAMES + f / TIME_LAPSE_FACTOR);
+
+        if (DOUBLE_MOVIE)
+        {
+            draw_frame(f, PLOT_B, particle, obstacle, trail, pressure);
+            glutSwapBuffers();
+            save_frame_lj_counter(NSTEPS + MID_FRAMES + 1 + f);
+        }
+    }
+
+    /* still frames at end of movie, by the process rendering the last frame */
+    if ((fmax == nframes) && (fmax > fmin))
+    {
+        f = nframes - 1;
+        if (DOUBLE_MOVIE)
+        {
+            draw_frame(f, PLOT, particle, obstacle, trail, pressure);
+            glutSwapBuffers();
+        }
+        for (f = 0; f < MID_FRAMES; f++)
+            save_frame_lj_counter(nframes + 1 + f);
+        if (DOUBLE_MOVIE)
+        {
+            f = nframes - 1;
+            draw_frame(f, PLOT_B, particle, obstacle, trail, pressure);
+            glutSwapBuffers();
+        }
+        for (f = 0; f < END_FRAMES; f++)
+            save_frame_lj_counter(NSTEPS + MID_FRAMES + 1 + DOUBLE_MOVIE * nframes + f);
+        if ((TIME_LAPSE) && (!DOUBLE_MOVIE))
+            for (f = 0; f < END_FRAMES; f++)
+                save_frame_lj_counter(NSTEPS + END_FRAMES + NSTEPS / TIME_LAPSE_FACTOR + f);
+    }
+
+    free(particle);
+    if (ADD_FIXED_OBSTACLES)
+        free(obstacle);
+    if (TRACER_PARTICLE)
+        free(trail);
+    free(hashgrid);
+    free(pressure);
+}
+
+void display(void)
+{
+    int fmin, fmax, block;
+
+    glPushMatrix();
+
+    blank();
+    glutSwapBuffers();
+    blank();
+    glutSwapBuffers();
+
+    block = (reader.nframes + RENDER_PROCESSES - 1) / RENDER_PROCESSES;
+    fmin = process_number * block;
+    fmax = fmin + block;
+    if (fmax > reader.nframes)
+        fmax = reader.nframes;
+    if (fmin < fmax)
+        render_frames(fmin, fmax);
+
+    glPopMatrix();
+
+    glutDestroyWindow(glutGetWindow());
+    exit(0);
+}
+
+int main(int argc, char **argv)
+{
+    int p, status;
+    pid_t pid = 0;
+
+    open_dump_for_reading(DUMP_FILE, &reader);
+
+    /* each process opens its own window */
+    for (p = 0; p < RENDER_PROCESSES; p++)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            process_number = p;
+            break;
+        }
+    }
+
+    if (pid != 0)
+    {
+        for (p = 0; p < RENDER_PROCESSES; p++)
+            wait(&status);
+        close_dump_for_reading(&reader);
+        if (system("mv lj*.tif tif_ljones/") != 0)
+            printf("Warning: could not move frames to tif_ljones/\n");
+        return 0;
+    }
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(WINWIDTH, WINHEIGHT);
+    glutCreateWindow("Re-rendering of Lennard-Jones particles");
+
+    init();
+
+    glutDisplayFunc(display);
+
+    glutMainLoop();
+
+    return 0;
+}
@@ -31,6 +31,8 @@
 #include <tiffio.h> /* Sam Leffler's libtiff library. */
 
 #define MOVIE 0 /* set to 1 to generate movie */
+#define HEADLESS 0 /* set to 1 to run the billiard without window */
+#define TELEMETRY 1 /* set to 1 to publish the progress of the run in shared memory, read with telemetry */
 
 #define WINWIDTH 1280 /* window width */
 #define WINHEIGHT 720 /* window height */
@@ -85,6 +87,7 @@
 #define PRINT_PARTICLE_NUMBER 1  /* set to 1 to print number of particles */
 #define PRINT_COLLISION_NUMBER 0 /* set to 1 to print number of collisions */
 #define TEST_ACTIVE 1            /* set to 1 to test whether particle is in billiard */
+#define COMPACT_PARTICLES 0      /* set to 1 to stop computing absorbed particles (they are removed at each frame) */
 
 #define NSTEPS 5000  /* number of frames of movie */
 #define TIME 1500    /* time between movie frames, for fluidity of real-time simulation */
@@ -124,6 +127,7 @@
 
 #include "global_particles.c"
 #include "sub_part_billiard.c"
+#include "sub_telemetry.c"
 
 int ncollisions = 0;
 
@@ -652,19 +656,37 @@ void print_collision_number(int ncollisions, double x, double y)
     write_text(x, y, message);
 }
 
-void animation()
+/*********************/
+/* simulation core   */
+/*********************/
+
+/* The billiard is initialised and advanced by the functions below, which make no   */
+/* OpenGL calls, so that it can also run without window (option HEADLESS). The     */
+/* particles are observed by reading the arrays of t_billiard_sim directly.        */
+
+typedef struct
 {
-    double time, dt, alpha, r, rgb[3], alphamax;
-    double *configs[NPARTMAX];
-    int i, j, resamp = 1, s, i1, i2, c, lengthmax;
-    int *color, *newcolor, *active;
-    //     t_circle *circles;      /* experimental */
+    double *configs[NPARTMAX]; /* configurations of particles */
+    int *color, *newcolor;     /* colors of particles */
+    int *active;               /* has value 0 for absorbed particles */
+    int frame;                 /* number of frames computed */
+} t_billiard_sim;
+
+void init_billiard_sim(t_billiard_sim *sim)
+/* allocate particles, and initialise billiard and configuration */
+{
+    double alpha, r, alphamax;
+    double **configs = sim->configs;
+    int i, c, i1, i2, lengthmax;
+    int *color, *newcolor;
 
     /* Since NPARTMAX can be big, it seemed wiser to use some memory allocation here */
-    color = malloc(sizeof(int) * (NPARTMAX));
-    newcolor = malloc(sizeof(int) * (NPARTMAX));
-    active = malloc(sizeof(int) * (NPARTMAX));
-    //     circles = malloc(sizeof(t_circle)*(NMAXCIRCLES));      /* experimental */
+    sim->color = malloc(sizeof(int) * (NPARTMAX));
+    sim->newcolor = malloc(sizeof(int) * (NPARTMAX));
+    sim->active = malloc(sizeof(int) * (NPARTMAX));
+    color = sim->color;
+    newcolor = sim->newcolor;
+    sim->frame = 0;
 
     for (i = 0; i < NPARTMAX; i++)
         configs[i] = (double *)malloc(8 * sizeof(double));
@@ -738,23 +760,11 @@ void animation()
     //     init_line_config(-0.7, -0.45, -0.7, 0.45, 0.0, configs);
     //     init_line_config(-1.5, 0.1, -0.1, 1.0, -0.5*PID, configs);
 
-    if (!SHOWTRAILS)
-        blank();
-    glColor3f(0.0, 0.0, 0.0);
-    if (DRAW_BILLIARD)
-        draw_billiard();
-    if (PRINT_PARTICLE_NUMBER)
-        print_part_number(configs, active, XMIN + 0.1, YMIN + 0.1);
-    else if (PRINT_COLLISION_NUMBER)
-        print_collision_number(ncollisions, XMIN + 0.1, YMIN + 0.1);
-
-    glutSwapBuffers();
-
     for (i = 0; i < NPARTMAX; i++)
     {
         color[i] = 0;
         newcolor[i] = 0;
-        active[i] = 1;
+        sim->active[i] = 1;
     }
 
     if (FLOWER_COLOR) /* adapt color scheme to flower configuration (beta implementation) */
@@ -782,32 +792,125 @@ void animation()
             newcolor[i] = (i * NCOLORS) / NPART;
         }
 
-    sleep(SLEEP1);
-
     /* initialize drops in different colors */
     //     init_partial_drop_config(0.0, 0.0, 0.0, DPI, 0, 2*NPART/5, 0, configs, color, newcolor);
     //     init_partial_drop_config(0.0, 0.8, 0.0, DPI, 2*NPART/5, 4*NPART/5, 10, configs, color, newcolor);
     //     init_partial_drop_config(1.2, 0.1, 0.0, DPI, 4*NPART/5, NPART, 36, configs, color, newcolor);
+}
+
+void step_billiard_sim(t_billiard_sim *sim, int nframes)
+/* advance billiard by nframes frames of TIME steps */
+{
+    int n, j;
+
+    for (n = 0; n < nframes; n++)
+    {
+        /* particles absorbed or escaped during the last frame are no longer computed */
+        if (COMPACT_PARTICLES)
+            compact_particles(sim->configs, sim->color, sim->newcolor, sim->active);
+
+        for (j = 0; j < nparticles; j++)
+            sim->color[j] = sim->newcolor[j];
+        graph_movie(TIME, sim->newcolor, sim->configs, sim->active);
+        sim->frame++;
+    }
+}
+
+void free_billiard_sim(t_billiard_sim *sim)
+{
+    int i;
+
+    free(sim->color);
+    free(sim->newcolor);
+    free(sim->active);
+    for (i = 0; i < NPARTMAX; i++)
+        free(sim->configs[i]);
+}
+
+int count_active_particles(t_billiard_sim *sim)
+{
+    int i, nactive = 0;
+
+    for (i = 0; i < nparticles; i++)
+        if (sim->active[i])
+            nactive++;
+    return (nactive);
+}
+
+void publish_billiard_telemetry(t_billiard_sim *sim, int nactive)
+/* end of frame for telemetry - a frame has TIME steps of length DPHI */
+{
+    telemetry_value(0, "active", (double)nactive);
+    telemetry_value(1, "collisions", (double)ncollisions);
+    telemetry_frame(sim->frame, (long)sim->frame * (long)TIME, (double)sim->frame * (double)TIME * DPHI);
+}
+
+void headless_run()
+/* run the billiard without window, printing the number of collisions and of active particles */
+{
+    int nactive;
+    t_billiard_sim sim;
+
+    init_billiard_sim(&sim);
+    if (TELEMETRY)
+        telemetry_open("particle_billiard", NSTEPS + 1);
+    while (sim.frame <= NSTEPS)
+    {
+        telemetry_phase(TM_COMPUTE);
+        step_billiard_sim(&sim, 1);
+        nactive = count_active_particles(&sim);
+        publish_billiard_telemetry(&sim, nactive);
+        printf("Frame %i: %i collisions, %i active particles\n", sim.frame, ncollisions, nactive);
+    }
+    telemetry_close();
+    free_billiard_sim(&sim);
+}
+
+/*********************/
+/* window front-end  */
+/*********************/
+
+void animation()
+{
+    int i, s;
+    t_billiard_sim sim;
+
+    init_billiard_sim(&sim);
+
+    if (!SHOWTRAILS)
+        blank();
+    glColor3f(0.0, 0.0, 0.0);
+    if (DRAW_BILLIARD)
+        draw_billiard();
+    if (PRINT_PARTICLE_NUMBER)
+        print_part_number(sim.configs, sim.active, XMIN + 0.1, YMIN + 0.1);
+    else if (PRINT_COLLISION_NUMBER)
+        print_collision_number(ncollisions, XMIN + 0.1, YMIN + 0.1);
+
+    glutSwapBuffers();
+
+    sleep(SLEEP1);
+    if (TELEMETRY)
+        telemetry_open("particle_billiard", NSTEPS + 1);
 
     for (i = 0; i <= NSTEPS; i++)
     {
-        graph_movie(TIME, newcolor, configs, active);
+        telemetry_phase(TM_COMPUTE);
+        step_billiard_sim(&sim, 1);
 
+        telemetry_phase(TM_DRAW);
         if (SHOWTRAILS)
-            draw_config_showtrails(newcolor, configs, active);
+            draw_config_showtrails(sim.newcolor, sim.configs, sim.active);
         else
-            draw_config(newcolor, configs, active);
+            draw_config(sim.newcolor, sim.configs, sim.active);
         //         draw_config(newcolor, configs, active);
         if (DRAW_BILLIARD)
             draw_billiard();
         if (PRINT_PARTICLE_NUMBER)
-            print_part_number(configs, active, XMIN + 0.1, YMIN + 0.1);
+            print_part_number(sim.configs, sim.active, XMIN + 0.1, YMIN + 0.1);
         else if (PRINT_COLLISION_NUMBER)
             print_collision_number(ncollisions, XMIN + 0.1, YMIN + 0.1);
 
-        for (j = 0; j < NPARTMAX; j++)
-            color[j] = newcolor[j];
-
         /* draw initial points */
         //         draw_initial_condition_circle(0.0, 0.0, 0.02, 0);
         //         draw_initial_condition_circle(0.0, 0.8, 0.02, 10);
@@ -815,6 +918,7 @@ void animation()
 
         if (MOVIE)
         {
+            telemetry_phase(TM_SAVE);
             save_frame();
 
             /* it seems that saving too many files too fast can cause trouble with the file system */
@@ -828,7 +932,10 @@ void animation()
         }
         else
             printf("Frame %i\n", i);
+        if (TELEMETRY)
+            publish_billiard_telemetry(&sim, count_active_particles(&sim));
     }
+    telemetry_close();
 
     if (MOVIE)
     {
@@ -837,10 +944,7 @@ void animation()
         s = system("mv part*.tif tif_part/");
     }
 
-    free(color);
-    free(newcolor);
-    for (i = 0; i < NPARTMAX; i++)
-        free(configs[i]);
+    free_billiard_sim(&sim);
 }
 
 void display(void)
@@ -867,6 +971,12 @@ int main(int argc, char **argv)
 {
     srand(time(NULL));
 
+    if (HEADLESS)
+    {
+        headless_run();
+        return 0;
+    }
+
     glutInit(&argc, argv);
     if (SHOWTRAILS)
         glutInitDisplayMode(GLUT_RGB | GLUT_SINGLE | GLUT_DEPTH);
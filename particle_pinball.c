@@ -92,6 +92,8 @@
 #define CYCLE 1         /* set to 1 for closed curve (start in all directions) */
 #define SHOWTRAILS 0   /* set to 1 to keep trails of the particles */
 #define TEST_ACTIVE 0   /* set to 1 to test whether particle is in billiard */
+#define COMPACT_PARTICLES 0 /* set to 1 to stop computing escaped particles (they are removed at each frame) */
+                            /* statistics of graph_movie() then only include remaining particles */
 
 #define NSTEPS 10400 /* number of frames of movie */
 // #define NSTEPS 1000     /* number of frames of movie */
@@ -913,6 +915,10 @@ void animation(int circle_config)
     for (i = 0; i <= NSTEPS; i++)
     // for (i=0; i<=INT32_MAX-2; i++)
     {
+        /* particles that escaped during the last frame are no longer computed */
+        if (COMPACT_PARTICLES)
+            compact_particles(configs, color, newcolor, active);
+
         graph_movie(TIME, newcolor, configs, active);
 
         if (SHOWTRAILS)
@@ -948,7 +954,7 @@ void animation(int circle_config)
 
         draw_statistics();
 
-        for (j = 0; j < NPARTMAX; j++)
+        for (j = 0; j < nparticles; j++)
             color[j] = newcolor[j];
 
         if (MOVIE)
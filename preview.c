@@ -0,0 +1,312 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Coarse previews of the simulations                                           */
+/*                                                                               */
+/*  october 2026                                                                 */
+/*                                                                               */
+/*  Writes a copy of a program with a reduced configuration to the folder       */
+/*  preview, compiles it there and runs it with window, so that parameters can  */
+/*  be checked in seconds or minutes before a full run. The domain, initial     */
+/*  condition and colour schemes are those of the program.                       */
+/*                                                                               */
+/*  The reduction depends on 3 factors:                                          */
+/*  - scale:  for the wave equation (programs with COURANT), the grid has scale  */
+/*            times fewer points in each direction; for molecular dynamics      */
+/*            (programs with DT_PARTICLE), particles are scale times larger, so  */
+/*            that there are scale^2 times fewer particles at the same density;  */
+/*  - skip:   only one frame out of skip is drawn;                               */
+/*  - window: the window is window times smaller in each direction.              */
+/*                                                                               */
+/*  Parameters depending on the grid or particle size are rescaled by the       */
+/*  rules in wave_rules and lj_rules below, so that a frame of the preview      */
+/*  shows the same physical time as skip frames of the full run. Movies and     */
+/*  output files are switched off. The derived parameters are printed.         */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o preview preview.c -O3 -lm                                             */
+/*                                                                               */
+/*  run with                                                                     */
+/*  ./preview program [-s scale] [-k skip] [-w window] [-n]                      */
+/*  where -n only writes the reduced program, without compiling and running it   */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define MAXLINES 4000 /* max number of lines of program */
+#define LINELENGTH 1024
+#define FOLDER "preview" /* folder of reduced program */
+
+#define DEFAULT_SCALE 4  /* default reduction factors */
+#define DEFAULT_SKIP 4
+#define DEFAULT_WINDOW 2
+
+#define MIN_VARIANCE_CELLS 2.0   /* min width of initial wave packet, in grid cells */
+#define MIN_WAVELENGTH_CELLS 1.0 /* min wavelength parameter of initial wave packet, in grid cells */
+
+#define DEFAULT_COMPILER "gcc -O3 -fopenmp"
+#define DEFAULT_LIBS "-L/usr/X11R6/lib -ltiff -lm -lGL -lGLU -lX11 -lXmu -lglut"
+
+typedef struct
+{
+    char *name;     /* name of parameter, as in #define */
+    int scale_exp;  /* parameter is multiplied by scale^scale_exp */
+    int skip_exp;   /* ... by skip^skip_exp */
+    int window_exp; /* ... and by window^window_exp */
+    int multiple;   /* integer parameters are rounded to a multiple of this */
+} t_rule;
+
+/* Wave equation: the Courant number c*DT/DX is kept, so that a time step is scale times */
+/* longer. Frequencies and damping per time step grow accordingly, GAMMA/DT^2 is kept,   */
+/* lengths in grid cells shrink, and frames have skip/scale times more time steps.      */
+t_rule wave_rules[] = {
+    {"NX", -1, 0, 0, 1},
+    {"NY", -1, 0, 0, 1},
+    {"AMR_BLOCK", -1, 0, 0, 1},
+    {"AMR_BOUNDARY", -1, 0, 0, 1},
+    {"HELMHOLTZ_LAYER", -1, 0, 0, 1},
+    {"OMEGA", 1, 0, 0, 1},
+    {"DAMPING", 1, 0, 0, 1},
+    {"GAMMA", 2, 0, 0, 1},
+    {"GAMMAB", 2, 0, 0, 1},
+    {"NVID", -1, 1, 0, 1},
+    {"NSTEPS", 0, -1, 0, 1},
+    {"INITIAL_TIME", 0, -1, 0, 1},
+    {"OSCILLATING_SOURCE_PERIOD", 0, -1, 0, 1},
+    {"WINWIDTH", 0, 0, -1, 1},
+    {"WINHEIGHT", 0, 0, -1, 1},
+    {NULL, 0, 0, 0, 1}};
+
+/* Molecular dynamics: lengths of particles grow by scale. Since forces derive from a  */
+/* potential of the ratio of distance and radius, the dynamics is the same after time */
+/* is multiplied by scale, so that the time step grows by scale, while forces and     */
+/* spring constants decrease. Lengths and durations in frames shrink by skip.         */
+t_rule lj_rules[] = {
+    {"MU", 1, 0, 0, 1},
+    {"MU_B", 1, 0, 0, 1},
+    {"NGRIDX", -1, 0, 0, 1},
+    {"NGRIDY", -1, 0, 0, 1},
+    {"NPOISSON", -2, 0, 0, 1},
+    {"HASHX", -1, 0, 0, 2}, /* even for some boundary conditions */
+    {"HASHY", -1, 0, 0, 2},
+    {"DT_PARTICLE", 1, 0, 0, 1},
+    {"KSPRING_BOUNDARY", -2, 0, 0, 1},
+    {"KSPRING_OBSTACLE", -2, 0, 0, 1},
+    {"FMAX", -1, 0, 0, 1},
+    {"SIR_AGENTS", -2, 0, 0, 1},
+    {"SIR_INFECTION_RADIUS", 1, 0, 0, 1},
+    {"NVID", 0, 1, 0, 1},
+    {"NSTEPS", 0, -1, 0, 1},
+    {"INITIAL_TIME", 0, -1, 0, 1},
+    {"TRAJECTORY_LENGTH", 0, -1, 0, 1},
+    {"ADD_TIME", 0, -1, 0, 1},
+    {"ADD_PERIOD", 0, -1, 0, 1},
+    {"FINAL_NOADD_PERIOD", 0, -1, 0, 1},
+    {"WALL_TIME", 0, -1, 0, 1},
+    {"RESTORE_TIME", 0, -1, 0, 1},
+    {"GRAVITY_RESTORE_TIME", 0, -1, 0, 1},
+    {"WINWIDTH", 0, 0, -1, 1},
+    {"WINHEIGHT", 0, 0, -1, 1},
+    {NULL, 0, 0, 0, 1}};
+
+/* options switched off in previews */
+char *off_options[] = {"MOVIE", "DOUBLE_MOVIE", "HEADLESS", "SAVE_FIELD_ARCHIVE", "SAVE_TIME_SERIES",
+                       "SAVE_DUMP_FILE", "STRUCTURE_ANALYSIS", NULL};
+
+char *new_value[MAXLINES]; /* new values of defined parameters, NULL if unchanged */
+
+#include "sub_defines.c"
+
+int define_value(int n, char *value)
+/* value of parameter defined in line n, as string; returns 0 if it is not a number */
+{
+    char name[LINELENGTH], *end;
+
+    if (sscanf(source[n], "#define %s %s", name, value) != 2)
+        return (0);
+    strtod(value, &end);
+    return ((end != value) && (*end == '\0'));
+}
+
+int parameter_value(char *name, double *x)
+/* numerical value of parameter, returns 0 if it is not defined as a number */
+{
+    int n;
+    char value[LINELENGTH];
+
+    n = define_line(name);
+    if ((n < 0) || (!define_value(n, value)))
+        return (0);
+    *x = strtod(value, NULL);
+    if (new_value[n] != NULL)
+        *x = strtod(new_value[n], NULL);
+    return (1);
+}
+
+void set_parameter(int n, char *name, char *value)
+/* replace value of parameter defined in line n */
+{
+    char old[LINELENGTH];
+
+    if (!define_value(n, old))
+        strcpy(old, "?");
+    if (strcmp(old, value) == 0)
+        return;
+    printf("%-28s %14s -> %s\n", name, old, value);
+    new_value[n] = strdup(value);
+}
+
+void apply_rules(t_rule rules[], double scale, double skip, double window)
+/* rescale parameters of program */
+{
+    int k, n, integer, i;
+    double x;
+    char value[LINELENGTH];
+
+    for (k = 0; rules[k].name != NULL; k++)
+    {
+        n = define_line(rules[k].name);
+        if (n < 0)
+            continue;
+        if (!define_value(n, value))
+        {
+            printf("Warning: %s is not a number, it is not rescaled\n", rules[k].name);
+            continue;
+        }
+        integer = (strpbrk(value, ".eE") == NULL);
+        x = strtod(value, NULL) * pow(scale, (double)rules[k].scale_exp) * pow(skip, (double)rules[k].skip_exp) *
+            pow(window, (double)rules[k].window_exp);
+
+        if (x == strtod(value, NULL))
+            continue;
+        if (integer)
+        {
+            i = rules[k].multiple * (int)(x / (double)rules[k].multiple + 0.5);
+            if ((i < 1) && (strtod(value, NULL) >= 1.0))
+                i = rules[k].multiple; /* numbers of cells, steps or frames stay positive */
+            sprintf(value, "%i", i);
+        }
+        else
+            sprintf(value, "%.6lg", x);
+        set_parameter(n, rules[k].name, value);
+    }
+}
+
+void resolve_wave_packet()
+/* widen initial wave packet if it is not resolved by the coarse grid, keeping its shape */
+{
+    int n;
+    double xmin, xmax, nx, variance, wavelength, dx, ratio = 1.0;
+    char value[64];
+
+    if ((!parameter_value("XMIN", &xmin)) || (!parameter_value("XMAX", &xmax)) || (!parameter_value("NX", &nx)) ||
+        (!parameter_value("INITIAL_VARIANCE", &variance)) || (!parameter_value("INITIAL_WAVELENGTH", &wavelength)))
+        return;
+
+    dx = (xmax - xmin) / nx;
+    if (MIN_VARIANCE_CELLS * dx > sqrt(variance))
+        ratio = MIN_VARIANCE_CELLS * dx / sqrt(variance);
+    if (MIN_WAVELENGTH_CELLS * dx > ratio * wavelength)
+        ratio = MIN_WAVELENGTH_CELLS * dx / wavelength;
+    if (ratio == 1.0)
+        return;
+
+    printf("Initial wave packet widened by %.3lg to be resolved by the coarse grid\n", ratio);
+    n = define_line("INITIAL_VARIANCE");
+    sprintf(value, "%.6lg", variance * ratio * ratio);
+    set_parameter(n, "INITIAL_VARIANCE", value);
+    n = define_line("INITIAL_WAVELENGTH");
+    sprintf(value, "%.6lg", wavelength * ratio);
+    set_parameter(n, "INITIAL_WAVELENGTH", value);
+}
+
+void write_preview_source(char *filename)
+/* write copy of program with new parameter values */
+{
+    int n;
+    char name[LINELENGTH];
+    FILE *file;
+
+    file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        printf("Error: cannot write %s\n", filename);
+        exit(1);
+    }
+    for (n = 0; n < nlines; n++)
+    {
+        if ((new_value[n] != NULL) && (sscanf(source[n], "#define %s", name) == 1))
+            write_define(file, source[n], name, new_value[n]);
+        else
+            fputs(source[n], file);
+    }
+    fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+    int i, n, run = 1;
+    double scale = DEFAULT_SCALE, skip = DEFAULT_SKIP, window = DEFAULT_WINDOW;
+    char *program = NULL, repo[LINELENGTH], filename[LINELENGTH + 300], command[4 * LINELENGTH];
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+            scale = atof(argv[++i]);
+        else if ((strcmp(argv[i], "-k") == 0) && (i + 1 < argc))
+            skip = atof(argv[++i]);
+        else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc))
+            window = atof(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0)
+            run = 0;
+        else if (program == NULL)
+            program = argv[i];
+        else
+            program = NULL;
+    }
+    if ((program == NULL) || (scale < 1.0) || (skip < 1.0) || (window < 1.0))
+    {
+        printf("Usage: %s program [-s scale] [-k skip] [-w window] [-n]\n", argv[0]);
+        printf("where scale, skip and window are at least 1\n");
+        return 1;
+    }
+
+    read_source(program);
+    printf("Preview of %s: scale %g, one frame out of %g, window reduced by %g\n", program, scale, skip, window);
+
+    if (define_line("COURANT") >= 0)
+    {
+        apply_rules(wave_rules, scale, skip, window);
+        resolve_wave_packet();
+    }
+    else if ((define_line("DT_PARTICLE") >= 0) && (define_line("MU") >= 0))
+        apply_rules(lj_rules, scale, skip, window);
+    else
+    {
+        printf("Error: no preview rules for %s.c (needs COURANT or DT_PARTICLE)\n", program);
+        return 1;
+    }
+    for (i = 0; off_options[i] != NULL; i++)
+        if ((n = define_line(off_options[i])) >= 0)
+            set_parameter(n, off_options[i], "0");
+
+    mkdir(FOLDER, 0755);
+    sprintf(filename, "%s/%s.c", FOLDER, program);
+    write_preview_source(filename);
+    printf("Reduced program written to %s\n", filename);
+    if (!run)
+        return 0;
+
+    if (getcwd(repo, LINELENGTH) == NULL)
+        return 1;
+    sprintf(command, "cd %s && %s -I%s -o %s %s.c %s && ./%s", FOLDER, DEFAULT_COMPILER, repo, program, program, DEFAULT_LIBS,
+            program);
+    fflush(stdout);
+    return (system(command) != 0);
+}
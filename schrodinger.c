@@ -176,11 +176,18 @@ void init_coherent_state(double x, double y, double px, double py, double scalex
     double xy[2], dist2, module, phase, scale2;    
 
     scale2 = scalex*scalex;
+    if (!init_fractal_xyin(xy_in, 0, NX))
+        for (i=0; i<NX; i++)
+            for (j=0; j<NY; j++)
+            {
+                ij_to_xy(i, j, xy);
+                xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
+            }
+
     for (i=0; i<NX; i++)
         for (j=0; j<NY; j++)
         {
             ij_to_xy(i, j, xy);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
 
             if (xy_in[i][j])
             {
@@ -218,11 +225,10 @@ void schrodinger_color_scheme(double phi, double psi, double scale, int time, do
     {
         amp = module2(phi,psi);
 //         if (amp < 1.0e-10) amp = 1.0e-10;
-        phase = argument(phi/amp, psi/amp);
-        if (phase < 0.0) phase += DPI;
+        phase = fast_argument(phi, psi);
         lum = (color_amplitude(amp, scale, time))*0.5;
         if (lum < 0.0) lum = 0.0;
-        hsl_to_rgb(phase*360.0/DPI, 0.9, lum, rgb);
+        phase_color(phase, lum, rgb);
     }
     else if (PLOT == P_REAL) color_scheme(COLOR_SCHEME, phi, scale, time, rgb);
     else if (PLOT == P_IMAGINARY) color_scheme(COLOR_SCHEME, psi, scale, time, rgb);
@@ -234,6 +240,24 @@ void draw_wave(double *phi[NX], double *psi[NX], short int *xy_in[NX], double sc
 {
     int i, j;
     double rgb[3], xy[2], x1, y1, x2, y2, amp, phase;
+    float *color;
+    static float *colors = NULL;
+
+    if (colors == NULL) colors = (float *)malloc(3*NX*NY*sizeof(float));
+    if (PLOT == P_PHASE) init_phase_lut();
+
+    /* colors are computed in parallel, then drawn */
+    #pragma omp parallel for private(i,j,rgb,color)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+            if (xy_in[i][j])
+            {
+                schrodinger_color_scheme(phi[i][j],psi[i][j], scale, time, rgb);
+                color = &colors[3*(i*NY+j)];
+                color[0] = rgb[0];
+                color[1] = rgb[1];
+                color[2] = rgb[2];
+            }
 
     glBegin(GL_QUADS);
 
@@ -242,9 +266,7 @@ void draw_wave(double *phi[NX], double *psi[NX], short int *xy_in[NX], double sc
         {
             if (xy_in[i][j])
             {
-                schrodinger_color_scheme(phi[i][j],psi[i][j], scale, time, rgb);
-                    
-                glColor3f(rgb[0], rgb[1], rgb[2]);
+                glColor3fv(&colors[3*(i*NY+j)]);
 
                 glVertex2i(i, j);
                 glVertex2i(i+1, j);
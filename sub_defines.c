@@ -0,0 +1,70 @@
+/* reading the lines of a program and rewriting its #define lines, for sweep.c and preview.c */
+/* MAXLINES and LINELENGTH have to be defined before including this file */
+
+char *source[MAXLINES]; /* lines of program */
+int nlines = 0;
+
+void read_source(char *program)
+/* read lines of program */
+{
+    FILE *file;
+    char filename[300], line[LINELENGTH];
+
+    sprintf(filename, "%s.c", program);
+    file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        printf("Error: cannot open %s\n", filename);
+        exit(1);
+    }
+    while (fgets(line, LINELENGTH, file) != NULL)
+    {
+        if (nlines >= MAXLINES)
+        {
+            printf("Error: %s has more than %i lines\n", filename, MAXLINES);
+            exit(1);
+        }
+        source[nlines] = strdup(line);
+        nlines++;
+    }
+    fclose(file);
+}
+
+int define_line(char *name)
+/* index of line defining name, -1 if there is none */
+{
+    int n, length;
+    char *line;
+
+    length = strlen(name);
+    for (n = 0; n < nlines; n++)
+    {
+        line = source[n];
+        if ((strncmp(line, "#define", 7) == 0) && ((line[7] == ' ') || (line[7] == '\t')))
+        {
+            line += 7;
+            while ((*line == ' ') || (*line == '\t'))
+                line++;
+            if ((strncmp(line, name, length) == 0) && ((line[length] == ' ') || (line[length] == '\t')))
+                return (n);
+        }
+    }
+    return (-1);
+}
+
+void write_define(FILE *file, char *line, char *name, char *value)
+/* write line defining name with new value, keeping comment and line ending */
+{
+    char *comment, *end;
+
+    comment = strstr(line, "/*");
+    if (comment == NULL)
+        comment = strstr(line, "//");
+    end = line + strcspn(line, "\r\n");
+
+    fprintf(file, "#define %s %s", name, value);
+    if (comment != NULL)
+        fprintf(file, " %s", comment);
+    else
+        fprintf(file, "%s", end);
+}
@@ -902,3 +902,202 @@ void compute_relative_positions(t_particle particle[NMAXCIRCLES], t_hashgrid has
             particle[j].hash_nneighb = n;
         }
 }
+
+int hilbert_index(int n, int x, int y)
+/* position of cell (x,y) along the Hilbert curve filling an n by n square, n a power of 2 */
+{
+    int rx, ry, s, t, d = 0;
+
+    for (s = n / 2; s > 0; s /= 2)
+    {
+        rx = ((x & s) > 0);
+        ry = ((y & s) > 0);
+        d += s * s * ((3 * rx) ^ ry);
+
+        /* rotate quadrant */
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return (d);
+}
+
+double neighbour_index_spread(t_particle particle[NMAXCIRCLES])
+/* mean distance in memory between particles and their hashgrid neighbours */
+/* grows as particles diffuse, and measures the locality of the force computation */
+{
+    int j, k;
+    long int count = 0;
+    double spread = 0.0;
+
+#pragma omp parallel for private(j, k) reduction(+ : spread, count)
+    for (j = 0; j < ncircles; j++)
+        if (particle[j].active)
+        {
+            for (k = 0; k < particle[j].hash_nneighb; k++)
+                spread += (double)abs(particle[j].hashneighbour[k] - j);
+            count += particle[j].hash_nneighb;
+        }
+
+    if (count == 0)
+        return (0.0);
+    return (spread / (double)count);
+}
+
+typedef struct
+{
+    int key;                    /* position along Hilbert curve */
+    int index;                  /* index of particle before reordering */
+} t_sortkey;
+
+int compare_sortkeys(const void *a, const void *b)
+/* comparison function for qsort, stable thanks to tie-breaking on index */
+{
+    const t_sortkey *ka = (const t_sortkey *)a, *kb = (const t_sortkey *)b;
+
+    if (ka->key != kb->key)
+        return ((ka->key > kb->key) - (ka->key < kb->key));
+    return ((ka->index > kb->index) - (ka->index < kb->index));
+}
+
+void permute_array(double *array, int *perm, double *buffer)
+/* apply permutation perm (new index -> old index) to array */
+{
+    int i;
+
+    for (i = 0; i < ncircles; i++)
+        buffer[i] = array[perm[i]];
+    for (i = 0; i < ncircles; i++)
+        array[i] = buffer[i];
+}
+
+void reorder_particles(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HASHX * HASHY],
+                       double px[NMAXCIRCLES], double py[NMAXCIRCLES], double pangle[NMAXCIRCLES],
+                       double qx[NMAXCIRCLES], double qy[NMAXCIRCLES], double qangle[NMAXCIRCLES],
+                       int tracer_n[N_TRACER_PARTICLES])
+/* renumber particles along a Hilbert curve over the hashgrid, so that neighbours are close in memory */
+/* inactive particles are moved to the end, the order within a hash cell is preserved */
+{
+    int i, j, n, start, cellx, celly, *perm, *newindex;
+    short int *done;
+    double *buffer;
+    t_sortkey *keys;
+    t_particle *tmp;
+
+    n = 1;
+    while ((n < HASHX) || (n < HASHY))
+        n *= 2;
+
+    keys = (t_sortkey *)malloc(ncircles * sizeof(t_sortkey));
+    perm = (int *)malloc(ncircles * sizeof(int));
+    newindex = (int *)malloc(ncircles * sizeof(int));
+    done = (short int *)malloc(ncircles * sizeof(short int));
+    buffer = (double *)malloc(ncircles * sizeof(double));
+    tmp = (t_particle *)malloc(sizeof(t_particle));
+
+    for (i = 0; i < ncircles; i++)
+    {
+        cellx = particle[i].hashcell / HASHY;
+        celly = particle[i].hashcell % HASHY;
+        keys[i].key = hilbert_index(n, cellx, celly);
+        if (!particle[i].active)
+            keys[i].key += n * n;
+        keys[i].index = i;
+    }
+    qsort(keys, ncircles, sizeof(t_sortkey), compare_sortkeys);
+
+    for (i = 0; i < ncircles; i++)
+    {
+        perm[i] = keys[i].index;
+        newindex[perm[i]] = i;
+        done[i] = 0;
+    }
+
+    /* permute particles in place, following the cycles of the permutation */
+    for (start = 0; start < ncircles; start++)
+        if (!done[start])
+        {
+            *tmp = particle[start];
+            i = start;
+            while (perm[i] != start)
+            {
+                particle[i] = particle[perm[i]];
+                done[i] = 1;
+                i = perm[i];
+            }
+            particle[i] = *tmp;
+            done[i] = 1;
+        }
+
+    permute_array(px, perm, buffer);
+    permute_array(py, perm, buffer);
+    permute_array(pangle, perm, buffer);
+    permute_array(qx, perm, buffer);
+    permute_array(qy, perm, buffer);
+    permute_array(qangle, perm, buffer);
+
+    if (TRACER_PARTICLE)
+        for (j = 0; j < N_TRACER_PARTICLES; j++)
+            tracer_n[j] = newindex[tracer_n[j]];
+
+    /* neighbour lists refer to old indices and have to be rebuilt */
+    update_hashgrid(particle, hashgrid, 0);
+    compute_relative_positions(particle, hashgrid);
+
+    free(keys);
+    free(perm);
+    free(newindex);
+    free(done);
+    free(buffer);
+    free(tmp);
+}
+
+int update_particle_order(t_particle particle[NMAXCIRCLES], t_hashgrid hashgrid[HASHX * HASHY],
+                          double px[NMAXCIRCLES], double py[NMAXCIRCLES], double pangle[NMAXCIRCLES],
+                          double qx[NMAXCIRCLES], double qy[NMAXCIRCLES], double qangle[NMAXCIRCLES],
+                          int tracer_n[N_TRACER_PARTICLES])
+/* reorder particles when locality of neighbour accesses has degraded by factor REORDER_THRESHOLD */
+/* as long as there is no reference spread, the spread is compared to the square root of the    */
+/* number of active particles, the spread of a lattice numbered row by row                      */
+/* returns 1 if particles have been reordered */
+{
+    static double reference_spread = -1.0;
+    double spread, new_spread;
+    int i, nactive = 0;
+
+    spread = neighbour_index_spread(particle);
+
+    if (reference_spread > 0.0)
+    {
+        if (spread < REORDER_THRESHOLD * reference_spread)
+            return (0);
+    }
+    else
+    {
+        for (i = 0; i < ncircles; i++)
+            if (particle[i].active)
+                nactive++;
+        if (spread < REORDER_THRESHOLD * sqrt((double)nactive))
+        {
+            if (spread > 0.0)
+                reference_spread = spread;
+            return (0);
+        }
+    }
+
+    printf("Reordering particles along Hilbert curve (neighbour index spread %.1f)\n", spread);
+    reorder_particles(particle, hashgrid, px, py, pangle, qx, qy, qangle, tracer_n);
+    new_spread = neighbour_index_spread(particle);
+    printf("Neighbour index spread after reordering: %.1f\n", new_spread);
+    if (new_spread > 0.0)
+        reference_spread = new_spread;
+    return (1);
+}
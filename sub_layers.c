@@ -0,0 +1,99 @@
+/* cached static overlay layers                                                        */
+/* Static overlays (billiard boundary, container and obstacles, colour bars) are       */
+/* recorded once in an OpenGL display list, and replayed at each frame. Each overlay    */
+/* is identified by a key, which is a hash of the geometry it depends on, so that it    */
+/* is only recorded again when this geometry changes (moving obstacles, lid, wall,      */
+/* container compression...). An overlay may use several slots, for instance for the   */
+/* colour bars of the two movies of DOUBLE_MOVIE.                                       */
+
+/* Usage:                                                                               */
+/*     if (begin_layer(layer, NSLOTS, key))                                             */
+/*     {                                                                                */
+/*         ... draw overlay ...                                                         */
+/*         end_layer(layer, NSLOTS);                                                    */
+/*     }                                                                                */
+
+#define CACHE_LAYERS 1      /* set to 0 to redraw static overlays at every frame */
+#define LAYER_HASH_SEED 14695981039346656037UL
+
+typedef struct
+{
+    GLuint list;            /* display list containing overlay */
+    int valid;              /* has value 1 if list has been recorded */
+    unsigned long key;      /* hash of geometry of recorded overlay */
+    unsigned long used;     /* time of last use, to recycle least recently used slot */
+} t_layer;
+
+unsigned long layer_clock = 0;
+t_layer *layer_recording = NULL;   /* slot being recorded */
+
+unsigned long layer_hash(unsigned long hash, void *data, size_t size)
+/* update FNV-1a hash with data, 8 bytes at a time */
+{
+    size_t k, nwords;
+    unsigned long word;
+    unsigned char *bytes = (unsigned char *)data;
+
+    nwords = size/sizeof(unsigned long);
+    for (k=0; k<nwords; k++)
+    {
+        memcpy(&word, bytes + k*sizeof(unsigned long), sizeof(unsigned long));
+        hash = (hash ^ word)*1099511628211UL;
+    }
+    for (k=nwords*sizeof(unsigned long); k<size; k++)
+        hash = (hash ^ (unsigned long)bytes[k])*1099511628211UL;
+    return(hash);
+}
+
+unsigned long layer_hash_double(unsigned long hash, double x)
+{
+    return(layer_hash(hash, &x, sizeof(double)));
+}
+
+int begin_layer(t_layer layer[], int nslots, unsigned long key)
+/* draw overlay with given key if it has been recorded, and return 0 */
+/* otherwise start recording it in least recently used slot, and return 1 */
+{
+    int k, oldest = 0;
+
+    if ((!CACHE_LAYERS)||(layer_recording != NULL)) return(1);
+
+    layer_clock++;
+    for (k=0; k<nslots; k++)
+    {
+        if ((layer[k].valid)&&(layer[k].key == key))
+        {
+            layer[k].used = layer_clock;
+            glCallList(layer[k].list);
+            return(0);
+        }
+        if (layer[k].used < layer[oldest].used) oldest = k;
+    }
+
+    if (layer[oldest].list == 0) layer[oldest].list = glGenLists(1);
+    if (layer[oldest].list == 0) return(1);     /* no display list available, draw directly */
+    layer[oldest].key = key;
+    layer[oldest].used = layer_clock;
+    layer[oldest].valid = 1;
+    glNewList(layer[oldest].list, GL_COMPILE_AND_EXECUTE);
+    layer_recording = &layer[oldest];
+    return(1);
+}
+
+void end_layer(t_layer layer[], int nslots)
+/* end recording of overlay started by begin_layer */
+{
+    if ((layer_recording >= layer)&&(layer_recording < layer + nslots))
+    {
+        glEndList();
+        layer_recording = NULL;
+    }
+}
+
+void invalidate_layer(t_layer layer[], int nslots)
+/* force overlay to be recorded again, e.g. when geometry changed outside the key */
+{
+    int k;
+
+    for (k=0; k<nslots; k++) layer[k].valid = 0;
+}
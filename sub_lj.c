@@ -4,6 +4,7 @@
 #include <GL/glut.h>
 #include "tiffio.h"
 #include "colors_waves.c"
+#include "sub_layers.c"
 #define PI M_PI
 
 // #define HUE_TYPE0 260.0     /* hue of particles of type 0 */
@@ -828,9 +829,11 @@ void init_particle_config(t_particle particles[NMAXCIRCLES])
 void init_people_config(t_person people[NMAXCIRCLES])
 /* initialise particle configuration */
 {
-    t_particle particles[NMAXCIRCLES];
+    t_particle *particles;
     int n;
 
+    /* t_particle is large, so the temporary configuration does not fit on the stack */
+    particles = (t_particle *)malloc(NMAXCIRCLES * sizeof(t_particle));
     init_particle_config(particles);
 
     for (n = 0; n < ncircles; n++)
@@ -840,6 +843,7 @@ void init_people_config(t_person people[NMAXCIRCLES])
         people[n].radius = particles[n].radius;
         people[n].active = particles[n].active;
     }
+    free(particles);
 }
 
 void init_obstacle_config(t_obstacle obstacle[NMAXOBSTACLES])
@@ -1750,16 +1754,31 @@ double neighbour_color(int nnbg)
     }
 }
 
+void compute_mixing_entropy(double p1, double p2, double entropy[2])
+/* entropies of both types of particles, given the fractions p1, p2 of particles on the left */
+{
+    static double log2 = 0.0;
+
+    if (log2 == 0.0)
+        log2 = log(2.0);
+    if ((p1 == 0.0) || (p1 == 1.0))
+        entropy[0] = 0.0;
+    else
+        entropy[0] = -(p1 * log(p1) + (1.0 - p1) * log(1.0 - p1) / log2);
+    if ((p2 == 0.0) || (p2 == 1.0))
+        entropy[1] = 0.0;
+    else
+        entropy[1] = -(p2 * log(p2) + (1.0 - p2) * log(1.0 - p2) / log2);
+}
+
 void compute_entropy(t_particle particle[NMAXCIRCLES], double entropy[2])
 {
     int i, nleft1 = 0, nleft2 = 0;
     double p1, p2, x;
     static int first = 1, ntot1 = 0, ntot2 = 0;
-    static double log2;
 
     if (first)
     {
-        log2 = log(2.0);
         for (i = 0; i < ncircles; i++)
             if (particle[i].type == 0)
                 ntot1++;
@@ -1787,16 +1806,7 @@ void compute_entropy(t_particle particle[NMAXCIRCLES], double entropy[2])
     }
     p1 = (double)nleft1 / (double)ntot1;
     p2 = (double)nleft2 / (double)ntot2;
-    printf("Type 1: nleft = %i, ntot = %i, p = %.3lg\n", nleft1, ntot1, p1);
-    printf("Type 2: nleft = %i, ntot = %i, p = %.3lg\n", nleft2, ntot2, p2);
-    if ((p1 == 0.0) || (p1 == 1.0))
-        entropy[0] = 0.0;
-    else
-        entropy[0] = -(p1 * log(p1) + (1.0 - p1) * log(1.0 - p1) / log2);
-    if ((p2 == 0.0) || (p2 == 1.0))
-        entropy[1] = 0.0;
-    else
-        entropy[1] = -(p2 * log(p2) + (1.0 - p2) * log(1.0 - p2) / log2);
+    compute_mixing_entropy(p1, p2, entropy);
 }
 
 void draw_one_particle_links(t_particle particle)
@@ -1984,15 +1994,145 @@ void draw_one_particle(t_particle particle, double xc, double yc, double radius,
         }
 }
 
-void draw_trajectory(t_tracer trajectory[TRAJECTORY_LENGTH * N_TRACER_PARTICLES], int traj_position, int traj_length)
-/* draw tracer particle trajectory */
+void init_trail(t_trail *trail)
+/* empty tracer particle trajectory */
+{
+    int c;
+
+    trail->first = 0;
+    trail->nchunks = 0;
+    trail->time = -1;
+    trail->error = 0.0;
+    for (c = 0; c < TRAIL_NCHUNKS; c++)
+    {
+        trail->chunk[c].npoints = 0;
+        trail->chunk[c].compiled = 0;
+        trail->chunk[c].list = 0;
+    }
+}
+
+int trail_jump(t_trail_point *a, t_trail_point *b)
+/* segments across periodic boundary conditions are not drawn */
 {
-    int i, j, time;
-    double x1, x2, y1, y2, rgb[3], lum;
+    return (module2(b->xc - a->xc, b->yc - a->yc) >= 0.1 * (YMAX - YMIN));
+}
+
+t_trail_chunk *new_trail_chunk(t_trail *trail)
+/* add empty chunk at end of ring buffer, dropping the oldest one if necessary */
+{
+    t_trail_chunk *chunk;
+
+    if (trail->nchunks == TRAIL_NCHUNKS)
+    {
+        trail->first = (trail->first + 1) % TRAIL_NCHUNKS;
+        trail->nchunks--;
+    }
+    chunk = &trail->chunk[(trail->first + trail->nchunks) % TRAIL_NCHUNKS];
+    chunk->npoints = 0;
+    chunk->compiled = 0;
+    trail->nchunks++;
+    return (chunk);
+}
+
+void add_trail_point(t_trail *trail, double x, double y, int time)
+/* add position of tracer particle at given frame to its trajectory                       */
+/* the last point is replaced by the new one as long as the points merged into it stay    */
+/* within TRAJECTORY_TOLERANCE of the simplified trajectory, so that straight parts of    */
+/* the trajectory use few segments                                                        */
+{
+    int n;
+    double dx, dy, length, deviation;
+    t_trail_chunk *chunk, *previous;
+    t_trail_point p, *a, *b;
+
+    p.xc = (float)x;
+    p.yc = (float)y;
+    p.time = time;
+
+    /* drop chunks that have faded out */
+    while ((trail->nchunks > 1) &&
+           (trail->chunk[trail->first].point[trail->chunk[trail->first].npoints - 1].time <= time - TRAJECTORY_LENGTH))
+    {
+        trail->first = (trail->first + 1) % TRAIL_NCHUNKS;
+        trail->nchunks--;
+    }
+
+    if (trail->nchunks == 0)
+        chunk = new_trail_chunk(trail);
+    else
+        chunk = &trail->chunk[(trail->first + trail->nchunks - 1) % TRAIL_NCHUNKS];
+
+    /* a chunk is closed when it is full or spans TRAIL_CHUNK frames, so that its age is  */
+    /* well defined, and closed chunks are not modified any more since they may be recorded */
+    if ((chunk->npoints == TRAIL_CHUNK + 1) || ((chunk->npoints > 1) && (time - chunk->point[0].time >= TRAIL_CHUNK)))
+    {
+        previous = chunk;
+        chunk = new_trail_chunk(trail);
+        chunk->point[0] = previous->point[previous->npoints - 1];
+        chunk->npoints = 1;
+    }
+
+    n = chunk->npoints;
+    if (n >= 2)
+    {
+        a = &chunk->point[n - 2];
+        b = &chunk->point[n - 1];
+        if ((!trail_jump(a, b)) && (!trail_jump(b, &p)))
+        {
+            /* distance from last point to segment joining previous point and new one */
+            dx = p.xc - a->xc;
+            dy = p.yc - a->yc;
+            length = module2(dx, dy);
+            if (length > 1.0e-10)
+                deviation = vabs(dx * (b->yc - a->yc) - dy * (b->xc - a->xc)) / length;
+            else
+                deviation = module2(b->xc - a->xc, b->yc - a->yc);
+            if (trail->error + deviation < TRAJECTORY_TOLERANCE)
+            {
+                *b = p;
+                trail->error += deviation;
+                trail->time = time;
+                return;
+            }
+        }
+    }
+
+    chunk->point[n] = p;
+    chunk->npoints++;
+    trail->error = 0.0;
+    trail->time = time;
+}
+
+void draw_trail_chunk(t_trail_chunk *chunk)
+/* draw chunk of trajectory, interrupted where the tracer particle crosses the boundary */
+{
+    int i;
+
+    glBegin(GL_LINE_STRIP);
+    glVertex2d(chunk->point[0].xc, chunk->point[0].yc);
+    for (i = 1; i < chunk->npoints; i++)
+    {
+        if (trail_jump(&chunk->point[i - 1], &chunk->point[i]))
+        {
+            glEnd();
+            glBegin(GL_LINE_STRIP);
+        }
+        glVertex2d(chunk->point[i].xc, chunk->point[i].yc);
+    }
+    glEnd();
+}
+
+void draw_trails(t_trail trail[N_TRACER_PARTICLES])
+/* draw tracer particle trajectories, fading with age                                     */
+/* Closed chunks are recorded once in a display list, which is replayed in the colour     */
+/* given by the age of the chunk, so that only the points of the last chunk are sent at   */
+/* each frame                                                                             */
+{
+    int j, c;
+    double rgb[3], lum, age;
+    t_trail_chunk *chunk;
 
-    blank();
     glLineWidth(TRAJECTORY_WIDTH);
-    printf("drawing trajectory\n");
 
     for (j = 0; j < N_TRACER_PARTICLES; j++)
     {
@@ -2002,63 +2142,245 @@ void draw_trajectory(t_tracer trajectory[TRAJECTORY_LENGTH * N_TRACER_PARTICLES]
             hsl_to_rgb(HUE_TYPE2, 0.9, 0.5, rgb);
         else
             hsl_to_rgb(HUE_TYPE3, 0.9, 0.5, rgb);
-        glColor3f(rgb[0], rgb[1], rgb[2]);
 
-        if (traj_length < TRAJECTORY_LENGTH)
-            for (i = 0; i < traj_length - 1; i++)
-            {
-                x1 = trajectory[j * TRAJECTORY_LENGTH + i].xc;
-                x2 = trajectory[j * TRAJECTORY_LENGTH + i + 1].xc;
-                y1 = trajectory[j * TRAJECTORY_LENGTH + i].yc;
-                y2 = trajectory[j * TRAJECTORY_LENGTH + i + 1].yc;
+        for (c = 0; c < trail[j].nchunks; c++)
+        {
+            chunk = &trail[j].chunk[(trail[j].first + c) % TRAIL_NCHUNKS];
+            if (chunk->npoints < 2)
+                continue;
 
-                time = traj_length - i;
-                lum = 1.0 - (double)time / (double)TRAJECTORY_LENGTH;
-                glColor3f(lum * rgb[0], lum * rgb[1], lum * rgb[2]);
+            age = (double)trail[j].time - 0.5 * (double)(chunk->point[0].time + chunk->point[chunk->npoints - 1].time);
+            lum = 1.0 - age / (double)TRAJECTORY_LENGTH;
+            if (lum <= 0.0)
+                continue;
+            glColor3f(lum * rgb[0], lum * rgb[1], lum * rgb[2]);
 
-                if (module2(x2 - x1, y2 - y1) < 0.25 * (YMAX - YMIN))
-                    draw_line(x1, y1, x2, y2);
+            if (chunk->compiled)
+                glCallList(chunk->list);
+            else if ((CACHE_LAYERS) && (c < trail[j].nchunks - 1) && (layer_recording == NULL))
+            {
+                if (chunk->list == 0)
+                    chunk->list = glGenLists(1);
+                if (chunk->list != 0)
+                {
+                    glNewList(chunk->list, GL_COMPILE_AND_EXECUTE);
+                    draw_trail_chunk(chunk);
+                    glEndList();
+                    chunk->compiled = 1;
+                }
+                else
+                    draw_trail_chunk(chunk);
+            }
+            else
+                draw_trail_chunk(chunk);
+        }
+    }
+}
+
+void convert_particle_view_colors(t_particle particle[NMAXCIRCLES], t_particle_view view[NMAXCIRCLES])
+/* convert colours of view given as hue, saturation and luminosity to RGB, by blocks of HSLUV_BATCH particles */
+{
+    int j0, j, n, k;
+    double hsl[3 * HSLUV_BATCH], rgb[3 * HSLUV_BATCH];
 
-                //             printf("(x1, y1) = (%.3lg, %.3lg), (x2, y2) = (%.3lg, %.3lg)\n", x1, y1, x2, y2);
+#pragma omp parallel for private(j0, j, n, k, hsl, rgb)
+    for (j0 = 0; j0 < ncircles; j0 += HSLUV_BATCH)
+    {
+        n = 0;
+        for (j = j0; (j < j0 + HSLUV_BATCH) && (j < ncircles); j++)
+            if (particle[j].active)
+            {
+                for (k = 0; k < 3; k++)
+                    hsl[3 * n + k] = view[j].rgb[k];
+                n++;
             }
-        else
-        {
-            for (i = traj_position + 1; i < traj_length - 1; i++)
+
+        hsl_to_rgb_batch(n, hsl, rgb, COLOR_PALETTE);
+
+        n = 0;
+        for (j = j0; (j < j0 + HSLUV_BATCH) && (j < ncircles); j++)
+            if (particle[j].active)
             {
-                x1 = trajectory[j * TRAJECTORY_LENGTH + i].xc;
-                x2 = trajectory[j * TRAJECTORY_LENGTH + i + 1].xc;
-                y1 = trajectory[j * TRAJECTORY_LENGTH + i].yc;
-                y2 = trajectory[j * TRAJECTORY_LENGTH + i + 1].yc;
+                for (k = 0; k < 3; k++)
+                    view[j].rgb[k] = rgb[3 * n + k];
+                n++;
+            }
+    }
+}
 
-                time = traj_position + traj_length - i;
-                lum = 1.0 - (double)time / (double)TRAJECTORY_LENGTH;
-                glColor3f(lum * rgb[0], lum * rgb[1], lum * rgb[2]);
+void compute_particle_views(t_particle particle[NMAXCIRCLES], int nviews, int plot[], t_particle_view *view[])
+/* compute colours and sizes of particles for nviews plots, in one sweep */
+{
+    int j, v, width, nsides;
+    double ej, hue, huex, huey, radius, angle;
 
-                if (module2(x2 - x1, y2 - y1) < 0.1 * (YMAX - YMIN))
-                    draw_line(x1, y1, x2, y2);
+#pragma omp parallel for private(j, v, width, nsides, ej, hue, huex, huey, radius, angle)
+    for (j = 0; j < ncircles; j++)
+        if (particle[j].active)
+        {
+            radius = particle[j].radius;
+            switch (particle[j].interaction)
+            {
+            case (I_LJ_DIRECTIONAL):
+            {
+                nsides = 4;
+                break;
             }
-            for (i = 0; i < traj_position - 1; i++)
+            case (I_LJ_PENTA):
             {
-                x1 = trajectory[j * TRAJECTORY_LENGTH + i].xc;
-                x2 = trajectory[j * TRAJECTORY_LENGTH + i + 1].xc;
-                y1 = trajectory[j * TRAJECTORY_LENGTH + i].yc;
-                y2 = trajectory[j * TRAJECTORY_LENGTH + i + 1].yc;
+                nsides = 5;
+                break;
+            }
+            case (I_LJ_QUADRUPOLE):
+            {
+                nsides = 4;
+                break;
+            }
+            case (I_LJ_WATER):
+            {
+                nsides = NSEG;
+                radius = 0.75 * particle[j].radius;
+                break;
+            }
+            default:
+                nsides = NSEG;
+            }
 
-                time = traj_position - i;
-                lum = 1.0 - (double)time / (double)TRAJECTORY_LENGTH;
-                glColor3f(lum * rgb[0], lum * rgb[1], lum * rgb[2]);
+            for (v = 0; v < nviews; v++)
+            {
+                switch (plot[v])
+                {
+                case (P_KINETIC):
+                {
+                    ej = particle[j].energy;
+                    hue = ENERGY_HUE_MIN;
+                    if (ej > 0.0)
+                    {
+                        hue = ENERGY_HUE_MIN + (ENERGY_HUE_MAX - ENERGY_HUE_MIN) * ej / PARTICLE_EMAX;
+                        if (hue > ENERGY_HUE_MIN)
+                            hue = ENERGY_HUE_MIN;
+                        if (hue < ENERGY_HUE_MAX)
+                            hue = ENERGY_HUE_MAX;
+                    }
+                    width = BOUNDARY_WIDTH;
+                    break;
+                }
+                case (P_NEIGHBOURS):
+                {
+                    hue = neighbour_color(particle[j].neighb);
+                    width = BOUNDARY_WIDTH;
+                    break;
+                }
+                case (P_BONDS):
+                {
+                    //                 if (particle[j].type == 1) hue = 70.0;        /* to make second particle type more visible */
+                    //                 if (particle[j].type == 1) hue = neighbour_color(7 - particle[j].neighb);
+                    //                 else
+                    hue = neighbour_color(particle[j].neighb);
+                    width = 1;
+                    break;
+                }
+                case (P_ANGLE):
+                {
+                    angle = particle[j].angle;
+                    hue = angle * particle[j].spin_freq / DPI;
+                    hue -= (double)((int)hue);
+                    huex = (DPI - angle) * particle[j].spin_freq / DPI;
+                    huex -= (double)((int)huex);
+                    angle = PI - angle;
+                    if (angle < 0.0)
+                        angle += DPI;
+                    huey = angle * particle[j].spin_freq / DPI;
+                    huey -= (double)((int)huey);
+                    hue = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * hue;
+                    huex = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * huex;
+                    huey = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * huey;
+                    width = BOUNDARY_WIDTH;
+                    break;
+                }
+                case (P_TYPE):
+                {
+                    //                 if (particle[j].type == 0) hue = 310.0;
+                    //                 else hue = 70.0;
+                    if (particle[j].type <= 1)
+                        hue = HUE_TYPE0;
+                    else if (particle[j].type == 2)
+                        hue = HUE_TYPE1;
+                    else if (particle[j].type == 3)
+                        hue = HUE_TYPE2;
+                    else
+                        hue = HUE_TYPE3;
+                    width = BOUNDARY_WIDTH;
+                    break;
+                }
+                case (P_DIRECTION):
+                {
+                    hue = argument(particle[j].vx, particle[j].vy);
+                    if (hue > DPI)
+                        hue -= DPI;
+                    if (hue < 0.0)
+                        hue += DPI;
+                    hue = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * hue / DPI;
+                    width = BOUNDARY_WIDTH;
+                    break;
+                }
+                case (P_ANGULAR_SPEED):
+                {
+                    hue = 160.0 * (1.0 + tanh(SLOPE * particle[j].omega));
+                    //                 printf("omega = %.3lg, hue = %.3lg\n", particle[j].omega, hue);
+                    width = BOUNDARY_WIDTH;
+                    break;
+                }
+                }
 
-                if (module2(x2 - x1, y2 - y1) < 0.1 * (YMAX - YMIN))
-                    draw_line(x1, y1, x2, y2);
+                switch (plot[v])
+                {
+                case (P_KINETIC):
+                {
+                    hsl_to_rgb_turbo(hue, 0.9, 0.5, view[v][j].rgb);
+                    break;
+                }
+                case (P_BONDS):
+                {
+                    hsl_to_rgb_turbo(hue, 0.9, 0.5, view[v][j].rgb);
+                    break;
+                }
+                case (P_DIRECTION):
+                {
+                    hsl_to_rgb_twilight(hue, 0.9, 0.5, view[v][j].rgb);
+                    break;
+                }
+                default:
+                {
+                    /* HSLuv colours are converted by blocks after the sweep */
+                    if (COLOR_PALETTE == COL_HSLUV)
+                    {
+                        view[v][j].rgb[0] = hue;
+                        view[v][j].rgb[1] = 0.9;
+                        view[v][j].rgb[2] = 0.5;
+                    }
+                    else
+                        hsl_to_rgb(hue, 0.9, 0.5, view[v][j].rgb);
+                }
+                }
+                view[v][j].radius = radius;
+                view[v][j].nsides = nsides;
+                view[v][j].width = width;
             }
         }
-    }
+
+    if (COLOR_PALETTE == COL_HSLUV)
+        for (v = 0; v < nviews; v++)
+            if ((plot[v] != P_KINETIC) && (plot[v] != P_BONDS) && (plot[v] != P_DIRECTION))
+                convert_particle_view_colors(particle, view[v]);
 }
 
-void draw_particles(t_particle particle[NMAXCIRCLES], int plot)
+void draw_particle_view(t_particle particle[NMAXCIRCLES], int plot, t_particle_view view[NMAXCIRCLES])
+/* draw particles with colours computed by compute_particle_views */
 {
-    int i, j, k, m, width, nnbg, nsides;
-    double ej, hue, huex, huey, rgb[3], rgbx[3], rgby[3], radius, x1, y1, x2, y2, angle, ca, sa, length, linkcolor, sign = 1.0, angle1, signy = 1.0, periodx, periody, x, y;
+    int i, j, k, width, nsides;
+    double radius, x1, y1, x2, y2, angle, sign = 1.0, angle1, signy = 1.0, periodx, periody, x, y;
+    double *rgb;
     char message[100];
 
     if (!TRACER_PARTICLE)
@@ -2100,158 +2422,13 @@ void draw_particles(t_particle particle[NMAXCIRCLES], int plot)
         //         }
     }
 
-    /* determine particle color and size */
     for (j = 0; j < ncircles; j++)
         if (particle[j].active)
         {
-            switch (plot)
-            {
-            case (P_KINETIC):
-            {
-                ej = particle[j].energy;
-                if (ej > 0.0)
-                {
-                    hue = ENERGY_HUE_MIN + (ENERGY_HUE_MAX - ENERGY_HUE_MIN) * ej / PARTICLE_EMAX;
-                    if (hue > ENERGY_HUE_MIN)
-                        hue = ENERGY_HUE_MIN;
-                    if (hue < ENERGY_HUE_MAX)
-                        hue = ENERGY_HUE_MAX;
-                }
-                radius = particle[j].radius;
-                width = BOUNDARY_WIDTH;
-                break;
-            }
-            case (P_NEIGHBOURS):
-            {
-                hue = neighbour_color(particle[j].neighb);
-                radius = particle[j].radius;
-                width = BOUNDARY_WIDTH;
-                break;
-            }
-            case (P_BONDS):
-            {
-                //                 if (particle[j].type == 1) hue = 70.0;        /* to make second particle type more visible */
-                //                 if (particle[j].type == 1) hue = neighbour_color(7 - particle[j].neighb);
-                //                 else
-                hue = neighbour_color(particle[j].neighb);
-                radius = particle[j].radius;
-                width = 1;
-                break;
-            }
-            case (P_ANGLE):
-            {
-                angle = particle[j].angle;
-                hue = angle * particle[j].spin_freq / DPI;
-                hue -= (double)((int)hue);
-                huex = (DPI - angle) * particle[j].spin_freq / DPI;
-                huex -= (double)((int)huex);
-                angle = PI - angle;
-                if (angle < 0.0)
-                    angle += DPI;
-                huey = angle * particle[j].spin_freq / DPI;
-                huey -= (double)((int)huey);
-                hue = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * hue;
-                huex = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * huex;
-                huey = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * huey;
-                radius = particle[j].radius;
-                width = BOUNDARY_WIDTH;
-                break;
-            }
-            case (P_TYPE):
-            {
-                //                 if (particle[j].type == 0) hue = 310.0;
-                //                 else hue = 70.0;
-                if (particle[j].type <= 1)
-                    hue = HUE_TYPE0;
-                else if (particle[j].type == 2)
-                    hue = HUE_TYPE1;
-                else if (particle[j].type == 3)
-                    hue = HUE_TYPE2;
-                else
-                    hue = HUE_TYPE3;
-                radius = particle[j].radius;
-                width = BOUNDARY_WIDTH;
-                break;
-            }
-            case (P_DIRECTION):
-            {
-                hue = argument(particle[j].vx, particle[j].vy);
-                if (hue > DPI)
-                    hue -= DPI;
-                if (hue < 0.0)
-                    hue += DPI;
-                hue = PARTICLE_HUE_MIN + (PARTICLE_HUE_MAX - PARTICLE_HUE_MIN) * hue / DPI;
-                radius = particle[j].radius;
-                width = BOUNDARY_WIDTH;
-                break;
-            }
-            case (P_ANGULAR_SPEED):
-            {
-                hue = 160.0 * (1.0 + tanh(SLOPE * particle[j].omega));
-                //                 printf("omega = %.3lg, hue = %.3lg\n", particle[j].omega, hue);
-                radius = particle[j].radius;
-                width = BOUNDARY_WIDTH;
-                break;
-            }
-            }
-
-            switch (particle[j].interaction)
-            {
-            case (I_LJ_DIRECTIONAL):
-            {
-                nsides = 4;
-                break;
-            }
-            case (I_LJ_PENTA):
-            {
-                nsides = 5;
-                break;
-            }
-            case (I_LJ_QUADRUPOLE):
-            {
-                nsides = 4;
-                break;
-            }
-            case (I_LJ_WATER):
-            {
-                nsides = NSEG;
-                radius *= 0.75;
-                break;
-            }
-            default:
-                nsides = NSEG;
-            }
-
-            switch (plot)
-            {
-            case (P_KINETIC):
-            {
-                hsl_to_rgb_turbo(hue, 0.9, 0.5, rgb);
-                hsl_to_rgb_turbo(hue, 0.9, 0.5, rgbx);
-                hsl_to_rgb_turbo(hue, 0.9, 0.5, rgby);
-                break;
-            }
-            case (P_BONDS):
-            {
-                hsl_to_rgb_turbo(hue, 0.9, 0.5, rgb);
-                hsl_to_rgb_turbo(hue, 0.9, 0.5, rgbx);
-                hsl_to_rgb_turbo(hue, 0.9, 0.5, rgby);
-                break;
-            }
-            case (P_DIRECTION):
-            {
-                hsl_to_rgb_twilight(hue, 0.9, 0.5, rgb);
-                hsl_to_rgb_twilight(hue, 0.9, 0.5, rgbx);
-                hsl_to_rgb_twilight(hue, 0.9, 0.5, rgby);
-                break;
-            }
-            default:
-            {
-                hsl_to_rgb(hue, 0.9, 0.5, rgb);
-                hsl_to_rgb(hue, 0.9, 0.5, rgbx);
-                hsl_to_rgb(hue, 0.9, 0.5, rgby);
-            }
-            }
+            rgb = view[j].rgb;
+            radius = view[j].radius;
+            nsides = view[j].nsides;
+            width = view[j].width;
             angle = particle[j].angle + APOLY * DPI;
 
             draw_one_particle(particle[j], particle[j].xc, particle[j].yc, radius, angle, nsides, width, rgb);
@@ -2305,10 +2482,10 @@ void draw_particles(t_particle particle[NMAXCIRCLES], int plot)
                             angle1 = PI - angle;
                         if (sign == -1.0)
                             draw_one_particle(particle[j], signy * (x1 + (double)i * (BCXMAX - BCXMIN)),
-                                              sign * (y1 + (double)k * (BCYMAX - BCYMIN)), radius, angle1, nsides, width, rgbx);
+                                              sign * (y1 + (double)k * (BCYMAX - BCYMIN)), radius, angle1, nsides, width, rgb);
                         else if (signy == -1.0)
                             draw_one_particle(particle[j], signy * (x1 + (double)i * (BCXMAX - BCXMIN)),
-                                              sign * (y1 + (double)k * (BCYMAX - BCYMIN)), radius, angle1, nsides, width, rgby);
+                                              sign * (y1 + (double)k * (BCYMAX - BCYMIN)), radius, angle1, nsides, width, rgb);
                         else
                             draw_one_particle(particle[j], signy * (x1 + (double)i * (BCXMAX - BCXMIN)),
                                               sign * (y1 + (double)k * (BCYMAX - BCYMIN)), radius, angle1, nsides, width, rgb);
@@ -2361,7 +2538,10 @@ void draw_particles(t_particle particle[NMAXCIRCLES], int plot)
     //     /* draw spin vectors */
     if ((DRAW_SPIN) || (DRAW_SPIN_B))
     {
-        glLineWidth(width);
+        if (plot == P_BONDS)
+            glLineWidth(1);
+        else
+            glLineWidth(BOUNDARY_WIDTH);
         for (j = 0; j < ncircles; j++)
             if ((particle[j].active) && (((DRAW_SPIN) && (particle[j].type == 0)) || ((DRAW_SPIN_B) && (particle[j].type == 1))))
             {
@@ -2378,7 +2558,18 @@ void draw_particles(t_particle particle[NMAXCIRCLES], int plot)
     }
 }
 
-void draw_container(double xmin, double xmax, t_obstacle obstacle[NMAXOBSTACLES], int wall)
+void draw_particles(t_particle particle[NMAXCIRCLES], int plot)
+/* draw particles for a single plot */
+{
+    static t_particle_view *view = NULL;
+
+    if (view == NULL)
+        view = (t_particle_view *)malloc(NMAXCIRCLES * sizeof(t_particle_view));
+    compute_particle_views(particle, 1, &plot, &view);
+    draw_particle_view(particle, plot, view);
+}
+
+void draw_container_nocache(double xmin, double xmax, t_obstacle obstacle[NMAXOBSTACLES], int wall)
 /* draw the container, for certain boundary conditions */
 {
     int i, j;
@@ -2608,6 +2799,32 @@ void draw_container(double xmin, double xmax, t_obstacle obstacle[NMAXOBSTACLES]
     //     }
 }
 
+t_layer container_layer[2];
+
+void draw_container(double xmin, double xmax, t_obstacle obstacle[NMAXOBSTACLES], int wall)
+/* draw the container, from cached layer if it did not move */
+{
+    unsigned long key;
+
+    key = layer_hash_double(LAYER_HASH_SEED, xmin);
+    key = layer_hash_double(key, xmax);
+    key = layer_hash_double(key, xspeed);
+    key = layer_hash_double(key, ylid);
+    key = layer_hash_double(key, xwall);
+    key = layer_hash(key, &wall, sizeof(int));
+    if (ADD_FIXED_OBSTACLES)
+    {
+        key = layer_hash(key, &nobstacles, sizeof(int));
+        key = layer_hash(key, obstacle, nobstacles * sizeof(t_obstacle));
+    }
+
+    if (begin_layer(container_layer, 2, key))
+    {
+        draw_container_nocache(xmin, xmax, obstacle, wall);
+        end_layer(container_layer, 2);
+    }
+}
+
 void print_parameters(double beta, double temperature, double krepel, double lengthcontainer, double boundary_force,
                       short int left, double pressure[N_PRESSURES], double gravity)
 {
@@ -0,0 +1,244 @@
+/* in-situ structure analysis for lennardjones.c (STRUCTURE_ANALYSIS)              */
+/* radial distribution function g(r), hexatic order psi6 and sizes of solid clusters, */
+/* computed from the neighbour lists built by compute_relative_positions()         */
+
+/* File layout:                                                                    */
+/* t_analysis_header                                                               */
+/* for each analysis: t_analysis_record, then GR_BINS doubles (g(r) at distances   */
+/* (k + 0.5)*GR_RMAX*MU/GR_BINS), then CLUSTER_BINS ints (number of clusters of    */
+/* size in [2^k, 2^(k+1)))                                                         */
+/* All records have fixed size, so that record n is at                             */
+/* sizeof(t_analysis_header) + n*header.record_size                                */
+
+/* g(r) is only reliable for distances smaller than the size of a hash cell,       */
+/* since neighbour lists do not extend beyond adjacent cells. The density used to  */
+/* normalise g(r) is that of the rectangle [BCXMIN,BCXMAX]x[BCYMIN,BCYMAX].        */
+/* Two particles are bonded if their distance is smaller than NBH_DIST_FACTOR      */
+/* times the radius, as for the neighbour count shown by P_NEIGHBOURS.             */
+
+#define ANALYSIS_MAGIC "LJSTRUC"
+#define ANALYSIS_VERSION 1
+#define CLUSTER_BINS 20 /* number of (logarithmic) bins of cluster size histogram */
+
+typedef struct
+{
+    char magic[8];      /* file signature ANALYSIS_MAGIC */
+    int version;        /* file format version */
+    int header_size;    /* size of header */
+    int record_size;    /* size of one analysis, including histograms */
+    int gr_bins;        /* number of bins of g(r) */
+    int cluster_bins;   /* number of bins of cluster size histogram */
+    int nmaxcircles;
+    double gr_rmax;     /* max distance of g(r) */
+    double bond_factor; /* NBH_DIST_FACTOR */
+    double psi6_threshold; /* min local order of solid particles */
+} t_analysis_header;
+
+typedef struct
+{
+    int step;               /* time step of simulation */
+    int nparticles;         /* number of active particles */
+    double psi6_global;     /* modulus of mean psi6 */
+    double psi6_local;      /* mean modulus of psi6 */
+    double solid_fraction;  /* fraction of particles with |psi6| > PSI6_THRESHOLD */
+    double mean_bonds;      /* mean number of bonded neighbours */
+    int nclusters;          /* number of solid clusters */
+    int largest_cluster;    /* size of largest solid cluster */
+    double mean_cluster;    /* mean size of solid clusters */
+} t_analysis_record;
+
+FILE *analysis_file = NULL;
+int *cluster_parent = NULL;
+int analysis_nrecords = 0;
+
+void open_analysis_file(char *filename)
+/* open structure analysis file for writing */
+{
+    t_analysis_header header;
+
+    analysis_file = fopen(filename, "w");
+    if (analysis_file == NULL)
+    {
+        printf("Error: cannot open analysis file %s\n", filename);
+        exit(1);
+    }
+
+    memset(&header, 0, sizeof(t_analysis_header));
+    strcpy(header.magic, ANALYSIS_MAGIC);
+    header.version = ANALYSIS_VERSION;
+    header.header_size = sizeof(t_analysis_header);
+    header.record_size = sizeof(t_analysis_record) + GR_BINS * sizeof(double) + CLUSTER_BINS * sizeof(int);
+    header.gr_bins = GR_BINS;
+    header.cluster_bins = CLUSTER_BINS;
+    header.nmaxcircles = NMAXCIRCLES;
+    header.gr_rmax = GR_RMAX * MU;
+    header.bond_factor = NBH_DIST_FACTOR;
+    header.psi6_threshold = PSI6_THRESHOLD;
+    fwrite(&header, sizeof(t_analysis_header), 1, analysis_file);
+
+    cluster_parent = (int *)malloc(NMAXCIRCLES * sizeof(int));
+    analysis_nrecords = 0;
+
+    if (GR_RMAX * MU > (BCXMAX - BCXMIN) / (double)HASHX)
+        printf("Warning: g(r) beyond %.3lg is underestimated, decrease GR_RMAX or HASHX\n", (BCXMAX - BCXMIN) / (double)HASHX);
+    printf("Saving structure analysis to %s\n", filename);
+}
+
+void close_analysis_file()
+{
+    fclose(analysis_file);
+    free(cluster_parent);
+    printf("Saved %i structure analyses\n", analysis_nrecords);
+    analysis_file = NULL;
+}
+
+int cluster_root(int i)
+/* root of cluster containing particle i, with path halving */
+{
+    while (cluster_parent[i] != i)
+    {
+        cluster_parent[i] = cluster_parent[cluster_parent[i]];
+        i = cluster_parent[i];
+    }
+    return (i);
+}
+
+void analyse_structure(int step, t_particle particle[NMAXCIRCLES])
+/* compute g(r), psi6 and solid clusters, and append them to analysis file */
+{
+    int j, k, p, bin, nbonds, n = 0, totalbonds = 0, nsolid = 0, r1, r2, largest = 0, nclusters = 0;
+    int gr_count[GR_BINS], cluster_hist[CLUSTER_BINS];
+    double dr, r, angle, re, im, re_sum = 0.0, im_sum = 0.0, local_sum = 0.0, density, shell;
+    double gr[GR_BINS];
+    double *psi6;
+    int *cluster_size;
+    t_analysis_record record;
+
+    psi6 = (double *)malloc(ncircles * sizeof(double));
+    cluster_size = (int *)malloc(ncircles * sizeof(int));
+    dr = GR_RMAX * MU / (double)GR_BINS;
+    for (k = 0; k < GR_BINS; k++)
+        gr_count[k] = 0;
+
+    /* pair distances and local hexatic order, from neighbour lists */
+#pragma omp parallel for private(j, k, r, bin, angle, re, im, nbonds) reduction(+ : n, totalbonds, nsolid, re_sum, im_sum, local_sum) reduction(+ : gr_count[:GR_BINS])
+    for (j = 0; j < ncircles; j++)
+    {
+        psi6[j] = 0.0;
+        if (particle[j].active)
+        {
+            n++;
+            re = 0.0;
+            im = 0.0;
+            nbonds = 0;
+            for (k = 0; k < particle[j].hash_nneighb; k++)
+            {
+                r = module2(particle[j].deltax[k], particle[j].deltay[k]);
+                bin = (int)(r / dr);
+                if (bin < GR_BINS)
+                    gr_count[bin]++;
+                if (r < NBH_DIST_FACTOR * particle[j].radius)
+                {
+                    angle = 6.0 * argument(particle[j].deltax[k], particle[j].deltay[k]);
+                    re += cos(angle);
+                    im += sin(angle);
+                    nbonds++;
+                }
+            }
+            if (nbonds > 0)
+            {
+                re /= (double)nbonds;
+                im /= (double)nbonds;
+                psi6[j] = module2(re, im);
+            }
+            re_sum += re;
+            im_sum += im;
+            local_sum += psi6[j];
+            totalbonds += nbonds;
+            if (psi6[j] > PSI6_THRESHOLD)
+                nsolid++;
+        }
+    }
+
+    /* clusters of bonded solid particles, by union-find */
+    for (j = 0; j < ncircles; j++)
+    {
+        cluster_parent[j] = j;
+        cluster_size[j] = 0;
+    }
+    for (j = 0; j < ncircles; j++)
+        if ((particle[j].active) && (psi6[j] > PSI6_THRESHOLD))
+            for (k = 0; k < particle[j].hash_nneighb; k++)
+            {
+                p = particle[j].hashneighbour[k];
+                if ((p > j) && (psi6[p] > PSI6_THRESHOLD) && (module2(particle[j].deltax[k], particle[j].deltay[k]) < NBH_DIST_FACTOR * particle[j].radius))
+                {
+                    r1 = cluster_root(j);
+                    r2 = cluster_root(p);
+                    if (r1 != r2)
+                        cluster_parent[r1] = r2;
+                }
+            }
+    for (j = 0; j < ncircles; j++)
+        if ((particle[j].active) && (psi6[j] > PSI6_THRESHOLD))
+            cluster_size[cluster_root(j)]++;
+
+    for (k = 0; k < CLUSTER_BINS; k++)
+        cluster_hist[k] = 0;
+    for (j = 0; j < ncircles; j++)
+        if (cluster_size[j] > 0)
+        {
+            nclusters++;
+            if (cluster_size[j] > largest)
+                largest = cluster_size[j];
+            bin = (int)(log((double)cluster_size[j]) / log(2.0));
+            if (bin >= CLUSTER_BINS)
+                bin = CLUSTER_BINS - 1;
+            cluster_hist[bin]++;
+        }
+
+    /* normalisation of g(r) by ideal gas pair density */
+    density = (double)n / ((BCXMAX - BCXMIN) * (BCYMAX - BCYMIN));
+    for (k = 0; k < GR_BINS; k++)
+    {
+        shell = PI * dr * dr * (double)(2 * k + 1);
+        if (n > 0)
+            gr[k] = (double)gr_count[k] / ((double)n * density * shell);
+        else
+            gr[k] = 0.0;
+    }
+
+    record.step = step;
+    record.nparticles = n;
+    if (n > 0)
+    {
+        record.psi6_global = module2(re_sum, im_sum) / (double)n;
+        record.psi6_local = local_sum / (double)n;
+        record.solid_fraction = (double)nsolid / (double)n;
+        record.mean_bonds = (double)totalbonds / (double)n;
+    }
+    else
+    {
+        record.psi6_global = 0.0;
+        record.psi6_local = 0.0;
+        record.solid_fraction = 0.0;
+        record.mean_bonds = 0.0;
+    }
+    record.nclusters = nclusters;
+    record.largest_cluster = largest;
+    if (nclusters > 0)
+        record.mean_cluster = (double)nsolid / (double)nclusters;
+    else
+        record.mean_cluster = 0.0;
+
+    fwrite(&record, sizeof(t_analysis_record), 1, analysis_file);
+    fwrite(gr, sizeof(double), GR_BINS, analysis_file);
+    fwrite(cluster_hist, sizeof(int), CLUSTER_BINS, analysis_file);
+    fflush(analysis_file);
+    analysis_nrecords++;
+
+    printf("Step %i: psi6 = %.3lg, solid fraction %.3lg, largest cluster %i\n", step, record.psi6_local, record.solid_fraction, largest);
+
+    free(psi6);
+    free(cluster_size);
+}
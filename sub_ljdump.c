@@ -0,0 +1,341 @@
+/* routines writing and reading binary dumps of particle configurations */
+/* written by lennardjones.c (SAVE_DUMP_FILE), read by lj_render.c to re-render a movie */
+/* without re-running the molecular dynamics */
+
+/* File layout:                                                                  */
+/* t_dump_header                                                                 */
+/* for each frame: t_dump_frame, then ntracers pairs of floats (tracer positions),*/
+/* then npressures floats, then nparticles t_dump_particle (active particles)    */
+/* frame index: nframes t_dump_index, its offset is stored in the header         */
+/* All records have fixed size, so that the file can be memory-mapped.           */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define DUMP_MAGIC "LJDUMP1"
+#define DUMP_VERSION 1
+
+typedef struct
+{
+    char magic[8];              /* file signature DUMP_MAGIC */
+    int version;                /* file format version */
+    int header_size;            /* sizes of records, to detect incompatible builds */
+    int frame_size;
+    int particle_size;
+    int boundary_cond;          /* simulation parameters, checked by the renderer */
+    int nmaxcircles;
+    int ntracers;
+    int npressures;
+    int nframes;                /* number of frames, set when file is closed */
+    long index_offset;          /* position of frame index, 0 if file was not closed */
+} t_dump_header;
+
+typedef struct
+{
+    int frame;                  /* frame number, starting at 0 at INITIAL_TIME */
+    int nparticles;             /* number of particles in frame */
+    int ncircles;               /* value of ncircles in simulation */
+    int wall;                   /* whether wall is present (BC_RECTANGLE_WALL b.c.) */
+    double beta;                /* inverse temperature */
+    double mean_energy;         /* mean kinetic energy */
+    double krepel;              /* repulsion constant */
+    double xmincontainer, xmaxcontainer;  /* container boundaries */
+    double boundary_force;      /* force on boundary per particle */
+    double gravity;             /* gravity */
+    double pleft, pright;       /* pressures in Ehrenfest configuration */
+    double xshift, ylid, xwall; /* positions of moving obstacle, lid and wall */
+} t_dump_frame;
+
+typedef struct
+{
+    float xc, yc, radius;       /* position and radius */
+    float angle, omega;         /* angle and angular velocity */
+    float vx, vy;               /* velocity */
+    float energy;               /* kinetic energy */
+    float spin_freq;            /* angular frequency of spin-spin interaction */
+    short int type;             /* type of particle */
+    short int neighb;           /* number of neighbours */
+    char interaction;           /* type of interaction */
+    char thermostat;            /* whether particle is coupled to thermostat */
+    short int padding;
+} t_dump_particle;
+
+typedef struct
+{
+    long offset;                /* position of frame in file */
+    int size;                   /* size of frame in bytes */
+    int frame;                  /* frame number */
+} t_dump_index;
+
+typedef struct
+{
+    int fd;                     /* file descriptor */
+    char *data;                 /* memory-mapped file */
+    size_t length;              /* length of file */
+    t_dump_header *header;
+    t_dump_index *index;        /* frame index */
+    int nframes;
+    short int own_index;        /* whether index has been allocated by reader */
+} t_dump_reader;
+
+FILE *dump_file = NULL;
+t_dump_header dump_header;
+t_dump_index *dump_index = NULL;
+int dump_nframes = 0, dump_index_size = 0;
+long dump_position = 0;
+
+void open_dump_file(char *filename, int ntracers, int npressures)
+/* open dump file for writing */
+{
+    dump_file = fopen(filename, "w");
+    if (dump_file == NULL)
+    {
+        printf("Error: cannot open dump file %s\n", filename);
+        exit(1);
+    }
+
+    memset(&dump_header, 0, sizeof(t_dump_header));
+    strcpy(dump_header.magic, DUMP_MAGIC);
+    dump_header.version = DUMP_VERSION;
+    dump_header.header_size = sizeof(t_dump_header);
+    dump_header.frame_size = sizeof(t_dump_frame);
+    dump_header.particle_size = sizeof(t_dump_particle);
+    dump_header.boundary_cond = BOUNDARY_COND;
+    dump_header.nmaxcircles = NMAXCIRCLES;
+    dump_header.ntracers = ntracers;
+    dump_header.npressures = npressures;
+    fwrite(&dump_header, sizeof(t_dump_header), 1, dump_file);
+
+    dump_position = sizeof(t_dump_header);
+    dump_nframes = 0;
+    dump_index_size = 1024;
+    dump_index = (t_dump_index *)malloc(dump_index_size * sizeof(t_dump_index));
+
+    printf("Saving particle configurations to %s\n", filename);
+}
+
+void write_dump_frame(t_dump_frame *frame, t_particle particle[NMAXCIRCLES], int tracer_n[], int ntracers,
+                      double pressure[], int npressures)
+/* append one frame to dump file, only active particles are saved */
+{
+    int i, n = 0, size;
+    float pos[2];
+    t_dump_particle *record;
+
+    record = (t_dump_particle *)malloc(ncircles * sizeof(t_dump_particle));
+
+    for (i = 0; i < ncircles; i++)
+        if (particle[i].active)
+        {
+            record[n].xc = (float)particle[i].xc;
+            record[n].yc = (float)particle[i].yc;
+            record[n].radius = (float)particle[i].radius;
+            record[n].angle = (float)particle[i].angle;
+            record[n].omega = (float)particle[i].omega;
+            record[n].vx = (float)particle[i].vx;
+            record[n].vy = (float)particle[i].vy;
+            record[n].energy = (float)particle[i].energy;
+            record[n].spin_freq = (float)particle[i].spin_freq;
+            record[n].type = particle[i].type;
+            record[n].neighb = (short int)particle[i].neighb;
+            record[n].interaction = (char)particle[i].interaction;
+            record[n].thermostat = (char)particle[i].thermostat;
+            record[n].padding = 0;
+            n++;
+        }
+
+    frame->nparticles = n;
+    frame->ncircles = ncircles;
+
+    size = sizeof(t_dump_frame) + 2 * ntracers * sizeof(float) + npressures * sizeof(float) + n * sizeof(t_dump_particle);
+
+    if (dump_nframes >= dump_index_size)
+    {
+        dump_index_size *= 2;
+        dump_index = (t_dump_index *)realloc(dump_index, dump_index_size * sizeof(t_dump_index));
+    }
+    dump_index[dump_nframes].offset = dump_position;
+    dump_index[dump_nframes].size = size;
+    dump_index[dump_nframes].frame = frame->frame;
+    dump_nframes++;
+
+    fwrite(frame, sizeof(t_dump_frame), 1, dump_file);
+    for (i = 0; i < ntracers; i++)
+    {
+        pos[0] = (float)particle[tracer_n[i]].xc;
+        pos[1] = (float)particle[tracer_n[i]].yc;
+        fwrite(pos, sizeof(float), 2, dump_file);
+    }
+    for (i = 0; i < npressures; i++)
+    {
+        pos[0] = (float)pressure[i];
+        fwrite(pos, sizeof(float), 1, dump_file);
+    }
+    fwrite(record, sizeof(t_dump_particle), n, dump_file);
+    dump_position += size;
+
+    free(record);
+}
+
+void close_dump_file()
+/* write frame index and update header */
+{
+    fwrite(dump_index, sizeof(t_dump_index), dump_nframes, dump_file);
+
+    dump_header.nframes = dump_nframes;
+    dump_header.index_offset = dump_position;
+    fseek(dump_file, 0, SEEK_SET);
+    fwrite(&dump_header, sizeof(t_dump_header), 1, dump_file);
+    fclose(dump_file);
+
+    printf("Saved %i frames to dump file\n", dump_nframes);
+    free(dump_index);
+    dump_file = NULL;
+}
+
+int dump_frame_size(t_dump_header *header, t_dump_frame *frame)
+/* size in bytes of a frame record */
+{
+    return (sizeof(t_dump_frame) + (2 * header->ntracers + header->npressures) * sizeof(float) + frame->nparticles * sizeof(t_dump_particle));
+}
+
+int open_dump_for_reading(char *filename, t_dump_reader *reader)
+/* memory-map dump file and load its frame index */
+/* if the simulation was interrupted, the index is reconstructed by scanning the file */
+/* returns number of frames */
+{
+    struct stat st;
+    long offset;
+    int n, size;
+    t_dump_frame *frame;
+
+    reader->fd = open(filename, O_RDONLY);
+    if ((reader->fd < 0) || (fstat(reader->fd, &st) < 0))
+    {
+        printf("Error: cannot open dump file %s\n", filename);
+        exit(1);
+    }
+    reader->length = st.st_size;
+    reader->data = (char *)mmap(NULL, reader->length, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (reader->data == MAP_FAILED)
+    {
+        printf("Error: cannot map dump file %s\n", filename);
+        exit(1);
+    }
+    reader->header = (t_dump_header *)reader->data;
+
+    if ((strcmp(reader->header->magic, DUMP_MAGIC) != 0) || (reader->header->header_size != sizeof(t_dump_header)) || (reader->header->frame_size != sizeof(t_dump_frame)) || (reader->header->particle_size != sizeof(t_dump_particle)))
+    {
+        printf("Error: %s is not a compatible dump file\n", filename);
+        exit(1);
+    }
+    if (reader->header->boundary_cond != BOUNDARY_COND)
+        printf("Warning: dump file was computed with BOUNDARY_COND = %i\n", reader->header->boundary_cond);
+    if (reader->header->nmaxcircles > NMAXCIRCLES)
+    {
+        printf("Error: dump file requires NMAXCIRCLES >= %i\n", reader->header->nmaxcircles);
+        exit(1);
+    }
+
+    if ((reader->header->index_offset > 0) && (reader->header->index_offset + reader->header->nframes * sizeof(t_dump_index) <= reader->length))
+    {
+        reader->nframes = reader->header->nframes;
+        reader->index = (t_dump_index *)(reader->data + reader->header->index_offset);
+        reader->own_index = 0;
+    }
+    else
+    {
+        printf("Dump file has no index, scanning frames\n");
+        n = 0;
+        size = 1024;
+        reader->index = (t_dump_index *)malloc(size * sizeof(t_dump_index));
+        offset = sizeof(t_dump_header);
+        while (offset + (long)sizeof(t_dump_frame) <= (long)reader->length)
+        {
+            frame = (t_dump_frame *)(reader->data + offset);
+            if (offset + dump_frame_size(reader->header, frame) > (long)reader->length)
+                break;
+            if (n >= size)
+            {
+                size *= 2;
+                reader->index = (t_dump_index *)realloc(reader->index, size * sizeof(t_dump_index));
+            }
+            reader->index[n].offset = offset;
+            reader->index[n].size = dump_frame_size(reader->header, frame);
+            reader->index[n].frame = frame->frame;
+            offset += reader->index[n].size;
+            n++;
+        }
+        reader->nframes = n;
+        reader->own_index = 1;
+    }
+
+    printf("Dump file %s contains %i frames\n", filename, reader->nframes);
+    return (reader->nframes);
+}
+
+t_dump_frame *dump_frame(t_dump_reader *reader, int n)
+/* pointer to header of frame n */
+{
+    return ((t_dump_frame *)(reader->data + reader->index[n].offset));
+}
+
+float *dump_tracers(t_dump_reader *reader, int n)
+/* pointer to tracer positions of frame n */
+{
+    return ((float *)(reader->data + reader->index[n].offset + sizeof(t_dump_frame)));
+}
+
+float *dump_pressures(t_dump_reader *reader, int n)
+/* pointer to pressures of frame n */
+{
+    return (dump_tracers(reader, n) + 2 * reader->header->ntracers);
+}
+
+t_dump_particle *dump_particles(t_dump_reader *reader, int n)
+/* pointer to particles of frame n */
+{
+    return ((t_dump_particle *)(dump_pressures(reader, n) + reader->header->npressures));
+}
+
+int read_dump_frame(t_dump_reader *reader, int n, t_particle particle[NMAXCIRCLES])
+/* copy particles of frame n into particle array, returns number of particles */
+{
+    int i, nparticles;
+    t_dump_particle *record;
+
+    nparticles = dump_frame(reader, n)->nparticles;
+    record = dump_particles(reader, n);
+
+#pragma omp parallel for private(i)
+    for (i = 0; i < nparticles; i++)
+    {
+        particle[i].xc = (double)record[i].xc;
+        particle[i].yc = (double)record[i].yc;
+        particle[i].radius = (double)record[i].radius;
+        particle[i].angle = (double)record[i].angle;
+        particle[i].omega = (double)record[i].omega;
+        particle[i].vx = (double)record[i].vx;
+        particle[i].vy = (double)record[i].vy;
+        particle[i].energy = (double)record[i].energy;
+        particle[i].spin_freq = (double)record[i].spin_freq;
+        particle[i].type = record[i].type;
+        particle[i].neighb = record[i].neighb;
+        particle[i].interaction = record[i].interaction;
+        particle[i].thermostat = record[i].thermostat;
+        particle[i].active = 1;
+        particle[i].hash_nneighb = 0;
+    }
+
+    ncircles = nparticles;
+    return (nparticles);
+}
+
+void close_dump_for_reading(t_dump_reader *reader)
+{
+    if (reader->own_index)
+        free(reader->index);
+    munmap(reader->data, reader->length);
+    close(reader->fd);
+}
@@ -0,0 +1,265 @@
+/* observables of lennardjones.c, evaluated in one parallel sweep over particles          */
+/* Each observable is given by a map, which gives the value of one particle (or no value  */
+/* for particles that do not contribute), and a reduction of these values: sum, mean,    */
+/* minimum or maximum. All observables are evaluated together by observe_particle(),     */
+/* called by evolve_particles() in its last pass over particles at the last time step    */
+/* of each frame, so that particles are only read once per frame. Each thread reduces    */
+/* into its own partial results, which are combined by reduce_observables().             */
+
+/* File layout (SAVE_OBSERVABLES):                                                       */
+/* t_observables_header, giving names and reductions of observables                      */
+/* for each frame: t_observables_record, then nobservables doubles                       */
+/* All records have fixed size, so that record n is at                                   */
+/* sizeof(t_observables_header) + n*header.record_size                                   */
+
+#include <float.h>
+
+#define OBSERVABLES_MAGIC "LJOBSER"
+#define OBSERVABLES_VERSION 1
+#define OBS_MAXNUMBER 16  /* max number of observables */
+#define OBS_NAMELENGTH 24 /* max length of names of observables */
+
+#define OBS_SUM 0 /* reductions of observables */
+#define OBS_MEAN 1
+#define OBS_MIN 2
+#define OBS_MAX 3
+
+typedef int (*t_obs_map)(t_particle *particle, double *value); /* returns 0 if particle has no value */
+
+typedef struct
+{
+    char name[OBS_NAMELENGTH];
+    int reduction;  /* OBS_SUM, OBS_MEAN, OBS_MIN or OBS_MAX */
+    t_obs_map map;  /* value of a particle */
+} t_observable;
+
+typedef struct
+{
+    double value[OBS_MAXNUMBER];    /* partial sums, minima or maxima */
+    int count[OBS_MAXNUMBER];       /* number of particles with a value */
+    char padding[64];               /* keeps partial results of threads on different cache lines */
+} t_obs_partial;
+
+typedef struct
+{
+    char magic[8];      /* file signature OBSERVABLES_MAGIC */
+    int version;        /* file format version */
+    int header_size;    /* size of header */
+    int record_size;    /* size of the values of one frame, including record */
+    int nobservables;   /* number of observables */
+    int nvid;           /* number of time steps per frame */
+    double dt;          /* time step */
+    char name[OBS_MAXNUMBER][OBS_NAMELENGTH];
+    int reduction[OBS_MAXNUMBER];
+} t_observables_header;
+
+typedef struct
+{
+    int frame;          /* frame of simulation */
+    int nparticles;     /* number of active particles */
+    double time;        /* time of simulation */
+} t_observables_record;
+
+t_observable observable[OBS_MAXNUMBER];
+int nobservables = 0;
+double observable_value[OBS_MAXNUMBER];    /* results of last sweep */
+t_obs_partial *obs_partial = NULL;
+int obs_nthreads = 0;
+FILE *observables_file = NULL;
+int observables_nrecords = 0;
+
+int register_observable(char *name, int reduction, t_obs_map map)
+/* add observable, returns its index */
+{
+    if (nobservables >= OBS_MAXNUMBER)
+    {
+        printf("Error: more than %i observables\n", OBS_MAXNUMBER);
+        exit(1);
+    }
+    memset(observable[nobservables].name, 0, OBS_NAMELENGTH);
+    strncpy(observable[nobservables].name, name, OBS_NAMELENGTH - 1);
+    observable[nobservables].reduction = reduction;
+    observable[nobservables].map = map;
+    observable_value[nobservables] = 0.0;
+    nobservables++;
+    return (nobservables - 1);
+}
+
+void reset_observables()
+/* initialise partial results of all threads, before a sweep */
+{
+    int t, k;
+
+    if (obs_partial == NULL)
+    {
+        obs_nthreads = omp_get_max_threads();
+        obs_partial = (t_obs_partial *)malloc(obs_nthreads * sizeof(t_obs_partial));
+    }
+    for (t = 0; t < obs_nthreads; t++)
+        for (k = 0; k < nobservables; k++)
+        {
+            obs_partial[t].count[k] = 0;
+            if (observable[k].reduction == OBS_MIN)
+                obs_partial[t].value[k] = DBL_MAX;
+            else if (observable[k].reduction == OBS_MAX)
+                obs_partial[t].value[k] = -DBL_MAX;
+            else
+                obs_partial[t].value[k] = 0.0;
+        }
+}
+
+void observe_particle(t_particle *particle)
+/* add contribution of particle to partial results of the calling thread */
+{
+    int k;
+    double x;
+    t_obs_partial *partial = &obs_partial[omp_get_thread_num()];
+
+    for (k = 0; k < nobservables; k++)
+        if (observable[k].map(particle, &x))
+        {
+            if (observable[k].reduction == OBS_MIN)
+            {
+                if (x < partial->value[k])
+                    partial->value[k] = x;
+            }
+            else if (observable[k].reduction == OBS_MAX)
+            {
+                if (x > partial->value[k])
+                    partial->value[k] = x;
+            }
+            else
+                partial->value[k] += x;
+            partial->count[k]++;
+        }
+}
+
+void reduce_observables()
+/* combine partial results of threads into observable_value, after a sweep */
+/* observables without any particle having a value are set to 0 */
+{
+    int t, k, count;
+    double x;
+
+    for (k = 0; k < nobservables; k++)
+    {
+        x = obs_partial[0].value[k];
+        count = obs_partial[0].count[k];
+        for (t = 1; t < obs_nthreads; t++)
+        {
+            if (observable[k].reduction == OBS_MIN)
+            {
+                if (obs_partial[t].value[k] < x)
+                    x = obs_partial[t].value[k];
+            }
+            else if (observable[k].reduction == OBS_MAX)
+            {
+                if (obs_partial[t].value[k] > x)
+                    x = obs_partial[t].value[k];
+            }
+            else
+                x += obs_partial[t].value[k];
+            count += obs_partial[t].count[k];
+        }
+        if (count == 0)
+            x = 0.0;
+        else if (observable[k].reduction == OBS_MEAN)
+            x /= (double)count;
+        observable_value[k] = x;
+    }
+}
+
+void open_observables_file(char *filename)
+/* open time series of observables for writing, after all observables are registered */
+{
+    int k;
+    t_observables_header header;
+
+    observables_file = fopen(filename, "w");
+    if (observables_file == NULL)
+    {
+        printf("Error: cannot open observables file %s\n", filename);
+        exit(1);
+    }
+
+    memset(&header, 0, sizeof(t_observables_header));
+    strcpy(header.magic, OBSERVABLES_MAGIC);
+    header.version = OBSERVABLES_VERSION;
+    header.header_size = sizeof(t_observables_header);
+    header.record_size = sizeof(t_observables_record) + nobservables * sizeof(double);
+    header.nobservables = nobservables;
+    header.nvid = NVID;
+    header.dt = DT_PARTICLE;
+    for (k = 0; k < nobservables; k++)
+    {
+        memcpy(header.name[k], observable[k].name, OBS_NAMELENGTH);
+        header.reduction[k] = observable[k].reduction;
+    }
+    fwrite(&header, sizeof(t_observables_header), 1, observables_file);
+    observables_nrecords = 0;
+    printf("Saving observables to %s\n", filename);
+}
+
+void write_observables(int frame, int nparticles)
+/* append results of last sweep to time series */
+{
+    t_observables_record record;
+
+    record.frame = frame;
+    record.nparticles = nparticles;
+    record.time = (double)(frame + 1) * (double)NVID * DT_PARTICLE;
+    fwrite(&record, sizeof(t_observables_record), 1, observables_file);
+    fwrite(observable_value, sizeof(double), nobservables, observables_file);
+    observables_nrecords++;
+}
+
+void close_observables_file()
+{
+    fclose(observables_file);
+    printf("Saved observables of %i frames\n", observables_nrecords);
+    observables_file = NULL;
+}
+
+/* maps of standard observables */
+
+int map_kinetic_energy(t_particle *particle, double *value)
+{
+    *value = particle->energy;
+    return (1);
+}
+
+int map_thermostat(t_particle *particle, double *value)
+{
+    *value = (double)particle->thermostat;
+    return (1);
+}
+
+int map_neighbours(t_particle *particle, double *value)
+{
+    *value = (double)particle->neighb;
+    return (1);
+}
+
+int map_left_type0(t_particle *particle, double *value)
+/* has value 1 for particles of type 0 on the left (or bottom for POSITION_Y_DEPENDENCE) */
+{
+    if (particle->type != 0)
+        return (0);
+    if (POSITION_Y_DEPENDENCE)
+        *value = (double)(particle->yc < 0.0);
+    else
+        *value = (double)(particle->xc < 0.0);
+    return (1);
+}
+
+int map_left_type1(t_particle *particle, double *value)
+/* same for particles of other types */
+{
+    if (particle->type == 0)
+        return (0);
+    if (POSITION_Y_DEPENDENCE)
+        *value = (double)(particle->yc < 0.0);
+    else
+        *value = (double)(particle->xc < 0.0);
+    return (1);
+}
@@ -1,4 +1,5 @@
 #include "colormaps.c"
+#include "sub_layers.c"
 
 #define DUMMY_ABSORBING -1000.0 /* dummy value of config[0] for absorbing circles */
 #define BOUNDARY_SHIFT 100000.0 /* shift of boundary parameterization for circles in domain */
@@ -514,7 +515,7 @@ void init_billiard_color()
     }
 }
 
-void draw_billiard() /* draws the billiard boundary */
+void draw_billiard_nocache() /* draws the billiard boundary */
 {
     double x0, x, y, phi, r = 0.01, alpha, dphi, omega, x1, y1, x2, beta2, angle, s, x2plus, x2minus;
     double omega2, co, so, axis1, axis2, phimax, rgb[3], rgb1[3], a, b, ymax, dy, width, cc;
@@ -1407,6 +1408,27 @@ void draw_billiard() /* draws the billiard boundary */
     }
 }
 
+t_layer billiard_layer[1];
+
+void draw_billiard() /* draws the billiard boundary, from cached layer if it did not change */
+{
+    unsigned long key;
+
+    /* circles[].new is decremented while drawing, so that highlighted circles are redrawn */
+    key = layer_hash(LAYER_HASH_SEED, &ncircles, sizeof(int));
+    key = layer_hash(key, circles, ncircles * sizeof(t_circle));
+    key = layer_hash(key, &nsides, sizeof(int));
+    key = layer_hash(key, polyline, nsides * sizeof(t_segment));
+    key = layer_hash_double(key, x_shooter);
+    key = layer_hash_double(key, y_shooter);
+
+    if (begin_layer(billiard_layer, 1, key))
+    {
+        draw_billiard_nocache();
+        end_layer(billiard_layer, 1);
+    }
+}
+
 /*********************************/
 /* computation of the collisions */
 /*********************************/
@@ -1441,6 +1463,36 @@ void print_colors(int color[NPARTMAX]) /* for debugging purposes */
     printf("\n");
 }
 
+int compact_particles(double *configs[NPARTMAX], int color[NPARTMAX], int newcolor[NPARTMAX], int active[NPARTMAX])
+/* move active particles to the beginning of the arrays, keeping their order, and reduce  */
+/* nparticles, so that loops over particles skip absorbed ones - configurations are      */
+/* exchanged by swapping pointers                                                        */
+/* returns the number of removed particles                                               */
+{
+    int i, n = 0, removed;
+    double *config;
+
+    for (i = 0; i < nparticles; i++)
+        if (active[i])
+        {
+            if (n < i)
+            {
+                config = configs[n];
+                configs[n] = configs[i];
+                configs[i] = config;
+                color[n] = color[i];
+                newcolor[n] = newcolor[i];
+                active[n] = 1;
+                active[i] = 0;
+            }
+            n++;
+        }
+
+    removed = nparticles - n;
+    nparticles = n;
+    return (removed);
+}
+
 /****************************************************************************************/
 /* rectangle billiard */
 /****************************************************************************************/
@@ -0,0 +1,425 @@
+/* agent-based SIR epidemic model for lennardjones.c (SIR_MODEL)                  */
+/* agents move ballistically with random changes of direction, infected agents     */
+/* infect susceptible agents within SIR_INFECTION_RADIUS with probability          */
+/* SIR_INFECTION_RATE per time step, and recover with probability SIR_RECOVERY_RATE */
+
+/* Agents are stored in a compact structure, so that 10^5 to 10^6 agents fit in   */
+/* memory. Contacts are found with a cell list of cells of size at least           */
+/* SIR_INFECTION_RADIUS, rebuilt by counting sort at each time step (the hashgrid  */
+/* of the molecular dynamics has a fixed number HASHMAX of particles per cell).    */
+/* Only infected agents are stored in the cell list, with their positions copied   */
+/* contiguously, so that susceptible agents scan short lists in cache.             */
+/* Random numbers are obtained by hashing (seed, time step, agent), so that results */
+/* do not depend on the number of threads.                                          */
+/* Periodic boundary conditions are used if bc_grouped(BOUNDARY_COND) = 1,          */
+/* otherwise agents are reflected at the boundary of [BCXMIN,BCXMAX]x[BCYMIN,BCYMAX]. */
+
+#define SIR_SUSCEPTIBLE 0
+#define SIR_INFECTED 1
+#define SIR_RECOVERED 2
+
+#define SIR_MAXGRID 4096        /* max number of cells of contact grid in each direction */
+
+typedef struct
+{
+    float xc, yc;                   /* position */
+    float vx, vy;                   /* velocity */
+    unsigned char health;           /* SIR_SUSCEPTIBLE, SIR_INFECTED or SIR_RECOVERED */
+    unsigned char protected;        /* 1 if agent cannot be infected */
+    unsigned short infected_time;   /* number of time steps since infection */
+} t_agent;
+
+typedef struct
+{
+    int gridx, gridy;               /* number of cells */
+    double dx, dy;                  /* size of cells */
+    int *cell_start;                /* index in cell_x, cell_y of first infected agent of each cell */
+    float *cell_x, *cell_y;         /* positions of infected agents, sorted by cell */
+    int *agent_cell;                /* cell of each agent */
+} t_sir_grid;
+
+unsigned long long sir_hash(unsigned long long x)
+/* mixing function of the splitmix64 generator */
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return (x ^ (x >> 31));
+}
+
+double sir_random(int step, int agent, int stream)
+/* reproducible uniform random number in [0,1) */
+{
+    unsigned long long key;
+
+    key = sir_hash((unsigned long long)SIR_SEED * 4 + (unsigned long long)stream);
+    key = sir_hash(key ^ (unsigned long long)step);
+    key = sir_hash(key ^ (unsigned long long)agent);
+    return ((double)(key >> 11) * (1.0 / 9007199254740992.0));
+}
+
+void init_sir_grid(t_sir_grid *grid, int nagents)
+/* allocate contact grid, with cells not smaller than infection radius */
+{
+    grid->gridx = (int)((BCXMAX - BCXMIN) / SIR_INFECTION_RADIUS);
+    grid->gridy = (int)((BCYMAX - BCYMIN) / SIR_INFECTION_RADIUS);
+    if (grid->gridx > SIR_MAXGRID)
+        grid->gridx = SIR_MAXGRID;
+    if (grid->gridy > SIR_MAXGRID)
+        grid->gridy = SIR_MAXGRID;
+    if (grid->gridx < 1)
+        grid->gridx = 1;
+    if (grid->gridy < 1)
+        grid->gridy = 1;
+    grid->dx = (BCXMAX - BCXMIN) / (double)grid->gridx;
+    grid->dy = (BCYMAX - BCYMIN) / (double)grid->gridy;
+
+    grid->cell_start = (int *)malloc((grid->gridx * grid->gridy + 1) * sizeof(int));
+    grid->cell_x = (float *)malloc(nagents * sizeof(float));
+    grid->cell_y = (float *)malloc(nagents * sizeof(float));
+    grid->agent_cell = (int *)malloc(nagents * sizeof(int));
+
+    printf("Contact grid of %i x %i cells\n", grid->gridx, grid->gridy);
+}
+
+void free_sir_grid(t_sir_grid *grid)
+{
+    free(grid->cell_start);
+    free(grid->cell_x);
+    free(grid->cell_y);
+    free(grid->agent_cell);
+}
+
+void update_sir_grid(t_agent *agent, int nagents, t_sir_grid *grid)
+/* compute cells of agents, and sort infected agents by cell */
+{
+    int j, i, k, ncells = grid->gridx * grid->gridy;
+
+#pragma omp parallel for private(j, i, k)
+    for (j = 0; j < nagents; j++)
+    {
+        i = (int)(((double)agent[j].xc - BCXMIN) / grid->dx);
+        k = (int)(((double)agent[j].yc - BCYMIN) / grid->dy);
+        if (i < 0)
+            i = 0;
+        else if (i >= grid->gridx)
+            i = grid->gridx - 1;
+        if (k < 0)
+            k = 0;
+        else if (k >= grid->gridy)
+            k = grid->gridy - 1;
+        grid->agent_cell[j] = i * grid->gridy + k;
+    }
+
+    for (i = 0; i <= ncells; i++)
+        grid->cell_start[i] = 0;
+    for (j = 0; j < nagents; j++)
+        if (agent[j].health == SIR_INFECTED)
+            grid->cell_start[grid->agent_cell[j] + 1]++;
+    for (i = 0; i < ncells; i++)
+        grid->cell_start[i + 1] += grid->cell_start[i];
+    for (j = 0; j < nagents; j++)
+        if (agent[j].health == SIR_INFECTED)
+        {
+            /* cell_start is shifted by one during filling, and restored below */
+            k = grid->cell_start[grid->agent_cell[j]]++;
+            grid->cell_x[k] = agent[j].xc;
+            grid->cell_y[k] = agent[j].yc;
+        }
+    for (i = ncells; i > 0; i--)
+        grid->cell_start[i] = grid->cell_start[i - 1];
+    grid->cell_start[0] = 0;
+}
+
+void init_agents(t_agent *agent, int nagents)
+/* random initial positions and directions, and initially infected agents */
+{
+    int j;
+    double angle;
+
+#pragma omp parallel for private(j, angle)
+    for (j = 0; j < nagents; j++)
+    {
+        agent[j].xc = (float)(INITXMIN + (INITXMAX - INITXMIN) * sir_random(0, j, 0));
+        agent[j].yc = (float)(INITYMIN + (INITYMAX - INITYMIN) * sir_random(0, j, 1));
+        angle = DPI * sir_random(0, j, 2);
+        agent[j].vx = (float)(SIR_SPEED * cos(angle));
+        agent[j].vy = (float)(SIR_SPEED * sin(angle));
+        agent[j].health = SIR_SUSCEPTIBLE;
+        agent[j].protected = (sir_random(0, j, 3) < SIR_PROTECTED);
+        agent[j].infected_time = 0;
+    }
+
+    for (j = 0; (j < SIR_INITIAL_INFECTED) && (j < nagents); j++)
+        agent[(int)((double)nagents * sir_random(0, j, 4))].health = SIR_INFECTED;
+}
+
+void move_agents(t_agent *agent, int nagents, int step)
+/* ballistic motion with random changes of direction */
+{
+    int j, periodic;
+    double angle, x, y;
+
+    periodic = (bc_grouped(BOUNDARY_COND) == 1);
+
+#pragma omp parallel for private(j, angle, x, y)
+    for (j = 0; j < nagents; j++)
+    {
+        if (sir_random(step, j, 0) < SIR_TURN_RATE)
+        {
+            angle = DPI * sir_random(step, j, 1);
+            agent[j].vx = (float)(SIR_SPEED * cos(angle));
+            agent[j].vy = (float)(SIR_SPEED * sin(angle));
+        }
+        x = (double)agent[j].xc + (double)agent[j].vx;
+        y = (double)agent[j].yc + (double)agent[j].vy;
+
+        if (periodic)
+        {
+            if (x >= BCXMAX)
+                x -= BCXMAX - BCXMIN;
+            else if (x < BCXMIN)
+                x += BCXMAX - BCXMIN;
+            if (y >= BCYMAX)
+                y -= BCYMAX - BCYMIN;
+            else if (y < BCYMIN)
+                y += BCYMAX - BCYMIN;
+        }
+        else
+        {
+            if (x >= BCXMAX)
+            {
+                x = 2.0 * BCXMAX - x;
+                agent[j].vx = -agent[j].vx;
+            }
+            else if (x < BCXMIN)
+            {
+                x = 2.0 * BCXMIN - x;
+                agent[j].vx = -agent[j].vx;
+            }
+            if (y >= BCYMAX)
+            {
+                y = 2.0 * BCYMAX - y;
+                agent[j].vy = -agent[j].vy;
+            }
+            else if (y < BCYMIN)
+            {
+                y = 2.0 * BCYMIN - y;
+                agent[j].vy = -agent[j].vy;
+            }
+        }
+        agent[j].xc = (float)x;
+        agent[j].yc = (float)y;
+    }
+}
+
+int count_infected_contacts(int j, t_agent *agent, t_sir_grid *grid, int periodic)
+/* number of infected agents within infection radius of agent j */
+{
+    int ci, ck, i, k, di, dk, m, p, n = 0;
+    double dx, dy, r2 = SIR_INFECTION_RADIUS * SIR_INFECTION_RADIUS;
+
+    ci = grid->agent_cell[j] / grid->gridy;
+    ck = grid->agent_cell[j] % grid->gridy;
+
+    for (di = -1; di <= 1; di++)
+        for (dk = -1; dk <= 1; dk++)
+        {
+            i = ci + di;
+            k = ck + dk;
+            if (periodic)
+            {
+                /* with less than 3 cells, offsets wrap around to cells already visited */
+                if ((di + 1 >= grid->gridx) || (dk + 1 >= grid->gridy))
+                    continue;
+                i = (i + grid->gridx) % grid->gridx;
+                k = (k + grid->gridy) % grid->gridy;
+            }
+            else if ((i < 0) || (i >= grid->gridx) || (k < 0) || (k >= grid->gridy))
+                continue;
+
+            m = i * grid->gridy + k;
+            for (p = grid->cell_start[m]; p < grid->cell_start[m + 1]; p++)
+            {
+                dx = (double)grid->cell_x[p] - (double)agent[j].xc;
+                dy = (double)grid->cell_y[p] - (double)agent[j].yc;
+                if (periodic)
+                {
+                    if (dx > 0.5 * (BCXMAX - BCXMIN))
+                        dx -= BCXMAX - BCXMIN;
+                    else if (dx < -0.5 * (BCXMAX - BCXMIN))
+                        dx += BCXMAX - BCXMIN;
+                    if (dy > 0.5 * (BCYMAX - BCYMIN))
+                        dy -= BCYMAX - BCYMIN;
+                    else if (dy < -0.5 * (BCYMAX - BCYMIN))
+                        dy += BCYMAX - BCYMIN;
+                }
+                if (dx * dx + dy * dy < r2)
+                    n++;
+            }
+        }
+    return (n);
+}
+
+void evolve_epidemic(t_agent *agent, int nagents, t_sir_grid *grid, unsigned char *new_health, int step, int count[3])
+/* infection and recovery transitions, returns compartment counts in count */
+{
+    int j, n, periodic, s = 0, inf = 0, r = 0;
+
+    periodic = (bc_grouped(BOUNDARY_COND) == 1);
+
+    /* new states are computed from the old ones only, so that the result does not depend on the order */
+#pragma omp parallel for private(j, n)
+    for (j = 0; j < nagents; j++)
+    {
+        new_health[j] = agent[j].health;
+        if ((agent[j].health == SIR_SUSCEPTIBLE) && (!agent[j].protected))
+        {
+            n = count_infected_contacts(j, agent, grid, periodic);
+            if ((n > 0) && (sir_random(step, j, 2) < 1.0 - pow(1.0 - SIR_INFECTION_RATE, (double)n)))
+                new_health[j] = SIR_INFECTED;
+        }
+        else if ((agent[j].health == SIR_INFECTED) && (sir_random(step, j, 3) < SIR_RECOVERY_RATE))
+            new_health[j] = SIR_RECOVERED;
+    }
+
+#pragma omp parallel for private(j) reduction(+ : s, inf, r)
+    for (j = 0; j < nagents; j++)
+    {
+        if (new_health[j] == SIR_INFECTED)
+        {
+            if ((agent[j].health == SIR_INFECTED) && (agent[j].infected_time < 65535))
+                agent[j].infected_time++;
+            inf++;
+        }
+        else if (new_health[j] == SIR_RECOVERED)
+            r++;
+        else
+            s++;
+        agent[j].health = new_health[j];
+    }
+
+    count[SIR_SUSCEPTIBLE] = s;
+    count[SIR_INFECTED] = inf;
+    count[SIR_RECOVERED] = r;
+}
+
+void count_compartments(t_agent *agent, int nagents, int count[3])
+/* number of susceptible, infected and recovered agents */
+{
+    int j, s = 0, inf = 0, r = 0;
+
+#pragma omp parallel for private(j) reduction(+ : s, inf, r)
+    for (j = 0; j < nagents; j++)
+    {
+        if (agent[j].health == SIR_INFECTED)
+            inf++;
+        else if (agent[j].health == SIR_RECOVERED)
+            r++;
+        else
+            s++;
+    }
+
+    count[SIR_SUSCEPTIBLE] = s;
+    count[SIR_INFECTED] = inf;
+    count[SIR_RECOVERED] = r;
+}
+
+void draw_agents(t_agent *agent, int nagents, int count[3], int time)
+/* draw agents as points colored by health, and compartment counts */
+{
+    int j;
+    char message[100];
+    static double rgb[3][3] = {{0.2, 0.5, 1.0}, {1.0, 0.15, 0.1}, {0.5, 0.5, 0.5}};
+
+    blank();
+
+    glPointSize(SIR_POINT_SIZE);
+    glBegin(GL_POINTS);
+    for (j = 0; j < nagents; j++)
+    {
+        glColor3f(rgb[agent[j].health][0], rgb[agent[j].health][1], rgb[agent[j].health][2]);
+        glVertex2d((double)agent[j].xc, (double)agent[j].yc);
+    }
+    glEnd();
+
+    if (BLACK)
+        glColor3f(1.0, 1.0, 1.0);
+    else
+        glColor3f(0.0, 0.0, 0.0);
+    sprintf(message, "t = %i   S = %i   I = %i   R = %i", time, count[SIR_SUSCEPTIBLE], count[SIR_INFECTED], count[SIR_RECOVERED]);
+    write_text(XMIN + 0.1, YMAX - 0.1, message);
+}
+
+void sir_animation()
+/* main loop of SIR model, replaces animation() if SIR_MODEL is set */
+{
+    int i, n, step = 0, count[3];
+    t_agent *agent;
+    t_sir_grid grid;
+    unsigned char *new_health;
+    FILE *counts_file;
+
+    agent = (t_agent *)malloc(SIR_AGENTS * sizeof(t_agent));
+    new_health = (unsigned char *)malloc(SIR_AGENTS * sizeof(unsigned char));
+    init_sir_grid(&grid, SIR_AGENTS);
+
+    counts_file = fopen(SIR_COUNTS_FILE, "w");
+    fprintf(counts_file, "# step susceptible infected recovered\n");
+
+    init_agents(agent, SIR_AGENTS);
+    count_compartments(agent, SIR_AGENTS, count);
+    draw_agents(agent, SIR_AGENTS, count, 0);
+    glutSwapBuffers();
+
+    sleep(SLEEP1);
+
+    for (i = 0; i <= INITIAL_TIME + NSTEPS; i++)
+    {
+        for (n = 0; n < NVID; n++)
+        {
+            step++;
+            move_agents(agent, SIR_AGENTS, step);
+            update_sir_grid(agent, SIR_AGENTS, &grid);
+            evolve_epidemic(agent, SIR_AGENTS, &grid, new_health, step, count);
+            fprintf(counts_file, "%i %i %i %i\n", step, count[SIR_SUSCEPTIBLE], count[SIR_INFECTED], count[SIR_RECOVERED]);
+        }
+        fflush(counts_file);
+
+        draw_agents(agent, SIR_AGENTS, count, step);
+        glutSwapBuffers();
+
+        if (MOVIE)
+        {
+            if (i >= INITIAL_TIME)
+                save_frame_lj();
+            else
+                printf("Initial phase time %i of %i\n", i, INITIAL_TIME);
+
+            /* it seems that saving too many files too fast can cause trouble with the file system */
+            /* so this is to make a pause from time to time - parameter PAUSE may need adjusting   */
+            if (i % PAUSE == PAUSE - 1)
+            {
+                printf("Making a short pause\n");
+                sleep(PSLEEP);
+                if (system("mv lj*.tif tif_ljones/") != 0)
+                    printf("Warning: could not move frames to tif_ljones/\n");
+            }
+        }
+        else
+            printf("Frame %i: S = %i, I = %i, R = %i\n", i, count[SIR_SUSCEPTIBLE], count[SIR_INFECTED], count[SIR_RECOVERED]);
+    }
+
+    if (MOVIE)
+    {
+        for (i = 0; i < END_FRAMES; i++)
+            save_frame_lj_counter(NSTEPS + 2 + i);
+        if (system("mv lj*.tif tif_ljones/") != 0)
+            printf("Warning: could not move frames to tif_ljones/\n");
+    }
+
+    fclose(counts_file);
+    free(agent);
+    free(new_health);
+    free_sir_grid(&grid);
+}
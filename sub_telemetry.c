@@ -0,0 +1,262 @@
+/* live telemetry of runs: each program publishes a small status record in a memory-mapped */
+/* file, updated once per frame, which is read by telemetry.c to monitor many runs at once */
+
+/* The record is the file TELEMETRY_DIR/<program>.<pid>.status, where TELEMETRY_DIR can be  */
+/* replaced by the environment variable SIM_TELEMETRY_DIR. During a frame, the program only */
+/* updates a private copy of the record. At the end of the frame, the copy is written to   */
+/* the mapped file between two increments of sequence (sequence lock): readers retry while */
+/* sequence is odd or has changed during their copy, so that the program never waits.      */
+/* Memory use and bytes written to storage are read from /proc/self, through files kept   */
+/* open. The record is removed when the run ends normally, and kept if it is interrupted. */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define TELEMETRY_MAGIC "SIMSTAT"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_DIR "/dev/shm"    /* folder of status records, should be in memory */
+#define TELEMETRY_NVALUES 8         /* max number of observables */
+#define TELEMETRY_NAMELENGTH 24     /* max length of names of observables */
+
+#define TM_COMPUTE 0                /* phases of a frame, whose durations are recorded */
+#define TM_DRAW 1
+#define TM_SAVE 2
+#define TM_NPHASES 3
+
+typedef struct
+{
+    char magic[8];              /* signature TELEMETRY_MAGIC */
+    int version;                /* format version */
+    int pid;                    /* process id of run */
+    char program[32];           /* name of program */
+    int frame, nframes;         /* frames computed, and total number of frames */
+    int finished;               /* has value 1 when the run has ended */
+    long steps;                 /* number of time steps computed */
+    double sim_time;            /* time of simulation */
+    double start_time;          /* wall clock time of start, in seconds since 1970 */
+    double update_time;         /* wall clock time of last update */
+    double steps_per_second;    /* time steps per second during the last frame */
+    double phase_time[TM_NPHASES];  /* total durations of phases, in seconds */
+    int nvalues;                /* number of observables */
+    char value_name[TELEMETRY_NVALUES][TELEMETRY_NAMELENGTH];
+    double value[TELEMETRY_NVALUES];    /* observables (temperature, energy, variance...) */
+    long memory;                /* resident memory in kB, -1 if unknown */
+    long output_bytes;          /* bytes written to storage (write_bytes of /proc/self/io), -1 if unknown */
+} t_telemetry_data;
+
+typedef struct
+{
+    volatile long sequence;     /* odd while the record is being written */
+    t_telemetry_data data;
+} t_telemetry_record;
+
+t_telemetry_record *telemetry_record = NULL;
+t_telemetry_data telemetry_data;
+char telemetry_filename[512];
+int telemetry_phase_current = -1, telemetry_statm = -1, telemetry_io = -1;
+double telemetry_phase_start, telemetry_frame_start;
+long telemetry_frame_steps;
+
+
+double telemetry_clock()
+/* wall clock time in seconds */
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_REALTIME, &t);
+    return ((double)t.tv_sec + 1.0e-9*(double)t.tv_nsec);
+}
+
+long telemetry_proc_value(int fd, char *key, int field)
+/* value following key in file fd of /proc/self, or field number field if key is NULL */
+{
+    char buffer[1024], *p;
+    int n, k;
+    long value;
+
+    if (fd < 0) return (-1);
+    n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (n <= 0) return (-1);
+    buffer[n] = '\0';
+
+    if (key != NULL)
+    {
+        p = strstr(buffer, key);
+        if ((p == NULL) || (sscanf(p + strlen(key), "%ld", &value) != 1)) return (-1);
+        return (value);
+    }
+    p = buffer;
+    for (k = 0; k < field; k++)
+    {
+        p = strchr(p, ' ');
+        if (p == NULL) return (-1);
+        p++;
+    }
+    if (sscanf(p, "%ld", &value) != 1) return (-1);
+    return (value);
+}
+
+void telemetry_open(char *program, int nframes)
+/* create status record of program, which will compute nframes frames */
+{
+    char *folder;
+    int fd;
+
+    folder = getenv("SIM_TELEMETRY_DIR");
+    if (folder == NULL) folder = TELEMETRY_DIR;
+    snprintf(telemetry_filename, sizeof(telemetry_filename), "%s/%s.%i.status", folder, program, (int)getpid());
+
+    fd = open(telemetry_filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ((fd < 0) || (ftruncate(fd, sizeof(t_telemetry_record)) < 0))
+    {
+        printf("Warning: cannot create status record %s, no telemetry\n", telemetry_filename);
+        if (fd >= 0) close(fd);
+        return;
+    }
+    telemetry_record = (t_telemetry_record *)mmap(NULL, sizeof(t_telemetry_record), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (telemetry_record == MAP_FAILED)
+    {
+        printf("Warning: cannot map status record %s, no telemetry\n", telemetry_filename);
+        telemetry_record = NULL;
+        return;
+    }
+
+    memset(&telemetry_data, 0, sizeof(t_telemetry_data));
+    strcpy(telemetry_data.magic, TELEMETRY_MAGIC);
+    telemetry_data.version = TELEMETRY_VERSION;
+    telemetry_data.pid = (int)getpid();
+    strncpy(telemetry_data.program, program, sizeof(telemetry_data.program) - 1);
+    telemetry_data.nframes = nframes;
+    telemetry_data.start_time = telemetry_clock();
+    telemetry_data.update_time = telemetry_data.start_time;
+
+    telemetry_statm = open("/proc/self/statm", O_RDONLY);
+    telemetry_io = open("/proc/self/io", O_RDONLY);
+
+    telemetry_phase_current = -1;
+    telemetry_frame_start = telemetry_data.start_time;
+    telemetry_frame_steps = 0;
+
+    telemetry_record->sequence = 0;
+    memcpy(&telemetry_record->data, &telemetry_data, sizeof(t_telemetry_data));
+}
+
+int telemetry_enabled()
+/* returns 1 if a status record is published */
+{
+    return (telemetry_record != NULL);
+}
+
+void telemetry_phase(int phase)
+/* start phase of frame, ending the current one (-1 for no phase) */
+{
+    double t;
+
+    if (telemetry_record == NULL) return;
+    t = telemetry_clock();
+    if (telemetry_phase_current >= 0) telemetry_data.phase_time[telemetry_phase_current] += t - telemetry_phase_start;
+    telemetry_phase_current = phase;
+    telemetry_phase_start = t;
+}
+
+void telemetry_value(int k, char *name, double value)
+/* set observable number k */
+{
+    if ((telemetry_record == NULL) || (k < 0) || (k >= TELEMETRY_NVALUES)) return;
+    strncpy(telemetry_data.value_name[k], name, TELEMETRY_NAMELENGTH - 1);
+    telemetry_data.value[k] = value;
+    if (k >= telemetry_data.nvalues) telemetry_data.nvalues = k + 1;
+}
+
+void telemetry_publish()
+/* copy private record to the mapped one, under the sequence lock */
+{
+    telemetry_record->sequence++;
+    __sync_synchronize();
+    memcpy(&telemetry_record->data, &telemetry_data, sizeof(t_telemetry_data));
+    __sync_synchronize();
+    telemetry_record->sequence++;
+}
+
+void telemetry_frame(int frame, long steps, double sim_time)
+/* publish state at the end of a frame - frame is the number of frames computed so far */
+{
+    double t;
+    long resident;
+
+    if (telemetry_record == NULL) return;
+    telemetry_phase(telemetry_phase_current);   /* account for current phase */
+
+    t = telemetry_phase_start;
+    if (t > telemetry_frame_start)
+        telemetry_data.steps_per_second = (double)(steps - telemetry_frame_steps)/(t - telemetry_frame_start);
+    telemetry_frame_start = t;
+    telemetry_frame_steps = steps;
+
+    telemetry_data.frame = frame;
+    telemetry_data.steps = steps;
+    telemetry_data.sim_time = sim_time;
+    telemetry_data.update_time = t;
+
+    resident = telemetry_proc_value(telemetry_statm, NULL, 1);
+    if (resident >= 0) telemetry_data.memory = resident*(sysconf(_SC_PAGESIZE)/1024);
+    else telemetry_data.memory = -1;
+    telemetry_data.output_bytes = telemetry_proc_value(telemetry_io, "write_bytes:", 0);
+
+    telemetry_publish();
+}
+
+void telemetry_close()
+/* mark run as finished, and remove the record */
+{
+    if (telemetry_record == NULL) return;
+    telemetry_phase(-1);
+    telemetry_data.finished = 1;
+    telemetry_data.update_time = telemetry_clock();
+    telemetry_publish();
+
+    munmap(telemetry_record, sizeof(t_telemetry_record));
+    telemetry_record = NULL;
+    unlink(telemetry_filename);
+    if (telemetry_statm >= 0) close(telemetry_statm);
+    if (telemetry_io >= 0) close(telemetry_io);
+    telemetry_statm = -1;
+    telemetry_io = -1;
+}
+
+int telemetry_read(char *filename, t_telemetry_data *data)
+/* consistent copy of a status record, returns 0 if file is not a valid record */
+{
+    int fd, tries;
+    long sequence;
+    struct stat st;
+    t_telemetry_record *record;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) return (0);
+    if ((fstat(fd, &st) < 0) || (st.st_size < (long)sizeof(t_telemetry_record)))
+    {
+        close(fd);
+        return (0);
+    }
+    record = (t_telemetry_record *)mmap(NULL, sizeof(t_telemetry_record), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (record == MAP_FAILED) return (0);
+
+    for (tries = 0; tries < 1000; tries++)
+    {
+        sequence = record->sequence;
+        __sync_synchronize();
+        if (sequence % 2 == 1) continue;
+        memcpy(data, &record->data, sizeof(t_telemetry_data));
+        __sync_synchronize();
+        if (record->sequence == sequence) break;
+    }
+    munmap(record, sizeof(t_telemetry_record));
+
+    if ((tries == 1000) || (strcmp(data->magic, TELEMETRY_MAGIC) != 0) || (data->version != TELEMETRY_VERSION)) return (0);
+    return (1);
+}
@@ -3,6 +3,7 @@
 /*********************/
 
 #include "colors_waves.c"
+#include "sub_layers.c"
 
 int writetiff_new(char *filename, char *description, int x, int y, int width, int height, int compression)
 {
@@ -279,6 +280,30 @@ void write_text( double x, double y, char *st)
 	}
 	return(alph);
  }
+
+ double fast_argument(double x, double y)
+ /* argument of (x,y) in [0, 2 Pi), with polynomial approximation of atan */
+ /* (Abramowitz-Stegun 4.4.49, error below 1e-7), to be used in colour schemes */
+ {
+	double ax, ay, z, z2, alph;
+
+	ax = vabs(x);
+	ay = vabs(y);
+	if ((ax == 0.0)&&(ay == 0.0)) return(0.0);
+
+	/* reduce to an angle in [0, Pi/4] */
+	if (ay <= ax) z = ay/ax;
+	else z = ax/ay;
+	z2 = z*z;
+	alph = z*(0.9999993329 + z2*(-0.3332985605 + z2*(0.1994653599 + z2*(-0.1390853351
+		+ z2*(0.0964200441 + z2*(-0.0559098861 + z2*(0.0218612288 - z2*0.0040540580)))))));
+
+	if (ay > ax) alph = PID - alph;
+	if (x < 0.0) alph = PI - alph;
+	if (y < 0.0) alph = DPI - alph;
+	if (alph >= DPI) alph -= DPI;
+	return(alph);
+ }
  
  
 // int in_polygon(double x, double y, double r, int npoly, double apoly)
@@ -2239,6 +2264,218 @@ int ij_in_billiard(int i, int j)
     return(xy_in_billiard(xy[0], xy[1]));
 }
 
+/* hierarchical construction of table xy_in for fractal domains, which xy_in_billiard()    */
+/* can only test recursively for each pixel                                               */
+/* For Menger carpets, the hole of level k with digits (a,b) is the product of the columns */
+/* whose k-th digit is a and the rows whose k-th digit is b. The digits are computed once */
+/* per column and row, as in xy_in_billiard(), and stored as bit masks of levels with      */
+/* digit MRATIO/2, so that a pixel is in a hole iff the masks of its column and row have a */
+/* common bit, the lowest one giving the level of the hole.                                */
+/* For von Koch snowflakes, each triangle of polyline is stamped into the pixels of its    */
+/* bounding box. Pixels are split into bands of columns, processed in parallel.           */
+/* Both constructions use the same tests as xy_in_billiard(), and give the same table.    */
+
+#define FRACTAL_BAND 32     /* width of bands of columns stamped by one thread */
+
+void menger_digit_masks(int n, int axis, unsigned long mask[], short int inside[])
+/* masks of levels k such that the k-th digit of column (axis 0) or row (axis 1) is MRATIO/2 */
+{
+    int i, k;
+    double xy[2], x1;
+
+    for (i=0; i<n; i++)
+    {
+        if (axis == 0) ij_to_xy(i, 0, xy);
+        else ij_to_xy(0, i, xy);
+        inside[i] = (vabs(xy[axis]) < 1.0);
+        mask[i] = 0;
+        x1 = 0.5*(xy[axis]+1.0);
+        for (k=0; k<MDEPTH; k++)
+        {
+            x1 = x1*(double)MRATIO;
+            if (((int)x1 % MRATIO)==MRATIO/2) mask[i] |= 1ul<<k;
+        }
+    }
+}
+
+void init_menger_xyin(short int *xy_in[NX], int imin, int imax)
+/* table xy_in of Menger carpets D_MENGER, D_MENGER_HEATED and D_MENGER_H_OPEN */
+{
+    int i, j, in;
+    unsigned long *maskx, *masky, m;
+    short int *insidex, *insidey;
+
+    maskx = (unsigned long *)malloc(NX*sizeof(unsigned long));
+    masky = (unsigned long *)malloc(NY*sizeof(unsigned long));
+    insidex = (short int *)malloc(NX*sizeof(short int));
+    insidey = (short int *)malloc(NY*sizeof(short int));
+    menger_digit_masks(NX, 0, maskx, insidex);
+    menger_digit_masks(NY, 1, masky, insidey);
+
+    #pragma omp parallel for private(i,j,in,m)
+    for (i=imin; i<imax; i++)
+        for (j=0; j<NY; j++)
+        {
+            in = ((insidex[i])&&(insidey[j]));
+            m = maskx[i]&masky[j];
+            switch (B_DOMAIN) {
+                case (D_MENGER):
+                {
+                    xy_in[i][j] = ((in)&&(m) ? 0 : 1);
+                    break;
+                }
+                case (D_MENGER_HEATED):
+                {
+                    if (!in) xy_in[i][j] = 0;
+                    else xy_in[i][j] = (m ? __builtin_ctzl(m) + 2 : 1);
+                    break;
+                }
+                case (D_MENGER_H_OPEN):
+                {
+                    xy_in[i][j] = ((in)&&(m) ? __builtin_ctzl(m) + 2 : 1);
+                    break;
+                }
+            }
+        }
+
+    free(maskx);
+    free(masky);
+    free(insidex);
+    free(insidey);
+}
+
+void init_vonkoch_xyin(short int *xy_in[NX], int imin, int imax)
+/* table xy_in of von Koch snowflakes D_VONKOCH and D_VONKOCH_HEATED */
+{
+    int i, j, k, l, m, t, ntriangles, band, imin1, imax1, outside, inside, *box;
+    double xy[2], pos[2];
+    t_vertex **vertex;
+
+    /* triangles tested by xy_in_billiard(), and their bounding boxes in pixels */
+    ntriangles = 1;
+    for (i=0, m=4; i<MDEPTH; i++, m*=4) ntriangles += npolyline/m;
+    vertex = (t_vertex **)malloc(3*ntriangles*sizeof(t_vertex *));
+    box = (int *)malloc(4*ntriangles*sizeof(int));
+
+    vertex[0] = &polyline[0];
+    vertex[1] = &polyline[npolyline/3];
+    vertex[2] = &polyline[2*npolyline/3];
+    t = 1;
+    m = 1;
+    k = 1;
+    for (i=0; i<MDEPTH; i++)
+    {
+        m = m*4;
+        for (j=0; j<npolyline/m; j++)
+        {
+            vertex[3*t] = &polyline[j*m + k];
+            vertex[3*t+1] = &polyline[j*m + 2*k];
+            vertex[3*t+2] = &polyline[j*m + 3*k];
+            t++;
+        }
+        k = k*4;
+    }
+
+    #pragma omp parallel for private(t,l,pos)
+    for (t=0; t<ntriangles; t++)
+    {
+        box[4*t] = NX;
+        box[4*t+1] = -1;
+        box[4*t+2] = NY;
+        box[4*t+3] = -1;
+        for (l=0; l<3; l++)
+        {
+            xy_to_pos(vertex[3*t+l]->x, vertex[3*t+l]->y, pos);
+            /* margin of one pixel for rounding */
+            if ((int)floor(pos[0]) - 1 < box[4*t]) box[4*t] = (int)floor(pos[0]) - 1;
+            if ((int)ceil(pos[0]) + 1 > box[4*t+1]) box[4*t+1] = (int)ceil(pos[0]) + 1;
+            if ((int)floor(pos[1]) - 1 < box[4*t+2]) box[4*t+2] = (int)floor(pos[1]) - 1;
+            if ((int)ceil(pos[1]) + 1 > box[4*t+3]) box[4*t+3] = (int)ceil(pos[1]) + 1;
+        }
+        if (box[4*t+2] < 0) box[4*t+2] = 0;
+        if (box[4*t+3] > NY-1) box[4*t+3] = NY-1;
+    }
+
+    /* value of pixels outside the snowflake, and inside */
+    if (B_DOMAIN == D_VONKOCH)
+    {
+        outside = 0;
+        inside = 1;
+    }
+    else
+    {
+        outside = 1;
+        inside = 0;
+    }
+
+    #pragma omp parallel for private(band,imin1,imax1,i,j,t,xy)
+    for (band=imin/FRACTAL_BAND; band<=(imax-1)/FRACTAL_BAND; band++)
+    {
+        imin1 = band*FRACTAL_BAND;
+        if (imin1 < imin) imin1 = imin;
+        imax1 = (band+1)*FRACTAL_BAND;
+        if (imax1 > imax) imax1 = imax;
+
+        for (i=imin1; i<imax1; i++)
+            for (j=0; j<NY; j++)
+            {
+                ij_to_xy(i, j, xy);
+                if ((B_DOMAIN == D_VONKOCH_HEATED)&&(xy[0]*xy[0] + xy[1]*xy[1] > LAMBDA*LAMBDA)) xy_in[i][j] = 2;
+                else xy_in[i][j] = outside;
+            }
+
+        for (t=0; t<ntriangles; t++)
+            for (i=(box[4*t] > imin1 ? box[4*t] : imin1); (i<=box[4*t+1])&&(i<imax1); i++)
+                for (j=box[4*t+2]; j<=box[4*t+3]; j++) if (xy_in[i][j] == outside)
+                {
+                    ij_to_xy(i, j, xy);
+                    if (xy_in_triangle_tvertex(xy[0], xy[1], *vertex[3*t], *vertex[3*t+1], *vertex[3*t+2]))
+                        xy_in[i][j] = inside;
+                }
+    }
+
+    free(vertex);
+    free(box);
+}
+
+int init_fractal_xyin(short int *xy_in[NX], int imin, int imax)
+/* initialise columns imin to imax-1 of table xy_in for fractal domains */
+/* returns 0 if the domain is not fractal, the table being left unchanged */
+{
+    int i, j;
+    double xy[2];
+
+    switch (B_DOMAIN) {
+        case (D_MENGER):
+        case (D_MENGER_HEATED):
+        case (D_MENGER_H_OPEN):
+        {
+            if (MDEPTH > 8*(int)sizeof(unsigned long)) return(0);
+            init_menger_xyin(xy_in, imin, imax);
+            return(1);
+        }
+        case (D_MENGER_ROTATED):
+        {
+            /* holes are not aligned with the grid, but their test only takes MDEPTH steps */
+            #pragma omp parallel for private(i,j,xy)
+            for (i=imin; i<imax; i++)
+                for (j=0; j<NY; j++)
+                {
+                    ij_to_xy(i, j, xy);
+                    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
+                }
+            return(1);
+        }
+        case (D_VONKOCH):
+        case (D_VONKOCH_HEATED):
+        {
+            init_vonkoch_xyin(xy_in, imin, imax);
+            return(1);
+        }
+        default: return(0);
+    }
+}
+
 void tvertex_lineto(t_vertex z)
 /* draws boundary segments of isospectral billiard */
 {
@@ -2246,7 +2483,7 @@ void tvertex_lineto(t_vertex z)
 }
 
 
-void draw_billiard()      /* draws the billiard boundary */
+void draw_billiard_nocache()      /* draws the billiard boundary */
 {
     double x0, x, y, x1, y1, dx, dy, phi, r = 0.01, pos[2], pos1[2], alpha, dphi, omega, z, l, width, a, b, c, ymax;
     int i, j, k, k1, k2, mr2;
@@ -3323,7 +3560,26 @@ void draw_billiard()      /* draws the billiard boundary */
     }
 }
 
-void draw_color_scheme(double x1, double y1, double x2, double y2, int plot, double min, double max)
+t_layer billiard_layer[1];
+
+void draw_billiard()      /* draws the billiard boundary, from cached layer if it did not change */
+{
+    unsigned long key;
+
+    key = layer_hash(LAYER_HASH_SEED, &ncircles, sizeof(int));
+    key = layer_hash(key, circles, ncircles*sizeof(t_circle));
+    key = layer_hash(key, polygons, ncircles*sizeof(t_polygon));
+    key = layer_hash(key, &npolyline, sizeof(int));
+    key = layer_hash(key, polyline, npolyline*sizeof(t_vertex));
+
+    if (begin_layer(billiard_layer, 1, key))
+    {
+        draw_billiard_nocache();
+        end_layer(billiard_layer, 1);
+    }
+}
+
+void draw_color_scheme_nocache(double x1, double y1, double x2, double y2, int plot, double min, double max)
 {
     int j, k, ij_botleft[2], ij_topright[2], imin, imax, jmin, jmax;
     double y, dy, dy_e, rgb[3], value, lum, amp;
@@ -3429,7 +3685,7 @@ void draw_color_scheme(double x1, double y1, double x2, double y2, int plot, dou
     draw_rectangle(x1, y1, x2, y2);
 }
 
-void draw_color_scheme_palette(double x1, double y1, double x2, double y2, int plot, double min, double max, int palette)
+void draw_color_scheme_palette_nocache(double x1, double y1, double x2, double y2, int plot, double min, double max, int palette)
 {
     int j, k, ij_botleft[2], ij_topright[2], imin, imax, jmin, jmax;
     double y, dy, dy_e, rgb[3], value, lum, amp;
@@ -3535,4 +3791,44 @@ void draw_color_scheme_palette(double x1, double y1, double x2, double y2, int p
     draw_rectangle(x1, y1, x2, y2);
 }
 
+#define NCOLORBAR_SLOTS 4   /* number of cached colour bars */
+
+t_layer colorbar_layer[NCOLORBAR_SLOTS];
+
+unsigned long color_scheme_key(double x1, double y1, double x2, double y2, int plot, double min, double max, int palette)
+/* key of colour bar for cached layers */
+{
+    unsigned long key;
+
+    key = layer_hash_double(LAYER_HASH_SEED, x1);
+    key = layer_hash_double(key, y1);
+    key = layer_hash_double(key, x2);
+    key = layer_hash_double(key, y2);
+    key = layer_hash_double(key, min);
+    key = layer_hash_double(key, max);
+    key = layer_hash(key, &plot, sizeof(int));
+    key = layer_hash(key, &palette, sizeof(int));
+    return(key);
+}
+
+void draw_color_scheme(double x1, double y1, double x2, double y2, int plot, double min, double max)
+/* draws colour bar, from cached layer if it did not change */
+{
+    if (begin_layer(colorbar_layer, NCOLORBAR_SLOTS, color_scheme_key(x1, y1, x2, y2, plot, min, max, -1)))
+    {
+        draw_color_scheme_nocache(x1, y1, x2, y2, plot, min, max);
+        end_layer(colorbar_layer, NCOLORBAR_SLOTS);
+    }
+}
+
+void draw_color_scheme_palette(double x1, double y1, double x2, double y2, int plot, double min, double max, int palette)
+/* draws colour bar with given palette, from cached layer if it did not change */
+{
+    if (begin_layer(colorbar_layer, NCOLORBAR_SLOTS, color_scheme_key(x1, y1, x2, y2, plot, min, max, palette)))
+    {
+        draw_color_scheme_palette_nocache(x1, y1, x2, y2, plot, min, max, palette);
+        end_layer(colorbar_layer, NCOLORBAR_SLOTS);
+    }
+}
+
 
@@ -835,7 +835,8 @@ void compute_field_color(double value, int cplot, int palette, double rgb[3])
         case (P_3D_PHASE):
         {
 //             phase_color_scheme(palette, value, rgb);
-            amp_to_rgb_palette(value, rgb, palette);
+            if (palette == amp_lut_palette) amp_color(value, rgb);
+            else amp_to_rgb_palette(value, rgb, palette);
             break;
         }
     }
@@ -982,6 +983,8 @@ void compute_cfield(double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY]
         }
     }
     
+    if (cplot == P_3D_PHASE) init_amp_lut(palette);
+    
     #pragma omp parallel for private(i,j,ca)
     for (i=0; i<NX; i++) for (j=0; j<NY; j++)
     {
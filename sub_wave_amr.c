@@ -0,0 +1,554 @@
+/* block-structured adaptive mesh refinement for wave_billiard.c (option AMR)           */
+
+/* The field is evolved on a coarse grid, AMR_RATIO times coarser than the NX*NY grid,  */
+/* and on refined blocks of AMR_BLOCK*AMR_BLOCK cells of the NX*NY grid. Blocks are     */
+/* refined within AMR_BOUNDARY cells of the boundary of the domain, around points set   */
+/* by amr_refine_point() (e.g. where time series are sampled), and where the gradient   */
+/* of the field exceeds AMR_THRESHOLD times its maximum. The neighbours of these blocks */
+/* are refined as well, so that wave fronts stay in refined blocks until the next       */
+/* regridding, which takes place every AMR_REGRID coarse steps.                         */
+
+/* A coarse step is AMR_RATIO times longer than a time step of the NX*NY grid, so that  */
+/* both grids have the same Courant number. The coarse grid is advanced first, then the */
+/* refined blocks take AMR_RATIO small steps (subcycling), in parallel over blocks,     */
+/* with ghost cells around them interpolated from the coarse grid in space and time.    */
+/* Finally the coarse cells covered by refined blocks are replaced by averages of the   */
+/* fine cells.                                                                          */
+
+/* Each call of evolve_wave_amr() advances the field by AMR_RATIO time steps, so that   */
+/* AMR_RATIO = 2 keeps the time between frames of evolve_wave(). Between two calls, the */
+/* NX*NY grid is only valid in refined blocks: amr_fill_fields() interpolates the       */
+/* coarse grid into the other blocks before drawing or saving the fields, and           */
+/* amr_load_fields() copies the NX*NY grid to the coarse grid after it was modified,    */
+/* e.g. by adding a wave. There are two levels of refinement, and the supported         */
+/* boundary conditions are those of grid_neighbours() and grid_absorbing().             */
+
+int amr_active = 0;         /* set to 1 by init_amr() if refinement can be used */
+int amr_nx, amr_ny;         /* size of coarse grid */
+int amr_nbx, amr_nby;       /* number of blocks in each direction */
+int amr_steps = 0;          /* number of coarse steps since initialisation */
+char *amr_refined;          /* 1 for refined blocks, at index bi*amr_nby+bj */
+char *amr_static;           /* 1 for blocks which are always refined */
+int amr_nblocks = 0;        /* number of refined blocks */
+int *amr_block;             /* list of refined blocks */
+int amr_nghost = 0;         /* number of ghost cells */
+int *amr_ghost;             /* cells of the NX*NY grid outside refined blocks adjacent to them, as i*NY+j */
+double *amr_phi, *amr_psi, *amr_phi_tmp, *amr_psi_tmp;  /* fields on coarse grid */
+short int *amr_xy;          /* table xy_in of coarse grid */
+char *amr_covered;          /* 1 for coarse cells whose neighbours are all covered by refined blocks */
+double amr_tcc[3], amr_tgamma[3];   /* squared Courant number and damping for xy_in = 0, 1 and other values */
+
+
+int amr_block_of(int i, int j)
+/* block containing cell (i,j) of the NX*NY grid */
+{
+    return((i/AMR_BLOCK)*amr_nby + j/AMR_BLOCK);
+}
+
+void amr_block_range(int b, int *imin, int *imax, int *jmin, int *jmax)
+/* range [imin,imax)x[jmin,jmax) of cells of block b */
+{
+    *imin = (b/amr_nby)*AMR_BLOCK;
+    *jmin = (b%amr_nby)*AMR_BLOCK;
+    *imax = *imin + AMR_BLOCK;
+    *jmax = *jmin + AMR_BLOCK;
+    if (*imax > NX) *imax = NX;
+    if (*jmax > NY) *jmax = NY;
+}
+
+void amr_weight(int i, int n, int *ic, double *f)
+/* coarse cells ic, ic+1 and weight f of ic+1 for linear interpolation at cell i of the fine grid, */
+/* for a coarse grid of n cells */
+{
+    double x;
+
+    x = ((double)i - 0.5*(double)(AMR_RATIO - 1))/(double)AMR_RATIO;
+    if (x < 0.0) x = 0.0;
+    *ic = (int)x;
+    if (*ic > n-2) *ic = n-2;
+    *f = x - (double)(*ic);
+    if (*f > 1.0) *f = 1.0;
+}
+
+double amr_interpolate(double field[], int i, int j)
+/* bilinear interpolation of coarse field at cell (i,j) of the NX*NY grid */
+{
+    int ic, jc;
+    double fx, fy;
+
+    amr_weight(i, amr_nx, &ic, &fx);
+    amr_weight(j, amr_ny, &jc, &fy);
+    return((1.0-fx)*(1.0-fy)*field[ic*amr_ny+jc] + fx*(1.0-fy)*field[(ic+1)*amr_ny+jc]
+           + (1.0-fx)*fy*field[ic*amr_ny+jc+1] + fx*fy*field[(ic+1)*amr_ny+jc+1]);
+}
+
+int amr_medium(short int xy)
+/* index of medium in tables amr_tcc and amr_tgamma */
+{
+    if ((xy == 0)||(xy == 1)) return(xy);
+    return(2);
+}
+
+double amr_new_value(short int xy, int i, int j, int nx, int ny, double x, double y, double delta, double inner, int absorbing, double scale)
+/* value of the field after one time step, on a grid of size nx*ny whose time step is scale times */
+/* the time step of the NX*NY grid - inner is the value of the inner neighbour of absorbing cells */
+{
+    double tc, tcc, tgamma;
+
+    wave_coefficients(xy, &tc, &tcc, &tgamma);
+    if (!absorbing) return(-y + 2.0*x + tcc*delta - scale*scale*KAPPA*x - scale*tgamma*(x-y));
+    /* corners are on the top and bottom for BC_ABSORBING, see grid_absorbing() */
+    if (((i == 0)||(i == nx-1))&&((B_COND != BC_ABSORBING)||((j > 0)&&(j < ny-1))))
+        return(x - tc*(x - inner) - scale*KAPPA_SIDES*x - scale*GAMMA_SIDES*(x-y));
+    return(x - tc*(x - inner) - scale*KAPPA_TOPBOT*x - scale*GAMMA_TOPBOT*(x-y));
+}
+
+void amr_coarse_step()
+/* one time step of the coarse grid */
+{
+    int i, j, k, d, m, in, nx = amr_nx, ny = amr_ny, nb[4];
+    double x, y, delta, r = (double)AMR_RATIO, *tmp;
+    double *phi = amr_phi, *psi = amr_psi, *phi_out = amr_phi_tmp, *psi_out = amr_psi_tmp;
+    short int *xy = amr_xy;
+    char *covered = amr_covered;
+
+    #pragma omp parallel for private(i,j,k,d,m,in,nb,x,y,delta)
+    for (i=0; i<nx; i++){
+        for (j=0; j<ny; j++){
+            k = i*ny + j;
+            if ((!TWOSPEEDS)&&(xy[k] == 0)) continue;
+
+            /* value will be replaced by average of fine cells */
+            if (covered[k])
+            {
+                psi_out[k] = phi[k];
+                continue;
+            }
+
+            x = phi[k];
+            y = psi[k];
+            if ((i>0)&&(i<nx-1)&&(j>0)&&(j<ny-1))
+            {
+                m = amr_medium(xy[k]);
+                delta = phi[k+ny] + phi[k-ny] + phi[k+1] + phi[k-1] - 4.0*x;
+                phi_out[k] = -y + 2*x + amr_tcc[m]*delta - r*r*KAPPA*x - r*amr_tgamma[m]*(x-y);
+            }
+            else
+            {
+                in = grid_absorbing(i, j, nx, ny);
+                grid_neighbours(i, j, nx, ny, nb);
+                delta = -4.0*x;
+                for (d=0; d<4; d++) delta += phi[nb[d]];
+                phi_out[k] = amr_new_value(xy[k], i, j, nx, ny, x, y, delta, (in >= 0 ? phi[in] : 0.0), (in >= 0), r);
+            }
+            psi_out[k] = x;
+        }
+    }
+
+    tmp = amr_phi;  amr_phi = amr_phi_tmp;  amr_phi_tmp = tmp;
+    tmp = amr_psi;  amr_psi = amr_psi_tmp;  amr_psi_tmp = tmp;
+}
+
+void amr_set_ghosts(double *phi[NX], short int *xy_in[NX], int substep)
+/* interpolate coarse grid at ghost cells, at time of given substep of the coarse step */
+{
+    int n, i, j;
+    double theta;
+
+    theta = (double)substep/(double)AMR_RATIO;
+
+    #pragma omp parallel for private(n,i,j)
+    for (n=0; n<amr_nghost; n++)
+    {
+        i = amr_ghost[n]/NY;
+        j = amr_ghost[n]%NY;
+        if ((TWOSPEEDS)||(xy_in[i][j] != 0))
+            phi[i][j] = (1.0 - theta)*amr_interpolate(amr_psi, i, j) + theta*amr_interpolate(amr_phi, i, j);
+    }
+}
+
+void amr_fine_step(double *phi_in[NX], double *psi_in[NX], double *phi_out[NX], double *psi_out[NX], short int *xy_in[NX])
+/* one time step of the refined blocks */
+{
+    int b, i, j, d, m, in, imin, imax, jmin, jmax, nb[4];
+    double x, y, delta, *phi0, *phil, *phir, *psi0, *phio, *psio;
+    short int *xy;
+
+    #pragma omp parallel for private(b,i,j,d,m,in,imin,imax,jmin,jmax,nb,x,y,delta,phi0,phil,phir,psi0,phio,psio,xy) schedule(dynamic)
+    for (b=0; b<amr_nblocks; b++)
+    {
+        amr_block_range(amr_block[b], &imin, &imax, &jmin, &jmax);
+        for (i=imin; i<imax; i++){
+            /* bulk of the domain */
+            if ((i > 0)&&(i < NX-1))
+            {
+                phi0 = phi_in[i];   phil = phi_in[i-1];     phir = phi_in[i+1];
+                psi0 = psi_in[i];   phio = phi_out[i];      psio = psi_out[i];
+                xy = xy_in[i];
+                for (j=(jmin > 0 ? jmin : 1); j<(jmax < NY ? jmax : NY-1); j++){
+                    if ((!TWOSPEEDS)&&(xy[j] == 0)) continue;
+                    x = phi0[j];
+                    y = psi0[j];
+                    m = amr_medium(xy[j]);
+                    delta = phir[j] + phil[j] + phi0[j+1] + phi0[j-1] - 4.0*x;
+                    phio[j] = -y + 2*x + amr_tcc[m]*delta - KAPPA*x - amr_tgamma[m]*(x-y);
+                    psio[j] = x;
+                }
+            }
+
+            /* boundary of the domain */
+            for (j=jmin; j<jmax; j++){
+                if ((i > 0)&&(i < NX-1)&&(j > 0)&&(j < NY-1)) continue;
+                if ((!TWOSPEEDS)&&(xy_in[i][j] == 0)) continue;
+                x = phi_in[i][j];
+                y = psi_in[i][j];
+                in = grid_absorbing(i, j, NX, NY);
+                grid_neighbours(i, j, NX, NY, nb);
+                delta = -4.0*x;
+                for (d=0; d<4; d++) delta += phi_in[nb[d]/NY][nb[d]%NY];
+                phi_out[i][j] = amr_new_value(xy_in[i][j], i, j, NX, NY, x, y, delta, (in >= 0 ? phi_in[in/NY][in%NY] : 0.0), (in >= 0), 1.0);
+                psi_out[i][j] = x;
+            }
+        }
+    }
+}
+
+void amr_restrict_block(int b, double *phi[NX], double *psi[NX], int velocity)
+/* replace coarse cells covered by block b by averages of the fine cells */
+/* if velocity is 1, the coarse field at the previous coarse step is also computed */
+{
+    int i, j, k, ic, jc, imin, imax, jmin, jmax;
+    double norm = 1.0/(double)(AMR_RATIO*AMR_RATIO);
+
+    amr_block_range(b, &imin, &imax, &jmin, &jmax);
+    for (ic=imin/AMR_RATIO; ic<imax/AMR_RATIO; ic++)
+        for (jc=jmin/AMR_RATIO; jc<jmax/AMR_RATIO; jc++)
+        {
+            amr_phi[ic*amr_ny+jc] = 0.0;
+            if (velocity) amr_psi[ic*amr_ny+jc] = 0.0;
+        }
+
+    for (i=imin; i<imax; i++)
+    {
+        k = (i/AMR_RATIO)*amr_ny;
+        for (j=jmin; j<jmax; j++) amr_phi[k + j/AMR_RATIO] += norm*phi[i][j];
+        if (velocity) for (j=jmin; j<jmax; j++) amr_psi[k + j/AMR_RATIO] += norm*psi[i][j];
+    }
+
+    /* coarse field at previous coarse step, extrapolated from the velocity */
+    if (velocity) for (ic=imin/AMR_RATIO; ic<imax/AMR_RATIO; ic++)
+        for (jc=jmin/AMR_RATIO; jc<jmax/AMR_RATIO; jc++)
+        {
+            k = ic*amr_ny+jc;
+            amr_psi[k] = amr_phi[k] - (double)AMR_RATIO*(amr_phi[k] - amr_psi[k]);
+        }
+}
+
+void amr_prolong_block(int b, double *phi[NX], double *psi[NX], short int *xy_in[NX])
+/* interpolate coarse grid in the cells of block b */
+{
+    int i, j, k, ic, imin, imax, jmin, jmax, jc[AMR_BLOCK];
+    double x, y, fx, fy[AMR_BLOCK], w[4];
+
+    amr_block_range(b, &imin, &imax, &jmin, &jmax);
+    for (j=jmin; j<jmax; j++) amr_weight(j, amr_ny, &jc[j-jmin], &fy[j-jmin]);
+    for (i=imin; i<imax; i++)
+    {
+        amr_weight(i, amr_nx, &ic, &fx);
+        for (j=jmin; j<jmax; j++) if ((TWOSPEEDS)||(xy_in[i][j] != 0))
+        {
+            k = ic*amr_ny + jc[j-jmin];
+            w[0] = (1.0-fx)*(1.0-fy[j-jmin]);
+            w[1] = fx*(1.0-fy[j-jmin]);
+            w[2] = (1.0-fx)*fy[j-jmin];
+            w[3] = fx*fy[j-jmin];
+            x = w[0]*amr_phi[k] + w[1]*amr_phi[k+amr_ny] + w[2]*amr_phi[k+1] + w[3]*amr_phi[k+amr_ny+1];
+            y = w[0]*amr_psi[k] + w[1]*amr_psi[k+amr_ny] + w[2]*amr_psi[k+1] + w[3]*amr_psi[k+amr_ny+1];
+            phi[i][j] = x;
+            psi[i][j] = x - (x - y)/(double)AMR_RATIO;
+        }
+    }
+}
+
+void amr_fill_fields(double *phi[NX], double *psi[NX], short int *xy_in[NX])
+/* interpolate coarse grid in blocks which are not refined */
+{
+    int b;
+
+    #pragma omp parallel for private(b) schedule(dynamic)
+    for (b=0; b<amr_nbx*amr_nby; b++) if (!amr_refined[b]) amr_prolong_block(b, phi, psi, xy_in);
+}
+
+void amr_load_fields(double *phi[NX], double *psi[NX])
+/* copy fields of the NX*NY grid, valid in all blocks, to the coarse grid */
+{
+    int b;
+
+    #pragma omp parallel for private(b)
+    for (b=0; b<amr_nbx*amr_nby; b++) amr_restrict_block(b, phi, psi, 1);
+}
+
+double amr_block_gradient(int b, double *phi[NX], int fine)
+/* max of gradient in block b, computed on the NX*NY grid if fine is 1, on the coarse grid otherwise */
+{
+    int i, j, imin, imax, jmin, jmax;
+    double g, gmax = 0.0;
+
+    amr_block_range(b, &imin, &imax, &jmin, &jmax);
+    if (fine)
+    {
+        if (imax == NX) imax--;
+        if (jmax == NY) jmax--;
+        for (i=imin; i<imax; i++)
+            for (j=jmin; j<jmax; j++)
+            {
+                g = fabs(phi[i+1][j] - phi[i][j]) + fabs(phi[i][j+1] - phi[i][j]);
+                if (g > gmax) gmax = g;
+            }
+        return(gmax);
+    }
+    imin /= AMR_RATIO;  imax /= AMR_RATIO;
+    jmin /= AMR_RATIO;  jmax /= AMR_RATIO;
+    if (imax == amr_nx) imax--;
+    if (jmax == amr_ny) jmax--;
+    for (i=imin; i<imax; i++)
+        for (j=jmin; j<jmax; j++)
+        {
+            g = fabs(amr_phi[(i+1)*amr_ny+j] - amr_phi[i*amr_ny+j]) + fabs(amr_phi[i*amr_ny+j+1] - amr_phi[i*amr_ny+j]);
+            if (g > gmax) gmax = g;
+        }
+    return(gmax/(double)AMR_RATIO);
+}
+
+void amr_regrid(double *phi[NX], double *psi[NX], short int *xy_in[NX], int all_fine)
+/* choose refined blocks, and update lists of blocks and ghost cells */
+/* all_fine is 1 if the NX*NY grid is valid in all blocks */
+{
+    int b, bi, bj, di, dj, i, j, k, d, nblocks, imin, imax, jmin, jmax, nb[4];
+    double gmax = 0.0, *gradient;
+    char *flag, *refined;
+
+    nblocks = amr_nbx*amr_nby;
+    gradient = (double *)malloc(nblocks*sizeof(double));
+    flag = (char *)malloc(nblocks*sizeof(char));
+    refined = (char *)malloc(nblocks*sizeof(char));
+
+    #pragma omp parallel for private(b) reduction(max:gmax) schedule(dynamic)
+    for (b=0; b<nblocks; b++)
+    {
+        gradient[b] = amr_block_gradient(b, phi, (all_fine)||(amr_refined[b]));
+        if (gradient[b] > gmax) gmax = gradient[b];
+    }
+
+    for (b=0; b<nblocks; b++)
+        flag[b] = (amr_static[b])||((gmax > 1.0e-10)&&(gradient[b] > AMR_THRESHOLD*gmax));
+
+    /* refine neighbours of flagged blocks */
+    for (b=0; b<nblocks; b++)
+    {
+        refined[b] = 0;
+        bi = b/amr_nby;
+        bj = b%amr_nby;
+        for (di=-1; di<=1; di++)
+            for (dj=-1; dj<=1; dj++)
+                if ((bi+di >= 0)&&(bi+di < amr_nbx)&&(bj+dj >= 0)&&(bj+dj < amr_nby)&&(flag[(bi+di)*amr_nby+bj+dj]))
+                    refined[b] = 1;
+    }
+
+    /* initialise newly refined blocks from the coarse grid */
+    if (!all_fine)
+    {
+        #pragma omp parallel for private(b) schedule(dynamic)
+        for (b=0; b<nblocks; b++)
+            if ((refined[b])&&(!amr_refined[b])) amr_prolong_block(b, phi, psi, xy_in);
+    }
+
+    amr_nblocks = 0;
+    for (b=0; b<nblocks; b++)
+    {
+        amr_refined[b] = refined[b];
+        if (refined[b]) amr_block[amr_nblocks++] = b;
+    }
+
+    /* coarse cells which are not used to interpolate ghost cells */
+    /* all blocks met by the span are checked, it may contain 3 blocks if AMR_BLOCK = AMR_RATIO */
+    #pragma omp parallel for private(i,j,bi,bj,imin,imax,jmin,jmax,k)
+    for (i=0; i<amr_nx; i++)
+        for (j=0; j<amr_ny; j++)
+        {
+            imin = (i > 0 ? (i-1)*AMR_RATIO : 0);
+            jmin = (j > 0 ? (j-1)*AMR_RATIO : 0);
+            imax = (i < amr_nx-1 ? (i+2)*AMR_RATIO - 1 : NX-1);
+            jmax = (j < amr_ny-1 ? (j+2)*AMR_RATIO - 1 : NY-1);
+            k = 1;
+            for (bi=imin/AMR_BLOCK; bi<=imax/AMR_BLOCK; bi++)
+                for (bj=jmin/AMR_BLOCK; bj<=jmax/AMR_BLOCK; bj++)
+                    if (!amr_refined[bi*amr_nby+bj]) k = 0;
+            amr_covered[i*amr_ny+j] = k;
+        }
+
+    /* ghost cells, on the border of blocks which are not refined, next to refined blocks */
+    amr_nghost = 0;
+    for (b=0; b<nblocks; b++) if (!amr_refined[b])
+    {
+        amr_block_range(b, &imin, &imax, &jmin, &jmax);
+        k = 0;
+        grid_neighbours(imin, jmin, NX, NY, nb);
+        if ((amr_refined[amr_block_of(nb[1]/NY, nb[1]%NY)])||(amr_refined[amr_block_of(nb[3]/NY, nb[3]%NY)])) k = 1;
+        grid_neighbours(imax-1, jmax-1, NX, NY, nb);
+        if ((amr_refined[amr_block_of(nb[0]/NY, nb[0]%NY)])||(amr_refined[amr_block_of(nb[2]/NY, nb[2]%NY)])) k = 1;
+        if (!k) continue;
+        for (i=imin; i<imax; i++)
+            for (j=jmin; j<jmax; j++)
+            {
+                if ((i != imin)&&(i != imax-1)&&(j != jmin)&&(j != jmax-1)) continue;
+                grid_neighbours(i, j, NX, NY, nb);
+                k = 0;
+                for (d=0; d<4; d++) if (amr_refined[amr_block_of(nb[d]/NY, nb[d]%NY)]) k = 1;
+                if (k) amr_ghost[amr_nghost++] = i*NY + j;
+            }
+    }
+
+    free(gradient);
+    free(flag);
+    free(refined);
+}
+
+void amr_refine_point(int ij[2])
+/* refine block containing cell ij at all times */
+{
+    if (amr_active) amr_static[amr_block_of(ij[0], ij[1])] = 1;
+}
+
+int init_amr(double *phi[NX], double *psi[NX], short int *xy_in[NX])
+/* allocate coarse grid and blocks, return 1 if refinement can be used */
+{
+    int i, j, k, b, bi, bj, nblocks;
+    double tc;
+
+    amr_active = 0;
+    if ((NX%AMR_RATIO != 0)||(NY%AMR_RATIO != 0)||(AMR_BLOCK%AMR_RATIO != 0)||(AMR_RATIO < 2))
+    {
+        printf("AMR needs NX, NY and AMR_BLOCK to be multiples of AMR_RATIO > 1, using uniform grid\n");
+        return(0);
+    }
+    if ((OSCILLATE_LEFT)||((B_COND != BC_DIRICHLET)&&(B_COND != BC_PERIODIC)&&(B_COND != BC_ABSORBING)&&(B_COND != BC_VPER_HABS)))
+    {
+        printf("AMR does not support these boundary conditions, using uniform grid\n");
+        return(0);
+    }
+
+    amr_nx = NX/AMR_RATIO;
+    amr_ny = NY/AMR_RATIO;
+    amr_nbx = (NX + AMR_BLOCK - 1)/AMR_BLOCK;
+    amr_nby = (NY + AMR_BLOCK - 1)/AMR_BLOCK;
+    nblocks = amr_nbx*amr_nby;
+
+    amr_phi = (double *)malloc(amr_nx*amr_ny*sizeof(double));
+    amr_psi = (double *)malloc(amr_nx*amr_ny*sizeof(double));
+    amr_phi_tmp = (double *)malloc(amr_nx*amr_ny*sizeof(double));
+    amr_psi_tmp = (double *)malloc(amr_nx*amr_ny*sizeof(double));
+    amr_xy = (short int *)malloc(amr_nx*amr_ny*sizeof(short int));
+    amr_covered = (char *)malloc(amr_nx*amr_ny*sizeof(char));
+    amr_refined = (char *)malloc(nblocks*sizeof(char));
+    amr_static = (char *)malloc(nblocks*sizeof(char));
+    amr_block = (int *)malloc(nblocks*sizeof(int));
+    amr_ghost = (int *)malloc(4*nblocks*AMR_BLOCK*sizeof(int));
+
+    for (i=0; i<amr_nx; i++)
+        for (j=0; j<amr_ny; j++)
+            amr_xy[i*amr_ny+j] = xy_in[i*AMR_RATIO + AMR_RATIO/2][j*AMR_RATIO + AMR_RATIO/2];
+
+    /* blocks close to the boundary of the domain are always refined */
+    for (b=0; b<nblocks; b++)
+    {
+        amr_refined[b] = 0;
+        amr_static[b] = 0;
+    }
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+            if (((i < NX-1)&&(xy_in[i+1][j] != xy_in[i][j]))||((j < NY-1)&&(xy_in[i][j+1] != xy_in[i][j])))
+            {
+                for (bi=(i-AMR_BOUNDARY)/AMR_BLOCK; bi<=(i+AMR_BOUNDARY)/AMR_BLOCK; bi++)
+                    for (bj=(j-AMR_BOUNDARY)/AMR_BLOCK; bj<=(j+AMR_BOUNDARY)/AMR_BLOCK; bj++)
+                        if ((bi >= 0)&&(bi < amr_nbx)&&(bj >= 0)&&(bj < amr_nby)) amr_static[bi*amr_nby+bj] = 1;
+            }
+
+    for (k=0; k<3; k++) wave_coefficients(k, &tc, &amr_tcc[k], &amr_tgamma[k]);
+    amr_load_fields(phi, psi);
+    for (k=0; k<amr_nx*amr_ny; k++)
+    {
+        amr_phi_tmp[k] = amr_phi[k];
+        amr_psi_tmp[k] = amr_psi[k];
+    }
+
+    k = 0;
+    for (b=0; b<nblocks; b++) k += amr_static[b];
+    printf("AMR: coarse grid of %i x %i cells, %i of %i blocks refined near boundary\n", amr_nx, amr_ny, k, nblocks);
+    amr_steps = 0;
+    amr_active = 1;
+    return(1);
+}
+
+void free_amr()
+{
+    if (!amr_active) return;
+    free(amr_phi);
+    free(amr_psi);
+    free(amr_phi_tmp);
+    free(amr_psi_tmp);
+    free(amr_xy);
+    free(amr_covered);
+    free(amr_refined);
+    free(amr_static);
+    free(amr_block);
+    free(amr_ghost);
+    amr_active = 0;
+}
+
+void evolve_wave_amr(double *phi[NX], double *psi[NX], double *phi_tmp[NX], double *psi_tmp[NX], short int *xy_in[NX])
+/* one coarse time step of field evolution, made of AMR_RATIO time steps of the refined blocks */
+/* phi is value of field at time t, psi at time t-1 */
+{
+    int m, b, i, j, imin, imax, jmin, jmax;
+
+    if (amr_steps == 0) amr_regrid(phi, psi, xy_in, 1);
+    else if (amr_steps%AMR_REGRID == 0) amr_regrid(phi, psi, xy_in, 0);
+
+    amr_coarse_step();
+
+    for (m=0; m<AMR_RATIO; m++)
+    {
+        if (m%2 == 0)
+        {
+            amr_set_ghosts(phi, xy_in, m);
+            amr_fine_step(phi, psi, phi_tmp, psi_tmp, xy_in);
+        }
+        else
+        {
+            amr_set_ghosts(phi_tmp, xy_in, m);
+            amr_fine_step(phi_tmp, psi_tmp, phi, psi, xy_in);
+        }
+    }
+
+    /* odd number of substeps: refined blocks are in phi_tmp */
+    if (AMR_RATIO%2 == 1)
+    {
+        #pragma omp parallel for private(b,i,j,imin,imax,jmin,jmax)
+        for (b=0; b<amr_nblocks; b++)
+        {
+            amr_block_range(amr_block[b], &imin, &imax, &jmin, &jmax);
+            for (i=imin; i<imax; i++)
+                for (j=jmin; j<jmax; j++)
+                {
+                    phi[i][j] = phi_tmp[i][j];
+                    psi[i][j] = psi_tmp[i][j];
+                }
+        }
+    }
+
+    #pragma omp parallel for private(b)
+    for (b=0; b<amr_nblocks; b++) amr_restrict_block(amr_block[b], phi, psi, 0);
+
+    amr_steps++;
+}
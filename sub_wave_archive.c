@@ -0,0 +1,520 @@
+/* routines writing and reading compressed archives of wave fields */
+/* written by wave_billiard.c and wave_3d.c (SAVE_FIELD_ARCHIVE), read by wave_replay.c */
+/* and wave_3d_replay.c to re-render a movie without solving the wave equation again   */
+
+/* File layout:                                                                   */
+/* t_archive_header, then the compressed domain mask xy_in (mask_size bytes)      */
+/* for each frame: t_archive_frame, then ARCHIVE_NFIELDS*nblocks ints (compressed */
+/* sizes of blocks), then the compressed blocks of phi and of the velocity        */
+/* phi - psi, each quantised to 16 bits with its own scale                        */
+/* frame index: nframes t_archive_index, its offset is stored in the header       */
+
+/* Codec: values are stored as differences with the previous value, mapped to    */
+/* unsigned integers (zigzag) and written in 7-bit groups (varint). A zero byte   */
+/* starts a run of unchanged values, followed by its length. Blocks of            */
+/* ARCHIVE_BLOCK_COLUMNS columns are independent and (de)compressed in parallel.  */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define ARCHIVE_MAGIC "WVARCH1"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_NFIELDS 2           /* field phi and velocity phi - psi */
+#define ARCHIVE_BLOCK_COLUMNS 16    /* number of columns per compressed block */
+#define ARCHIVE_QMAX 32767.0        /* largest quantised value */
+
+#define ARCHIVE_NBLOCKS ((NX + ARCHIVE_BLOCK_COLUMNS - 1)/ARCHIVE_BLOCK_COLUMNS)
+#define ARCHIVE_BLOCK_BOUND (3*ARCHIVE_BLOCK_COLUMNS*NY)   /* max size of compressed block */
+
+typedef struct
+{
+    char magic[8];              /* file signature ARCHIVE_MAGIC */
+    int version;                /* file format version */
+    int header_size;            /* sizes of records, to detect incompatible builds */
+    int frame_size;
+    int nx, ny;                 /* grid size */
+    int b_domain;               /* domain shape, checked by the replay programs */
+    int block_columns;          /* number of columns per block */
+    int mask_size;              /* compressed size of domain mask */
+    int nframes;                /* number of frames, set when file is closed */
+    long index_offset;          /* position of frame index, 0 if file was not closed */
+} t_archive_header;
+
+typedef struct
+{
+    int frame;                  /* frame number in simulation */
+    int size;                   /* size of frame record in bytes */
+    double scale[ARCHIVE_NFIELDS];  /* quantisation step of each field */
+} t_archive_frame;
+
+typedef struct
+{
+    long offset;                /* position of frame in file */
+    int size;                   /* size of frame in bytes */
+    int frame;                  /* frame number */
+} t_archive_index;
+
+typedef struct
+{
+    int fd;                     /* file descriptor */
+    char *data;                 /* memory-mapped file */
+    size_t length;              /* length of file */
+    t_archive_header *header;
+    t_archive_index *index;     /* frame index */
+    int nframes;
+    short int own_index;        /* whether index has been allocated by reader */
+    short int *q;               /* buffer for quantised fields */
+} t_archive_reader;
+
+FILE *archive_file = NULL;
+t_archive_header archive_header;
+t_archive_index *archive_index = NULL;
+int archive_nframes = 0, archive_index_size = 0;
+long archive_position = 0;
+short int *archive_q = NULL;
+unsigned char *archive_buffer = NULL;
+
+
+/*********************/
+/* codec             */
+/*********************/
+
+int put_varint(unsigned int v, unsigned char *out)
+/* write v in groups of 7 bits, returns number of bytes */
+{
+    int n = 0;
+
+    while (v >= 0x80)
+    {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return(n);
+}
+
+unsigned int get_varint(unsigned char *in, int *pos)
+/* read value written by put_varint, and advance position */
+{
+    unsigned int v = 0;
+    int shift = 0;
+
+    while (in[*pos] & 0x80)
+    {
+        v |= (unsigned int)(in[*pos] & 0x7f) << shift;
+        shift += 7;
+        (*pos)++;
+    }
+    v |= (unsigned int)in[*pos] << shift;
+    (*pos)++;
+    return(v);
+}
+
+int encode_block(short int *q, int n, unsigned char *out)
+/* compress n quantised values, returns compressed size (at most 3n bytes) */
+{
+    int k = 0, run, delta, size = 0, prev = 0;
+
+    while (k < n)
+    {
+        delta = (int)q[k] - prev;
+        if (delta == 0)
+        {
+            run = 1;
+            while ((k + run < n)&&(q[k+run] == q[k])) run++;
+            out[size++] = 0;
+            size += put_varint((unsigned int)run, &out[size]);
+            k += run;
+        }
+        else
+        {
+            /* zigzag mapping, nonzero deltas never produce a leading zero byte */
+            size += put_varint(((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31), &out[size]);
+            prev = q[k];
+            k++;
+        }
+    }
+    return(size);
+}
+
+void decode_block(unsigned char *in, int n, short int *q)
+/* decompress n values compressed by encode_block */
+{
+    int k = 0, l, run, pos = 0, prev = 0;
+    unsigned int v;
+
+    while (k < n)
+    {
+        if (in[pos] == 0)
+        {
+            pos++;
+            run = (int)get_varint(in, &pos);
+            for (l=0; (l<run)&&(k<n); l++) q[k++] = (short int)prev;
+        }
+        else
+        {
+            v = get_varint(in, &pos);
+            prev += (int)(v >> 1) ^ -(int)(v & 1);
+            q[k++] = (short int)prev;
+        }
+    }
+}
+
+short int quantize_value(double x, double step)
+/* 16-bit quantisation of x */
+{
+    if (step == 0.0) return(0);
+    return((short int)lrint(x/step));
+}
+
+void quantize_fields_mod(double phi[NX*NY], double psi[NX*NY], short int *q, double scale[ARCHIVE_NFIELDS])
+/* quantise phi and phi - psi, with quantisation steps returned in scale */
+{
+    int k;
+    double max0 = 0.0, max1 = 0.0;
+
+    #pragma omp parallel for private(k) reduction(max:max0,max1)
+    for (k=0; k<NX*NY; k++)
+    {
+        if (vabs(phi[k]) > max0) max0 = vabs(phi[k]);
+        if (vabs(phi[k] - psi[k]) > max1) max1 = vabs(phi[k] - psi[k]);
+    }
+    scale[0] = max0/ARCHIVE_QMAX;
+    scale[1] = max1/ARCHIVE_QMAX;
+
+    #pragma omp parallel for private(k)
+    for (k=0; k<NX*NY; k++)
+    {
+        q[k] = quantize_value(phi[k], scale[0]);
+        q[NX*NY + k] = quantize_value(phi[k] - psi[k], scale[1]);
+    }
+}
+
+void quantize_fields(double *phi[NX], double *psi[NX], short int *q, double scale[ARCHIVE_NFIELDS])
+/* same as quantize_fields_mod, for fields stored as arrays of columns */
+{
+    int i, j;
+    double max0 = 0.0, max1 = 0.0;
+
+    #pragma omp parallel for private(i, j) reduction(max:max0,max1)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            if (vabs(phi[i][j]) > max0) max0 = vabs(phi[i][j]);
+            if (vabs(phi[i][j] - psi[i][j]) > max1) max1 = vabs(phi[i][j] - psi[i][j]);
+        }
+    scale[0] = max0/ARCHIVE_QMAX;
+    scale[1] = max1/ARCHIVE_QMAX;
+
+    #pragma omp parallel for private(i, j)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            q[i*NY + j] = quantize_value(phi[i][j], scale[0]);
+            q[NX*NY + i*NY + j] = quantize_value(phi[i][j] - psi[i][j], scale[1]);
+        }
+}
+
+
+/*********************/
+/* writing           */
+/*********************/
+
+void open_wave_archive_mod(char *filename, short int xy_in[NX*NY])
+/* open archive for writing and save domain mask */
+{
+    archive_file = fopen(filename, "w");
+    if (archive_file == NULL)
+    {
+        printf("Error: cannot open archive file %s\n", filename);
+        exit(1);
+    }
+
+    archive_q = (short int *)malloc(ARCHIVE_NFIELDS*NX*NY*sizeof(short int));
+    archive_buffer = (unsigned char *)malloc(ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS*ARCHIVE_BLOCK_BOUND);
+
+    memset(&archive_header, 0, sizeof(t_archive_header));
+    strcpy(archive_header.magic, ARCHIVE_MAGIC);
+    archive_header.version = ARCHIVE_VERSION;
+    archive_header.header_size = sizeof(t_archive_header);
+    archive_header.frame_size = sizeof(t_archive_frame);
+    archive_header.nx = NX;
+    archive_header.ny = NY;
+    archive_header.b_domain = B_DOMAIN;
+    archive_header.block_columns = ARCHIVE_BLOCK_COLUMNS;
+
+    /* the mask is compressed as a single block, the output buffer is large enough */
+    archive_header.mask_size = encode_block(xy_in, NX*NY, archive_buffer);
+    fwrite(&archive_header, sizeof(t_archive_header), 1, archive_file);
+    fwrite(archive_buffer, 1, archive_header.mask_size, archive_file);
+
+    archive_position = sizeof(t_archive_header) + archive_header.mask_size;
+    archive_nframes = 0;
+    archive_index_size = 1024;
+    archive_index = (t_archive_index *)malloc(archive_index_size*sizeof(t_archive_index));
+
+    printf("Saving wave fields to %s\n", filename);
+}
+
+void open_wave_archive(char *filename, short int *xy_in[NX])
+/* same as open_wave_archive_mod, for fields stored as arrays of columns */
+{
+    int i;
+    short int *mask;
+
+    mask = (short int *)malloc(NX*NY*sizeof(short int));
+    for (i=0; i<NX; i++) memcpy(&mask[i*NY], xy_in[i], NY*sizeof(short int));
+    open_wave_archive_mod(filename, mask);
+    free(mask);
+}
+
+int block_length(int b)
+/* number of values in block b of a field */
+{
+    if ((b + 1)*ARCHIVE_BLOCK_COLUMNS > NX) return((NX - b*ARCHIVE_BLOCK_COLUMNS)*NY);
+    else return(ARCHIVE_BLOCK_COLUMNS*NY);
+}
+
+void write_quantized_frame(int frame, double scale[ARCHIVE_NFIELDS])
+/* compress quantised fields in archive_q and append them to archive */
+{
+    int b, f, size, blocksize[ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS];
+    t_archive_frame record;
+
+    #pragma omp parallel for private(b, f)
+    for (b=0; b<ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS; b++)
+    {
+        f = b/ARCHIVE_NBLOCKS;
+        blocksize[b] = encode_block(&archive_q[f*NX*NY + (b%ARCHIVE_NBLOCKS)*ARCHIVE_BLOCK_COLUMNS*NY],
+                                    block_length(b%ARCHIVE_NBLOCKS), &archive_buffer[(long)b*ARCHIVE_BLOCK_BOUND]);
+    }
+
+    size = sizeof(t_archive_frame) + ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS*sizeof(int);
+    for (b=0; b<ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS; b++) size += blocksize[b];
+
+    if (archive_nframes >= archive_index_size)
+    {
+        archive_index_size *= 2;
+        archive_index = (t_archive_index *)realloc(archive_index, archive_index_size*sizeof(t_archive_index));
+    }
+    archive_index[archive_nframes].offset = archive_position;
+    archive_index[archive_nframes].size = size;
+    archive_index[archive_nframes].frame = frame;
+    archive_nframes++;
+
+    record.frame = frame;
+    record.size = size;
+    for (f=0; f<ARCHIVE_NFIELDS; f++) record.scale[f] = scale[f];
+    fwrite(&record, sizeof(t_archive_frame), 1, archive_file);
+    fwrite(blocksize, sizeof(int), ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS, archive_file);
+    for (b=0; b<ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS; b++)
+        fwrite(&archive_buffer[(long)b*ARCHIVE_BLOCK_BOUND], 1, blocksize[b], archive_file);
+    archive_position += size;
+}
+
+void write_wave_archive_frame_mod(int frame, double phi[NX*NY], double psi[NX*NY])
+/* append fields phi and psi to archive */
+{
+    double scale[ARCHIVE_NFIELDS];
+
+    quantize_fields_mod(phi, psi, archive_q, scale);
+    write_quantized_frame(frame, scale);
+}
+
+void write_wave_archive_frame(int frame, double *phi[NX], double *psi[NX])
+/* same as write_wave_archive_frame_mod, for fields stored as arrays of columns */
+{
+    double scale[ARCHIVE_NFIELDS];
+
+    quantize_fields(phi, psi, archive_q, scale);
+    write_quantized_frame(frame, scale);
+}
+
+void close_wave_archive()
+/* write frame index and update header */
+{
+    fwrite(archive_index, sizeof(t_archive_index), archive_nframes, archive_file);
+
+    archive_header.nframes = archive_nframes;
+    archive_header.index_offset = archive_position;
+    fseek(archive_file, 0, SEEK_SET);
+    fwrite(&archive_header, sizeof(t_archive_header), 1, archive_file);
+    fclose(archive_file);
+
+    printf("Saved %i frames to archive, %.1f MB\n", archive_nframes, (double)archive_position/1048576.0);
+    free(archive_index);
+    free(archive_q);
+    free(archive_buffer);
+    archive_file = NULL;
+}
+
+
+/*********************/
+/* reading           */
+/*********************/
+
+int open_wave_archive_for_reading(char *filename, t_archive_reader *reader)
+/* memory-map archive and load its frame index */
+/* if the simulation was interrupted, the index is reconstructed by scanning the file */
+/* returns number of frames */
+{
+    struct stat st;
+    long offset;
+    int n, size;
+    t_archive_frame *frame;
+
+    reader->fd = open(filename, O_RDONLY);
+    if ((reader->fd < 0)||(fstat(reader->fd, &st) < 0))
+    {
+        printf("Error: cannot open archive file %s\n", filename);
+        exit(1);
+    }
+    reader->length = st.st_size;
+    reader->data = (char *)mmap(NULL, reader->length, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (reader->data == MAP_FAILED)
+    {
+        printf("Error: cannot map archive file %s\n", filename);
+        exit(1);
+    }
+    reader->header = (t_archive_header *)reader->data;
+
+    if ((strcmp(reader->header->magic, ARCHIVE_MAGIC) != 0)||(reader->header->header_size != sizeof(t_archive_header))
+        ||(reader->header->frame_size != sizeof(t_archive_frame))||(reader->header->block_columns != ARCHIVE_BLOCK_COLUMNS))
+    {
+        printf("Error: %s is not a compatible archive file\n", filename);
+        exit(1);
+    }
+    if ((reader->header->nx != NX)||(reader->header->ny != NY))
+    {
+        printf("Error: archive file was computed with NX = %i, NY = %i\n", reader->header->nx, reader->header->ny);
+        exit(1);
+    }
+    if (reader->header->b_domain != B_DOMAIN)
+        printf("Warning: archive file was computed with B_DOMAIN = %i\n", reader->header->b_domain);
+
+    if ((reader->header->index_offset > 0)&&(reader->header->index_offset + reader->header->nframes*sizeof(t_archive_index) <= reader->length))
+    {
+        reader->nframes = reader->header->nframes;
+        reader->index = (t_archive_index *)(reader->data + reader->header->index_offset);
+        reader->own_index = 0;
+    }
+    else
+    {
+        printf("Archive file has no index, scanning frames\n");
+        n = 0;
+        size = 1024;
+        reader->index = (t_archive_index *)malloc(size*sizeof(t_archive_index));
+        offset = sizeof(t_archive_header) + reader->header->mask_size;
+        while (offset + (long)sizeof(t_archive_frame) <= (long)reader->length)
+        {
+            frame = (t_archive_frame *)(reader->data + offset);
+            if ((frame->size <= 0)||(offset + frame->size > (long)reader->length)) break;
+            if (n >= size)
+            {
+                size *= 2;
+                reader->index = (t_archive_index *)realloc(reader->index, size*sizeof(t_archive_index));
+            }
+            reader->index[n].offset = offset;
+            reader->index[n].size = frame->size;
+            reader->index[n].frame = frame->frame;
+            offset += frame->size;
+            n++;
+        }
+        reader->nframes = n;
+        reader->own_index = 1;
+    }
+
+    reader->q = (short int *)malloc(ARCHIVE_NFIELDS*NX*NY*sizeof(short int));
+
+    printf("Archive file %s contains %i frames\n", filename, reader->nframes);
+    return(reader->nframes);
+}
+
+t_archive_frame *archive_frame(t_archive_reader *reader, int n)
+/* pointer to header of frame n */
+{
+    return((t_archive_frame *)(reader->data + reader->index[n].offset));
+}
+
+void read_wave_archive_mask_mod(t_archive_reader *reader, short int xy_in[NX*NY])
+/* decompress domain mask */
+{
+    decode_block((unsigned char *)(reader->data + sizeof(t_archive_header)), NX*NY, xy_in);
+}
+
+void read_wave_archive_mask(t_archive_reader *reader, short int *xy_in[NX])
+/* same as read_wave_archive_mask_mod, for arrays of columns */
+{
+    int i;
+
+    read_wave_archive_mask_mod(reader, reader->q);
+    for (i=0; i<NX; i++) memcpy(xy_in[i], &reader->q[i*NY], NY*sizeof(short int));
+}
+
+void decode_archive_frame(t_archive_reader *reader, int n)
+/* decompress quantised fields of frame n into reader->q */
+{
+    int b, f;
+    long offset[ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS];
+    int *blocksize;
+    unsigned char *data;
+
+    blocksize = (int *)(reader->data + reader->index[n].offset + sizeof(t_archive_frame));
+    data = (unsigned char *)(blocksize + ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS);
+    offset[0] = 0;
+    for (b=1; b<ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS; b++) offset[b] = offset[b-1] + blocksize[b-1];
+
+    #pragma omp parallel for private(b, f)
+    for (b=0; b<ARCHIVE_NFIELDS*ARCHIVE_NBLOCKS; b++)
+    {
+        f = b/ARCHIVE_NBLOCKS;
+        decode_block(&data[offset[b]], block_length(b%ARCHIVE_NBLOCKS),
+                     &reader->q[f*NX*NY + (b%ARCHIVE_NBLOCKS)*ARCHIVE_BLOCK_COLUMNS*NY]);
+    }
+}
+
+int read_wave_archive_frame_mod(t_archive_reader *reader, int n, double phi[NX*NY], double psi[NX*NY])
+/* reconstruct fields phi and psi of frame n, returns frame number in simulation */
+{
+    int k;
+    double *scale;
+
+    decode_archive_frame(reader, n);
+    scale = archive_frame(reader, n)->scale;
+
+    #pragma omp parallel for private(k)
+    for (k=0; k<NX*NY; k++)
+    {
+        phi[k] = (double)reader->q[k]*scale[0];
+        psi[k] = phi[k] - (double)reader->q[NX*NY + k]*scale[1];
+    }
+    return(archive_frame(reader, n)->frame);
+}
+
+int read_wave_archive_frame(t_archive_reader *reader, int n, double *phi[NX], double *psi[NX])
+/* same as read_wave_archive_frame_mod, for fields stored as arrays of columns */
+{
+    int i, j;
+    double *scale;
+
+    decode_archive_frame(reader, n);
+    scale = archive_frame(reader, n)->scale;
+
+    #pragma omp parallel for private(i, j)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            phi[i][j] = (double)reader->q[i*NY + j]*scale[0];
+            psi[i][j] = phi[i][j] - (double)reader->q[NX*NY + i*NY + j]*scale[1];
+        }
+    return(archive_frame(reader, n)->frame);
+}
+
+void close_wave_archive_for_reading(t_archive_reader *reader)
+{
+    if (reader->own_index) free(reader->index);
+    free(reader->q);
+    munmap(reader->data, reader->length);
+    close(reader->fd);
+}
@@ -0,0 +1,219 @@
+/* embedded boundary (cut cells) for curved walls, for wave_billiard.c and heat.c        */
+/* (option CUT_CELLS)                                                                   */
+
+/* With the staircase boundary given by xy_in, the wall is effectively moved to the     */
+/* nearest grid points, which is only first order accurate and scatters waves on        */
+/* curved walls. Here the discretized Laplacian of the cells near the wall is replaced  */
+/* by a stencil taking into account the position of the wall given by xy_in_billiard(). */
+
+/* CUT_DIRICHLET: the distance from a cell to the wall along each grid line is found    */
+/* by bisection, and the Laplacian uses the unequal arms of the Shortley-Weller stencil,*/
+/* which is second order accurate. The value on the wall is the one of the outer cell,  */
+/* that is 0 for the wave equation, or the temperature of the outer cell for heat.c.    */
+
+/* CUT_NEUMANN: each cell is the centre of a square control volume, of which a fraction */
+/* kappa is inside the domain. The Laplacian is the sum of the fluxes through the faces,*/
+/* weighted by the fraction of the face inside the domain (aperture), divided by kappa, */
+/* and there is no flux through the wall. Outer cells with kappa > 0 are evolved too.   */
+
+/* Very small distances to the wall (or volume fractions) would require tiny time       */
+/* steps, they are replaced by CUT_MIN_FRACTION. Cells on the sides of the grid keep    */
+/* the boundary conditions B_COND.                                                      */
+
+#define CUT_MIN_FRACTION 0.25   /* smallest distance to wall or volume fraction used in stencils */
+#define CUT_BISECTIONS 24       /* number of bisection steps to find the wall */
+#define CUT_SAMPLES 16          /* number of samples per direction for apertures and volume fractions */
+
+typedef struct
+{
+    int i, j;               /* position of cell */
+    int nbi[4], nbj[4];     /* position of neighbours (right, left, top, bottom) */
+    double w[5];            /* weights of cell and of its neighbours in discretized Laplacian */
+} t_cut_cell;
+
+int cut_active = 0;         /* set to 1 by init_cut_cells() */
+int cut_ncells = 0;         /* number of cells with modified stencil */
+int cut_medium = -1;        /* value of xy_in in domain, -1 for all nonzero values */
+double cut_wmax = 4.0;      /* largest diagonal weight, the time step has to be reduced when it exceeds 4 */
+t_cut_cell *cut_cells;      /* cells with modified stencil */
+
+
+int cut_in_domain(int xy)
+{
+    if (cut_medium < 0) return(xy != 0);
+    return(xy == cut_medium);
+}
+
+double cut_wall_distance(int i, int j, int inb, int jnb)
+/* fraction of the segment from cell (i,j) to cell (inb,jnb) inside the domain */
+{
+    int k;
+    double xy[2], xynb[2], t, tmin = 0.0, tmax = 1.0;
+
+    ij_to_xy(i, j, xy);
+    ij_to_xy(inb, jnb, xynb);
+    for (k=0; k<CUT_BISECTIONS; k++)
+    {
+        t = 0.5*(tmin + tmax);
+        if (cut_in_domain(xy_in_billiard(xy[0] + t*(xynb[0] - xy[0]), xy[1] + t*(xynb[1] - xy[1])))) tmin = t;
+        else tmax = t;
+    }
+    return(0.5*(tmin + tmax));
+}
+
+double cut_fraction(double x, double y, double dx, double dy, int nx, int ny)
+/* fraction of the rectangle of size dx*dy centred at (x,y) inside the domain, */
+/* using nx*ny samples (faces are rectangles with dx or dy equal to 0)         */
+{
+    int k, l, n = 0;
+
+    for (k=0; k<nx; k++)
+        for (l=0; l<ny; l++)
+            n += cut_in_domain(xy_in_billiard(x + dx*(((double)k + 0.5)/(double)nx - 0.5),
+                                              y + dy*(((double)l + 0.5)/(double)ny - 0.5)));
+    return((double)n/(double)(nx*ny));
+}
+
+int cut_near_wall(int i, int j, short int *xy_in[NX])
+/* returns 1 if the neighbourhood of cell (i,j) contains cells inside and outside the domain */
+{
+    int k, l, in;
+
+    in = cut_in_domain(xy_in[i][j]);
+    for (k=i-1; k<=i+1; k++)
+        for (l=j-1; l<=j+1; l++)
+            if (cut_in_domain(xy_in[k][l]) != in) return(1);
+    return(0);
+}
+
+void cut_dirichlet_cell(t_cut_cell *cell, short int *xy_in[NX])
+/* Shortley-Weller weights of cell */
+{
+    int d;
+    double arm[4];
+
+    for (d=0; d<4; d++)
+    {
+        if (cut_in_domain(xy_in[cell->nbi[d]][cell->nbj[d]])) arm[d] = 1.0;
+        else
+        {
+            arm[d] = cut_wall_distance(cell->i, cell->j, cell->nbi[d], cell->nbj[d]);
+            if (arm[d] < CUT_MIN_FRACTION) arm[d] = CUT_MIN_FRACTION;
+        }
+    }
+    cell->w[1] = 2.0/(arm[0]*(arm[0] + arm[1]));
+    cell->w[2] = 2.0/(arm[1]*(arm[0] + arm[1]));
+    cell->w[3] = 2.0/(arm[2]*(arm[2] + arm[3]));
+    cell->w[4] = 2.0/(arm[3]*(arm[2] + arm[3]));
+    cell->w[0] = 2.0/(arm[0]*arm[1]) + 2.0/(arm[2]*arm[3]);
+}
+
+int cut_neumann_cell(t_cut_cell *cell, float *kappa)
+/* weights of cell given by apertures and volume fraction, returns 1 if they differ from the standard stencil */
+{
+    int d, modified;
+    double xy[2], dx, dy, aperture, volume;
+
+    dx = (XMAX - XMIN)/(double)NX;
+    dy = (YMAX - YMIN)/(double)NY;
+    ij_to_xy(cell->i, cell->j, xy);
+
+    volume = kappa[cell->i*NY + cell->j];
+    modified = (volume < 1.0);
+    if (volume < CUT_MIN_FRACTION) volume = CUT_MIN_FRACTION;
+
+    cell->w[0] = 0.0;
+    for (d=0; d<4; d++)
+    {
+        if (kappa[cell->nbi[d]*NY + cell->nbj[d]] == 0.0) aperture = 0.0;
+        else if (kappa[cell->nbi[d]*NY + cell->nbj[d]] == 1.0) aperture = 1.0;
+        else switch (d) {
+            case (0): aperture = cut_fraction(xy[0] + 0.5*dx, xy[1], 0.0, dy, 1, CUT_SAMPLES); break;
+            case (1): aperture = cut_fraction(xy[0] - 0.5*dx, xy[1], 0.0, dy, 1, CUT_SAMPLES); break;
+            case (2): aperture = cut_fraction(xy[0], xy[1] + 0.5*dy, dx, 0.0, CUT_SAMPLES, 1); break;
+            case (3): aperture = cut_fraction(xy[0], xy[1] - 0.5*dy, dx, 0.0, CUT_SAMPLES, 1); break;
+        }
+        if (aperture < 1.0) modified = 1;
+        cell->w[d+1] = aperture/volume;
+        cell->w[0] += cell->w[d+1];
+    }
+    return(modified);
+}
+
+void init_cut_cells(short int *xy_in[NX], int type, int medium)
+/* find cells near the wall and their stencils - medium is the value of xy_in in the domain, */
+/* or -1 for all nonzero values */
+{
+    int i, j, n;
+    double xy[2], dx, dy;
+    float *kappa;
+    t_cut_cell cell;
+
+    cut_medium = medium;
+    dx = (XMAX - XMIN)/(double)NX;
+    dy = (YMAX - YMIN)/(double)NY;
+
+    /* volume fractions of control volumes, for Neumann conditions */
+    kappa = (float *)malloc(NX*NY*sizeof(float));
+    #pragma omp parallel for private(i,j,xy)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            kappa[i*NY+j] = (float)cut_in_domain(xy_in[i][j]);
+            if ((type == CUT_NEUMANN)&&(i > 0)&&(i < NX-1)&&(j > 0)&&(j < NY-1)&&(cut_near_wall(i, j, xy_in)))
+            {
+                ij_to_xy(i, j, xy);
+                kappa[i*NY+j] = (float)cut_fraction(xy[0], xy[1], dx, dy, CUT_SAMPLES, CUT_SAMPLES);
+            }
+        }
+
+    n = 0;
+    for (i=1; i<NX-1; i++)
+        for (j=1; j<NY-1; j++) if (cut_near_wall(i, j, xy_in)) n++;
+    cut_cells = (t_cut_cell *)malloc(n*sizeof(t_cut_cell));
+
+    cut_ncells = 0;
+    cut_wmax = 4.0;
+    for (i=1; i<NX-1; i++)
+        for (j=1; j<NY-1; j++) if (cut_near_wall(i, j, xy_in))
+        {
+            cell.i = i;         cell.j = j;
+            cell.nbi[0] = i+1;  cell.nbj[0] = j;
+            cell.nbi[1] = i-1;  cell.nbj[1] = j;
+            cell.nbi[2] = i;    cell.nbj[2] = j+1;
+            cell.nbi[3] = i;    cell.nbj[3] = j-1;
+
+            if (type == CUT_DIRICHLET)
+            {
+                if (!cut_in_domain(xy_in[i][j])) continue;
+                cut_dirichlet_cell(&cell, xy_in);
+                if (cell.w[0] == 4.0) continue;
+            }
+            else
+            {
+                if (kappa[i*NY+j] == 0.0) continue;
+                if ((!cut_neumann_cell(&cell, kappa))&&(cut_in_domain(xy_in[i][j]))) continue;
+            }
+            if (cell.w[0] > cut_wmax) cut_wmax = cell.w[0];
+            cut_cells[cut_ncells] = cell;
+            cut_ncells++;
+        }
+    free(kappa);
+
+    cut_active = 1;
+    printf("Embedded boundary: %i cells with modified stencil, largest diagonal weight %.3lg\n", cut_ncells, cut_wmax);
+}
+
+void free_cut_cells()
+{
+    if (cut_active) free(cut_cells);
+    cut_active = 0;
+}
+
+double cut_laplacian(double *phi[NX], t_cut_cell *cell)
+/* discretized Laplacian of cell with modified stencil */
+{
+    return(cell->w[1]*phi[cell->nbi[0]][cell->nbj[0]] + cell->w[2]*phi[cell->nbi[1]][cell->nbj[1]]
+         + cell->w[3]*phi[cell->nbi[2]][cell->nbj[2]] + cell->w[4]*phi[cell->nbi[3]][cell->nbj[3]]
+         - cell->w[0]*phi[cell->i][cell->j]);
+}
@@ -0,0 +1,642 @@
+/* eigenmodes of the discretized Laplacian in a billiard, for wave_modes.c               */
+
+/* The unknowns are the cells with xy_in != 0, the field vanishes in the other cells    */
+/* (hard walls, as in wave_billiard with TWOSPEEDS = 0), and the sides of the grid      */
+/* behave as in grid_neighbours() (absorbing sides are reflecting). The operator is     */
+/* A = -DX^2 times the 5-point Laplacian, so that the eigenvalue mu of a mode is        */
+/* related to its wave number by k = sqrt(mu)/DX.                                        */
+
+/* The NEV eigenpairs of smallest eigenvalue (or closest to a target eigenvalue, by     */
+/* applying the method to (A - target)^2) are computed by the block LOBPCG method of    */
+/* Knyazev, with a few extra guard vectors. The search space [X, W, P] is made of the  */
+/* current approximations X, the preconditioned residuals W and the previous search     */
+/* directions P. It is orthonormalized by Gram-Schmidt (dropping nearly dependent       */
+/* vectors, e.g. residuals of converged modes), and the Rayleigh-Ritz problem is solved */
+/* by Jacobi rotations. The preconditioner is one multigrid V-cycle for A, on a         */
+/* hierarchy of grids coarsened by a factor 2, with damped Jacobi smoothing.            */
+
+#define EIG_MG_MIN 16           /* coarsening stops when a side of the grid is smaller */
+#define EIG_MG_SWEEPS 2         /* number of smoothing sweeps before and after coarse correction */
+#define EIG_MG_COARSE_SWEEPS 60 /* number of sweeps on coarsest grid */
+#define EIG_MG_OMEGA 0.8        /* Jacobi damping */
+#define EIG_DROP 1.0e-10        /* relative norm below which vectors of search space are dropped */
+#define EIG_MAXLEVELS 16
+#define EIG_CHUNK 256          /* size of chunks of vectors in scalar products and linear combinations */
+
+typedef struct
+{
+    int nx, ny;             /* size of grid */
+    double scale;           /* 4^(-level), so that all levels approximate the same operator */
+    char *in;               /* 1 for unknowns */
+    int *nb;                /* 4 neighbours of each cell, as i*ny+j, -1 if equal to the cell */
+    double *x, *b, *r;      /* correction, right-hand side and residual */
+} t_eig_level;
+
+int eig_n;                  /* number of unknowns */
+int *eig_cell;              /* cell of each unknown, as i*NY+j */
+int *eig_nb;                /* 4 neighbours of each unknown, -1 if outside domain or equal to unknown */
+double *eig_diag;           /* diagonal of A */
+double eig_target = 0.0;    /* target eigenvalue, 0 for smallest eigenvalues */
+int eig_nlevels;
+t_eig_level eig_level[EIG_MAXLEVELS];
+
+
+/*********************/
+/* operator          */
+/*********************/
+
+void eig_apply_laplacian(double *x, double *y)
+/* y = A x */
+{
+    int u, d, v;
+    double s;
+
+    #pragma omp parallel for private(u,d,v,s)
+    for (u=0; u<eig_n; u++)
+    {
+        s = eig_diag[u]*x[u];
+        for (d=0; d<4; d++)
+        {
+            v = eig_nb[4*u+d];
+            if (v >= 0) s -= x[v];
+        }
+        y[u] = s;
+    }
+}
+
+void eig_apply_operator(double *x, double *y, double *ax)
+/* y = A x, or (A - target)^2 x, and ax = A x */
+{
+    int u;
+
+    eig_apply_laplacian(x, ax);
+    if (eig_target == 0.0)
+    {
+        memcpy(y, ax, eig_n*sizeof(double));
+        return;
+    }
+    #pragma omp parallel for private(u)
+    for (u=0; u<eig_n; u++) ax[u] -= eig_target*x[u];
+    eig_apply_laplacian(ax, y);
+    #pragma omp parallel for private(u)
+    for (u=0; u<eig_n; u++)
+    {
+        y[u] -= eig_target*ax[u];
+        ax[u] += eig_target*x[u];
+    }
+}
+
+double eig_dot(double *x, double *y)
+{
+    int u;
+    double s = 0.0;
+
+    #pragma omp parallel for private(u) reduction(+:s)
+    for (u=0; u<eig_n; u++) s += x[u]*y[u];
+    return(s);
+}
+
+
+/*********************/
+/* multigrid         */
+/*********************/
+
+void eig_init_level(t_eig_level *level, int nx, int ny, double scale)
+{
+    int c, i, j, d, nb[4];
+
+    level->nx = nx;
+    level->ny = ny;
+    level->scale = scale;
+    level->in = (char *)malloc(nx*ny*sizeof(char));
+    level->nb = (int *)malloc(4*nx*ny*sizeof(int));
+    level->x = (double *)malloc(nx*ny*sizeof(double));
+    level->b = (double *)malloc(nx*ny*sizeof(double));
+    level->r = (double *)malloc(nx*ny*sizeof(double));
+
+    for (i=0; i<nx; i++)
+        for (j=0; j<ny; j++)
+        {
+            c = i*ny + j;
+            grid_neighbours(i, j, nx, ny, nb);
+            for (d=0; d<4; d++)
+            {
+                if (nb[d] == c) level->nb[4*c+d] = -1;
+                else level->nb[4*c+d] = nb[d];
+            }
+        }
+}
+
+void eig_level_residual(t_eig_level *level)
+/* r = b - A x on a level */
+{
+    int c, d, v;
+    double s;
+
+    #pragma omp parallel for private(c,d,v,s)
+    for (c=0; c<level->nx*level->ny; c++) if (level->in[c])
+    {
+        s = 0.0;
+        for (d=0; d<4; d++)
+        {
+            v = level->nb[4*c+d];
+            if (v >= 0)
+            {
+                s += level->x[c];
+                if (level->in[v]) s -= level->x[v];
+            }
+        }
+        level->r[c] = level->b[c] - level->scale*s;
+    }
+}
+
+void eig_smooth(t_eig_level *level, int nsweeps)
+/* damped Jacobi sweeps */
+{
+    int k, c, d, count;
+
+    for (k=0; k<nsweeps; k++)
+    {
+        eig_level_residual(level);
+        #pragma omp parallel for private(c,d,count)
+        for (c=0; c<level->nx*level->ny; c++) if (level->in[c])
+        {
+            count = 0;
+            for (d=0; d<4; d++) if (level->nb[4*c+d] >= 0) count++;
+            if (count > 0) level->x[c] += EIG_MG_OMEGA*level->r[c]/(level->scale*(double)count);
+        }
+    }
+}
+
+void eig_vcycle(int l)
+/* approximate solution of A x = b on level l, starting from x = 0 */
+{
+    t_eig_level *level = &eig_level[l], *coarse;
+    int i, j, a, b, c, cc;
+
+    memset(level->x, 0, level->nx*level->ny*sizeof(double));
+    if (l == eig_nlevels - 1)
+    {
+        eig_smooth(level, EIG_MG_COARSE_SWEEPS);
+        return;
+    }
+
+    coarse = &eig_level[l+1];
+    eig_smooth(level, EIG_MG_SWEEPS);
+    eig_level_residual(level);
+
+    /* restriction: mean of residuals of the 4 children */
+    #pragma omp parallel for private(i,j,a,b,c,cc)
+    for (i=0; i<coarse->nx; i++)
+        for (j=0; j<coarse->ny; j++)
+        {
+            cc = i*coarse->ny + j;
+            coarse->b[cc] = 0.0;
+            if (coarse->in[cc]) for (a=2*i; (a<2*i+2)&&(a<level->nx); a++)
+                for (b=2*j; (b<2*j+2)&&(b<level->ny); b++)
+                {
+                    c = a*level->ny + b;
+                    if (level->in[c]) coarse->b[cc] += 0.25*level->r[c];
+                }
+        }
+
+    eig_vcycle(l+1);
+
+    /* prolongation: constant on children, transpose of restriction */
+    #pragma omp parallel for private(a,b,c,cc)
+    for (a=0; a<level->nx; a++)
+        for (b=0; b<level->ny; b++)
+        {
+            c = a*level->ny + b;
+            cc = (a/2)*coarse->ny + b/2;
+            if ((level->in[c])&&(coarse->in[cc])) level->x[c] += coarse->x[cc];
+        }
+
+    eig_smooth(level, EIG_MG_SWEEPS);
+}
+
+void eig_precondition(double *r, double *w)
+/* w = one V-cycle applied to r */
+{
+    int u;
+    t_eig_level *level = &eig_level[0];
+
+    memset(level->b, 0, level->nx*level->ny*sizeof(double));
+    #pragma omp parallel for private(u)
+    for (u=0; u<eig_n; u++) level->b[eig_cell[u]] = r[u];
+    eig_vcycle(0);
+    #pragma omp parallel for private(u)
+    for (u=0; u<eig_n; u++) w[u] = level->x[eig_cell[u]];
+}
+
+
+/*********************/
+/* initialisation    */
+/*********************/
+
+void init_eigen(short int *xy_in[NX])
+/* list unknowns, build operator and multigrid hierarchy */
+{
+    int i, j, c, d, u, l, a, b, n, nx, ny, nb[4], *unknown;
+    t_eig_level *level, *fine;
+
+    unknown = (int *)malloc(NX*NY*sizeof(int));
+    eig_n = 0;
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            if (xy_in[i][j] != 0) unknown[i*NY+j] = eig_n++;
+            else unknown[i*NY+j] = -1;
+        }
+
+    eig_cell = (int *)malloc(eig_n*sizeof(int));
+    eig_nb = (int *)malloc(4*eig_n*sizeof(int));
+    eig_diag = (double *)malloc(eig_n*sizeof(double));
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++) if ((u = unknown[i*NY+j]) >= 0)
+        {
+            eig_cell[u] = i*NY + j;
+            eig_diag[u] = 0.0;
+            grid_neighbours(i, j, NX, NY, nb);
+            for (d=0; d<4; d++)
+            {
+                eig_nb[4*u+d] = -1;
+                if (nb[d] != i*NY+j)
+                {
+                    eig_diag[u] += 1.0;
+                    eig_nb[4*u+d] = unknown[nb[d]];
+                }
+            }
+        }
+    free(unknown);
+
+    /* multigrid hierarchy, a coarse cell is in the domain if at least 2 of its children are */
+    eig_init_level(&eig_level[0], NX, NY, 1.0);
+    for (c=0; c<NX*NY; c++) eig_level[0].in[c] = (xy_in[c/NY][c%NY] != 0);
+    nx = NX;
+    ny = NY;
+    for (l=1; (l<EIG_MAXLEVELS)&&(nx >= 2*EIG_MG_MIN)&&(ny >= 2*EIG_MG_MIN); l++)
+    {
+        fine = &eig_level[l-1];
+        level = &eig_level[l];
+        nx = (nx + 1)/2;
+        ny = (ny + 1)/2;
+        eig_init_level(level, nx, ny, 0.25*fine->scale);
+        for (i=0; i<nx; i++)
+            for (j=0; j<ny; j++)
+            {
+                n = 0;
+                for (a=2*i; (a<2*i+2)&&(a<fine->nx); a++)
+                    for (b=2*j; (b<2*j+2)&&(b<fine->ny); b++) n += fine->in[a*fine->ny+b];
+                level->in[i*ny+j] = (n >= 2);
+            }
+    }
+    eig_nlevels = l;
+
+    printf("%i unknowns, %i multigrid levels\n", eig_n, eig_nlevels);
+}
+
+void free_eigen()
+{
+    int l;
+
+    for (l=0; l<eig_nlevels; l++)
+    {
+        free(eig_level[l].in);
+        free(eig_level[l].nb);
+        free(eig_level[l].x);
+        free(eig_level[l].b);
+        free(eig_level[l].r);
+    }
+    free(eig_cell);
+    free(eig_nb);
+    free(eig_diag);
+}
+
+
+/*********************/
+/* LOBPCG            */
+/*********************/
+
+void eig_jacobi(double *h, int q, double *eval, double *evec)
+/* eigenvalues (in increasing order) and eigenvectors (columns of evec) of symmetric q*q matrix h */
+{
+    int i, j, k, p, sweep, imin;
+    double off, theta, t, c, s, hpp, hqq, hpq, hkp, hkq, tmp;
+
+    for (i=0; i<q; i++)
+        for (j=0; j<q; j++) evec[i*q+j] = (double)(i == j);
+
+    for (sweep=0; sweep<100; sweep++)
+    {
+        off = 0.0;
+        for (i=0; i<q; i++)
+            for (j=i+1; j<q; j++) off += h[i*q+j]*h[i*q+j];
+        if (off < 1.0e-30) break;
+
+        for (p=0; p<q; p++)
+            for (j=p+1; j<q; j++) if (h[p*q+j] != 0.0)
+            {
+                hpp = h[p*q+p];
+                hqq = h[j*q+j];
+                hpq = h[p*q+j];
+                theta = 0.5*(hqq - hpp)/hpq;
+                t = 1.0/(fabs(theta) + sqrt(theta*theta + 1.0));
+                if (theta < 0.0) t = -t;
+                c = 1.0/sqrt(t*t + 1.0);
+                s = t*c;
+                for (k=0; k<q; k++)
+                {
+                    hkp = h[k*q+p];
+                    hkq = h[k*q+j];
+                    h[k*q+p] = c*hkp - s*hkq;
+                    h[k*q+j] = s*hkp + c*hkq;
+                }
+                for (k=0; k<q; k++)
+                {
+                    hkp = h[p*q+k];
+                    hkq = h[j*q+k];
+                    h[p*q+k] = c*hkp - s*hkq;
+                    h[j*q+k] = s*hkp + c*hkq;
+                }
+                for (k=0; k<q; k++)
+                {
+                    hkp = evec[k*q+p];
+                    hkq = evec[k*q+j];
+                    evec[k*q+p] = c*hkp - s*hkq;
+                    evec[k*q+j] = s*hkp + c*hkq;
+                }
+            }
+    }
+
+    for (i=0; i<q; i++) eval[i] = h[i*q+i];
+
+    /* sort by increasing eigenvalue */
+    for (i=0; i<q; i++)
+    {
+        imin = i;
+        for (j=i+1; j<q; j++) if (eval[j] < eval[imin]) imin = j;
+        if (imin != i)
+        {
+            tmp = eval[i]; eval[i] = eval[imin]; eval[imin] = tmp;
+            for (k=0; k<q; k++)
+            {
+                tmp = evec[k*q+i]; evec[k*q+i] = evec[k*q+imin]; evec[k*q+imin] = tmp;
+            }
+        }
+    }
+}
+
+void eig_gram(double *a[], int na, double *b[], int nb, double *g)
+/* g[k*nb+l] = scalar product of a[k] and b[l], computed by chunks of EIG_CHUNK entries, */
+/* and 4 vectors b[l] at a time                                                          */
+{
+    int k, l, u, u0, u1;
+    double s0, s1, s2, s3, x, *v, *gloc;
+
+    for (k=0; k<na*nb; k++) g[k] = 0.0;
+
+    #pragma omp parallel private(k,l,u,u0,u1,s0,s1,s2,s3,x,v,gloc)
+    {
+        gloc = (double *)calloc(na*nb, sizeof(double));
+        #pragma omp for
+        for (u0=0; u0<eig_n; u0+=EIG_CHUNK)
+        {
+            u1 = u0 + EIG_CHUNK;
+            if (u1 > eig_n) u1 = eig_n;
+            for (k=0; k<na; k++)
+            {
+                v = a[k];
+                for (l=0; l+3<nb; l+=4)
+                {
+                    s0 = s1 = s2 = s3 = 0.0;
+                    for (u=u0; u<u1; u++)
+                    {
+                        x = v[u];
+                        s0 += x*b[l][u];
+                        s1 += x*b[l+1][u];
+                        s2 += x*b[l+2][u];
+                        s3 += x*b[l+3][u];
+                    }
+                    gloc[k*nb+l] += s0;
+                    gloc[k*nb+l+1] += s1;
+                    gloc[k*nb+l+2] += s2;
+                    gloc[k*nb+l+3] += s3;
+                }
+                for (; l<nb; l++)
+                {
+                    s0 = 0.0;
+                    for (u=u0; u<u1; u++) s0 += v[u]*b[l][u];
+                    gloc[k*nb+l] += s0;
+                }
+            }
+        }
+        #pragma omp critical
+        for (k=0; k<na*nb; k++) g[k] += gloc[k];
+        free(gloc);
+    }
+}
+
+void eig_combine(double *s[], int q, double *coef, int ldc, int m, double *out[], int subtract)
+/* out[a] = sum of s[k]*coef[k*ldc+a] for k < q and a < m, 4 vectors s[k] at a time */
+/* - if subtract is 1, the sum is subtracted from out[a] instead                     */
+{
+    int k, a, u, u0, u1;
+    double sign, c0, c1, c2, c3, *o;
+
+    if (subtract) sign = -1.0;
+    else sign = 1.0;
+
+    #pragma omp parallel for private(k,a,u,u0,u1,c0,c1,c2,c3,o)
+    for (u0=0; u0<eig_n; u0+=EIG_CHUNK)
+    {
+        u1 = u0 + EIG_CHUNK;
+        if (u1 > eig_n) u1 = eig_n;
+        for (a=0; a<m; a++)
+        {
+            o = out[a];
+            if (!subtract) for (u=u0; u<u1; u++) o[u] = 0.0;
+            for (k=0; k+3<q; k+=4)
+            {
+                c0 = sign*coef[k*ldc+a];
+                c1 = sign*coef[(k+1)*ldc+a];
+                c2 = sign*coef[(k+2)*ldc+a];
+                c3 = sign*coef[(k+3)*ldc+a];
+                for (u=u0; u<u1; u++) o[u] += c0*s[k][u] + c1*s[k+1][u] + c2*s[k+2][u] + c3*s[k+3][u];
+            }
+            for (; k<q; k++)
+            {
+                c0 = sign*coef[k*ldc+a];
+                for (u=u0; u<u1; u++) o[u] += c0*s[k][u];
+            }
+        }
+    }
+}
+
+void eig_swap(double *s[], double *t[], int n)
+/* exchange vectors s[k] and t[k] for k < n */
+{
+    int k;
+    double *tmp;
+
+    for (k=0; k<n; k++)
+    {
+        tmp = s[k];
+        s[k] = t[k];
+        t[k] = tmp;
+    }
+}
+
+int eig_svqb(double *v[], int nv, double *tmp[])
+/* orthonormalize v[0..nv-1] by diagonalizing their Gram matrix (SVQB of Stathopoulos and Wu), */
+/* using nv vectors tmp - nearly dependent directions are dropped, returns the new number     */
+{
+    int k, l, nkept;
+    double *g, *d, *eval, *evec, *coef;
+
+    if (nv == 0) return(0);
+    g = (double *)malloc(nv*nv*sizeof(double));
+    evec = (double *)malloc(nv*nv*sizeof(double));
+    coef = (double *)malloc(nv*nv*sizeof(double));
+    d = (double *)malloc(nv*sizeof(double));
+    eval = (double *)malloc(nv*sizeof(double));
+
+    eig_gram(v, nv, v, nv, g);
+    for (k=0; k<nv; k++)
+    {
+        if (g[k*nv+k] > 0.0) d[k] = 1.0/sqrt(g[k*nv+k]);
+        else d[k] = 0.0;
+    }
+    for (k=0; k<nv; k++)
+        for (l=0; l<nv; l++) g[k*nv+l] *= d[k]*d[l];
+    eig_jacobi(g, nv, eval, evec);
+
+    /* eigenvalues are in increasing order, the largest ones are kept */
+    nkept = 0;
+    for (l=nv-1; (l>=0)&&(eval[l] > EIG_DROP*eval[nv-1]); l--)
+    {
+        for (k=0; k<nv; k++) coef[k*nv+nkept] = d[k]*evec[k*nv+l]/sqrt(eval[l]);
+        nkept++;
+    }
+    eig_combine(v, nv, coef, nv, nkept, tmp, 0);
+    eig_swap(v, tmp, nkept);
+
+    free(g);
+    free(evec);
+    free(coef);
+    free(d);
+    free(eval);
+    return(nkept);
+}
+
+int compute_eigenmodes(int nev, int nguard, double target, double tolerance, int maxiter,
+                       double *mode[], double eigenvalue[], double residual[])
+/* compute nev eigenpairs of A, of smallest eigenvalue if target = 0, or closest to target */
+/* otherwise - mode[k] are vectors of size eig_n, returns the number of converged modes    */
+/* The search space s contains X in s[0..m-1], followed by W and P, and t is work space.  */
+{
+    int m, q, nv, nw, np, k, l, u, it, pass, nconv;
+    double **s, **t, *y, *ax, *h, *g, *eval, *evec, rayleigh;
+
+    eig_target = target;
+    m = nev + nguard;
+    s = (double **)malloc(3*m*sizeof(double *));
+    t = (double **)malloc(2*m*sizeof(double *));
+    for (k=0; k<3*m; k++) s[k] = (double *)malloc(eig_n*sizeof(double));
+    for (k=0; k<2*m; k++) t[k] = (double *)malloc(eig_n*sizeof(double));
+    y = (double *)malloc(eig_n*sizeof(double));
+    ax = (double *)malloc(eig_n*sizeof(double));
+    h = (double *)malloc(9*m*m*sizeof(double));
+    g = (double *)malloc(4*m*m*sizeof(double));
+    eval = (double *)malloc(3*m*sizeof(double));
+    evec = (double *)malloc(9*m*m*sizeof(double));
+
+    /* random initial vectors, and Rayleigh-Ritz on the space they span */
+    srand(5);
+    for (k=0; k<m; k++)
+        for (u=0; u<eig_n; u++) s[k][u] = (double)rand()/(double)RAND_MAX - 0.5;
+    eig_svqb(s, m, t);
+    for (k=0; k<m; k++) eig_apply_operator(s[k], t[k], ax);
+    eig_gram(s, m, t, m, g);
+    for (k=0; k<m; k++)
+        for (l=0; l<m; l++) h[k*m+l] = 0.5*(g[k*m+l] + g[l*m+k]);
+    eig_jacobi(h, m, eval, evec);
+    eig_combine(s, m, evec, m, m, t, 0);
+    eig_swap(s, t, m);
+
+    np = 0;
+    nconv = 0;
+    for (it=1; it<=maxiter; it++)
+    {
+        /* residuals R of X, in t - convergence is tested on the residuals for A */
+        nconv = 0;
+        for (k=0; k<m; k++)
+        {
+            eig_apply_operator(s[k], y, ax);
+            rayleigh = eig_dot(s[k], ax);
+            #pragma omp parallel for private(u)
+            for (u=0; u<eig_n; u++)
+            {
+                t[k][u] = y[u] - eval[k]*s[k][u];
+                ax[u] -= rayleigh*s[k][u];
+            }
+            if (k < nev)
+            {
+                eigenvalue[k] = rayleigh;
+                residual[k] = sqrt(eig_dot(ax, ax))/(fabs(rayleigh) + 1.0e-15);
+                if ((residual[k] < tolerance)&&(nconv == k)) nconv++;
+            }
+        }
+        if ((nconv == nev)||(it == maxiter)) break;
+        if (it%10 == 0) printf("Iteration %i: %i of %i modes converged, residual of next mode %.3lg\n", it, nconv, nev, residual[nconv]);
+
+        /* preconditioned residuals W of modes not converged yet, followed by P */
+        nw = m - nconv;
+        for (k=0; k<nw; k++) eig_precondition(t[nconv+k], s[m+k]);
+        if (nw < m) eig_swap(&s[m+nw], &s[2*m], np);
+        nv = nw + np;
+
+        /* orthonormalize [W P] against X and itself, twice for stability */
+        for (pass=0; pass<2; pass++)
+        {
+            eig_gram(s, m, &s[m], nv, g);
+            eig_combine(s, m, g, nv, nv, &s[m], 1);
+            nv = eig_svqb(&s[m], nv, t);
+        }
+        q = m + nv;
+
+        /* Rayleigh-Ritz, the block of X is diagonal with the previous Ritz values */
+        for (k=0; k<nv; k++) eig_apply_operator(s[m+k], t[k], ax);
+        for (k=0; k<q*q; k++) h[k] = 0.0;
+        for (k=0; k<m; k++) h[k*q+k] = eval[k];
+        eig_gram(s, m, t, nv, g);
+        for (k=0; k<m; k++)
+            for (l=0; l<nv; l++) h[k*q+m+l] = h[(m+l)*q+k] = g[k*nv+l];
+        eig_gram(&s[m], nv, t, nv, g);
+        for (k=0; k<nv; k++)
+            for (l=0; l<nv; l++) h[(m+k)*q+m+l] = 0.5*(g[k*nv+l] + g[l*nv+k]);
+        eig_jacobi(h, q, eval, evec);
+
+        /* new X, and new directions P given by the components along [W P] */
+        eig_combine(s, q, evec, q, m, t, 0);
+        eig_combine(&s[m], nv, &evec[m*q], q, m, &t[m], 0);
+        eig_swap(s, t, m);
+        eig_swap(&s[2*m], &t[m], m);
+        np = m;
+    }
+
+    for (k=0; k<nev; k++) memcpy(mode[k], s[k], eig_n*sizeof(double));
+    printf("%i of %i modes converged after %i iterations\n", nconv, nev, it);
+
+    for (k=0; k<3*m; k++) free(s[k]);
+    for (k=0; k<2*m; k++) free(t[k]);
+    free(s);
+    free(t);
+    free(y);
+    free(ax);
+    free(h);
+    free(g);
+    free(eval);
+    free(evec);
+    return(nconv);
+}
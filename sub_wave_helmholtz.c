@@ -0,0 +1,670 @@
+/* time-harmonic steady state of the wave equation, for wave_billiard.c (option HELMHOLTZ) */
+
+/* With OSCILLATE_LEFT, the field converges to a periodic orbit of frequency OMEGA,     */
+/* phi(t) = Re(u exp(-i OMEGA t)), after a long transient. The complex amplitude u is   */
+/* computed here directly, as solution of the discrete Helmholtz equation obtained by   */
+/* substituting this form in the scheme of evolve_wave_half(): same stencils, media,    */
+/* damping, absorbing sides (grid_absorbing()) and embedded walls (sub_wave_cut.c), so  */
+/* that the time steps stay on the periodic orbit. The effect of DAMPING is neglected.  */
+/* Optionally, waves are absorbed in a layer along the absorbing sides instead, where   */
+/* k^2 gets an imaginary part: this reflects much less than the absorbing boundary      */
+/* conditions at grazing incidence, but the time steps then leave the orbit slowly.     */
+
+/* The linear system is solved by BiCGStab, preconditioned by one multigrid V-cycle     */
+/* for the shifted Laplacian -Laplacian - (1 + i HELM_SHIFT) k^2 (Erlangga, Vuik and    */
+/* Oosterlee), on a hierarchy of grids coarsened by a factor 2 down to a few cells,     */
+/* with damped Jacobi smoothing and bilinear interpolation of corrections.              */
+/* Complex vectors are stored as pairs (real part, imaginary part).                     */
+
+#define HELM_SHIFT 1.0          /* imaginary part of shift of Laplacian in preconditioner */
+#define HELM_MG_MIN 2           /* coarsening stops when a side of the grid is smaller */
+#define HELM_MG_SWEEPS 2        /* number of smoothing sweeps before and after coarse correction */
+#define HELM_MG_COARSE_SWEEPS 20    /* number of sweeps on coarsest grid */
+#define HELM_MG_OMEGA 0.6       /* Jacobi damping */
+#define HELM_LAYER_DAMPING 1.0  /* largest relative imaginary part of k^2 in absorbing layer */
+#define HELM_MAXLEVELS 16
+
+typedef struct
+{
+    int nx, ny;             /* size of grid */
+    char *in;               /* 1 for unknowns */
+    int *nb;                /* 4 neighbours of each cell, as i*ny+j, -1 if missing */
+    double *off;            /* coefficients of the 4 neighbours */
+    double *diag;           /* complex diagonal coefficient */
+    double *shift;          /* part of diag not coming from the Laplacian */
+    double *x, *b, *r;      /* complex correction, right-hand side and residual */
+} t_helm_level;
+
+int helm_active = 0;        /* set to 1 by init_helmholtz() */
+int helm_n;                 /* number of unknowns */
+int *helm_cell;             /* cell of each unknown, as i*NY+j */
+int *helm_nb;               /* 4 neighbours of each unknown, -1 if not an unknown */
+double *helm_off;           /* coefficients of the 4 neighbours */
+double *helm_diag;          /* complex diagonal coefficient */
+double *helm_rhs;           /* complex right-hand side, from the oscillating boundary */
+double *helm_u;             /* complex amplitude on the whole grid, of size 2*NX*NY */
+double helm_omega;          /* frequency, per time step */
+int helm_layer;             /* width of absorbing layer, in cells */
+int helm_nlevels;
+t_helm_level helm_level[HELM_MAXLEVELS];
+
+
+/*********************/
+/* operator          */
+/*********************/
+
+void helm_apply(double *x, double *y)
+/* y = A x */
+{
+    int u, d, v;
+    double sr, si;
+
+    #pragma omp parallel for private(u,d,v,sr,si)
+    for (u=0; u<helm_n; u++)
+    {
+        sr = helm_diag[2*u]*x[2*u] - helm_diag[2*u+1]*x[2*u+1];
+        si = helm_diag[2*u]*x[2*u+1] + helm_diag[2*u+1]*x[2*u];
+        for (d=0; d<4; d++)
+        {
+            v = helm_nb[4*u+d];
+            if (v >= 0)
+            {
+                sr += helm_off[4*u+d]*x[2*v];
+                si += helm_off[4*u+d]*x[2*v+1];
+            }
+        }
+        y[2*u] = sr;
+        y[2*u+1] = si;
+    }
+}
+
+void helm_dot(double *x, double *y, double dot[2])
+/* dot = sum of conj(x)*y */
+{
+    int u;
+    double sr = 0.0, si = 0.0;
+
+    #pragma omp parallel for private(u) reduction(+:sr,si)
+    for (u=0; u<helm_n; u++)
+    {
+        sr += x[2*u]*y[2*u] + x[2*u+1]*y[2*u+1];
+        si += x[2*u]*y[2*u+1] - x[2*u+1]*y[2*u];
+    }
+    dot[0] = sr;
+    dot[1] = si;
+}
+
+void helm_divide(double a[2], double b[2], double q[2])
+/* q = a/b for complex numbers */
+{
+    double n2;
+
+    n2 = b[0]*b[0] + b[1]*b[1];
+    q[0] = (a[0]*b[0] + a[1]*b[1])/n2;
+    q[1] = (a[1]*b[0] - a[0]*b[1])/n2;
+}
+
+
+/*********************/
+/* multigrid         */
+/*********************/
+
+void helm_init_level(t_helm_level *level, int nx, int ny)
+{
+    int c, i, j, d, nb[4];
+
+    level->nx = nx;
+    level->ny = ny;
+    level->in = (char *)malloc(nx*ny*sizeof(char));
+    level->nb = (int *)malloc(4*nx*ny*sizeof(int));
+    level->off = (double *)malloc(4*nx*ny*sizeof(double));
+    level->diag = (double *)malloc(2*nx*ny*sizeof(double));
+    level->shift = (double *)malloc(2*nx*ny*sizeof(double));
+    level->x = (double *)malloc(2*nx*ny*sizeof(double));
+    level->b = (double *)malloc(2*nx*ny*sizeof(double));
+    level->r = (double *)malloc(2*nx*ny*sizeof(double));
+
+    for (i=0; i<nx; i++)
+        for (j=0; j<ny; j++)
+        {
+            c = i*ny + j;
+            grid_neighbours(i, j, nx, ny, nb);
+            for (d=0; d<4; d++)
+            {
+                if (nb[d] == c) level->nb[4*c+d] = -1;
+                else level->nb[4*c+d] = nb[d];
+                level->off[4*c+d] = 0.0;
+            }
+        }
+}
+
+void helm_level_residual(t_helm_level *level)
+/* r = b - M x on a level */
+{
+    int c, d, v;
+    double sr, si, *x = level->x;
+
+    #pragma omp parallel for private(c,d,v,sr,si)
+    for (c=0; c<level->nx*level->ny; c++) if (level->in[c])
+    {
+        sr = level->diag[2*c]*x[2*c] - level->diag[2*c+1]*x[2*c+1];
+        si = level->diag[2*c]*x[2*c+1] + level->diag[2*c+1]*x[2*c];
+        for (d=0; d<4; d++)
+        {
+            v = level->nb[4*c+d];
+            if ((v >= 0)&&(level->in[v]))
+            {
+                sr += level->off[4*c+d]*x[2*v];
+                si += level->off[4*c+d]*x[2*v+1];
+            }
+        }
+        level->r[2*c] = level->b[2*c] - sr;
+        level->r[2*c+1] = level->b[2*c+1] - si;
+    }
+}
+
+void helm_smooth(t_helm_level *level, int nsweeps)
+/* damped Jacobi sweeps */
+{
+    int k, c;
+    double q[2];
+
+    for (k=0; k<nsweeps; k++)
+    {
+        helm_level_residual(level);
+        #pragma omp parallel for private(c,q)
+        for (c=0; c<level->nx*level->ny; c++) if (level->in[c])
+        {
+            helm_divide(&level->r[2*c], &level->diag[2*c], q);
+            level->x[2*c] += HELM_MG_OMEGA*q[0];
+            level->x[2*c+1] += HELM_MG_OMEGA*q[1];
+        }
+    }
+}
+
+void helm_interpolate(t_helm_level *coarse, int a, int b, double x[2])
+/* add coarse correction at centre of fine cell (a,b) to x - coarse cells outside */
+/* the domain are replaced by the coarse cell containing (a,b)                    */
+{
+    int i, j, k, ci[2], cj[2], c, c0;
+    double w[2] = {0.75, 0.25};
+
+    ci[0] = a/2;
+    cj[0] = b/2;
+    c0 = ci[0]*coarse->ny + cj[0];
+    if (!coarse->in[c0]) return;
+    ci[1] = ci[0] + 2*(a%2) - 1;
+    cj[1] = cj[0] + 2*(b%2) - 1;
+    for (i=0; i<2; i++)
+        for (j=0; j<2; j++)
+        {
+            c = ci[i]*coarse->ny + cj[j];
+            if ((ci[i] < 0)||(ci[i] >= coarse->nx)||(cj[j] < 0)||(cj[j] >= coarse->ny)||(!coarse->in[c])) c = c0;
+            for (k=0; k<2; k++) x[k] += w[i]*w[j]*coarse->x[2*c+k];
+        }
+}
+
+void helm_vcycle(int l)
+/* approximate solution of M x = b on level l, starting from x = 0 */
+{
+    t_helm_level *level = &helm_level[l], *coarse;
+    int i, j, a, b, c, cc;
+
+    memset(level->x, 0, 2*level->nx*level->ny*sizeof(double));
+    if (l == helm_nlevels - 1)
+    {
+        helm_smooth(level, HELM_MG_COARSE_SWEEPS);
+        return;
+    }
+
+    coarse = &helm_level[l+1];
+    helm_smooth(level, HELM_MG_SWEEPS);
+    helm_level_residual(level);
+
+    /* restriction: mean of residuals of the 4 children */
+    #pragma omp parallel for private(i,j,a,b,c,cc)
+    for (i=0; i<coarse->nx; i++)
+        for (j=0; j<coarse->ny; j++)
+        {
+            cc = i*coarse->ny + j;
+            coarse->b[2*cc] = 0.0;
+            coarse->b[2*cc+1] = 0.0;
+            if (coarse->in[cc]) for (a=2*i; (a<2*i+2)&&(a<level->nx); a++)
+                for (b=2*j; (b<2*j+2)&&(b<level->ny); b++)
+                {
+                    c = a*level->ny + b;
+                    if (level->in[c])
+                    {
+                        coarse->b[2*cc] += 0.25*level->r[2*c];
+                        coarse->b[2*cc+1] += 0.25*level->r[2*c+1];
+                    }
+                }
+        }
+
+    helm_vcycle(l+1);
+
+    /* prolongation: bilinear interpolation between centres of coarse cells */
+    #pragma omp parallel for private(a,b,c)
+    for (a=0; a<level->nx; a++)
+        for (b=0; b<level->ny; b++)
+        {
+            c = a*level->ny + b;
+            if (level->in[c]) helm_interpolate(coarse, a, b, &level->x[2*c]);
+        }
+
+    helm_smooth(level, HELM_MG_SWEEPS);
+}
+
+void helm_coarsen(t_helm_level *fine, t_helm_level *coarse)
+/* operator of coarse level: Galerkin operator R M P for the mean R over children and constant */
+/* prolongation P, with the part coming from the Laplacian divided by 2 - this gives the       */
+/* Laplacian of the coarse grid, with the same boundary conditions as the fine grid            */
+{
+    int i, j, a, b, c, cc, v, cv, d, dd, k;
+
+    for (i=0; i<coarse->nx; i++)
+        for (j=0; j<coarse->ny; j++)
+        {
+            cc = i*coarse->ny + j;
+            coarse->in[cc] = 0;
+            for (k=0; k<2; k++)
+            {
+                coarse->diag[2*cc+k] = 0.0;
+                coarse->shift[2*cc+k] = 0.0;
+            }
+            for (a=2*i; (a<2*i+2)&&(a<fine->nx); a++)
+                for (b=2*j; (b<2*j+2)&&(b<fine->ny); b++) if (fine->in[c = a*fine->ny+b])
+                {
+                    coarse->in[cc] = 1;
+                    for (k=0; k<2; k++)
+                    {
+                        coarse->diag[2*cc+k] += 0.125*(fine->diag[2*c+k] - fine->shift[2*c+k]);
+                        coarse->shift[2*cc+k] += 0.25*fine->shift[2*c+k];
+                    }
+                    for (d=0; d<4; d++)
+                    {
+                        v = fine->nb[4*c+d];
+                        if ((v < 0)||(!fine->in[v])) continue;
+                        cv = ((v/fine->ny)/2)*coarse->ny + (v%fine->ny)/2;
+                        if (cv == cc) coarse->diag[2*cc] += 0.125*fine->off[4*c+d];
+                        else for (dd=0; dd<4; dd++) if (coarse->nb[4*cc+dd] == cv)
+                        {
+                            coarse->off[4*cc+dd] += 0.125*fine->off[4*c+d];
+                            break;
+                        }
+                    }
+                }
+            for (k=0; k<2; k++) coarse->diag[2*cc+k] += coarse->shift[2*cc+k];
+        }
+}
+
+void helm_precondition(double *r, double *w)
+/* w = one V-cycle applied to r */
+{
+    int u;
+    t_helm_level *level = &helm_level[0];
+
+    memset(level->b, 0, 2*level->nx*level->ny*sizeof(double));
+    #pragma omp parallel for private(u)
+    for (u=0; u<helm_n; u++)
+    {
+        level->b[2*helm_cell[u]] = r[2*u];
+        level->b[2*helm_cell[u]+1] = r[2*u+1];
+    }
+    helm_vcycle(0);
+    #pragma omp parallel for private(u)
+    for (u=0; u<helm_n; u++)
+    {
+        w[2*u] = level->x[2*helm_cell[u]];
+        w[2*u+1] = level->x[2*helm_cell[u]+1];
+    }
+}
+
+
+/*********************/
+/* initialisation    */
+/*********************/
+
+int helm_fixed_left(int c)
+/* returns 1 if cell c is on the oscillating left side of the grid */
+{
+    return((OSCILLATE_LEFT)&&(c < NY));
+}
+
+double helm_layer_damping(int i, int j)
+/* relative imaginary part of k^2 in absorbing layer, growing quadratically towards absorbing sides */
+{
+    int d = helm_layer;
+    double x;
+
+    if (helm_layer <= 0) return(0.0);
+    if ((B_COND == BC_ABSORBING)||(B_COND == BC_VPER_HABS))
+    {
+        if ((!OSCILLATE_LEFT)&&(i < d)) d = i;
+        if (NX-1-i < d) d = NX-1-i;
+    }
+    if (B_COND == BC_ABSORBING)
+    {
+        if (j < d) d = j;
+        if (NY-1-j < d) d = NY-1-j;
+    }
+    x = 1.0 - (double)d/(double)helm_layer;
+    return(HELM_LAYER_DAMPING*x*x);
+}
+
+void helm_row(int i, int j, int k, short int *xy_in[NX], double diag[2], double off[4], int nb[4], double *base,
+              double *k2)
+/* coefficients of equation of cell (i,j), with index k in cut_cells or -1, and its neighbour cells - */
+/* base is the part of diag coming from the Laplacian, or from the difference with the inner cell    */
+{
+    int d, in, c = i*NY + j;
+    double tc, tcc, gamma, kappa, s2, cosw, sinw;
+
+    cosw = cos(helm_omega);
+    sinw = sin(helm_omega);
+    s2 = 4.0*sin(0.5*helm_omega)*sin(0.5*helm_omega);
+
+    /* absorbing side: (z - 1 + tc + kappa + gamma*(1 - 1/z)) u - tc u_in = 0, with z = exp(-i omega) */
+    in = grid_absorbing(i, j, NX, NY);
+    if ((k < 0)&&(in >= 0))
+    {
+        wave_coefficients(xy_in[i][j], &tc, &tcc, &gamma);
+        if (in%NY == j)     /* inner neighbour in horizontal direction */
+        {
+            kappa = KAPPA_SIDES;
+            gamma = GAMMA_SIDES;
+        }
+        else
+        {
+            kappa = KAPPA_TOPBOT;
+            gamma = GAMMA_TOPBOT;
+        }
+        diag[0] = 1.0 + (cosw - 1.0 + kappa + gamma*(1.0 - cosw))/tc;
+        diag[1] = -(1.0 + gamma)*sinw/tc;
+        for (d=0; d<4; d++) nb[d] = -1;
+        nb[0] = in;
+        off[0] = -1.0;
+        *base = 1.0;
+        *k2 = 0.0;
+        return;
+    }
+
+    /* bulk and cut cells: -Laplacian u - (4 sin^2(omega/2) - KAPPA - gamma*(1 - 1/z))/tcc u = 0 */
+    if (k >= 0)
+    {
+        tcc = COURANT*COURANT;
+        if (xy_in[i][j] == 2) gamma = GAMMAB;
+        else gamma = GAMMA;
+        *base = cut_cells[k].w[0];
+        for (d=0; d<4; d++)
+        {
+            nb[d] = cut_cells[k].nbi[d]*NY + cut_cells[k].nbj[d];
+            off[d] = -cut_cells[k].w[d+1];
+        }
+    }
+    else
+    {
+        wave_coefficients(xy_in[i][j], &tc, &tcc, &gamma);
+        grid_neighbours(i, j, NX, NY, nb);
+        *base = 0.0;
+        for (d=0; d<4; d++)
+        {
+            if (nb[d] == c) nb[d] = -1;
+            else *base += 1.0;
+            off[d] = -1.0;
+        }
+    }
+    diag[0] = *base - (s2 - KAPPA - gamma*(1.0 - cosw))/tcc;
+    *k2 = s2/tcc;
+    diag[1] = -gamma*sinw/tcc - helm_layer_damping(i, j)*(*k2);
+}
+
+void init_helmholtz(short int *xy_in[NX], double omega, int layer)
+/* build the Helmholtz equation for frequency omega, with absorbing layer of given width, */
+/* and the multigrid hierarchy                                                             */
+{
+    int i, j, c, d, u, v, l, nx, ny, nb[4], *unknown, *cutindex;
+    double diag[2], off[4], *k2, *base;
+    t_helm_level *level;
+
+    helm_omega = omega;
+    helm_layer = layer;
+
+    /* cells with modified stencil */
+    cutindex = (int *)malloc(NX*NY*sizeof(int));
+    for (c=0; c<NX*NY; c++) cutindex[c] = -1;
+    if (cut_active) for (u=0; u<cut_ncells; u++) cutindex[cut_cells[u].i*NY + cut_cells[u].j] = u;
+
+    /* unknowns are the cells updated by evolve_wave_half() */
+    unknown = (int *)malloc(NX*NY*sizeof(int));
+    helm_n = 0;
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            c = i*NY + j;
+            if ((!helm_fixed_left(c))&&((TWOSPEEDS)||(xy_in[i][j] != 0)||(cutindex[c] >= 0))) unknown[c] = helm_n++;
+            else unknown[c] = -1;
+        }
+
+    helm_cell = (int *)malloc(helm_n*sizeof(int));
+    helm_nb = (int *)malloc(4*helm_n*sizeof(int));
+    helm_off = (double *)malloc(4*helm_n*sizeof(double));
+    helm_diag = (double *)malloc(2*helm_n*sizeof(double));
+    k2 = (double *)malloc(helm_n*sizeof(double));
+    base = (double *)malloc(helm_n*sizeof(double));
+    helm_rhs = (double *)malloc(2*helm_n*sizeof(double));
+    helm_u = (double *)malloc(2*NX*NY*sizeof(double));
+
+    /* fixed cells go to the right-hand side */
+    #pragma omp parallel for private(c,u,d,nb,off,diag)
+    for (c=0; c<NX*NY; c++) if ((u = unknown[c]) >= 0)
+    {
+        helm_cell[u] = c;
+        helm_row(c/NY, c%NY, cutindex[c], xy_in, diag, off, nb, &base[u], &k2[u]);
+        helm_diag[2*u] = diag[0];
+        helm_diag[2*u+1] = diag[1];
+        helm_rhs[2*u] = 0.0;
+        helm_rhs[2*u+1] = 0.0;
+        for (d=0; d<4; d++)
+        {
+            helm_nb[4*u+d] = -1;
+            helm_off[4*u+d] = off[d];
+            if (nb[d] < 0) continue;
+            helm_nb[4*u+d] = unknown[nb[d]];
+            if ((unknown[nb[d]] < 0)&&(helm_fixed_left(nb[d]))) helm_rhs[2*u] -= off[d]*AMPLITUDE;
+        }
+    }
+    free(cutindex);
+
+    /* multigrid hierarchy for the shifted Laplacian, the finest level has the stencils of A */
+    level = &helm_level[0];
+    helm_init_level(level, NX, NY);
+    memset(level->in, 0, NX*NY*sizeof(char));
+    for (u=0; u<helm_n; u++)
+    {
+        c = helm_cell[u];
+        level->in[c] = 1;
+        level->diag[2*c] = helm_diag[2*u];
+        level->diag[2*c+1] = helm_diag[2*u+1] - HELM_SHIFT*k2[u];
+        level->shift[2*c] = level->diag[2*c] - base[u];
+        level->shift[2*c+1] = level->diag[2*c+1];
+        for (d=0; d<4; d++)
+        {
+            v = helm_nb[4*u+d];
+            if (v >= 0) level->nb[4*c+d] = helm_cell[v];
+            else level->nb[4*c+d] = -1;
+            level->off[4*c+d] = helm_off[4*u+d];
+        }
+    }
+    free(unknown);
+    free(k2);
+    free(base);
+
+    nx = NX;
+    ny = NY;
+    for (l=1; (l<HELM_MAXLEVELS)&&(nx >= 2*HELM_MG_MIN)&&(ny >= 2*HELM_MG_MIN); l++)
+    {
+        nx = (nx + 1)/2;
+        ny = (ny + 1)/2;
+        helm_init_level(&helm_level[l], nx, ny);
+        helm_coarsen(&helm_level[l-1], &helm_level[l]);
+    }
+    helm_nlevels = l;
+
+    helm_active = 1;
+    printf("Helmholtz equation: %i unknowns, %i multigrid levels, wavelength %.3lg cells\n", helm_n, helm_nlevels,
+           PI*COURANT/sin(0.5*omega));
+}
+
+void free_helmholtz()
+{
+    int l;
+
+    if (!helm_active) return;
+    for (l=0; l<helm_nlevels; l++)
+    {
+        free(helm_level[l].in);
+        free(helm_level[l].nb);
+        free(helm_level[l].off);
+        free(helm_level[l].diag);
+        free(helm_level[l].shift);
+        free(helm_level[l].x);
+        free(helm_level[l].b);
+        free(helm_level[l].r);
+    }
+    free(helm_cell);
+    free(helm_nb);
+    free(helm_off);
+    free(helm_diag);
+    free(helm_rhs);
+    free(helm_u);
+    helm_active = 0;
+}
+
+
+/*********************/
+/* solver            */
+/*********************/
+
+int solve_helmholtz(double tolerance, int maxiter)
+/* compute the complex amplitude by right-preconditioned BiCGStab, returns the number of iterations */
+{
+    int u, it, m = 2*helm_n;
+    double *x, *r, *rhat, *p, *v, *y, *t;
+    double rho[2] = {1.0, 0.0}, rho1[2], alpha[2] = {1.0, 0.0}, w[2] = {1.0, 0.0}, beta[2], q[2], dot[2];
+    double bnorm, rnorm;
+
+    x = (double *)calloc(m, sizeof(double));
+    r = (double *)malloc(m*sizeof(double));
+    rhat = (double *)malloc(m*sizeof(double));
+    p = (double *)calloc(m, sizeof(double));
+    v = (double *)calloc(m, sizeof(double));
+    y = (double *)malloc(m*sizeof(double));
+    t = (double *)malloc(m*sizeof(double));
+
+    memcpy(r, helm_rhs, m*sizeof(double));
+    memcpy(rhat, helm_rhs, m*sizeof(double));
+    helm_dot(r, r, dot);
+    bnorm = sqrt(dot[0]);
+    rnorm = bnorm;
+    if (bnorm == 0.0) maxiter = 0;
+
+    for (it=0; (it<maxiter)&&(rnorm > tolerance*bnorm); it++)
+    {
+        /* p = r + beta*(p - w*v) */
+        helm_dot(rhat, r, rho1);
+        helm_divide(rho1, rho, q);
+        helm_divide(alpha, w, beta);
+        dot[0] = q[0]*beta[0] - q[1]*beta[1];
+        dot[1] = q[0]*beta[1] + q[1]*beta[0];
+        beta[0] = dot[0];
+        beta[1] = dot[1];
+        #pragma omp parallel for private(u,q)
+        for (u=0; u<helm_n; u++)
+        {
+            q[0] = p[2*u] - w[0]*v[2*u] + w[1]*v[2*u+1];
+            q[1] = p[2*u+1] - w[0]*v[2*u+1] - w[1]*v[2*u];
+            p[2*u] = r[2*u] + beta[0]*q[0] - beta[1]*q[1];
+            p[2*u+1] = r[2*u+1] + beta[0]*q[1] + beta[1]*q[0];
+        }
+
+        /* half step: x += alpha*M^(-1)p, r -= alpha*A M^(-1)p */
+        helm_precondition(p, y);
+        helm_apply(y, v);
+        helm_dot(rhat, v, dot);
+        helm_divide(rho1, dot, alpha);
+        #pragma omp parallel for private(u)
+        for (u=0; u<helm_n; u++)
+        {
+            x[2*u] += alpha[0]*y[2*u] - alpha[1]*y[2*u+1];
+            x[2*u+1] += alpha[0]*y[2*u+1] + alpha[1]*y[2*u];
+            r[2*u] -= alpha[0]*v[2*u] - alpha[1]*v[2*u+1];
+            r[2*u+1] -= alpha[0]*v[2*u+1] + alpha[1]*v[2*u];
+        }
+        helm_dot(r, r, dot);
+        if (sqrt(dot[0]) <= tolerance*bnorm)
+        {
+            rnorm = sqrt(dot[0]);
+            break;
+        }
+
+        /* stabilisation: x += w*M^(-1)r, r -= w*A M^(-1)r */
+        helm_precondition(r, y);
+        helm_apply(y, t);
+        helm_dot(t, r, q);
+        helm_dot(t, t, dot);
+        helm_divide(q, dot, w);
+        #pragma omp parallel for private(u)
+        for (u=0; u<helm_n; u++)
+        {
+            x[2*u] += w[0]*y[2*u] - w[1]*y[2*u+1];
+            x[2*u+1] += w[0]*y[2*u+1] + w[1]*y[2*u];
+            r[2*u] -= w[0]*t[2*u] - w[1]*t[2*u+1];
+            r[2*u+1] -= w[0]*t[2*u+1] + w[1]*t[2*u];
+        }
+        helm_dot(r, r, dot);
+        rnorm = sqrt(dot[0]);
+        rho[0] = rho1[0];
+        rho[1] = rho1[1];
+        if (it%10 == 0) printf("Helmholtz iteration %i, relative residual %.3lg\n", it, rnorm/bnorm);
+    }
+    printf("Helmholtz solver: relative residual %.3lg after %i iterations\n", rnorm/(bnorm + 1.0e-300), it);
+
+    /* amplitude on the whole grid */
+    for (u=0; u<2*NX*NY; u++) helm_u[u] = 0.0;
+    for (u=0; u<NY; u++) if (helm_fixed_left(u)) helm_u[2*u] = AMPLITUDE;
+    for (u=0; u<helm_n; u++)
+    {
+        helm_u[2*helm_cell[u]] = x[2*u];
+        helm_u[2*helm_cell[u]+1] = x[2*u+1];
+    }
+
+    free(x);
+    free(r);
+    free(rhat);
+    free(p);
+    free(v);
+    free(y);
+    free(t);
+    return(it);
+}
+
+void helmholtz_field(long t, double *phi[NX], double *psi[NX])
+/* field of the periodic orbit at time step t, phi = Re(u exp(-i omega t)), and psi at time step t-1 */
+{
+    int i, j;
+    double c0, s0, c1, s1;
+
+    c0 = cos(helm_omega*(double)t);
+    s0 = sin(helm_omega*(double)t);
+    c1 = cos(helm_omega*(double)(t-1));
+    s1 = sin(helm_omega*(double)(t-1));
+
+    #pragma omp parallel for private(i,j)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            phi[i][j] = helm_u[2*(i*NY+j)]*c0 + helm_u[2*(i*NY+j)+1]*s0;
+            psi[i][j] = helm_u[2*(i*NY+j)]*c1 + helm_u[2*(i*NY+j)+1]*s1;
+        }
+}
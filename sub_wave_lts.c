@@ -0,0 +1,308 @@
+/* local time stepping for the wave equation in two media (TWOSPEEDS)                  */
+/* included by wave_billiard.c and wave_3d.c (option LOCAL_TIME_STEPS)                 */
+
+/* With TWOSPEEDS, the time step is imposed by the Courant number of the faster medium.  */
+/* Here the cells of the slower medium take time steps LTS_RATIO times larger, while    */
+/* the refined region, made of the cells of the faster medium and their neighbours,     */
+/* takes LTS_RATIO small steps during each large step. The coupling at the interface is */
+/* that of the local time stepping leapfrog scheme of Diaz and Grote (SIAM J. Sci.      */
+/* Comput. 31, 2009): during the small steps, the contribution of the other cells to    */
+/* the Laplacian is frozen at its value at the beginning of the large step. The scheme  */
+/* conserves a discrete energy and needs no interpolation in time, and reduces to the   */
+/* usual leapfrog if all cells are slow. The layer of slow cells in the refined region  */
+/* ensures that the large step only involves the Courant number of the slow medium.     */
+
+/* The coupling lowers the stability limit of the large step: LTS_RATIO times the      */
+/* smaller Courant number should stay below about 0.3 (instead of 1/sqrt(2) for the     */
+/* leapfrog scheme), a natural choice being the ratio of the two Courant numbers.       */
+/* Each call of evolve_wave_lts() advances the field by 2*LTS_RATIO time steps,        */
+/* instead of 2 for evolve_wave_half() called twice, so that NVID can be divided by     */
+/* LTS_RATIO to keep the same time between frames.                                      */
+/* Supported boundary conditions are BC_DIRICHLET, BC_PERIODIC, BC_ABSORBING and        */
+/* BC_VPER_HABS. Absorbing boundaries always belong to the slow cells.                  */
+
+#define LTS_COARSE 0        /* cell only coupled to slow cells, takes one large step */
+#define LTS_FINE 1          /* cell of refined region or neighbour of such a cell, takes small steps */
+#define LTS_ABSORBING 2     /* cell of absorbing boundary, takes one large step */
+
+int lts_active = 0;         /* set to 1 by init_lts() if local time stepping can be used */
+int lts_ratio = 1;          /* ratio of large and small time steps */
+int lts_ncells = 0;         /* number of cells taking small steps */
+char *lts_type;             /* type of cell (i,j), at index i*NY+j */
+int *lts_cell;              /* cells taking small steps, as i*NY+j */
+int *lts_nbcell;            /* their 4 neighbours, as i*NY+j */
+int *lts_nbfine;            /* index of neighbours in lts_cell if they are refined, -1 otherwise */
+short int *lts_fine;        /* 1 for cells of the refined region */
+double *lts_tcc, *lts_tgamma;   /* squared Courant number and damping of small step */
+double *lts_w, *lts_z[3];   /* frozen contribution of slow cells, and iterates of small steps */
+
+
+int lts_is_fast(short int *xy_in[NX], int fast_inside, int k)
+/* return 1 if cell k = i*NY+j belongs to the fast medium */
+{
+    int i = k/NY, j = k%NY;
+
+    if (grid_absorbing(i, j, NX, NY) >= 0) return(0);
+    return((xy_in[i][j] != 0) == fast_inside);
+}
+
+int lts_is_refined(short int *xy_in[NX], int fast_inside, int k)
+/* return 1 if cell k = i*NY+j belongs to the refined region */
+{
+    int d, nb[4];
+
+    if (grid_absorbing(k/NY, k%NY, NX, NY) >= 0) return(0);
+    if (lts_is_fast(xy_in, fast_inside, k)) return(1);
+    grid_neighbours(k/NY, k%NY, NX, NY, nb);
+    for (d=0; d<4; d++) if (lts_is_fast(xy_in, fast_inside, nb[d])) return(1);
+    return(0);
+}
+
+int init_lts(short int *xy_in[NX], int ratio)
+/* sort cells according to their time step, and return 1 if local time stepping can be used */
+{
+    int i, j, k, n, d, fast_inside, nb[4], *index;
+    char *refined;
+    double tc, cslow, cfast;
+
+    lts_active = 0;
+    if (!TWOSPEEDS)
+    {
+        printf("Local time stepping needs TWOSPEEDS, using uniform time steps\n");
+        return(0);
+    }
+    if ((COURANT == COURANTB)||(ratio < 2))
+    {
+        printf("Local time stepping needs different speeds and LTS_RATIO > 1, using uniform time steps\n");
+        return(0);
+    }
+    if ((OSCILLATE_LEFT)||((B_COND != BC_DIRICHLET)&&(B_COND != BC_PERIODIC)&&(B_COND != BC_ABSORBING)&&(B_COND != BC_VPER_HABS)))
+    {
+        printf("Local time stepping does not support these boundary conditions, using uniform time steps\n");
+        return(0);
+    }
+
+    fast_inside = (COURANT > COURANTB);
+    cfast = fast_inside ? COURANT : COURANTB;
+    cslow = fast_inside ? COURANTB : COURANT;
+    if ((double)ratio*cslow > 0.3)
+        printf("Warning: LTS_RATIO*%.3lg exceeds stability limit 0.3 of local time stepping, decrease LTS_RATIO\n", cslow);
+    if (((B_COND == BC_ABSORBING)||(B_COND == BC_VPER_HABS))&&((double)ratio*cfast > 1.0))
+        printf("Warning: LTS_RATIO*%.3lg exceeds stability limit 1 of absorbing boundary\n", cfast);
+
+    lts_ratio = ratio;
+    lts_type = (char *)malloc(NX*NY*sizeof(char));
+    index = (int *)malloc(NX*NY*sizeof(int));
+    refined = (char *)malloc(NX*NY*sizeof(char));
+
+    /* classify cells */
+    for (k=0; k<NX*NY; k++) refined[k] = lts_is_refined(xy_in, fast_inside, k);
+    lts_ncells = 0;
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            k = i*NY + j;
+            index[k] = -1;
+            if (grid_absorbing(i, j, NX, NY) >= 0) lts_type[k] = LTS_ABSORBING;
+            else
+            {
+                lts_type[k] = LTS_COARSE;
+                grid_neighbours(i, j, NX, NY, nb);
+                if (refined[k]) lts_type[k] = LTS_FINE;
+                for (d=0; d<4; d++) if (refined[nb[d]]) lts_type[k] = LTS_FINE;
+            }
+            if (lts_type[k] == LTS_FINE) index[k] = lts_ncells++;
+        }
+
+    lts_cell = (int *)malloc((lts_ncells + 1)*sizeof(int));
+    lts_nbcell = (int *)malloc(4*(lts_ncells + 1)*sizeof(int));
+    lts_nbfine = (int *)malloc(4*(lts_ncells + 1)*sizeof(int));
+    lts_fine = (short int *)malloc((lts_ncells + 1)*sizeof(short int));
+    lts_tcc = (double *)malloc((lts_ncells + 1)*sizeof(double));
+    lts_tgamma = (double *)malloc((lts_ncells + 1)*sizeof(double));
+    lts_w = (double *)malloc((lts_ncells + 1)*sizeof(double));
+    for (d=0; d<3; d++) lts_z[d] = (double *)malloc((lts_ncells + 1)*sizeof(double));
+
+    /* list of cells taking small steps, with their neighbours */
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            k = i*NY + j;
+            n = index[k];
+            if (n < 0) continue;
+            lts_cell[n] = k;
+            lts_fine[n] = refined[k];
+            wave_coefficients(xy_in[i][j], &tc, &lts_tcc[n], &lts_tgamma[n]);
+            grid_neighbours(i, j, NX, NY, nb);
+            for (d=0; d<4; d++)
+            {
+                lts_nbcell[4*n+d] = nb[d];
+                if (refined[nb[d]]) lts_nbfine[4*n+d] = index[nb[d]];
+                else lts_nbfine[4*n+d] = -1;
+            }
+        }
+    free(index);
+    free(refined);
+
+    printf("Local time stepping: %i of %i cells take %i small steps per large step\n", lts_ncells, NX*NY, ratio);
+    lts_active = 1;
+    return(1);
+}
+
+void free_lts()
+{
+    int d;
+
+    if (!lts_active) return;
+    free(lts_type);
+    free(lts_cell);
+    free(lts_nbcell);
+    free(lts_nbfine);
+    free(lts_fine);
+    free(lts_tcc);
+    free(lts_tgamma);
+    free(lts_w);
+    for (d=0; d<3; d++) free(lts_z[d]);
+    lts_active = 0;
+}
+
+void lts_step(double *phi_in[NX], double *psi_in[NX], double *phi_out[NX], double *psi_out[NX],
+              short int *xy_in[NX])
+/* large time step of field evolution, made of lts_ratio small time steps */
+/* phi is value of field at time t, psi at time t-1 */
+{
+    int i, j, k, n, m, d, in, nb[4];
+    double x, y, delta, a, tc, tcc, tgamma, p, pp, *zprev, *z, *znext, *ztmp;
+
+    p = (double)lts_ratio;
+    pp = p*p;
+
+    /* cells coupled to slow cells only, and absorbing boundaries: one large step */
+    #pragma omp parallel for private(i,j,k,d,in,nb,x,y,delta,tc,tcc,tgamma)
+    for (i=0; i<NX; i++){
+        for (j=0; j<NY; j++){
+            k = i*NY + j;
+            if (lts_type[k] == LTS_FINE) continue;
+            x = phi_in[i][j];
+            y = psi_in[i][j];
+            wave_coefficients(xy_in[i][j], &tc, &tcc, &tgamma);
+
+            if (lts_type[k] == LTS_COARSE)
+            {
+                if ((i>0)&&(i<NX-1)&&(j>0)&&(j<NY-1))
+                    delta = phi_in[i+1][j] + phi_in[i-1][j] + phi_in[i][j+1] + phi_in[i][j-1] - 4.0*x;
+                else
+                {
+                    grid_neighbours(i, j, NX, NY, nb);
+                    delta = -4.0*x;
+                    for (d=0; d<4; d++) delta += phi_in[nb[d]/NY][nb[d]%NY];
+                }
+                phi_out[i][j] = -y + 2*x + pp*(tcc*delta - KAPPA*x) - p*tgamma*(x-y);
+            }
+            else
+            {
+                in = grid_absorbing(i, j, NX, NY);
+                if (in%NY == j)
+                    phi_out[i][j] = x - p*tc*(x - phi_in[in/NY][in%NY]) - p*KAPPA_SIDES*x - p*GAMMA_SIDES*(x-y);
+                else
+                    phi_out[i][j] = x - p*tc*(x - phi_in[in/NY][in%NY]) - p*KAPPA_TOPBOT*x - p*GAMMA_TOPBOT*(x-y);
+            }
+            psi_out[i][j] = x;
+        }
+    }
+
+    /* contribution of slow cells to the Laplacian of the other cells, frozen during small steps */
+    #pragma omp parallel for private(n,k,d,x,delta)
+    for (n=0; n<lts_ncells; n++)
+    {
+        k = lts_cell[n];
+        x = phi_in[k/NY][k%NY];
+        delta = 0.0;
+        for (d=0; d<4; d++) if (lts_nbfine[4*n+d] < 0)
+            delta += phi_in[lts_nbcell[4*n+d]/NY][lts_nbcell[4*n+d]%NY];
+        if (lts_fine[n]) lts_w[n] = lts_tcc[n]*delta;
+        else lts_w[n] = lts_tcc[n]*(delta - 4.0*x) - KAPPA*x;
+        lts_z[0][n] = x;
+    }
+
+    /* small steps */
+    zprev = lts_z[2];
+    z = lts_z[0];
+    znext = lts_z[1];
+    for (m=0; m<lts_ratio; m++)
+    {
+        #pragma omp parallel for private(n,d,a)
+        for (n=0; n<lts_ncells; n++)
+        {
+            a = lts_w[n];
+            if (lts_fine[n]) a -= (4.0*lts_tcc[n] + KAPPA)*z[n];
+            for (d=0; d<4; d++) if (lts_nbfine[4*n+d] >= 0) a += lts_tcc[n]*z[lts_nbfine[4*n+d]];
+
+            if (m == 0) znext[n] = z[n] + 0.5*a;
+            else znext[n] = 2.0*z[n] - zprev[n] + a;
+        }
+        ztmp = zprev;
+        zprev = z;
+        z = znext;
+        znext = ztmp;
+    }
+
+    #pragma omp parallel for private(n,k,x,y)
+    for (n=0; n<lts_ncells; n++)
+    {
+        k = lts_cell[n];
+        x = phi_in[k/NY][k%NY];
+        y = psi_in[k/NY][k%NY];
+        phi_out[k/NY][k%NY] = 2.0*z[n] - y - p*lts_tgamma[n]*(x-y);
+        psi_out[k/NY][k%NY] = x;
+    }
+
+    /* for debugging purposes/if there is a risk of blow-up */
+    if (FLOOR) for (i=0; i<NX; i++){
+        for (j=0; j<NY; j++){
+            if (xy_in[i][j] != 0)
+            {
+                if (phi_out[i][j] > VMAX) phi_out[i][j] = VMAX;
+                if (phi_out[i][j] < -VMAX) phi_out[i][j] = -VMAX;
+                if (psi_out[i][j] > VMAX) psi_out[i][j] = VMAX;
+                if (psi_out[i][j] < -VMAX) psi_out[i][j] = -VMAX;
+            }
+        }
+    }
+}
+
+void evolve_wave_lts(double *phi[NX], double *psi[NX], double *phi_tmp[NX], double *psi_tmp[NX], short int *xy_in[NX])
+/* two large time steps of field evolution */
+/* phi is value of field at time t, psi at time t-1 */
+{
+    lts_step(phi, psi, phi_tmp, psi_tmp, xy_in);
+    lts_step(phi_tmp, psi_tmp, phi, psi, xy_in);
+}
+
+int init_lts_mod(short int xy_in[NX*NY], int ratio)
+/* version of init_lts() for fields stored in a single array */
+{
+    int i;
+    short int *xy_col[NX];
+
+    for (i=0; i<NX; i++) xy_col[i] = &xy_in[i*NY];
+    return(init_lts(xy_col, ratio));
+}
+
+void evolve_wave_lts_mod(double phi[NX*NY], double psi[NX*NY], double phi_tmp[NX*NY], double psi_tmp[NX*NY], short int xy_in[NX*NY])
+/* version of evolve_wave_lts() for fields stored in a single array */
+{
+    int i;
+    double *phi_col[NX], *psi_col[NX], *phi_tmp_col[NX], *psi_tmp_col[NX];
+    short int *xy_col[NX];
+
+    for (i=0; i<NX; i++)
+    {
+        phi_col[i] = &phi[i*NY];
+        psi_col[i] = &psi[i*NY];
+        phi_tmp_col[i] = &phi_tmp[i*NY];
+        psi_tmp_col[i] = &psi_tmp[i*NY];
+        xy_col[i] = &xy_in[i*NY];
+    }
+    evolve_wave_lts(phi_col, psi_col, phi_tmp_col, psi_tmp_col, xy_col);
+}
@@ -0,0 +1,400 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Parameter sweeps of the simulations                                          */
+/*                                                                               */
+/*  october 2026                                                                 */
+/*                                                                               */
+/*  Reads a sweep file giving a program and values of some of its parameters,    */
+/*  and runs the program for all combinations of these values, without window   */
+/*  (option HEADLESS). For each run, a copy of the program with modified         */
+/*  #define lines is written to its own subfolder, compiled and run there, so    */
+/*  that its output files (archive, dump file, time series) are kept apart.      */
+/*  At most JOBS runs are executed at the same time, each with THREADS OpenMP   */
+/*  threads. Runs share a cache of domain tables xy_in (see init_xyin_cached()   */
+/*  in wave_common.c), so that the domain is only computed once per geometry.   */
+/*  The parameters, exit status, duration and output files of all runs are      */
+/*  written to the file index.txt of the sweep folder.                           */
+/*                                                                               */
+/*  Example of sweep file:                                                       */
+/*                                                                               */
+/*      program wave_billiard                                                    */
+/*      folder sweep_courant                                                     */
+/*      jobs 4                                                                   */
+/*      threads 2                                                                */
+/*      param COURANT 0.01 0.02 0.05                                             */
+/*      param LAMBDA 0.5 1.0                                                     */
+/*                                                                               */
+/*  Optional lines "compiler" and "libs" replace the default compiler command    */
+/*  and libraries. Lines starting with # are ignored.                            */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o sweep sweep.c -O3                                                     */
+/*                                                                               */
+/*  run with                                                                     */
+/*  ./sweep file.sweep                                                           */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define MAXPARAMS 16  /* max number of swept parameters */
+#define MAXVALUES 32  /* max number of values of a parameter */
+#define MAXJOBS 10000 /* max number of runs */
+#define MAXLINES 4000 /* max number of lines of program */
+#define LINELENGTH 1024
+
+#define DEFAULT_COMPILER "gcc -O3 -fopenmp"
+#define DEFAULT_LIBS "-L/usr/X11R6/lib -ltiff -lm -lGL -lGLU -lX11 -lXmu -lglut"
+
+typedef struct
+{
+    char name[64];                      /* name of parameter, as in #define */
+    int nvalues;                        /* number of values */
+    char value[MAXVALUES][64];          /* values of parameter */
+} t_sweep_param;
+
+typedef struct
+{
+    char program[256];                  /* name of program, without .c */
+    char folder[256];                   /* folder of sweep */
+    char compiler[LINELENGTH];          /* compiler and options */
+    char libs[LINELENGTH];              /* libraries */
+    int jobs;                           /* max number of simultaneous runs */
+    int threads;                        /* number of OpenMP threads per run */
+    int nparams;                        /* number of swept parameters */
+    t_sweep_param param[MAXPARAMS];
+} t_sweep;
+
+typedef struct
+{
+    pid_t pid;                          /* process of run, 0 if not running */
+    int status;                         /* exit status */
+    double start, duration;             /* start time and duration in seconds */
+} t_job;
+
+int param_line[MAXPARAMS];              /* lines defining swept parameters */
+
+#include "sub_defines.c"
+
+double wall_time()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return ((double)tv.tv_sec + 1.0e-6 * (double)tv.tv_usec);
+}
+
+void read_sweep_file(char *filename, t_sweep *sweep)
+{
+    FILE *file;
+    char line[LINELENGTH], key[64], *token;
+    t_sweep_param *param;
+
+    file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        printf("Error: cannot open sweep file %s\n", filename);
+        exit(1);
+    }
+
+    strcpy(sweep->program, "");
+    strcpy(sweep->folder, "sweep");
+    strcpy(sweep->compiler, DEFAULT_COMPILER);
+    strcpy(sweep->libs, DEFAULT_LIBS);
+    sweep->jobs = 1;
+    sweep->threads = 0;
+    sweep->nparams = 0;
+
+    while (fgets(line, LINELENGTH, file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((line[0] == '#') || (sscanf(line, "%63s", key) != 1))
+            continue;
+
+        if (strcmp(key, "program") == 0)
+            sscanf(line, "%*s %255s", sweep->program);
+        else if (strcmp(key, "folder") == 0)
+            sscanf(line, "%*s %255s", sweep->folder);
+        else if (strcmp(key, "jobs") == 0)
+            sscanf(line, "%*s %i", &sweep->jobs);
+        else if (strcmp(key, "threads") == 0)
+            sscanf(line, "%*s %i", &sweep->threads);
+        else if (strcmp(key, "compiler") == 0)
+            strcpy(sweep->compiler, line + strlen("compiler") + 1);
+        else if (strcmp(key, "libs") == 0)
+            strcpy(sweep->libs, line + strlen("libs") + 1);
+        else if (strcmp(key, "param") == 0)
+        {
+            if (sweep->nparams >= MAXPARAMS)
+            {
+                printf("Error: more than %i parameters\n", MAXPARAMS);
+                exit(1);
+            }
+            param = &sweep->param[sweep->nparams];
+            token = strtok(line, " \t");
+            token = strtok(NULL, " \t");
+            if (token == NULL)
+                continue;
+            strncpy(param->name, token, 63);
+            param->name[63] = '\0';
+            param->nvalues = 0;
+            while (((token = strtok(NULL, " \t")) != NULL) && (param->nvalues < MAXVALUES))
+            {
+                strncpy(param->value[param->nvalues], token, 63);
+                param->value[param->nvalues][63] = '\0';
+                param->nvalues++;
+            }
+            if (param->nvalues > 0)
+                sweep->nparams++;
+        }
+        else
+            printf("Warning: unknown line \"%s\" in sweep file\n", line);
+    }
+    fclose(file);
+
+    if (strlen(sweep->program) == 0)
+    {
+        printf("Error: no program given in sweep file\n");
+        exit(1);
+    }
+    if (sweep->jobs < 1)
+        sweep->jobs = 1;
+    if (sweep->threads < 1)
+    {
+        sweep->threads = (int)sysconf(_SC_NPROCESSORS_ONLN) / sweep->jobs;
+        if (sweep->threads < 1)
+            sweep->threads = 1;
+    }
+}
+
+void write_job_source(t_sweep *sweep, int value_index[MAXPARAMS], char *filename)
+/* write copy of program with swept parameters, running without window */
+{
+    int n, p, found, headless, movie;
+    FILE *file;
+
+    file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        printf("Error: cannot write %s\n", filename);
+        exit(1);
+    }
+    headless = define_line("HEADLESS");
+    movie = define_line("MOVIE");
+    for (n = 0; n < nlines; n++)
+    {
+        found = 0;
+        for (p = 0; (p < sweep->nparams) && (!found); p++)
+            if (n == param_line[p])
+            {
+                write_define(file, source[n], sweep->param[p].name, sweep->param[p].value[value_index[p]]);
+                found = 1;
+            }
+        if (found)
+            continue;
+        if (n == headless)
+            write_define(file, source[n], "HEADLESS", "1");
+        else if (n == movie)
+            write_define(file, source[n], "MOVIE", "0");
+        else
+            fputs(source[n], file);
+    }
+    fclose(file);
+}
+
+void job_values(t_sweep *sweep, int job, int value_index[MAXPARAMS])
+/* indices of parameter values of a run, the last parameter varying fastest */
+{
+    int p;
+
+    for (p = sweep->nparams - 1; p >= 0; p--)
+    {
+        value_index[p] = job % sweep->param[p].nvalues;
+        job /= sweep->param[p].nvalues;
+    }
+}
+
+pid_t start_job(t_sweep *sweep, int job, char *repo, char *cache)
+/* compile and run program in folder of run */
+{
+    pid_t pid;
+    char folder[600], command[4 * LINELENGTH], threads[16];
+    int fd;
+
+    sprintf(folder, "%s/run_%04i", sweep->folder, job);
+    sprintf(command, "%s -I%s -o %s %s.c %s && ./%s", sweep->compiler, repo, sweep->program, sweep->program, sweep->libs,
+            sweep->program);
+    sprintf(threads, "%i", sweep->threads);
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+        if (chdir(folder) != 0)
+            exit(1);
+        setenv("OMP_NUM_THREADS", threads, 1);
+        setenv("WAVE_MASK_CACHE", cache, 1);
+        fd = fileno(freopen("log.txt", "w", stdout));
+        dup2(fd, 2);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        exit(1);
+    }
+    return (pid);
+}
+
+void write_index_entry(FILE *index, t_sweep *sweep, int job, t_job *run)
+/* write parameters, status, duration and output files of a run */
+{
+    int p, value_index[MAXPARAMS];
+    char folder[600], program_source[300];
+    DIR *dir;
+    struct dirent *entry;
+
+    job_values(sweep, job, value_index);
+    fprintf(index, "run_%04i status %i time %.2f", job, run->status, run->duration);
+    for (p = 0; p < sweep->nparams; p++)
+        fprintf(index, " %s=%s", sweep->param[p].name, sweep->param[p].value[value_index[p]]);
+
+    /* output files are all files of the folder, except program and log */
+    fprintf(index, " outputs");
+    sprintf(folder, "%s/run_%04i", sweep->folder, job);
+    sprintf(program_source, "%s.c", sweep->program);
+    dir = opendir(folder);
+    if (dir != NULL)
+    {
+        while ((entry = readdir(dir)) != NULL)
+            if ((entry->d_name[0] != '.') && (strcmp(entry->d_name, "log.txt") != 0) &&
+                (strcmp(entry->d_name, sweep->program) != 0) && (strcmp(entry->d_name, program_source) != 0))
+                fprintf(index, " %s", entry->d_name);
+        closedir(dir);
+    }
+    fprintf(index, "\n");
+    fflush(index);
+}
+
+int main(int argc, char **argv)
+{
+    int p, job, njobs, nrunning = 0, next = 0, done = 0, status, failed = 0, value_index[MAXPARAMS];
+    char repo[LINELENGTH], cache[2 * LINELENGTH], folder[600], filename[900];
+    pid_t pid;
+    double start;
+    t_sweep sweep;
+    t_job *run;
+    FILE *index;
+
+    if (argc < 2)
+    {
+        printf("Usage: %s sweep_file\n", argv[0]);
+        return 1;
+    }
+
+    read_sweep_file(argv[1], &sweep);
+    read_source(sweep.program);
+
+    if (define_line("HEADLESS") < 0)
+    {
+        printf("Error: %s.c has no HEADLESS option\n", sweep.program);
+        return 1;
+    }
+    njobs = 1;
+    for (p = 0; p < sweep.nparams; p++)
+    {
+        param_line[p] = define_line(sweep.param[p].name);
+        if (param_line[p] < 0)
+        {
+            printf("Error: parameter %s is not defined in %s.c\n", sweep.param[p].name, sweep.program);
+            return 1;
+        }
+        njobs *= sweep.param[p].nvalues;
+    }
+    if (njobs > MAXJOBS)
+    {
+        printf("Error: %i runs, at most %i are allowed\n", njobs, MAXJOBS);
+        return 1;
+    }
+
+    if (getcwd(repo, LINELENGTH) == NULL)
+        return 1;
+    mkdir(sweep.folder, 0755);
+    if (sweep.folder[0] == '/')
+        sprintf(cache, "%s/cache", sweep.folder);
+    else
+        sprintf(cache, "%s/%s/cache", repo, sweep.folder);
+    mkdir(cache, 0755);
+
+    /* write sources of all runs */
+    for (job = 0; job < njobs; job++)
+    {
+        sprintf(folder, "%s/run_%04i", sweep.folder, job);
+        mkdir(folder, 0755);
+        sprintf(filename, "%s/%s.c", folder, sweep.program);
+        job_values(&sweep, job, value_index);
+        write_job_source(&sweep, value_index, filename);
+    }
+
+    sprintf(filename, "%s/index.txt", sweep.folder);
+    index = fopen(filename, "w");
+    if (index == NULL)
+    {
+        printf("Error: cannot write %s\n", filename);
+        return 1;
+    }
+    fprintf(index, "# sweep of %s, %i runs, %i simultaneous runs of %i threads\n", sweep.program, njobs, sweep.jobs,
+            sweep.threads);
+
+    run = (t_job *)malloc(njobs * sizeof(t_job));
+    for (job = 0; job < njobs; job++)
+        run[job].pid = 0;
+
+    printf("Running %i runs of %s, %i at a time with %i threads each\n", njobs, sweep.program, sweep.jobs, sweep.threads);
+    start = wall_time();
+
+    while (done < njobs)
+    {
+        while ((nrunning < sweep.jobs) && (next < njobs))
+        {
+            run[next].start = wall_time();
+            run[next].pid = start_job(&sweep, next, repo, cache);
+            if (run[next].pid < 0)
+            {
+                printf("Error: cannot start run %i\n", next);
+                return 1;
+            }
+            nrunning++;
+            next++;
+        }
+
+        pid = wait(&status);
+        if (pid < 0)
+            break;
+        for (job = 0; job < next; job++)
+            if (run[job].pid == pid)
+            {
+                run[job].pid = 0;
+                run[job].status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                run[job].duration = wall_time() - run[job].start;
+                if (run[job].status != 0)
+                    failed++;
+                write_index_entry(index, &sweep, job, &run[job]);
+                printf("Run %i of %i finished with status %i after %.1f s\n", job + 1, njobs, run[job].status,
+                       run[job].duration);
+                nrunning--;
+                done++;
+            }
+    }
+
+    fprintf(index, "# total time %.2f, %i failed runs\n", wall_time() - start, failed);
+    fclose(index);
+    free(run);
+
+    printf("Sweep finished in %.1f s, %i failed runs, see %s/index.txt\n", wall_time() - start, failed, sweep.folder);
+    return (failed > 0);
+}
@@ -0,0 +1,189 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Monitoring of running simulations                                            */
+/*                                                                               */
+/*  october 2026                                                                 */
+/*                                                                               */
+/*  Lists the status records published by running simulations (see               */
+/*  sub_telemetry.c), one line per run: progress, speed, estimated remaining     */
+/*  time, share of time spent computing, drawing and saving, memory use,         */
+/*  bytes written to storage and observables. The records are read from shared   */
+/*  memory, without disturbing the runs. Runs remove their record when they      */
+/*  end normally, so that records left over belong to interrupted runs.          */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o telemetry telemetry.c -O3                                             */
+/*                                                                               */
+/*  run with                                                                     */
+/*  ./telemetry             list runs once                                       */
+/*  ./telemetry -w 2        refresh list every 2 seconds                         */
+/*  ./telemetry -c          remove records of interrupted runs                   */
+/*  ./telemetry -d folder   read records in folder instead of TELEMETRY_DIR      */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include "sub_telemetry.c"
+
+#define MAXRUNS 1000    /* max number of listed runs */
+
+
+void format_duration(double t, char *s)
+/* duration as h:mm:ss */
+{
+    long n;
+
+    if (t < 0.0)
+    {
+        strcpy(s, "-");
+        return;
+    }
+    n = (long)t;
+    sprintf(s, "%ld:%02ld:%02ld", n/3600, (n/60)%60, n%60);
+}
+
+void format_size(double x, char *s)
+/* size in bytes with unit */
+{
+    char *unit[5] = {"B", "kB", "MB", "GB", "TB"};
+    int k = 0;
+
+    if (x < 0.0)
+    {
+        strcpy(s, "-");
+        return;
+    }
+    while ((x >= 1024.0) && (k < 4))
+    {
+        x /= 1024.0;
+        k++;
+    }
+    sprintf(s, "%.1f%s", x, unit[k]);
+}
+
+int run_alive(t_telemetry_data *data)
+{
+    return ((kill((pid_t)data->pid, 0) == 0) || (errno == EPERM));
+}
+
+void print_run(t_telemetry_data *data, double now)
+/* one line describing a run */
+{
+    char elapsed[32], remaining[32], memory[32], output[32], *status;
+    double total, eta = -1.0;
+    int k;
+
+    if (data->finished) status = "done";
+    else if (!run_alive(data)) status = "stopped";
+    else status = "running";
+
+    format_duration(data->update_time - data->start_time, elapsed);
+    if ((!data->finished) && (data->frame > 0) && (data->nframes > data->frame))
+        eta = (data->update_time - data->start_time)*(double)(data->nframes - data->frame)/(double)data->frame;
+    format_duration(eta, remaining);
+    format_size(data->memory >= 0 ? 1024.0*(double)data->memory : -1.0, memory);
+    format_size((double)data->output_bytes, output);
+
+    total = 0.0;
+    for (k = 0; k < TM_NPHASES; k++) total += data->phase_time[k];
+    if (total <= 0.0) total = 1.0;
+
+    printf("%-16s %7i %-7s %6i/%-6i %5.1f%% %10.4lg %10.3lg %9s %9s  %3.0f/%3.0f/%3.0f%% %9s %9s",
+           data->program, data->pid, status, data->frame, data->nframes,
+           100.0*(double)data->frame/(double)(data->nframes > 0 ? data->nframes : 1),
+           data->sim_time, data->steps_per_second, elapsed, remaining,
+           100.0*data->phase_time[TM_COMPUTE]/total, 100.0*data->phase_time[TM_DRAW]/total,
+           100.0*data->phase_time[TM_SAVE]/total, memory, output);
+    for (k = 0; k < data->nvalues; k++) printf("  %s %.5lg", data->value_name[k], data->value[k]);
+    if ((!data->finished) && (now - data->update_time > 600.0)) printf("  (no update for %.0f s)", now - data->update_time);
+    printf("\n");
+}
+
+int list_runs(char *folder, int clean)
+/* print all records of folder, or remove those of runs that are not running if clean is 1 */
+/* returns number of runs */
+{
+    DIR *dir;
+    struct dirent *entry;
+    char filename[1024];
+    int n = 0, len;
+    double now;
+    t_telemetry_data data;
+
+    dir = opendir(folder);
+    if (dir == NULL)
+    {
+        printf("Error: cannot open folder %s\n", folder);
+        exit(1);
+    }
+    now = telemetry_clock();
+
+    if (!clean)
+        printf("%-16s %7s %-7s %13s %6s %10s %10s %9s %9s  %13s %9s %9s  observables\n", "program", "pid", "status",
+               "frame", "", "sim time", "steps/s", "elapsed", "remaining", "comp/draw/save", "memory", "output");
+
+    while (((entry = readdir(dir)) != NULL) && (n < MAXRUNS))
+    {
+        len = strlen(entry->d_name);
+        if ((len < 7) || (strcmp(entry->d_name + len - 7, ".status") != 0)) continue;
+        snprintf(filename, sizeof(filename), "%s/%s", folder, entry->d_name);
+        if (!telemetry_read(filename, &data)) continue;
+
+        if (clean)
+        {
+            if ((data.finished) || (!run_alive(&data)))
+            {
+                printf("Removing %s\n", filename);
+                unlink(filename);
+            }
+        }
+        else print_run(&data, now);
+        n++;
+    }
+    closedir(dir);
+    return (n);
+}
+
+int main(int argc, char **argv)
+{
+    char *folder;
+    int i, clean = 0, period = 0;
+
+    folder = getenv("SIM_TELEMETRY_DIR");
+    if (folder == NULL) folder = TELEMETRY_DIR;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc)) period = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0) clean = 1;
+        else if ((strcmp(argv[i], "-d") == 0) && (i + 1 < argc)) folder = argv[++i];
+        else
+        {
+            printf("Usage: %s [-w seconds] [-c] [-d folder]\n", argv[0]);
+            return (1);
+        }
+    }
+
+    if ((clean) || (period <= 0))
+    {
+        if (list_runs(folder, clean) == 0) printf("No runs in %s\n", folder);
+        return (0);
+    }
+
+    while (1)
+    {
+        printf("\033[H\033[2J");    /* clear terminal */
+        if (list_runs(folder, 0) == 0) printf("No runs in %s\n", folder);
+        fflush(stdout);
+        sleep(period);
+    }
+    return (0);
+}
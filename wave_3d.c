@@ -44,6 +44,8 @@
 
 #define MOVIE 0         /* set to 1 to generate movie */
 #define DOUBLE_MOVIE 0  /* set to 1 to produce movies for wave height and energy simultaneously */
+#define HEADLESS 0      /* set to 1 to run the simulation without window, e.g. to save an archive */
+#define TELEMETRY 1     /* set to 1 to publish the progress of the run in shared memory, read with telemetry */
 
 /* General geometrical parameters */
 
@@ -118,6 +120,8 @@
 // #define TWOSPEEDS 0          /* set to 1 to replace hardcore boundary by medium with different speed */
 #define TWOSPEEDS 0          /* set to 1 to replace hardcore boundary by medium with different speed */
 #define OSCILLATE_LEFT 0     /* set to 1 to add oscilating boundary condition on the left */
+#define LOCAL_TIME_STEPS 0  /* set to 1 to let the slower medium take larger time steps (needs TWOSPEEDS) */
+#define LTS_RATIO 4         /* ratio of time steps of slower and faster medium, for LOCAL_TIME_STEPS */
 #define OSCILLATE_TOPBOT 0   /* set to 1 to enforce a planar wave on top and bottom boundary */
 
 #define OMEGA 0.005        /* frequency of periodic excitation */
@@ -229,6 +233,8 @@
 #define ROTATE_COLOR_SCHEME 0   /* set to 1 to draw color scheme horizontally */
 
 #define SAVE_TIME_SERIES 0      /* set to 1 to save wave time series at a point */
+#define SAVE_FIELD_ARCHIVE 0    /* set to 1 to save compressed fields, for re-rendering with wave_3d_replay */
+#define ARCHIVE_FILE "wave_archive.bin"   /* file containing archived fields */
 
 /* For debugging purposes only */
 #define FLOOR 0         /* set to 1 to limit wave amplitude to VMAX */
@@ -255,6 +261,9 @@ double observer[3] = {10.0, 6.0, 8.5};    /* location of observer for REP_PROJ_3
 
 #include "global_3d.c"          /* constants and global variables */
 #include "sub_wave_3d.c"        /* graphical functions specific to wave_3d */
+#include "sub_wave_archive.c"   /* compressed archive of wave fields */
+#include "sub_wave_lts.c"       /* local time stepping for two media */
+#include "sub_telemetry.c"      /* live status of the run, for telemetry.c */
 
 FILE *time_series_left, *time_series_right;
 
@@ -495,8 +504,12 @@ void evolve_wave(double phi[NX*NY], double psi[NX*NY], double phi_tmp[NX*NY], do
 /* time step of field evolution */
 /* phi is value of field at time t, psi at time t-1 */
 {
-    evolve_wave_half(phi, psi, phi_tmp, psi_tmp, xy_in, tc, tcc, tgamma);
-    evolve_wave_half(phi_tmp, psi_tmp, phi, psi, xy_in, tc, tcc, tgamma);
+    if (lts_active) evolve_wave_lts_mod(phi, psi, phi_tmp, psi_tmp, xy_in);
+    else
+    {
+        evolve_wave_half(phi, psi, phi_tmp, psi_tmp, xy_in, tc, tcc, tgamma);
+        evolve_wave_half(phi_tmp, psi_tmp, phi, psi, xy_in, tc, tcc, tgamma);
+    }
 }
 
 
@@ -507,15 +520,34 @@ void draw_color_bar_palette(int plot, double range, int palette)
 }
 
 
-void animation()
+/*********************/
+/* simulation core   */
+/*********************/
+
+/* The simulation is initialised and advanced by the functions below, which make no  */
+/* OpenGL calls, so that it can also run without window (option HEADLESS). The      */
+/* fields are observed by reading the arrays of t_wave_sim directly, without copy.  */
+
+typedef struct
+{
+    double *phi, *psi;              /* field at times t and t-1 */
+    double *phi_tmp, *psi_tmp;      /* intermediate fields of time step */
+    double *total_energy;           /* accumulated energy, for P_MEAN_ENERGY */
+    double *color_scale;            /* color scale, for RESCALE_COLOR_IN_CENTER */
+    double *tc, *tcc, *tgamma;      /* tables of wave speed and dissipation */
+    short int *xy_in;               /* has value 1 in billiard */
+    int sample_left[2], sample_right[2];    /* sample points of time series */
+    int frame;                      /* number of frames computed */
+    int period;                     /* number of added oscillating sources */
+} t_wave_sim;
+
+void init_wave_sim(t_wave_sim *sim)
+/* allocate fields, and initialise domain, wave and tables of wave speed */
 {
-    double time, scale, ratio, startleft[2], startright[2], sign, r2, xy[2], fade_value; 
+    double ratio, startleft[2], startright[2], r2, xy[2];
     double *phi, *psi, *phi_tmp, *psi_tmp, *total_energy, *color_scale, *tc, *tcc, *tgamma;
     short int *xy_in;
-    int i, j, s, sample_left[2], sample_right[2], period = 0, fade;
-    static int counter = 0;
-    long int wave_value;
-    t_wave *wave;
+    int i, j, period = 0;
     
     if (SAVE_TIME_SERIES)
     {
@@ -535,8 +567,6 @@ void animation()
     tcc = (double *)malloc(NX*NY*sizeof(double));
     tgamma = (double *)malloc(NX*NY*sizeof(double));
     
-    wave = (t_wave *)malloc(NX*NY*sizeof(t_wave));
-    
     
     /* initialise positions and radii of circles */
     if ((B_DOMAIN == D_CIRCLES)||(B_DOMAIN == D_CIRCLES_IN_RECT)) init_circle_config(circles);
@@ -647,6 +677,145 @@ void animation()
         }
     }
 
+    if (LOCAL_TIME_STEPS) init_lts_mod(xy_in, LTS_RATIO);
+    if (SAVE_FIELD_ARCHIVE) open_wave_archive_mod(ARCHIVE_FILE, xy_in);
+    
+    sim->phi = phi;
+    sim->psi = psi;
+    sim->phi_tmp = phi_tmp;
+    sim->psi_tmp = psi_tmp;
+    sim->total_energy = total_energy;
+    sim->color_scale = color_scale;
+    sim->tc = tc;
+    sim->tcc = tcc;
+    sim->tgamma = tgamma;
+    sim->xy_in = xy_in;
+    sim->frame = 0;
+    sim->period = period;
+    for (i=0; i<2; i++)
+    {
+        sim->sample_left[i] = 0;
+        sim->sample_right[i] = 0;
+    }
+}
+
+void step_wave_sim(t_wave_sim *sim, int nframes)
+/* advance simulation by nframes frames of NVID time steps */
+{
+    int n, j;
+    long int wave_value;
+    
+    for (n=0; n<nframes; n++)
+    {
+        if (SAVE_FIELD_ARCHIVE) write_wave_archive_frame_mod(sim->frame, sim->phi, sim->psi);
+        for (j=0; j<NVID; j++) 
+        {
+            evolve_wave(sim->phi, sim->psi, sim->phi_tmp, sim->psi_tmp, sim->xy_in, sim->tc, sim->tcc, sim->tgamma);
+            if (SAVE_TIME_SERIES)
+            {
+                wave_value = (long int)(sim->phi[sim->sample_left[0]*NY+sim->sample_left[1]]*1.0e16);
+                fprintf(time_series_left, "%019ld\n", wave_value);
+                wave_value = (long int)(sim->phi[sim->sample_right[0]*NY+sim->sample_right[1]]*1.0e16);
+                fprintf(time_series_right, "%019ld\n", wave_value);
+                if ((j == 0)&&(sim->frame%10 == 0)) printf("Frame %i of %i\n", sim->frame, NSTEPS);
+//                 fprintf(time_series_right, "%.15f\n", phi[sample_right[0]][sample_right[1]]);
+            }
+//             if (i % 10 == 9) oscillate_linear_wave(0.2*scale, 0.15*(double)(i*NVID + j), -1.5, YMIN, -1.5, YMAX, phi, psi);
+        }
+        
+        /* add oscillating waves */
+        if ((ADD_OSCILLATING_SOURCE)&&(sim->frame%OSCILLATING_SOURCE_PERIOD == OSCILLATING_SOURCE_PERIOD - 1))
+        {
+            add_circular_wave_mod(1.0, -1.0, 0.0, sim->phi, sim->psi, sim->xy_in);
+//               add_circular_wave(1.0, -1.5*LAMBDA, 0.0, phi, psi, xy_in);
+//             add_circular_wave(-1.0, 0.6*cos((double)(period)*DPI/3.0), 0.6*sin((double)(period)*DPI/3.0), phi, psi, xy_in);
+            sim->period++;    
+        }
+        sim->frame++;
+    }
+}
+
+void publish_wave_telemetry(t_wave_sim *sim, double scale)
+/* end of frame for telemetry - a frame has NVID time steps, made of two half steps */
+{
+    long steps;
+    double variance, energy;
+    
+    if (!telemetry_enabled()) return;
+    compute_wave_observables_mod(sim->phi, sim->psi, sim->xy_in, &variance, &energy);
+    telemetry_value(0, "variance", variance);
+    telemetry_value(1, "energy", energy);
+    if (SCALE) telemetry_value(2, "scale", scale);
+    steps = (long)sim->frame*(long)(2*NVID);
+    telemetry_frame(sim->frame, steps, (double)steps*COURANT*(XMAX - XMIN)/(double)NX);
+}
+
+void free_wave_sim(t_wave_sim *sim)
+/* free fields, and close output files */
+{
+    if (SAVE_FIELD_ARCHIVE) close_wave_archive();
+    if (LOCAL_TIME_STEPS) free_lts();
+    
+    free(sim->xy_in);
+    free(sim->phi);
+    free(sim->psi);
+    free(sim->phi_tmp);
+    free(sim->psi_tmp);
+    free(sim->total_energy);
+    free(sim->color_scale);
+    free(sim->tc);
+    free(sim->tcc);
+    free(sim->tgamma);
+    
+    if (SAVE_TIME_SERIES)
+    {
+        fclose(time_series_left);
+        fclose(time_series_right);
+    }
+}
+
+void headless_run()
+/* run the simulation without window, e.g. to save an archive for wave_3d_replay */
+{
+    t_wave_sim sim;
+    
+    if ((!SAVE_FIELD_ARCHIVE)&&(!SAVE_TIME_SERIES)) printf("Warning: HEADLESS run saves neither archive nor time series\n");
+    
+    init_wave_sim(&sim);
+    if (TELEMETRY) telemetry_open("wave_3d", INITIAL_TIME + NSTEPS + 1);
+    while (sim.frame <= INITIAL_TIME + NSTEPS)
+    {
+        telemetry_phase(TM_COMPUTE);
+        step_wave_sim(&sim, 1);
+        publish_wave_telemetry(&sim, 1.0);
+        if (sim.frame%10 == 0) printf("Computed frame %i of %i\n", sim.frame, INITIAL_TIME + NSTEPS);
+    }
+    telemetry_close();
+    free_wave_sim(&sim);
+}
+
+
+/*********************/
+/* window front-end  */
+/*********************/
+
+void animation()
+{
+    double scale; 
+    double *phi, *psi;
+    short int *xy_in;
+    int i, s;
+    static int counter = 0;
+    t_wave *wave;
+    t_wave_sim sim;
+    
+    init_wave_sim(&sim);
+    phi = sim.phi;
+    psi = sim.psi;
+    xy_in = sim.xy_in;
+    
+    wave = (t_wave *)malloc(NX*NY*sizeof(t_wave));
+
     blank();
     glColor3f(0.0, 0.0, 0.0);
     draw_wave_3d(phi, psi, xy_in, wave, ZPLOT, CPLOT, COLOR_PALETTE, 0, 1.0);
@@ -660,10 +829,12 @@ void animation()
 
 
     sleep(SLEEP1);
+    if (TELEMETRY) telemetry_open("wave_3d", INITIAL_TIME + NSTEPS + 1);
 
     for (i=0; i<=INITIAL_TIME + NSTEPS; i++)
     {
 	//printf("%d\n",i);
+        telemetry_phase(TM_DRAW);
         /* compute the variance of the field to adjust color scheme */
         /* the color depends on the field divided by sqrt(1 + variance) */
         if (SCALE)
@@ -674,38 +845,20 @@ void animation()
         else scale = 1.0;
         
         draw_wave_3d(phi, psi, xy_in, wave, ZPLOT, CPLOT, COLOR_PALETTE, 0, 1.0);
-        for (j=0; j<NVID; j++) 
-        {
-            evolve_wave(phi, psi, phi_tmp, psi_tmp, xy_in, tc, tcc, tgamma);
-            if (SAVE_TIME_SERIES)
-            {
-                wave_value = (long int)(phi[sample_left[0]*NY+sample_left[1]]*1.0e16);
-                fprintf(time_series_left, "%019ld\n", wave_value);
-                wave_value = (long int)(phi[sample_right[0]*NY+sample_right[1]]*1.0e16);
-                fprintf(time_series_right, "%019ld\n", wave_value);
-                if ((j == 0)&&(i%10 == 0)) printf("Frame %i of %i\n", i, NSTEPS);
-//                 fprintf(time_series_right, "%.15f\n", phi[sample_right[0]][sample_right[1]]);
-            }
-//             if (i % 10 == 9) oscillate_linear_wave(0.2*scale, 0.15*(double)(i*NVID + j), -1.5, YMIN, -1.5, YMAX, phi, psi);
-        }
+        
+        telemetry_phase(TM_COMPUTE);
+        step_wave_sim(&sim, 1);
+        telemetry_phase(TM_DRAW);
         
 //         draw_billiard();
         
         if (DRAW_COLOR_SCHEME) draw_color_bar_palette(CPLOT, COLORBAR_RANGE, COLOR_PALETTE); 
         
-        /* add oscillating waves */
-        if ((ADD_OSCILLATING_SOURCE)&&(i%OSCILLATING_SOURCE_PERIOD == OSCILLATING_SOURCE_PERIOD - 1))
-        {
-            add_circular_wave_mod(1.0, -1.0, 0.0, phi, psi, xy_in);
-//               add_circular_wave(1.0, -1.5*LAMBDA, 0.0, phi, psi, xy_in);
-//             add_circular_wave(-1.0, 0.6*cos((double)(period)*DPI/3.0), 0.6*sin((double)(period)*DPI/3.0), phi, psi, xy_in);
-            period++;    
-        }
-
 	glutSwapBuffers();
 
 	if (MOVIE)
         {
+            telemetry_phase(TM_SAVE);
             if (i >= INITIAL_TIME) save_frame();
             else printf("Initial phase time %i of %i\n", i, INITIAL_TIME);
             
@@ -728,8 +881,9 @@ void animation()
                 s = system("mv wave*.tif tif_wave/");
             }
         }
-
+        publish_wave_telemetry(&sim, scale);
     }
+    telemetry_close();
 
     if (MOVIE) 
     {
@@ -775,27 +929,8 @@ void animation()
         s = system("mv wave*.tif tif_wave/");
     }
     
-    free(xy_in);
-    free(phi);
-    free(psi);
-    free(phi_tmp);
-    free(psi_tmp);
-    free(total_energy);
-    free(color_scale);
-    free(tc);
-    free(tcc);
-    free(tgamma);
-    
+    free_wave_sim(&sim);
     free(wave);
-
-    
-    if (SAVE_TIME_SERIES)
-    {
-        fclose(time_series_left);
-        fclose(time_series_right);
-    }
-
-
 }
 
 
@@ -820,6 +955,12 @@ void display(void)
 
 int main(int argc, char** argv)
 {
+    if (HEADLESS)
+    {
+        headless_run();
+        return 0;
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
     glutInitWindowSize(WINWIDTH,WINHEIGHT);
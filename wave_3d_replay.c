@@ -0,0 +1,417 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Re-rendering of wave fields saved by wave_3d                                 */
+/*                                                                               */
+/*  october 2026, based on wave_3d.c by N. Berglund                              */
+/*                                                                               */
+/*  Reads the archive written by wave_3d with SAVE_FIELD_ARCHIVE set to 1, and   */
+/*  produces the movie frames without solving the wave equation again.          */
+/*  Parameters defining the geometry (grid size, domain, window) have to agree   */
+/*  with those of the simulation, while ZPLOT, CPLOT, palettes, the 3D           */
+/*  projection parameters and DOUBLE_MOVIE can be changed freely.                */
+/*  Frames are split into RENDER_PROCESSES contiguous blocks, each rendered by   */
+/*  its own process and window. The still frames at the end of the movie show    */
+/*  the last archived field.                                                     */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o wave_3d_replay wave_3d_replay.c                                       */
+/* -L/usr/X11R6/lib -ltiff -lm -lGL -lGLU -lX11 -lXmu -lglut -O3 -fopenmp        */
+/*                                                                               */
+/*  create subfolder tif_wave, and create movie using                            */
+/*  ffmpeg -i wave.%05d.tif -vcodec libx264 wave.mp4                             */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <GL/glut.h>
+#include <GL/glu.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <tiffio.h>     /* Sam Leffler's libtiff library. */
+#include <omp.h>
+
+#define DOUBLE_MOVIE 0  /* set to 1 to produce movies for wave height and energy simultaneously */
+
+#define ARCHIVE_FILE "wave_archive.bin"   /* file containing fields, saved by wave_3d */
+#define RENDER_PROCESSES 4      /* number of processes rendering frames in parallel */
+
+/* General geometrical parameters */
+
+/* uncomment for higher resolution */
+// #define WINWIDTH 	1920  /* window width */
+// #define WINHEIGHT 	1000  /* window height */
+// #define NX 1920          /* number of grid points on x axis */
+// #define NY 1000          /* number of grid points on y axis */
+// // #define NX 3840          /* number of grid points on x axis */
+// // #define NY 2000          /* number of grid points on y axis */
+// 
+// #define XMIN -2.0
+// #define XMAX 2.0	/* x interval  */
+// #define YMIN -1.041666667
+// #define YMAX 1.041666667	/* y interval for 9/16 aspect ratio */
+
+#define HIGHRES 0        /* set to 1 if resolution of grid is double that of displayed image */
+
+/* comment out for higher resolution */
+#define WINWIDTH 	1280  /* window width */
+#define WINHEIGHT 	720   /* window height */
+
+#define NX 1280          /* number of grid points on x axis */
+#define NY 720          /* number of grid points on y axis */
+
+#define XMIN -2.0
+#define XMAX 2.0	/* x interval  */
+#define YMIN -1.125
+#define YMAX 1.125	/* y interval for 9/16 aspect ratio */
+
+#define JULIA_SCALE 0.8 /* scaling for Julia sets */
+
+/* Choice of the billiard table */
+
+#define B_DOMAIN 16        /* choice of domain shape, see list in global_pdes.c */
+
+#define CIRCLE_PATTERN 201   /* pattern of circles or polygons, see list in global_pdes.c */
+
+#define P_PERCOL 0.25       /* probability of having a circle in C_RAND_PERCOL arrangement */
+#define NPOISSON 300        /* number of points for Poisson C_RAND_POISSON arrangement */
+#define RANDOM_POLY_ANGLE 1 /* set to 1 to randomize angle of polygons */
+
+#define LAMBDA 0.6	    /* parameter controlling the dimensions of domain */
+#define MU 0.6              /* parameter controlling the dimensions of domain */
+#define NPOLY 6             /* number of sides of polygon */
+#define APOLY 0.0           /* angle by which to turn polygon, in units of Pi/2 */ 
+#define MDEPTH 3            /* depth of computation of Menger gasket */
+#define MRATIO 3            /* ratio defining Menger gasket */
+#define MANDELLEVEL 1000    /* iteration level for Mandelbrot set */
+#define MANDELLIMIT 10.0    /* limit value for approximation of Mandelbrot set */
+#define FOCI 1              /* set to 1 to draw focal points of ellipse */
+#define NGRIDX 36           /* number of grid point for grid of disks */
+#define NGRIDY 6           /* number of grid point for grid of disks */
+
+#define X_SHOOTER -0.2
+#define Y_SHOOTER -0.6
+#define X_TARGET 0.4
+#define Y_TARGET 0.7        /* shooter and target positions in laser fight */
+
+#define ISO_XSHIFT_LEFT -2.9
+#define ISO_XSHIFT_RIGHT 1.4
+#define ISO_YSHIFT_LEFT -0.15
+#define ISO_YSHIFT_RIGHT -0.15 
+#define ISO_SCALE 0.5           /* coordinates for isospectral billiards */
+
+
+/* You can add more billiard tables by adapting the functions */
+/* xy_in_billiard and draw_billiard below */
+
+/* Physical parameters of wave equation */
+
+// #define TWOSPEEDS 0          /* set to 1 to replace hardcore boundary by medium with different speed */
+#define TWOSPEEDS 0          /* set to 1 to replace hardcore boundary by medium with different speed */
+#define OSCILLATE_LEFT 0     /* set to 1 to add oscilating boundary condition on the left */
+#define OSCILLATE_TOPBOT 0   /* set to 1 to enforce a planar wave on top and bottom boundary */
+
+#define OMEGA 0.005        /* frequency of periodic excitation */
+#define AMPLITUDE 0.8      /* amplitude of periodic excitation */ 
+#define COURANT 0.06       /* Courant number */
+#define COURANTB 0.03      /* Courant number in medium B */
+// #define COURANTB 0.016363636     /* Courant number in medium B */
+#define GAMMA 0.0          /* damping factor in wave equation */
+#define GAMMAB 1.0e-7        /* damping factor in wave equation */
+#define GAMMA_SIDES 1.0e-4      /* damping factor on boundary */
+#define GAMMA_TOPBOT 1.0e-7     /* damping factor on boundary */
+#define KAPPA 0.0           /* "elasticity" term enforcing oscillations */
+#define KAPPA_SIDES 5.0e-4  /* "elasticity" term on absorbing boundary */
+#define KAPPA_TOPBOT 0.0    /* "elasticity" term on absorbing boundary */
+/* The Courant number is given by c*DT/DX, where DT is the time step and DX the lattice spacing */
+/* The physical damping coefficient is given by GAMMA/(DT)^2 */
+/* Increasing COURANT speeds up the simulation, but decreases accuracy */
+/* For similar wave forms, COURANT^2*GAMMA should be kept constant */
+
+#define ADD_OSCILLATING_SOURCE 0        /* set to 1 to add an oscillating wave source */
+#define OSCILLATING_SOURCE_PERIOD 30    /* period of oscillating source */
+// #define OSCILLATING_SOURCE_PERIOD 14    /* period of oscillating source */
+
+/* Boundary conditions, see list in global_pdes.c  */
+
+#define B_COND 2
+// #define B_COND 2
+
+/* Parameters for length and speed of simulation */
+
+#define NSTEPS 2500        /* number of frames of movie */
+#define NVID 10           /* number of iterations between images displayed on screen */
+#define NSEG 1000         /* number of segments of boundary */
+#define INITIAL_TIME 0      /* time after which to start saving frames */
+#define BOUNDARY_WIDTH 3    /* width of billiard boundary */
+
+#define PAUSE 200       /* number of frames after which to pause */
+#define PSLEEP 2         /* sleep time during pause */
+#define SLEEP1  1        /* initial sleeping time */
+#define SLEEP2  1        /* final sleeping time */
+#define MID_FRAMES 200    /* number of still frames between parts of two-part movie */
+#define END_FRAMES 100   /* number of still frames at end of movie */
+#define FADE 1           /* set to 1 to fade at end of movie */
+
+/* Parameters of initial condition */
+
+#define INITIAL_AMP 0.5         /* amplitude of initial condition */
+#define INITIAL_VARIANCE 0.0005  /* variance of initial condition */
+#define INITIAL_WAVELENGTH  0.1  /* wavelength of initial condition */
+
+/* Plot type, see list in global_pdes.c  */
+
+#define ZPLOT 103     /* wave height */
+#define CPLOT 103     /* color scheme */
+
+#define ZPLOT_B 104        
+#define CPLOT_B 104        /* plot type for second movie */
+
+
+#define AMPLITUDE_HIGH_RES 1    /* set to 1 to increase resolution of plot */
+#define SHADE_3D 1              /* set to 1 to change luminosity according to normal vector */
+#define NON_DIRICHLET_BC 0      /* set to 1 to draw only facets in domain, if field is not zero on boundary */
+#define DRAW_BILLIARD 1         /* set to 1 to draw boundary */
+#define DRAW_BILLIARD_FRONT 1   /* set to 1 to draw front of boundary after drawing wave */
+#define FADE_IN_OBSTACLE 1      /* set to 1 to fade color inside obstacles */
+
+#define PLOT_SCALE_ENERGY 0.05      /* vertical scaling in energy plot */
+#define PLOT_SCALE_LOG_ENERGY 0.6      /* vertical scaling in log energy plot */
+
+/* 3D representation */
+
+#define REPRESENTATION_3D 1     /* choice of 3D representation */ 
+
+#define REP_AXO_3D 0        /* linear projection (axonometry) */
+#define REP_PROJ_3D 1       /* projection on plane orthogonal to observer line of sight */
+
+
+/* Color schemes */
+
+#define COLOR_PALETTE 14    /* Color palette, see list in global_pdes.c  */
+#define COLOR_PALETTE_B 11     /* Color palette, see list in global_pdes.c  */
+
+#define BLACK 1          /* background */
+
+#define COLOR_SCHEME 3   /* choice of color scheme, see list in global_pdes.c  */
+
+#define SCALE 0          /* set to 1 to adjust color scheme to variance of field */
+#define SLOPE 1.0       /* sensitivity of color on wave amplitude */
+#define VSCALE_AMPLITUDE 0.2     /* additional scaling factor for color scheme P_3D_AMPLITUDE */
+#define VSCALE_ENERGY 0.35       /* additional scaling factor for color scheme P_3D_ENERGY */
+#define PHASE_FACTOR 20.0       /* factor in computation of phase in color scheme P_3D_PHASE */
+#define PHASE_SHIFT 0.0      /* shift of phase in color scheme P_3D_PHASE */
+#define ATTENUATION 0.0  /* exponential attenuation coefficient of contrast with time */
+#define E_SCALE 200.0     /* scaling factor for energy representation */
+#define LOG_SCALE 1.0     /* scaling factor for energy log representation */
+#define LOG_SHIFT 1.0     /* shift of colors on log scale */
+#define RESCALE_COLOR_IN_CENTER 0   /* set to 1 to decrease color intentiy in the center (for wave escaping ring) */
+
+#define COLORHUE 260     /* initial hue of water color for scheme C_LUM */
+#define COLORDRIFT 0.0   /* how much the color hue drifts during the whole simulation */
+#define LUMMEAN 0.5      /* amplitude of luminosity variation for scheme C_LUM */
+#define LUMAMP 0.3       /* amplitude of luminosity variation for scheme C_LUM */
+#define HUEMEAN 240.0    /* mean value of hue for color scheme C_HUE */
+#define HUEAMP -200.0      /* amplitude of variation of hue for color scheme C_HUE */
+
+#define DRAW_COLOR_SCHEME 0     /* set to 1 to plot the color scheme */
+#define COLORBAR_RANGE 3.0     /* scale of color scheme bar */
+#define COLORBAR_RANGE_B 5.0    /* scale of color scheme bar for 2nd part */
+#define ROTATE_COLOR_SCHEME 0   /* set to 1 to draw color scheme horizontally */
+
+/* For debugging purposes only */
+#define FLOOR 0         /* set to 1 to limit wave amplitude to VMAX */
+#define VMAX 10.0       /* max value of wave amplitude */
+
+/* Parameters controlling 3D projection */
+
+double u_3d[2] = {0.75, -0.45};     /* projections of basis vectors for REP_AXO_3D representation */
+double v_3d[2] = {-0.75, -0.45};
+double w_3d[2] = {0.0, 0.015};
+double light[3] = {0.816496581, -0.40824829, 0.40824829};      /* vector of "light" direction for P_3D_ANGLE color scheme */
+double observer[3] = {10.0, 6.0, 8.5};    /* location of observer for REP_PROJ_3D representation */ 
+
+#define Z_SCALING_FACTOR 0.018     /* overall scaling factor of z axis for REP_PROJ_3D representation */
+#define XY_SCALING_FACTOR 3.75     /* overall scaling factor for on-screen (x,y) coordinates after projection */
+#define ZMAX_FACTOR 1.0           /* max value of z coordinate for REP_PROJ_3D representation */
+#define XSHIFT_3D 0.0             /* overall x shift for REP_PROJ_3D representation */
+#define YSHIFT_3D 0.0             /* overall y shift for REP_PROJ_3D representation */
+
+
+#include "global_pdes.c"        /* constants and global variables */
+#include "sub_wave.c"           /* common functions for wave_billiard, heat and schrodinger */
+#include "wave_common.c"        /* common functions for wave_billiard, wave_comparison, etc */
+
+#include "global_3d.c"          /* constants and global variables */
+#include "sub_wave_3d.c"        /* graphical functions specific to wave_3d */
+#include "sub_wave_archive.c"   /* compressed archive of wave fields */
+
+
+t_archive_reader reader;
+int process_number = 0;
+
+/*********************/
+/* animation part    */
+/*********************/
+
+void draw_color_bar_palette(int plot, double range, int palette)
+{
+    if (ROTATE_COLOR_SCHEME) draw_color_scheme_palette_3d(-1.0, -0.8, XMAX - 0.1, -1.0, plot, -range, range, palette);
+    else draw_color_scheme_palette_3d(XMAX - 0.3, YMIN + 0.1, XMAX - 0.1, YMAX - 0.1, plot, -range, range, palette);
+}
+
+void draw_frame(double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY], t_wave wave[NX*NY],
+                int zplot, int cplot, int palette, double colorbar_range, int fade, double fade_value)
+/* draw wave and color bar, as in wave_3d */
+{
+    draw_wave_3d(phi, psi, xy_in, wave, zplot, cplot, palette, fade, fade_value);
+    if (DRAW_COLOR_SCHEME) draw_color_bar_palette(cplot, colorbar_range, palette);
+    glutSwapBuffers();
+}
+
+void render_frames(int nmin, int nmax)
+/* render archived frames nmin to nmax-1, and the final still frames if nmax is the last frame */
+{
+    double *phi, *psi;
+    short int *xy_in;
+    int i, n, time = 0, nsaved, counter;
+    t_wave *wave;
+
+    xy_in = (short int *)malloc(NX*NY*sizeof(short int));
+    phi = (double *)malloc(NX*NY*sizeof(double));
+    psi = (double *)malloc(NX*NY*sizeof(double));
+    wave = (t_wave *)malloc(NX*NY*sizeof(t_wave));
+
+    /* initialise positions and radii of circles */
+    if ((B_DOMAIN == D_CIRCLES)||(B_DOMAIN == D_CIRCLES_IN_RECT)) init_circle_config(circles);
+    else if (B_DOMAIN == D_POLYGONS) init_polygon_config(polygons);
+
+    /* initialise polyline for von Koch and similar domains */
+    npolyline = init_polyline(MDEPTH, polyline);
+
+    read_wave_archive_mask_mod(&reader, xy_in);
+
+    for (n=nmin; n<nmax; n++)
+    {
+        time = read_wave_archive_frame_mod(&reader, n, phi, psi);
+
+        draw_frame(phi, psi, xy_in, wave, ZPLOT, CPLOT, COLOR_PALETTE, COLORBAR_RANGE, 0, 1.0);
+
+        if (time >= INITIAL_TIME)
+        {
+            save_frame_counter(time - INITIAL_TIME + 1);
+            if (DOUBLE_MOVIE)
+            {
+                draw_frame(phi, psi, xy_in, wave, ZPLOT_B, CPLOT_B, COLOR_PALETTE_B, COLORBAR_RANGE_B, 0, 1.0);
+                save_frame_counter(NSTEPS + MID_FRAMES + 1 + time - INITIAL_TIME);
+            }
+        }
+        else printf("Initial phase time %i of %i\n", time, INITIAL_TIME);
+    }
+
+    /* still frames at the end of the movie, numbered as in wave_3d */
+    if (nmax == reader.nframes)
+    {
+        nsaved = time - INITIAL_TIME + 1;
+        if (DOUBLE_MOVIE)
+        {
+            draw_frame(phi, psi, xy_in, wave, ZPLOT, CPLOT, COLOR_PALETTE, COLORBAR_RANGE, 0, 1.0);
+
+            if (!FADE) for (i=0; i<MID_FRAMES; i++) save_frame_counter(nsaved + 1 + i);
+            else for (i=0; i<MID_FRAMES; i++)
+            {
+                draw_frame(phi, psi, xy_in, wave, ZPLOT, CPLOT, COLOR_PALETTE, COLORBAR_RANGE, 1, 1.0 - (double)i/(double)MID_FRAMES);
+                save_frame_counter(NSTEPS + i + 1);
+            }
+            draw_frame(phi, psi, xy_in, wave, ZPLOT_B, CPLOT_B, COLOR_PALETTE_B, COLORBAR_RANGE_B, 0, 1.0);
+
+            counter = nsaved;
+            if (!FADE) for (i=0; i<END_FRAMES; i++) save_frame_counter(NSTEPS + MID_FRAMES + 1 + counter + i);
+            else for (i=0; i<END_FRAMES; i++)
+            {
+                draw_frame(phi, psi, xy_in, wave, ZPLOT_B, CPLOT_B, COLOR_PALETTE_B, COLORBAR_RANGE_B, 1, 1.0 - (double)i/(double)END_FRAMES);
+                save_frame_counter(NSTEPS + MID_FRAMES + 1 + counter + i);
+            }
+        }
+        else
+        {
+            if (!FADE) for (i=0; i<END_FRAMES; i++) save_frame_counter(NSTEPS + MID_FRAMES + 1 + i);
+            else for (i=0; i<END_FRAMES; i++)
+            {
+                draw_frame(phi, psi, xy_in, wave, ZPLOT, CPLOT, COLOR_PALETTE, COLORBAR_RANGE, 1, 1.0 - (double)i/(double)END_FRAMES);
+                save_frame_counter(NSTEPS + 1 + i);
+            }
+        }
+    }
+
+    free(xy_in);
+    free(phi);
+    free(psi);
+    free(wave);
+}
+
+
+void display(void)
+{
+    int block, nmin, nmax;
+
+    glPushMatrix();
+
+    blank();
+    glutSwapBuffers();
+    blank();
+    glutSwapBuffers();
+
+    block = (reader.nframes + RENDER_PROCESSES - 1)/RENDER_PROCESSES;
+    nmin = process_number*block;
+    nmax = nmin + block;
+    if (nmax > reader.nframes) nmax = reader.nframes;
+    if (nmin < nmax) render_frames(nmin, nmax);
+
+    glPopMatrix();
+
+    glutDestroyWindow(glutGetWindow());
+    exit(0);
+}
+
+
+int main(int argc, char** argv)
+{
+    int p, status;
+    pid_t pid = 0;
+
+    open_wave_archive_for_reading(ARCHIVE_FILE, &reader);
+
+    /* each process opens its own window */
+    for (p=0; p<RENDER_PROCESSES; p++)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            process_number = p;
+            break;
+        }
+    }
+
+    if (pid != 0)
+    {
+        for (p=0; p<RENDER_PROCESSES; p++) wait(&status);
+        close_wave_archive_for_reading(&reader);
+        if (system("mv wave*.tif tif_wave/") != 0) printf("Warning: could not move frames to tif_wave/\n");
+        return 0;
+    }
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(WINWIDTH,WINHEIGHT);
+    glutCreateWindow("Re-rendering of wave equation in a planar domain");
+
+    init_3d();
+
+    glutDisplayFunc(display);
+
+    glutMainLoop();
+
+    return 0;
+}
@@ -44,6 +44,8 @@
 
 #define MOVIE 0         /* set to 1 to generate movie */
 #define DOUBLE_MOVIE 0  /* set to 1 to produce movies for wave height and energy simultaneously */
+#define HEADLESS 0      /* set to 1 to run the simulation without window, e.g. to save an archive */
+#define TELEMETRY 1     /* set to 1 to publish the progress of the run in shared memory, read with telemetry */
 
 /* General geometrical parameters */
 
@@ -59,7 +61,8 @@
 #define YMIN -1.041666667
 #define YMAX 1.041666667	/* y interval for 9/16 aspect ratio */
 
-#define HIGHRES 1        /* set to 1 if resolution of grid is double that of displayed image */
+#define HIGHRES 1        /* set to 1 if resolution of grid differs from that of displayed image */
+#define RESAMPLING R_BILINEAR   /* interpolation from grid to window for HIGHRES, see list in global_pdes.c */
 
 // #define WINWIDTH 	1280  /* window width */
 // #define WINHEIGHT 	720   /* window height */
@@ -116,6 +119,19 @@
 
 #define TWOSPEEDS 1          /* set to 1 to replace hardcore boundary by medium with different speed */
 #define OSCILLATE_LEFT 1     /* set to 1 to add oscilating boundary condition on the left */
+#define LOCAL_TIME_STEPS 0  /* set to 1 to let the slower medium take larger time steps (needs TWOSPEEDS) */
+#define LTS_RATIO 4         /* ratio of time steps of slower and faster medium, for LOCAL_TIME_STEPS */
+#define AMR 0               /* set to 1 to use block-structured adaptive mesh refinement */
+#define AMR_RATIO 2         /* ratio of coarse and fine grid spacings, for AMR */
+#define AMR_BLOCK 40        /* size of refinement blocks, in grid cells */
+#define AMR_REGRID 5        /* number of coarse time steps between choices of refined blocks */
+#define AMR_THRESHOLD 0.05  /* blocks where gradient exceeds AMR_THRESHOLD times its max are refined */
+#define AMR_BOUNDARY 4      /* blocks closer than AMR_BOUNDARY cells to the boundary are always refined */
+#define CUT_CELLS 0         /* set to CUT_DIRICHLET or CUT_NEUMANN for embedded curved walls (needs TWOSPEEDS = 0) */
+#define HELMHOLTZ 0         /* set to HELM_START or HELM_ORBIT to compute the periodic orbit of OSCILLATE_LEFT directly */
+#define HELMHOLTZ_TOLERANCE 1.0e-8  /* relative residual of Helmholtz solver */
+#define HELMHOLTZ_MAXITER 1000      /* maximal number of iterations of Helmholtz solver */
+#define HELMHOLTZ_LAYER 0           /* width of absorbing layer along absorbing sides, in cells, for HELMHOLTZ */
 #define OSCILLATE_TOPBOT 0   /* set to 1 to enforce a planar wave on top and bottom boundary */
 
 #define OMEGA 0.005        /* frequency of periodic excitation */
@@ -206,6 +222,8 @@
 #define ROTATE_COLOR_SCHEME 0   /* set to 1 to draw color scheme horizontally */
 
 #define SAVE_TIME_SERIES 0      /* set to 1 to save wave time series at a point */
+#define SAVE_FIELD_ARCHIVE 0    /* set to 1 to save compressed fields, for re-rendering with wave_replay */
+#define ARCHIVE_FILE "wave_archive.bin"   /* file containing archived fields */
 
 /* For debugging purposes only */
 #define FLOOR 0         /* set to 1 to limit wave amplitude to VMAX */
@@ -214,6 +232,12 @@
 #include "global_pdes.c"        /* constants and global variables */
 #include "sub_wave.c"           /* common functions for wave_billiard, heat and schrodinger */
 #include "wave_common.c"        /* common functions for wave_billiard, wave_comparison, etc */
+#include "sub_wave_archive.c"   /* compressed archive of wave fields */
+#include "sub_wave_lts.c"       /* local time stepping for two media */
+#include "sub_wave_amr.c"       /* adaptive mesh refinement */
+#include "sub_wave_cut.c"       /* embedded boundary for curved walls */
+#include "sub_wave_helmholtz.c" /* time-harmonic steady state */
+#include "sub_telemetry.c"      /* live status of the run, for telemetry.c */
 
 FILE *time_series_left, *time_series_right;
 
@@ -231,7 +255,7 @@ void evolve_wave_half(double *phi_in[NX], double *psi_in[NX], double *phi_out[NX
 /* phi is value of field at time t, psi at time t-1 */
 /* this version of the function has been rewritten in order to minimize the number of if-branches */
 {
-    int i, j, iplus, iminus, jplus, jminus;
+    int i, j, k, iplus, iminus, jplus, jminus;
     double delta, x, y, c, cc, gamma;
     static long time = 0;
     static double tc[NX][NY], tcc[NX][NY], tgamma[NX][NY];
@@ -280,6 +304,24 @@ void evolve_wave_half(double *phi_in[NX], double *psi_in[NX], double *phi_out[NX
         }
     }
     
+    /* modified stencil near curved walls */
+    if (cut_active)
+    {
+        #pragma omp parallel for private(k,i,j,delta,x,y,gamma)
+        for (k=0; k<cut_ncells; k++){
+            i = cut_cells[k].i;
+            j = cut_cells[k].j;
+            x = phi_in[i][j];
+            y = psi_in[i][j];
+            if (xy_in[i][j] == 2) gamma = GAMMAB;
+            else gamma = GAMMA;
+            
+            delta = cut_laplacian(phi_in, &cut_cells[k]);
+            phi_out[i][j] = -y + 2*x + courant2*delta - KAPPA*x - gamma*(x-y);
+            psi_out[i][j] = x;
+        }
+    }
+    
     /* left boundary */
     if (OSCILLATE_LEFT) for (j=1; j<NY-1; j++) phi_out[0][j] = AMPLITUDE*cos((double)time*OMEGA)*exp(-(double)time*DAMPING);
     else for (j=1; j<NY-1; j++){
@@ -479,8 +521,13 @@ void evolve_wave(double *phi[NX], double *psi[NX], double *phi_tmp[NX], double *
 /* time step of field evolution */
 /* phi is value of field at time t, psi at time t-1 */
 {
-    evolve_wave_half(phi, psi, phi_tmp, psi_tmp, xy_in);
-    evolve_wave_half(phi_tmp, psi_tmp, phi, psi, xy_in);
+    if (amr_active) evolve_wave_amr(phi, psi, phi_tmp, psi_tmp, xy_in);
+    else if (lts_active) evolve_wave_lts(phi, psi, phi_tmp, psi_tmp, xy_in);
+    else
+    {
+        evolve_wave_half(phi, psi, phi_tmp, psi_tmp, xy_in);
+        evolve_wave_half(phi_tmp, psi_tmp, phi, psi, xy_in);
+    }
 }
 
 
@@ -497,14 +544,33 @@ void draw_color_bar_palette(int plot, double range, int palette)
     else draw_color_scheme_palette(XMAX - 0.3, YMIN + 0.1, XMAX - 0.1, YMAX - 0.1, plot, -range, range, palette);
 }
 
-void animation()
+/*********************/
+/* simulation core   */
+/*********************/
+
+/* The simulation is initialised and advanced by the functions below, which make no  */
+/* OpenGL calls, so that it can also run without window (option HEADLESS). The      */
+/* fields are observed by reading the arrays of t_wave_sim directly, without copy.  */
+
+typedef struct
 {
-    double time, scale, ratio, startleft[2], startright[2], sign, r2, xy[2]; 
-    double *phi[NX], *psi[NX], *phi_tmp[NX], *psi_tmp[NX], *total_energy[NX], *color_scale[NX];
-    short int *xy_in[NX];
-    int i, j, s, sample_left[2], sample_right[2], period = 0;
-    static int counter = 0;
-    long int wave_value;
+    double *phi[NX], *psi[NX];          /* field at times t and t-1 */
+    double *phi_tmp[NX], *psi_tmp[NX];  /* intermediate fields of time step */
+    double *total_energy[NX];           /* accumulated energy, for P_MEAN_ENERGY */
+    double *color_scale[NX];            /* color scale, for RESCALE_COLOR_IN_CENTER */
+    short int *xy_in[NX];               /* has value 1 in billiard */
+    int sample_left[2], sample_right[2];    /* sample points of time series */
+    int frame;                          /* number of frames computed */
+    int period;                         /* number of added oscillating sources */
+} t_wave_sim;
+
+void init_wave_sim(t_wave_sim *sim)
+/* allocate fields, and initialise domain and wave */
+{
+    double ratio, startleft[2], startright[2], r2, xy[2];
+    double **phi = sim->phi, **psi = sim->psi;
+    short int **xy_in = sim->xy_in;
+    int i, j;
     
     if (SAVE_TIME_SERIES)
     {
@@ -515,14 +581,20 @@ void animation()
     /* Since NX and NY are big, it seemed wiser to use some memory allocation here */
     for (i=0; i<NX; i++)
     {
-        phi[i] = (double *)malloc(NY*sizeof(double));
-        psi[i] = (double *)malloc(NY*sizeof(double));
-        phi_tmp[i] = (double *)malloc(NY*sizeof(double));
-        psi_tmp[i] = (double *)malloc(NY*sizeof(double));
-        total_energy[i] = (double *)malloc(NY*sizeof(double));
-        xy_in[i] = (short int *)malloc(NY*sizeof(short int));
-        color_scale[i] = (double *)malloc(NY*sizeof(double));
+        sim->phi[i] = (double *)malloc(NY*sizeof(double));
+        sim->psi[i] = (double *)malloc(NY*sizeof(double));
+        sim->phi_tmp[i] = (double *)malloc(NY*sizeof(double));
+        sim->psi_tmp[i] = (double *)malloc(NY*sizeof(double));
+        sim->total_energy[i] = (double *)malloc(NY*sizeof(double));
+        sim->xy_in[i] = (short int *)malloc(NY*sizeof(short int));
+        sim->color_scale[i] = (double *)malloc(NY*sizeof(double));
     }
+    sim->frame = 0;
+    sim->period = 0;
+    sim->sample_left[0] = 0;
+    sim->sample_left[1] = 0;
+    sim->sample_right[0] = 0;
+    sim->sample_right[1] = 0;
     
     /* initialise positions and radii of circles */
     if ((B_DOMAIN == D_CIRCLES)||(B_DOMAIN == D_CIRCLES_IN_RECT)) init_circle_config(circles);
@@ -544,7 +616,7 @@ void animation()
             {
                 ij_to_xy(i, j, xy);
                 r2 = xy[0]*xy[0] + xy[1]*xy[1];
-                color_scale[i][j] = 1.0 - exp(-4.0*r2/LAMBDA*LAMBDA);
+                sim->color_scale[i][j] = 1.0 - exp(-4.0*r2/LAMBDA*LAMBDA);
             }
     }
 
@@ -555,7 +627,7 @@ void animation()
     if ((PLOT == P_MEAN_ENERGY)||(PLOT_B == P_MEAN_ENERGY)||(PLOT == P_LOG_MEAN_ENERGY)||(PLOT_B == P_LOG_MEAN_ENERGY))
         for (i=0; i<NX; i++)
             for (j=0; j<NY; j++) 
-                total_energy[i][j] = 0.0;
+                sim->total_energy[i][j] = 0.0;
     
     ratio = (XMAX - XMIN)/8.4;  /* for Tokarsky billiard */
     
@@ -564,8 +636,8 @@ void animation()
 //     homophonic_initial_point(0.5, -0.25, 1.5, -0.25, startleft, startright);
 //     printf("xleft = (%.3f, %.3f) xright = (%.3f, %.3f)\n", startleft[0], startleft[1], startright[0], startright[1]);    
     
-//     xy_to_ij(startleft[0], startleft[1], sample_left);
-//     xy_to_ij(startright[0], startright[1], sample_right);
+//     xy_to_ij(startleft[0], startleft[1], sim->sample_left);
+//     xy_to_ij(startright[0], startright[1], sim->sample_right);
 //     printf("xleft = (%.3f, %.3f) xright = (%.3f, %.3f)\n", xin_left, yin_left, xin_right, yin_right);
     
     init_wave_flat(phi, psi, xy_in);
@@ -603,11 +675,161 @@ void animation()
 //     add_drop_to_wave(1.0, -0.7, 0.0, phi, psi);
 //     add_drop_to_wave(1.0, 0.0, -0.7, phi, psi);
 
+
+    if (LOCAL_TIME_STEPS) init_lts(xy_in, LTS_RATIO);
+    if ((AMR)&&(HELMHOLTZ == HELM_ORBIT)) printf("AMR is not used with HELM_ORBIT, using uniform grid\n");
+    else if ((AMR)&&(init_amr(phi, psi, xy_in))&&(SAVE_TIME_SERIES))
+    {
+        amr_refine_point(sim->sample_left);
+        amr_refine_point(sim->sample_right);
+    }
+    if ((CUT_CELLS)&&(!TWOSPEEDS)&&(!amr_active))
+    {
+        init_cut_cells(xy_in, CUT_CELLS, -1);
+        if (COURANT*COURANT*cut_wmax > 2.0) 
+            printf("Warning: COURANT should be below %.3lg for stability of embedded boundary\n", sqrt(2.0/cut_wmax));
+    }
+    else if (CUT_CELLS) printf("Embedded boundary needs TWOSPEEDS = 0 and no AMR, using staircase boundary\n");
+    if (HELMHOLTZ)
+    {
+        if (!OSCILLATE_LEFT) printf("Warning: HELMHOLTZ needs OSCILLATE_LEFT, the periodic orbit is zero\n");
+        if (DAMPING > 0.0) printf("Warning: the periodic orbit of HELMHOLTZ neglects DAMPING\n");
+        init_helmholtz(xy_in, OMEGA, HELMHOLTZ_LAYER);
+        solve_helmholtz(HELMHOLTZ_TOLERANCE, HELMHOLTZ_MAXITER);
+        helmholtz_field(0, phi, psi);
+        if (amr_active) amr_load_fields(phi, psi);
+    }
+    if (SAVE_FIELD_ARCHIVE) open_wave_archive(ARCHIVE_FILE, xy_in);
+}
+
+void step_wave_sim(t_wave_sim *sim, int nframes)
+/* advance simulation by nframes frames of NVID time steps */
+{
+    int n, j;
+    long int wave_value;
+    
+    for (n=0; n<nframes; n++)
+    {
+        if (SAVE_FIELD_ARCHIVE) write_wave_archive_frame(sim->frame, sim->phi, sim->psi);
+        if (HELMHOLTZ == HELM_ORBIT) helmholtz_field((long)(sim->frame + 1)*(long)(2*NVID), sim->phi, sim->psi);
+        else for (j=0; j<NVID; j++) 
+        {
+            evolve_wave(sim->phi, sim->psi, sim->phi_tmp, sim->psi_tmp, sim->xy_in);
+            if (SAVE_TIME_SERIES)
+            {
+                wave_value = (long int)(sim->phi[sim->sample_left[0]][sim->sample_left[1]]*1.0e16);
+                fprintf(time_series_left, "%019ld\n", wave_value);
+                wave_value = (long int)(sim->phi[sim->sample_right[0]][sim->sample_right[1]]*1.0e16);
+                fprintf(time_series_right, "%019ld\n", wave_value);
+                if ((j == 0)&&(sim->frame%10 == 0)) printf("Frame %i of %i\n", sim->frame, NSTEPS);
+//                 fprintf(time_series_right, "%.15f\n", phi[sample_right[0]][sample_right[1]]);
+            }
+//             if (i % 10 == 9) oscillate_linear_wave(0.2*scale, 0.15*(double)(i*NVID + j), -1.5, YMIN, -1.5, YMAX, phi, psi);
+        }
+        if (amr_active) amr_fill_fields(sim->phi, sim->psi, sim->xy_in);
+        
+        /* add oscillating waves */
+        if ((ADD_OSCILLATING_SOURCE)&&(sim->frame%OSCILLATING_SOURCE_PERIOD == OSCILLATING_SOURCE_PERIOD - 1))
+        {
+//               add_circular_wave(1.0, -1.5*LAMBDA, 0.0, phi, psi, xy_in);
+            add_circular_wave(-1.0, 0.6*cos((double)(sim->period)*DPI/3.0), 0.6*sin((double)(sim->period)*DPI/3.0), sim->phi, sim->psi, sim->xy_in);
+            sim->period++;    
+            if (amr_active) amr_load_fields(sim->phi, sim->psi);
+        }
+        sim->frame++;
+    }
+}
+
+void publish_wave_telemetry(t_wave_sim *sim, double scale)
+/* end of frame for telemetry - a frame has NVID time steps, made of two half steps */
+{
+    long steps;
+    double variance, energy;
+    
+    if (!telemetry_enabled()) return;
+    compute_wave_observables(sim->phi, sim->psi, sim->xy_in, &variance, &energy);
+    telemetry_value(0, "variance", variance);
+    telemetry_value(1, "energy", energy);
+    if (SCALE) telemetry_value(2, "scale", scale);
+    steps = (long)sim->frame*(long)(2*NVID);
+    telemetry_frame(sim->frame, steps, (double)steps*COURANT*(XMAX - XMIN)/(double)NX);
+}
+
+void free_wave_sim(t_wave_sim *sim)
+/* free fields, and close output files */
+{
+    int i;
+    
+    if (SAVE_FIELD_ARCHIVE) close_wave_archive();
+    if (LOCAL_TIME_STEPS) free_lts();
+    if (AMR) free_amr();
+    if (CUT_CELLS) free_cut_cells();
+    if (HELMHOLTZ) free_helmholtz();
+    
+    for (i=0; i<NX; i++)
+    {
+        free(sim->phi[i]);
+        free(sim->psi[i]);
+        free(sim->phi_tmp[i]);
+        free(sim->psi_tmp[i]);
+        free(sim->total_energy[i]);
+        free(sim->xy_in[i]);
+        free(sim->color_scale[i]);
+    }
+    
+    if (SAVE_TIME_SERIES)
+    {
+        fclose(time_series_left);
+        fclose(time_series_right);
+    }
+}
+
+void headless_run()
+/* run the simulation without window, e.g. to save an archive for wave_replay */
+{
+    t_wave_sim sim;
+    
+    if ((!SAVE_FIELD_ARCHIVE)&&(!SAVE_TIME_SERIES)) printf("Warning: HEADLESS run saves neither archive nor time series\n");
+    
+    init_wave_sim(&sim);
+    if (TELEMETRY) telemetry_open("wave_billiard", INITIAL_TIME + NSTEPS + 1);
+    while (sim.frame <= INITIAL_TIME + NSTEPS)
+    {
+        telemetry_phase(TM_COMPUTE);
+        step_wave_sim(&sim, 1);
+        publish_wave_telemetry(&sim, 1.0);
+        if (sim.frame%10 == 0) printf("Computed frame %i of %i\n", sim.frame, INITIAL_TIME + NSTEPS);
+    }
+    telemetry_close();
+    free_wave_sim(&sim);
+}
+
+
+/*********************/
+/* window front-end  */
+/*********************/
+
+void animation()
+{
+    double scale; 
+    int i, s, nviews;
+    int view_plot[2] = {PLOT, PLOT_B}, view_palette[2] = {COLOR_PALETTE, COLOR_PALETTE_B};
+    float *view_rgb[2];
+    static int counter = 0;
+    t_wave_sim sim;
+    
+    init_wave_sim(&sim);
+    
+    /* colours of the plots, computed in one sweep for both movies of DOUBLE_MOVIE */
+    view_rgb[0] = allocate_wave_view();
+    if (DOUBLE_MOVIE) view_rgb[1] = allocate_wave_view();
+    
     blank();
     glColor3f(0.0, 0.0, 0.0);
 //     draw_wave(phi, psi, xy_in, 1.0, 0, PLOT);
-    if (HIGHRES) draw_wave_highres_palette(2, phi, psi, total_energy, xy_in, 1.0, 0, PLOT, COLOR_PALETTE);
-    else draw_wave_epalette(phi, psi, total_energy, color_scale, xy_in, 1.0, 0, PLOT, COLOR_PALETTE);
+    compute_wave_views(sim.phi, sim.psi, sim.total_energy, sim.color_scale, sim.xy_in, 1.0, 0, 1, view_plot, view_palette, view_rgb);
+    if (HIGHRES) draw_wave_view_resampled(view_rgb[0], sim.xy_in, RESAMPLING);
+    else draw_wave_view(view_rgb[0], sim.xy_in);
 
     draw_billiard();
     
@@ -619,61 +841,48 @@ void animation()
 
 
     sleep(SLEEP1);
+    if (TELEMETRY) telemetry_open("wave_billiard", INITIAL_TIME + NSTEPS + 1);
 
     for (i=0; i<=INITIAL_TIME + NSTEPS; i++)
     {
 	//printf("%d\n",i);
+        telemetry_phase(TM_DRAW);
         /* compute the variance of the field to adjust color scheme */
         /* the color depends on the field divided by sqrt(1 + variance) */
         if (SCALE)
         {
-            scale = sqrt(1.0 + compute_variance(phi,psi, xy_in));
+            scale = sqrt(1.0 + compute_variance(sim.phi, sim.psi, sim.xy_in));
 //             printf("Scaling factor: %5lg\n", scale);
         }
         else scale = 1.0;
 
 //         draw_wave(phi, psi, xy_in, scale, i, PLOT);
-        if (HIGHRES) draw_wave_highres_palette(2, phi, psi, total_energy, xy_in, scale, i, PLOT, COLOR_PALETTE);
-        else draw_wave_epalette(phi, psi, total_energy, color_scale, xy_in, scale, i, PLOT, COLOR_PALETTE);
-        for (j=0; j<NVID; j++) 
-        {
-            evolve_wave(phi, psi, phi_tmp, psi_tmp, xy_in);
-            if (SAVE_TIME_SERIES)
-            {
-                wave_value = (long int)(phi[sample_left[0]][sample_left[1]]*1.0e16);
-                fprintf(time_series_left, "%019ld\n", wave_value);
-                wave_value = (long int)(phi[sample_right[0]][sample_right[1]]*1.0e16);
-                fprintf(time_series_right, "%019ld\n", wave_value);
-                if ((j == 0)&&(i%10 == 0)) printf("Frame %i of %i\n", i, NSTEPS);
-//                 fprintf(time_series_right, "%.15f\n", phi[sample_right[0]][sample_right[1]]);
-            }
-//             if (i % 10 == 9) oscillate_linear_wave(0.2*scale, 0.15*(double)(i*NVID + j), -1.5, YMIN, -1.5, YMAX, phi, psi);
-        }
+        nviews = 1 + ((MOVIE)&&(DOUBLE_MOVIE)&&(i >= INITIAL_TIME));
+        compute_wave_views(sim.phi, sim.psi, sim.total_energy, sim.color_scale, sim.xy_in, scale, i, nviews, view_plot, view_palette, view_rgb);
+        if (HIGHRES) draw_wave_view_resampled(view_rgb[0], sim.xy_in, RESAMPLING);
+        else draw_wave_view(view_rgb[0], sim.xy_in);
+        
+        telemetry_phase(TM_COMPUTE);
+        step_wave_sim(&sim, 1);
+        telemetry_phase(TM_DRAW);
         
         draw_billiard();
         
         if (DRAW_COLOR_SCHEME) draw_color_bar_palette(PLOT, COLORBAR_RANGE, COLOR_PALETTE); 
         
-        /* add oscillating waves */
-        if ((ADD_OSCILLATING_SOURCE)&&(i%OSCILLATING_SOURCE_PERIOD == OSCILLATING_SOURCE_PERIOD - 1))
-        {
-//               add_circular_wave(1.0, -1.5*LAMBDA, 0.0, phi, psi, xy_in);
-            add_circular_wave(-1.0, 0.6*cos((double)(period)*DPI/3.0), 0.6*sin((double)(period)*DPI/3.0), phi, psi, xy_in);
-            period++;    
-        }
-
 	glutSwapBuffers();
 
 	if (MOVIE)
         {
+            telemetry_phase(TM_SAVE);
             if (i >= INITIAL_TIME) save_frame();
             else printf("Initial phase time %i of %i\n", i, INITIAL_TIME);
             
             if ((i >= INITIAL_TIME)&&(DOUBLE_MOVIE))
             {
 //                 draw_wave(phi, psi, xy_in, scale, i, PLOT_B);
-                if (HIGHRES) draw_wave_highres_palette(2, phi, psi, total_energy, xy_in, scale, i, PLOT_B, COLOR_PALETTE_B);
-                else draw_wave_epalette(phi, psi, total_energy, color_scale, xy_in, scale, i, PLOT_B, COLOR_PALETTE_B);
+                if (HIGHRES) draw_wave_view_resampled(view_rgb[1], sim.xy_in, RESAMPLING);
+                else draw_wave_view(view_rgb[1], sim.xy_in);
                 draw_billiard();
                 if (DRAW_COLOR_SCHEME) draw_color_bar_palette(PLOT_B, COLORBAR_RANGE_B, COLOR_PALETTE_B);  
                 glutSwapBuffers();
@@ -691,16 +900,18 @@ void animation()
                 s = system("mv wave*.tif tif_wave/");
             }
         }
-
+        publish_wave_telemetry(&sim, scale);
     }
+    telemetry_close();
 
     if (MOVIE) 
     {
         if (DOUBLE_MOVIE) 
         {
 //             draw_wave(phi, psi, xy_in, scale, i, PLOT);
-            if (HIGHRES) draw_wave_highres_palette(2, phi, psi, total_energy, xy_in, scale, NSTEPS, PLOT, COLOR_PALETTE);
-            else draw_wave_epalette(phi, psi, total_energy, color_scale, xy_in, scale, NSTEPS, PLOT, COLOR_PALETTE);
+            compute_wave_views(sim.phi, sim.psi, sim.total_energy, sim.color_scale, sim.xy_in, scale, NSTEPS, 2, view_plot, view_palette, view_rgb);
+            if (HIGHRES) draw_wave_view_resampled(view_rgb[0], sim.xy_in, RESAMPLING);
+            else draw_wave_view(view_rgb[0], sim.xy_in);
             draw_billiard();
             if (DRAW_COLOR_SCHEME) draw_color_bar_palette(PLOT, COLORBAR_RANGE, COLOR_PALETTE);   
             glutSwapBuffers();
@@ -709,8 +920,8 @@ void animation()
         if (DOUBLE_MOVIE) 
         {
 //             draw_wave(phi, psi, xy_in, scale, i, PLOT_B);
-            if (HIGHRES) draw_wave_highres_palette(2, phi, psi, total_energy, xy_in, scale, NSTEPS, PLOT_B, COLOR_PALETTE_B);
-            else draw_wave_epalette(phi, psi, total_energy, color_scale, xy_in, scale, NSTEPS, PLOT_B, COLOR_PALETTE_B);
+            if (HIGHRES) draw_wave_view_resampled(view_rgb[1], sim.xy_in, RESAMPLING);
+            else draw_wave_view(view_rgb[1], sim.xy_in);
             draw_billiard();
             if (DRAW_COLOR_SCHEME) draw_color_bar_palette(PLOT_B, COLORBAR_RANGE_B, COLOR_PALETTE_B); 
             glutSwapBuffers();
@@ -719,22 +930,10 @@ void animation()
         
         s = system("mv wave*.tif tif_wave/");
     }
-    for (i=0; i<NX; i++)
-    {
-        free(phi[i]);
-        free(psi[i]);
-        free(phi_tmp[i]);
-        free(psi_tmp[i]);
-        free(total_energy[i]);
-        free(xy_in[i]);
-        free(color_scale[i]);
-    }
     
-    if (SAVE_TIME_SERIES)
-    {
-        fclose(time_series_left);
-        fclose(time_series_right);
-    }
+    free_wave_sim(&sim);
+    free(view_rgb[0]);
+    if (DOUBLE_MOVIE) free(view_rgb[1]);
 
 
 }
@@ -761,6 +960,12 @@ void display(void)
 
 int main(int argc, char** argv)
 {
+    if (HEADLESS)
+    {
+        headless_run();
+        return 0;
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
     glutInitWindowSize(WINWIDTH,WINHEIGHT);
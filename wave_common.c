@@ -8,6 +8,8 @@ void init_xyin(short int * xy_in[NX])
     int i, j;
     double xy[2];
 
+    if (init_fractal_xyin(xy_in, 0, NX)) return;
+
     for (i=0; i<NX; i++)
         for (j=0; j<NY; j++)
         {
@@ -24,6 +26,8 @@ void init_xyin_xrange(short int * xy_in[NX], int imin, int imax)
     int i, j;
     double xy[2];
 
+    if (init_fractal_xyin(xy_in, imin, imax)) return;
+
     for (i=imin; i<imax; i++)
         for (j=0; j<NY; j++)
         {
@@ -33,18 +37,361 @@ void init_xyin_xrange(short int * xy_in[NX], int imin, int imax)
 }
 
 
+/* cache of table xy_in - if the environment variable WAVE_MASK_CACHE contains the name */
+/* of a directory (as set by the parameter sweep runner sweep.c), the table is read from */
+/* a file of this directory identified by a hash of the geometry, or computed and saved */
+/* there, so that runs with the same domain only compute it once                        */
+
+unsigned long mask_geometry_key()
+/* hash of the parameters and scatterers defining the domain - this has to include */
+/* every constant and global variable read by xy_in_billiard()                      */
+{
+    unsigned long key = LAYER_HASH_SEED;
+    int iparams[9] = {B_DOMAIN, NX, NY, NPOLY, MDEPTH, MRATIO, NGRIDX, NGRIDY, MANDELLEVEL};
+    double dparams[11] = {XMIN, XMAX, YMIN, YMAX, LAMBDA, MU, APOLY, MANDELLIMIT, JULIA_SCALE, julia_x, julia_y};
+
+    key = layer_hash(key, iparams, sizeof(iparams));
+    key = layer_hash(key, dparams, sizeof(dparams));
+    key = layer_hash(key, &ncircles, sizeof(int));
+    key = layer_hash(key, circles, ncircles*sizeof(t_circle));
+    key = layer_hash(key, polygons, ncircles*sizeof(t_polygon));
+    key = layer_hash(key, &npolyline, sizeof(int));
+    key = layer_hash(key, polyline, npolyline*sizeof(t_vertex));
+    return(key);
+}
+
+int read_mask_cache(char *filename, short int *column[NX])
+/* read table xy_in from cache file, returns 1 if successful */
+{
+    int i, size[2], ok;
+    FILE *file;
+
+    file = fopen(filename, "rb");
+    if (file == NULL) return(0);
+    ok = ((fread(size, sizeof(int), 2, file) == 2)&&(size[0] == NX)&&(size[1] == NY));
+    for (i=0; (ok)&&(i<NX); i++) ok = (fread(column[i], sizeof(short int), NY, file) == NY);
+    fclose(file);
+    return(ok);
+}
+
+void write_mask_cache(char *filename, short int *column[NX])
+/* write table xy_in to cache file - the file is renamed once complete, */
+/* so that concurrent runs never read a partial file */
+{
+    int i, size[2] = {NX, NY};
+    char tmpname[1100];
+    FILE *file;
+
+    snprintf(tmpname, sizeof(tmpname), "%s.%i", filename, (int)getpid());
+    file = fopen(tmpname, "wb");
+    if (file == NULL) return;
+    fwrite(size, sizeof(int), 2, file);
+    for (i=0; i<NX; i++) fwrite(column[i], sizeof(short int), NY, file);
+    fclose(file);
+    rename(tmpname, filename);
+}
+
+void init_xyin_cached(short int *column[NX])
+/* initialise table xy_in, using cache directory WAVE_MASK_CACHE if it is set */
+{
+    int i, j;
+    double xy[2];
+    char *dir, filename[1024];
+
+    dir = getenv("WAVE_MASK_CACHE");
+    if (dir != NULL)
+    {
+        snprintf(filename, sizeof(filename), "%s/mask_%016lx.bin", dir, mask_geometry_key());
+        if (read_mask_cache(filename, column))
+        {
+            printf("Table xy_in read from %s\n", filename);
+            return;
+        }
+    }
+
+    if (!init_fractal_xyin(column, 0, NX))
+    {
+        #pragma omp parallel for private(i,j,xy)
+        for (i=0; i<NX; i++)
+            for (j=0; j<NY; j++)
+            {
+                ij_to_xy(i, j, xy);
+                column[i][j] = xy_in_billiard(xy[0],xy[1]);
+            }
+    }
+
+    if (dir != NULL) write_mask_cache(filename, column);
+}
+
+void init_xyin_cached_mod(short int xy_in[NX*NY])
+/* version of init_xyin_cached for tables of size NX*NY */
+{
+    int i;
+    short int *column[NX];
+
+    for (i=0; i<NX; i++) column[i] = &xy_in[i*NY];
+    init_xyin_cached(column);
+}
+
+
+/* neighbours and coefficients of cells of grids of size nx*ny (the simulation grid, or */
+/* the coarser grids of sub_wave_amr.c), with the boundary conditions of evolve_wave_half */
+
+int grid_absorbing(int i, int j, int nx, int ny)
+/* return inner neighbour of cell (i,j), as i*ny+j, if it is on an absorbing boundary, -1 otherwise */
+{
+    /* as in evolve_wave_half(), corners are on the top and bottom for BC_ABSORBING, */
+    /* and the right corners are reflecting for BC_VPER_HABS                         */
+    if (B_COND == BC_ABSORBING)
+    {
+        if (j == 0) return(i*ny + 1);
+        if (j == ny-1) return(i*ny + ny-2);
+    }
+    if ((B_COND == BC_ABSORBING)||(B_COND == BC_VPER_HABS))
+    {
+        if (i == 0) return(ny + j);
+        if ((i == nx-1)&&(j > 0)&&(j < ny-1)) return((nx-2)*ny + j);
+    }
+    return(-1);
+}
+
+void grid_neighbours(int i, int j, int nx, int ny, int nb[4])
+/* neighbours of cell (i,j), as i*ny+j - missing neighbours are replaced by (i,j), */
+/* which gives the discretized Laplacian with reflecting boundary of evolve_wave_half() */
+{
+    int iplus, iminus, jplus, jminus;
+
+    iplus = i+1;    iminus = i-1;
+    jplus = j+1;    jminus = j-1;
+    if (B_COND == BC_PERIODIC)
+    {
+        if (iplus == nx) iplus = 0;
+        if (iminus == -1) iminus = nx-1;
+    }
+    else
+    {
+        if (iplus == nx) iplus = nx-1;
+        if (iminus == -1) iminus = 0;
+    }
+    if ((B_COND == BC_PERIODIC)||(B_COND == BC_VPER_HABS))
+    {
+        if (jplus == ny) jplus = 0;
+        if (jminus == -1) jminus = ny-1;
+    }
+    else
+    {
+        if (jplus == ny) jplus = ny-1;
+        if (jminus == -1) jminus = 0;
+    }
+    nb[0] = iplus*ny + j;
+    nb[1] = iminus*ny + j;
+    nb[2] = i*ny + jplus;
+    nb[3] = i*ny + jminus;
+}
+
+void wave_coefficients(short int xy, double *tc, double *tcc, double *tgamma)
+/* Courant number, its square and damping of cell with given value of xy_in, as in evolve_wave_half() */
+{
+    if (xy != 0)
+    {
+        *tc = COURANT;
+        if (xy == 1) *tgamma = GAMMA;
+        else *tgamma = GAMMAB;
+    }
+    else
+    {
+        *tc = COURANTB;
+        *tgamma = GAMMAB;
+    }
+    *tcc = (*tc)*(*tc);
+}
+
+
+/* wave sources - the Gaussian envelope of a source is negligible beyond its radius, */
+/* so that only the columns and rows within this radius are updated */
+
+void set_source_profile(t_source *source, double amplitude, double variance, double wavelength)
+/* set profile of source and its support radius */
+{
+    source->amplitude = amplitude;
+    source->variance = variance;
+    source->wavelength = wavelength;
+    source->radius = sqrt(SOURCE_SUPPORT*variance);
+}
+
+void set_point_source(t_source *source, double factor, double x, double y)
+/* circular wave centered at (x,y), with standard profile multiplied by factor */
+{
+    source->type = S_POINT;
+    source->x1 = x;
+    source->y1 = y;
+    set_source_profile(source, INITIAL_AMP*factor, INITIAL_VARIANCE, INITIAL_WAVELENGTH);
+}
+
+void set_line_source(t_source *source, double factor, double x1, double y1, double x2, double y2)
+/* wave emitted by segment from (x1,y1) to (x2,y2) */
+{
+    source->type = S_LINE;
+    source->x1 = x1;
+    source->y1 = y1;
+    source->x2 = x2;
+    source->y2 = y2;
+    set_source_profile(source, INITIAL_AMP*factor, INITIAL_VARIANCE, INITIAL_WAVELENGTH);
+}
+
+void set_planar_source(t_source *source, double factor, double x1, double y1, double x2, double y2)
+/* planar wave emitted by line through (x1,y1) and (x2,y2) */
+{
+    source->type = S_PLANAR;
+    source->x1 = x1;
+    source->y1 = y1;
+    source->x2 = x2;
+    source->y2 = y2;
+    set_source_profile(source, INITIAL_AMP*factor, INITIAL_VARIANCE, INITIAL_WAVELENGTH);
+}
+
+double source_distance2(t_source *source, double x, double y)
+/* squared distance from (x,y) to source */
+{
+    double dx, dy, lx, ly, t;
+
+    dx = x - source->x1;
+    dy = y - source->y1;
+    if (source->type == S_POINT) return(dx*dx + dy*dy);
+
+    lx = source->x2 - source->x1;
+    ly = source->y2 - source->y1;
+    t = (dx*lx + dy*ly)/(lx*lx + ly*ly);
+    if (source->type == S_LINE)
+    {
+        if (t < 0.0) t = 0.0;
+        else if (t > 1.0) t = 1.0;
+    }
+    dx -= t*lx;
+    dy -= t*ly;
+    return(dx*dx + dy*dy);
+}
+
+int source_rows(t_source *source, double x, int jrange[2])
+/* range of rows of column at abscissa x within support of source, returns 0 if empty */
+{
+    double xmin, xmax, ymin, ymax, h, nx, ny, len, y0;
+
+    switch (source->type) {
+        case (S_POINT):
+        {
+            if (vabs(x - source->x1) >= source->radius) return(0);
+            h = sqrt(source->radius*source->radius - (x - source->x1)*(x - source->x1));
+            ymin = source->y1 - h;
+            ymax = source->y1 + h;
+            break;
+        }
+        case (S_LINE):
+        {
+            if (source->x1 < source->x2) {xmin = source->x1; xmax = source->x2;}
+            else {xmin = source->x2; xmax = source->x1;}
+            if ((x <= xmin - source->radius)||(x >= xmax + source->radius)) return(0);
+            if (source->y1 < source->y2) {ymin = source->y1; ymax = source->y2;}
+            else {ymin = source->y2; ymax = source->y1;}
+            ymin -= source->radius;
+            ymax += source->radius;
+            break;
+        }
+        case (S_PLANAR):
+        {
+            /* unit normal to the line */
+            len = module2(source->x2 - source->x1, source->y2 - source->y1);
+            nx = -(source->y2 - source->y1)/len;
+            ny = (source->x2 - source->x1)/len;
+            if (vabs(ny) < 1.0e-10)
+            {
+                if (vabs(x - source->x1) >= source->radius) return(0);
+                ymin = YMIN;
+                ymax = YMAX;
+            }
+            else
+            {
+                y0 = source->y1 - nx*(x - source->x1)/ny;
+                h = source->radius/vabs(ny);
+                ymin = y0 - h;
+                ymax = y0 + h;
+            }
+            break;
+        }
+        default: return(0);
+    }
+
+    jrange[0] = (int)((double)NY*(ymin - YMIN)/(YMAX - YMIN));
+    jrange[1] = (int)((double)NY*(ymax - YMIN)/(YMAX - YMIN)) + 1;
+    if (jrange[0] < 0) jrange[0] = 0;
+    if (jrange[1] > NY) jrange[1] = NY;
+    return(jrange[0] < jrange[1]);
+}
+
+void stamp_sources_column(int i, int nsources, t_source sources[], double *phi_column, short int *xy_in_column)
+/* add waves of sources to column i of field, xy_in_column may be NULL to add them everywhere */
+{
+    int s, j, jrange[2];
+    double x, y, dist2, r2;
+
+    x = XMIN + ((double)i)*(XMAX-XMIN)/((double)NX);
+    for (s=0; s<nsources; s++) if (source_rows(&sources[s], x, jrange))
+    {
+        r2 = sources[s].radius*sources[s].radius;
+        for (j=jrange[0]; j<jrange[1]; j++)
+            if ((xy_in_column == NULL)||(xy_in_column[j])||(TWOSPEEDS))
+            {
+                y = YMIN + ((double)j)*(YMAX-YMIN)/((double)NY);
+                dist2 = source_distance2(&sources[s], x, y);
+                if (dist2 < r2)
+                    phi_column[j] += sources[s].amplitude*exp(-dist2/sources[s].variance)*cos(-sqrt(dist2)/sources[s].wavelength);
+            }
+    }
+}
+
+void add_sources(int nsources, t_source sources[], double *phi[NX], short int * xy_in[NX])
+/* add waves of several sources to the field */
+{
+    int i;
+
+    #pragma omp parallel for private(i)
+    for (i=0; i<NX; i++)
+    {
+        if (xy_in == NULL) stamp_sources_column(i, nsources, sources, phi[i], NULL);
+        else stamp_sources_column(i, nsources, sources, phi[i], xy_in[i]);
+    }
+}
+
+void reset_wave(double *phi[NX], double *psi[NX], short int * xy_in[NX])
+/* set field to zero and initialise table xy_in */
+{
+    int i, j;
+
+    init_xyin_cached(xy_in);
+
+    #pragma omp parallel for private(i,j)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+        {
+            phi[i][j] = 0.0;
+            psi[i][j] = 0.0;
+        }
+}
+
+
 void init_wave(double x, double y, double *phi[NX], double *psi[NX], short int * xy_in[NX])
 /* initialise field with drop at (x,y) - phi is wave height, psi is phi at time t-1 */
 {
     int i, j;
     double xy[2], dist2;
 
+    init_xyin(xy_in);
+
     for (i=0; i<NX; i++)
         for (j=0; j<NY; j++)
         {
             ij_to_xy(i, j, xy);
             dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
             
 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.2*exp(-dist2/0.005)*cos(-sqrt(dist2)/0.1);
 // 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.2*exp(-dist2/0.001)*cos(-sqrt(dist2)/0.01);
@@ -57,25 +404,12 @@ void init_wave(double x, double y, double *phi[NX], double *psi[NX], short int *
 void init_circular_wave(double x, double y, double *phi[NX], double *psi[NX], short int * xy_in[NX])
 /* initialise field with drop at (x,y) - phi is wave height, psi is phi at time t-1 */
 {
-    int i, j;
-    double xy[2], dist2;
+    t_source source;
 
     printf("Initializing wave\n"); 
-    for (i=0; i<NX; i++)
-    {
-        if (i%100 == 0) printf("Initializing column %i of %i\n", i, NX);
-        for (j=0; j<NY; j++)
-        {
-            ij_to_xy(i, j, xy);
-            dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
-            
-	    if ((xy_in[i][j])||(TWOSPEEDS)) 
-                phi[i][j] = INITIAL_AMP*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
-            else phi[i][j] = 0.0;
-            psi[i][j] = 0.0;
-        }
-    }
+    reset_wave(phi, psi, xy_in);
+    set_point_source(&source, 1.0, x, y);
+    add_sources(1, &source, phi, xy_in);
 }
 
 void init_wave_plus(double x, double y, double *phi[NX], double *psi[NX], short int * xy_in[NX])
@@ -84,12 +418,13 @@ void init_wave_plus(double x, double y, double *phi[NX], double *psi[NX], short
     int i, j;
     double xy[2], dist2;
 
+    init_xyin(xy_in);
+
     for (i=0; i<NX; i++)
         for (j=0; j<NY; j++)
         {
             ij_to_xy(i, j, xy);
             dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
             
 	    if ((xy[1] > 0.0)&&((xy_in[i][j])||(TWOSPEEDS))) 
                 phi[i][j] = INITIAL_AMP*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
@@ -105,13 +440,14 @@ void init_circular_wave_xplusminus(double xleft, double yleft, double xright, do
     int i, j;
     double xy[2], dist2;
 
+    init_xyin(xy_in);
+
     for (i=0; i<NX; i++)
         for (j=0; j<NY; j++)
         {
             ij_to_xy(i, j, xy);
             if (xy[0] < 0.0) dist2 = (xy[0]-xleft)*(xy[0]-xleft) + (xy[1]-yleft)*(xy[1]-yleft);
             else dist2 = (xy[0]-xright)*(xy[0]-xright) + (xy[1]-yright)*(xy[1]-yright);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
             
 	    if ((xy_in[i][j])||(TWOSPEEDS)) 
                 phi[i][j] = INITIAL_AMP*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
@@ -122,32 +458,13 @@ void init_circular_wave_xplusminus(double xleft, double yleft, double xright, do
 
 void init_planar_wave(double x, double y, double *phi[NX], double *psi[NX], short int * xy_in[NX])
 /* initialise field with drop at (x,y) - phi is wave height, psi is phi at time t-1 */
-/* beta version, works for vertical planar wave only so far */
+/* vertical planar wave, use set_planar_source for other directions */
 {
-    int i, j;
-    double xy[2], dist2;
+    t_source source;
 
-    for (i=0; i<NX; i++)
-    {
-//         if (i%100 == 0) printf("Initializing column %i\n", i);
-        for (j=0; j<NY; j++)
-        {
-            ij_to_xy(i, j, xy);
-            dist2 = (xy[0]-x)*(xy[0]-x);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
-            
-            if ((xy_in[i][j])||(TWOSPEEDS)) 
-                phi[i][j] = INITIAL_AMP*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
-// 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.01*exp(-dist2/0.0005)*cos(-sqrt(dist2)/0.01);
-// 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.01*exp(-dist2/0.0005)*cos(-sqrt(dist2)/0.02);
-// 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.01*exp(-dist2/0.005)*cos(-sqrt(dist2)/0.02);
-// 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.01*exp(-dist2/0.01)*cos(-sqrt(dist2)/0.02);
-// 	    if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.01*exp(-dist2/0.0005)*cos(-sqrt(dist2)/0.01);
-//             if ((xy_in[i][j])||(TWOSPEEDS)) phi[i][j] = 0.01*exp(-dist2/0.05)*cos(-sqrt(dist2)/0.025);
-            else phi[i][j] = 0.0;
-            psi[i][j] = 0.0;
-        }
-    }
+    reset_wave(phi, psi, xy_in);
+    set_planar_source(&source, 1.0, x, y, x, y + 1.0);
+    add_sources(1, &source, phi, xy_in);
 }
 
 
@@ -155,14 +472,13 @@ void init_wave_flat( double *phi[NX], double *psi[NX], short int * xy_in[NX])
 /* initialise flat field - phi is wave height, psi is phi at time t-1 */
 {
     int i, j;
-    double xy[2], dist2;
+
+    printf("Initialising wave and table xy_in\n");
+    init_xyin_cached(xy_in);
 
     for (i=0; i<NX; i++) {
-        if (i%100 == 0) printf("Wave and table xy_in - Initialising column %i of %i\n", i, NX);
         for (j=0; j<NY; j++)
         {
-            ij_to_xy(i, j, xy);
-	    xy_in[i][j] = xy_in_billiard(xy[0],xy[1]);
 //             if ((i%10 == 0)&&(j == NY/2)) printf ("xy_in[%i][%i] = %i\n", i, j, xy_in[i][j]);
 	    phi[i][j] = 0.0;
             psi[i][j] = 0.0;
@@ -174,32 +490,20 @@ void init_wave_flat( double *phi[NX], double *psi[NX], short int * xy_in[NX])
 void add_drop_to_wave(double factor, double x, double y, double *phi[NX], double *psi[NX])
 /* OLD VERSION - add drop at (x,y) to the field with given prefactor */
 {
-    int i, j;
-    double xy[2], dist2;
+    t_source source;
 
-    for (i=0; i<NX; i++)
-        for (j=0; j<NY; j++)
-        {
-            ij_to_xy(i, j, xy);
-            dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-            phi[i][j] += 0.2*factor*exp(-dist2/0.001)*cos(-sqrt(dist2)/0.01);
-        }
+    set_point_source(&source, factor, x, y);
+    set_source_profile(&source, 0.2*factor, 0.001, 0.01);
+    add_sources(1, &source, phi, NULL);
 }
 
 void add_circular_wave(double factor, double x, double y, double *phi[NX], double *psi[NX], short int * xy_in[NX])
 /* add drop at (x,y) to the field with given prefactor */
 {
-    int i, j;
-    double xy[2], dist2;
+    t_source source;
 
-    for (i=0; i<NX; i++)
-        for (j=0; j<NY; j++)
-        {
-            ij_to_xy(i, j, xy);
-            dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-            if ((xy_in[i][j])||(TWOSPEEDS)) 
-                phi[i][j] += INITIAL_AMP*factor*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
-        }
+    set_point_source(&source, factor, x, y);
+    add_sources(1, &source, phi, xy_in);
 }
 
 
@@ -292,6 +596,28 @@ double compute_variance(double *phi[NX], double *psi[NX], short int *xy_in[NX])
     return(variance/(double)n);
 }
 
+void compute_wave_observables(double *phi[NX], double *psi[NX], short int *xy_in[NX], double *variance, double *energy)
+/* variance of the field, as in compute_variance(), and mean energy density in the billiard, */
+/* in one parallel sweep - published by the telemetry of runs                                */
+{
+    int i, j;
+    long n = 0;
+    double var = 0.0, en = 0.0;
+
+    #pragma omp parallel for private(i,j) reduction(+:n,var,en)
+    for (i=1; i<NX; i++)
+        for (j=1; j<NY; j++)
+            if (xy_in[i][j])
+            {
+                n++;
+                var += phi[i][j]*phi[i][j];
+                en += compute_energy(phi, psi, xy_in, i, j);
+            }
+    if (n==0) n=1;
+    *variance = var/(double)n;
+    *energy = en/(double)n;
+}
+
 
 double compute_dissipation(double *phi[NX], double *psi[NX], short int *xy_in[NX], double x, double y)
 {
@@ -847,49 +1173,363 @@ void draw_wave_highres_palette(int size, double *phi[NX], double *psi[NX], doubl
     glEnd ();
 }
 
-/* modified function for "flattened" wave tables */
+/* multi-view rendering: the colours of several plots (PLOT and PLOT_B for DOUBLE_MOVIE) */
+/* are computed in one parallel sweep, sharing the computation of the energy, and each    */
+/* view is then drawn from its table of colours                                           */
 
-void init_circular_wave_mod(double x, double y, double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY])
-/* initialise field with drop at (x,y) - phi is wave height, psi is phi at time t-1 */
+float *allocate_wave_view()
+/* table of colours of one view, 3 floats per cell */
+{
+    return((float *)malloc(3*NX*NY*sizeof(float)));
+}
+
+void compute_wave_views(double *phi[NX], double *psi[NX], double *total_energy[NX], double *color_scale[NX], short int *xy_in[NX], 
+                        double scale, int time, int nviews, int plot[], int palette[], float *view[])
+/* compute colours of nviews plots of the field, with given palettes */
+/* with palette COL_HSLUV, the colours of a column are converted together by hsl_to_rgb_batch */
+{
+    int i, j, k, v, asym, energy_needed = 0, mean_needed = 0, log_mean = 0, hsluv_needed = 0;
+    double rgb[3], value, energy, mean_energy, *hsl, *hsl_rgb;
+    float *color;
+
+    for (v=0; v<nviews; v++)
+    {
+        if (plot[v] != P_AMPLITUDE) energy_needed = 1;
+        if ((plot[v] == P_MEAN_ENERGY)||(plot[v] == P_LOG_MEAN_ENERGY)) mean_needed = 1;
+        if (plot[v] == P_LOG_MEAN_ENERGY) log_mean = 1;
+        if (palette[v] == COL_HSLUV) hsluv_needed = 1;
+    }
+
+    #pragma omp parallel private(i,j,k,v,asym,rgb,value,energy,mean_energy,color,hsl,hsl_rgb)
+    {
+        /* hue, saturation and luminosity of a column for each view, and their conversion */
+        hsl = NULL;
+        hsl_rgb = NULL;
+        if (hsluv_needed)
+        {
+            hsl = (double *)malloc(3*NY*nviews*sizeof(double));
+            hsl_rgb = (double *)malloc(3*NY*sizeof(double));
+        }
+
+        #pragma omp for schedule(static)
+        for (i=0; i<NX; i++)
+        {
+            for (j=0; j<NY; j++)
+            {
+                if ((TWOSPEEDS)||(xy_in[i][j]))
+                {
+                    energy = 0.0;
+                    mean_energy = 0.0;
+                    if (energy_needed) energy = compute_energy(phi, psi, xy_in, i, j);
+                    
+                    /* the mean energy is only updated once, whatever the number of views */
+                    if (mean_needed)
+                    {
+                        if ((log_mean)&&(energy == 0.0)) total_energy[i][j] += 1.0e-20;
+                        else total_energy[i][j] += energy;
+                        mean_energy = total_energy[i][j]/(double)(time+1);
+                    }
+
+                    for (v=0; v<nviews; v++)
+                    {
+                        asym = 0;
+                        switch (plot[v]) {
+                            case (P_AMPLITUDE):
+                            {
+                                value = phi[i][j];
+                                if (RESCALE_COLOR_IN_CENTER) value *= color_scale[i][j];
+                                break;
+                            }
+                            case (P_ENERGY):
+                            {
+                                value = energy;
+                                if (RESCALE_COLOR_IN_CENTER) value *= color_scale[i][j];
+                                asym = (COLOR_PALETTE >= COL_TURBO);
+                                break;
+                            }
+                            case (P_MIXED):
+                            {
+                                if (j > NY/2) value = phi[i][j];
+                                else value = energy;
+                                break;
+                            }
+                            case (P_MEAN_ENERGY):
+                            {
+                                value = mean_energy;
+                                asym = (COLOR_PALETTE >= COL_TURBO);
+                                break;
+                            }
+                            case (P_LOG_ENERGY):
+                            {
+                                value = LOG_SHIFT + LOG_SCALE*log(energy);
+                                break;
+                            }
+                            case (P_LOG_MEAN_ENERGY):
+                            {
+                                value = LOG_SHIFT + LOG_SCALE*log(mean_energy);
+                                break;
+                            }
+                            default: asym = -1;
+                        }
+
+                        if (palette[v] == COL_HSLUV)
+                        {
+                            if ((asym < 0)||(!color_scheme_hsl(COLOR_SCHEME, asym, value, scale, time, &hsl[3*(v*NY+j)])))
+                                for (k=0; k<3; k++) hsl[3*(v*NY+j)+k] = 0.0;
+                            continue;
+                        }
+
+                        if (asym < 0)
+                        {
+                            rgb[0] = 0.0;   rgb[1] = 0.0;   rgb[2] = 0.0;
+                        }
+                        else if (asym) color_scheme_asym_palette(COLOR_SCHEME, palette[v], value, scale, time, rgb);
+                        else color_scheme_palette(COLOR_SCHEME, palette[v], value, scale, time, rgb);
+                        color = &view[v][3*(i*NY+j)];
+                        color[0] = rgb[0];
+                        color[1] = rgb[1];
+                        color[2] = rgb[2];
+                    }
+                }
+                else for (v=0; v<nviews; v++)
+                {
+                    /* black, also for HSLuv views (luminosity 0) */
+                    if (palette[v] == COL_HSLUV)
+                        for (k=0; k<3; k++) hsl[3*(v*NY+j)+k] = 0.0;
+                    else
+                    {
+                        color = &view[v][3*(i*NY+j)];
+                        color[0] = 0.0;
+                        color[1] = 0.0;
+                        color[2] = 0.0;
+                    }
+                }
+            }
+
+            for (v=0; v<nviews; v++) if (palette[v] == COL_HSLUV)
+            {
+                hsl_to_rgb_batch(NY, &hsl[3*v*NY], hsl_rgb, COL_HSLUV);
+                color = &view[v][3*i*NY];
+                for (k=0; k<3*NY; k++) color[k] = hsl_rgb[k];
+            }
+        }
+
+        if (hsluv_needed)
+        {
+            free(hsl);
+            free(hsl_rgb);
+        }
+    }
+}
+
+void draw_wave_view(float view[], short int *xy_in[NX])
+/* draw view computed by compute_wave_views */
 {
     int i, j;
-    double xy[2], dist2;
 
-    printf("Initializing wave\n"); 
-    #pragma omp parallel for private(i,j,xy,dist2)
+    glBegin(GL_QUADS);
     for (i=0; i<NX; i++)
-    {
-        if (i%100 == 0) printf("Initializing column %i of %i\n", i, NX);
         for (j=0; j<NY; j++)
+            if ((TWOSPEEDS)||(xy_in[i][j]))
+            {
+                glColor3fv(&view[3*(i*NY+j)]);
+                glVertex2i(i, j);
+                glVertex2i(i+1, j);
+                glVertex2i(i+1, j+1);
+                glVertex2i(i, j+1);
+            }
+    glEnd ();
+}
+
+/* resampled rendering: the colours of a view are interpolated from grid resolution to */
+/* window resolution, and the result is drawn as a single image. The grid may be finer  */
+/* or coarser than the window. Cells outside the domain do not contribute, and pixels   */
+/* mostly outside the domain keep the background colour.                               */
+
+void resampling_taps(int n_in, int n_out, int kernel, int tap[], float weight[])
+/* indices and weights of the 4 cells contributing to each of n_out pixels */
+{
+    int k, m, i0;
+    double u, t;
+
+    for (k=0; k<n_out; k++)
+    {
+        /* position of pixel center in units of cells, cell i has center at i */
+        u = ((double)k + 0.5)*(double)n_in/(double)n_out - 0.5;
+        i0 = (int)floor(u);
+        t = u - (double)i0;
+        for (m=0; m<4; m++)
         {
-//             printf("i*NY+j = %i\n", i*NY+j);
-            ij_to_xy(i, j, xy);
-            dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-	    xy_in[i*NY+j] = xy_in_billiard(xy[0],xy[1]);
+            tap[4*k+m] = i0 - 1 + m;
+            if (tap[4*k+m] < 0) tap[4*k+m] = 0;
+            if (tap[4*k+m] >= n_in) tap[4*k+m] = n_in - 1;
+        }
+        if (kernel == R_BICUBIC)
+        {
+            weight[4*k] = 0.5*(-t + 2.0*t*t - t*t*t);
+            weight[4*k+1] = 0.5*(2.0 - 5.0*t*t + 3.0*t*t*t);
+            weight[4*k+2] = 0.5*(t + 4.0*t*t - 3.0*t*t*t);
+            weight[4*k+3] = 0.5*(-t*t + t*t*t);
+        }
+        else
+        {
+            weight[4*k] = 0.0;
+            weight[4*k+1] = 1.0 - t;
+            weight[4*k+2] = t;
+            weight[4*k+3] = 0.0;
+        }
+    }
+}
+
+void resample_column_row(int y, float view[], short int *xy_in[NX], int ytap[], float yweight[], float row[])
+/* interpolate view at height of pixel row y, for each column of the grid */
+/* row contains red, green, blue (multiplied by coverage) and coverage of domain */
+{
+    int i, m, j[4];
+    float w[4], in, *color;
+
+    for (m=0; m<4; m++)
+    {
+        j[m] = ytap[4*y+m];
+        w[m] = yweight[4*y+m];
+    }
+    for (i=0; i<NX; i++)
+    {
+        row[4*i] = 0.0;
+        row[4*i+1] = 0.0;
+        row[4*i+2] = 0.0;
+        row[4*i+3] = 0.0;
+        for (m=0; m<4; m++)
+        {
+            in = w[m]*(float)((TWOSPEEDS)||(xy_in[i][j[m]]));
+            color = &view[3*(i*NY+j[m])];
+            row[4*i] += in*color[0];
+            row[4*i+1] += in*color[1];
+            row[4*i+2] += in*color[2];
+            row[4*i+3] += in;
+        }
+    }
+}
+
+void resample_pixel_row(float row[], int xtap[], float xweight[], unsigned char pixels[])
+/* interpolate row along x axis, and convert it to RGBA pixels of window width */
+{
+    int x, m;
+    float r, g, b, a;
+
+    #pragma omp simd private(m,r,g,b,a)
+    for (x=0; x<WINWIDTH; x++)
+    {
+        r = 0.0;  g = 0.0;  b = 0.0;  a = 0.0;
+        for (m=0; m<4; m++)
+        {
+            r += xweight[4*x+m]*row[4*xtap[4*x+m]];
+            g += xweight[4*x+m]*row[4*xtap[4*x+m]+1];
+            b += xweight[4*x+m]*row[4*xtap[4*x+m]+2];
+            a += xweight[4*x+m]*row[4*xtap[4*x+m]+3];
+        }
+        /* normalize by coverage, and clamp overshoots of bicubic kernel */
+        a = (a > 0.5f) ? a : 1.0f;
+        r = r/a;  g = g/a;  b = b/a;
+        r = (r < 0.0f) ? 0.0f : ((r > 1.0f) ? 1.0f : r);
+        g = (g < 0.0f) ? 0.0f : ((g > 1.0f) ? 1.0f : g);
+        b = (b < 0.0f) ? 0.0f : ((b > 1.0f) ? 1.0f : b);
+        pixels[4*x] = (unsigned char)(255.0f*r + 0.5f);
+        pixels[4*x+1] = (unsigned char)(255.0f*g + 0.5f);
+        pixels[4*x+2] = (unsigned char)(255.0f*b + 0.5f);
+    }
+}
+
+void draw_wave_view_resampled(float view[], short int *xy_in[NX], int kernel)
+/* draw view computed by compute_wave_views at window resolution, kernel is R_BILINEAR or R_BICUBIC */
+{
+    int x, y;
+    float *row;
+    static int *xtap, *ytap, current_kernel = -1;
+    static float *xweight, *yweight;
+    static unsigned char *image = NULL;
+
+    if (image == NULL)
+    {
+        xtap = (int *)malloc(4*WINWIDTH*sizeof(int));
+        ytap = (int *)malloc(4*WINHEIGHT*sizeof(int));
+        xweight = (float *)malloc(4*WINWIDTH*sizeof(float));
+        yweight = (float *)malloc(4*WINHEIGHT*sizeof(float));
+        image = (unsigned char *)malloc(4*WINWIDTH*WINHEIGHT*sizeof(unsigned char));
+    }
+    if (kernel != current_kernel)
+    {
+        resampling_taps(NX, WINWIDTH, kernel, xtap, xweight);
+        resampling_taps(NY, WINHEIGHT, kernel, ytap, yweight);
+        current_kernel = kernel;
+    }
+
+    #pragma omp parallel private(x,y,row)
+    {
+        row = (float *)malloc(4*NX*sizeof(float));
+        #pragma omp for schedule(static)
+        for (y=0; y<WINHEIGHT; y++)
+        {
+            resample_column_row(y, view, xy_in, ytap, yweight, row);
+            resample_pixel_row(row, xtap, xweight, &image[4*y*WINWIDTH]);
             
-	    if ((xy_in[i*NY+j])||(TWOSPEEDS)) 
-                phi[i*NY+j] = INITIAL_AMP*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
-            else phi[i*NY+j] = 0.0;
-            psi[i*NY+j] = 0.0;
+            /* alpha channel, pixels whose nearest cell is outside the domain are not drawn */
+            for (x=0; x<WINWIDTH; x++)
+                image[4*(y*WINWIDTH+x)+3] = 255*((TWOSPEEDS)||(xy_in[(2*x+1)*NX/(2*WINWIDTH)][(2*y+1)*NY/(2*WINHEIGHT)]));
         }
+        free(row);
     }
+
+    glRasterPos2i(0, 0);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.5);
+    glDrawPixels(WINWIDTH, WINHEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    glDisable(GL_ALPHA_TEST);
 }
 
-void add_circular_wave_mod(double factor, double x, double y, double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY])
-/* add drop at (x,y) to the field with given prefactor */
+/* modified function for "flattened" wave tables */
+
+void add_sources_mod(int nsources, t_source sources[], double phi[NX*NY], short int xy_in[NX*NY])
+/* add waves of several sources to the field */
+{
+    int i;
+
+    #pragma omp parallel for private(i)
+    for (i=0; i<NX; i++)
+    {
+        if (xy_in == NULL) stamp_sources_column(i, nsources, sources, &phi[i*NY], NULL);
+        else stamp_sources_column(i, nsources, sources, &phi[i*NY], &xy_in[i*NY]);
+    }
+}
+
+void init_circular_wave_mod(double x, double y, double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY])
+/* initialise field with drop at (x,y) - phi is wave height, psi is phi at time t-1 */
 {
     int i, j;
-    double xy[2], dist2;
+    t_source source;
 
-    #pragma omp parallel for private(i,j,xy,dist2)
+    printf("Initializing wave\n"); 
+    init_xyin_cached_mod(xy_in);
+
+    #pragma omp parallel for private(i,j)
     for (i=0; i<NX; i++)
         for (j=0; j<NY; j++)
         {
-            ij_to_xy(i, j, xy);
-            dist2 = (xy[0]-x)*(xy[0]-x) + (xy[1]-y)*(xy[1]-y);
-            if ((xy_in[i*NY+j])||(TWOSPEEDS)) 
-                phi[i*NY+j] += INITIAL_AMP*factor*exp(-dist2/INITIAL_VARIANCE)*cos(-sqrt(dist2)/INITIAL_WAVELENGTH);
+            phi[i*NY+j] = 0.0;
+            psi[i*NY+j] = 0.0;
         }
+
+    set_point_source(&source, 1.0, x, y);
+    add_sources_mod(1, &source, phi, xy_in);
+}
+
+void add_circular_wave_mod(double factor, double x, double y, double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY])
+/* add drop at (x,y) to the field with given prefactor */
+{
+    t_source source;
+
+    set_point_source(&source, factor, x, y);
+    add_sources_mod(1, &source, phi, xy_in);
 }
 
 double compute_variance_mod(double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY])
@@ -933,6 +1573,27 @@ double compute_energy_mod(double phi[NX*NY], double psi[NX*NY], short int xy_in[
     else return(0.0);
 }
 
+void compute_wave_observables_mod(double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY], double *variance, double *energy)
+/* version of compute_wave_observables for tables of size NX*NY */
+{
+    int i, j;
+    long n = 0;
+    double var = 0.0, en = 0.0;
+
+    #pragma omp parallel for private(i,j) reduction(+:n,var,en)
+    for (i=1; i<NX; i++)
+        for (j=1; j<NY; j++)
+            if (xy_in[i*NY+j])
+            {
+                n++;
+                var += phi[i*NY+j]*phi[i*NY+j];
+                en += compute_energy_mod(phi, psi, xy_in, i, j);
+            }
+    if (n==0) n=1;
+    *variance = var/(double)n;
+    *energy = en/(double)n;
+}
+
 double compute_phase(double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY], int i, int j)
 {
     double velocity, angle;
@@ -942,16 +1603,14 @@ double compute_phase(double phi[NX*NY], double psi[NX*NY], short int xy_in[NX*NY
     if (module2(phi[i*NY+j], velocity) < 1.0e-10) return(0.0); 
     else if (xy_in[i*NY+j]) 
     {
-        angle = argument(phi[i*NY+j], PHASE_FACTOR*velocity/COURANT);
-        if (angle < 0.0) angle += DPI;
+        angle = fast_argument(phi[i*NY+j], PHASE_FACTOR*velocity/COURANT);
         
         if ((i==NY/2)&&(j==NY/2)) printf("Phase = %.3lg Pi\n", angle/PI);
         return(angle);
     }
     else if (TWOSPEEDS) 
     {
-        angle = argument(phi[i*NY+j], PHASE_FACTOR*velocity/COURANTB);
-        if (angle < 0.0) angle += DPI;
+        angle = fast_argument(phi[i*NY+j], PHASE_FACTOR*velocity/COURANTB);
         return(angle);
     }
     else return(0.0);
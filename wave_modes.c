@@ -0,0 +1,208 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Eigenmodes of the wave equation in a billiard                                */
+/*                                                                               */
+/*  october 2026, based on wave_billiard.c by N. Berglund                        */
+/*                                                                               */
+/*  Computes the NEV lowest eigenmodes of the discretized Laplacian in the       */
+/*  domain (or the NEV modes with wave number closest to EIGEN_TARGET), with     */
+/*  Dirichlet conditions on the walls, as in wave_billiard with TWOSPEEDS = 0.   */
+/*  This shows the resonant modes directly, instead of integrating the wave      */
+/*  equation for a long time with plot P_MEAN_ENERGY.                            */
+/*  The modes are saved as the frames of an archive, which can be rendered by    */
+/*  wave_replay with any plot type and palette (set ARCHIVE_FILE, NSTEPS and     */
+/*  INITIAL_TIME = 0 there, and the same geometry as here). Their wave numbers,  */
+/*  and their periods in time steps of wave_billiard for the Courant number      */
+/*  COURANT, are written to MODES_FILE. See sub_wave_eigen.c for the method.     */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o wave_modes wave_modes.c                                               */
+/* -L/usr/X11R6/lib -ltiff -lm -lGL -lGLU -lX11 -lXmu -lglut -O3 -fopenmp        */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <GL/glut.h>
+#include <GL/glu.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <tiffio.h>     /* Sam Leffler's libtiff library. */
+#include <omp.h>
+
+#define NEV 20                  /* number of eigenmodes */
+#define EIGEN_TARGET 0.0        /* wave number around which modes are computed, 0 for lowest modes */
+#define EIGEN_GUARD 4           /* number of extra vectors, which speed up convergence */
+#define EIGEN_TOLERANCE 1.0e-6  /* relative residual of converged modes */
+#define EIGEN_MAXITER 2000      /* maximal number of iterations */
+
+#define ARCHIVE_FILE "wave_modes.bin"   /* archive of eigenmodes, to be rendered by wave_replay */
+#define MODES_FILE "wave_modes.dat"     /* list of eigenvalues */
+#define NSTEPS NEV                      /* number of frames of archive */
+
+#define COURANT 0.05       /* Courant number of wave_billiard, giving the periods of modes in time steps */
+
+/* Grid, which has to agree with the one of wave_replay */
+
+#define NX 1920          /* number of grid points on x axis */
+#define NY 1000          /* number of grid points on y axis */
+
+#define XMIN -1.25
+#define XMAX 2.75	/* x interval  */
+#define YMIN -1.041666667
+#define YMAX 1.041666667	/* y interval for 9/16 aspect ratio */
+
+/* Choice of the billiard table */
+
+#define B_DOMAIN 3       /* choice of domain shape, see list in global_pdes.c */
+
+#define CIRCLE_PATTERN 201   /* pattern of circles or polygons, see list in global_pdes.c */
+
+#define P_PERCOL 0.25       /* probability of having a circle in C_RAND_PERCOL arrangement */
+#define NPOISSON 300        /* number of points for Poisson C_RAND_POISSON arrangement */
+#define RANDOM_POLY_ANGLE 1 /* set to 1 to randomize angle of polygons */
+
+#define LAMBDA 0.75	    /* parameter controlling the dimensions of domain */
+#define MU 0.2              /* parameter controlling the dimensions of domain */
+#define NPOLY 3             /* number of sides of polygon */
+#define APOLY 0.3333333333333333           /* angle by which to turn polygon, in units of Pi/2 */ 
+#define MDEPTH 6            /* depth of computation of Menger gasket */
+#define MRATIO 3            /* ratio defining Menger gasket */
+#define MANDELLEVEL 1000    /* iteration level for Mandelbrot set */
+#define MANDELLIMIT 10.0    /* limit value for approximation of Mandelbrot set */
+#define JULIA_SCALE 1.0     /* scaling for Julia sets */
+#define NGRIDX 36           /* number of grid point for grid of disks */
+#define NGRIDY 6           /* number of grid point for grid of disks */
+
+#define ISO_XSHIFT_LEFT -2.9
+#define ISO_XSHIFT_RIGHT 1.4
+#define ISO_YSHIFT_LEFT -0.15
+#define ISO_YSHIFT_RIGHT -0.15 
+#define ISO_SCALE 0.5           /* coordinates for isospectral billiards */
+
+/* Boundary conditions of the sides of the grid, see list in global_pdes.c  */
+
+#define B_COND 3
+
+/* Parameters of wave_billiard required by sub_wave.c and wave_common.c, */
+/* which are not used for computing eigenmodes                           */
+
+#define TWOSPEEDS 0         /* modes are computed with hard walls */
+#define WINWIDTH 	1920
+#define WINHEIGHT 	1000
+#define FOCI 1
+#define X_SHOOTER -0.2
+#define Y_SHOOTER -0.6
+#define X_TARGET 0.4
+#define Y_TARGET 0.7
+#define OMEGA 0.005
+#define COURANTB 0.0375
+#define GAMMA 0.0
+#define GAMMAB 0.0
+#define NSEG 1000
+#define BOUNDARY_WIDTH 1
+#define INITIAL_AMP 0.75
+#define INITIAL_VARIANCE 0.00025
+#define INITIAL_WAVELENGTH  0.015
+#define COLOR_PALETTE 18
+#define BLACK 1
+#define COLOR_SCHEME 3
+#define SLOPE 1.0
+#define PHASE_FACTOR 1.0
+#define ATTENUATION 0.0
+#define E_SCALE 300.0
+#define LOG_SCALE 1.0
+#define LOG_SHIFT 1.0
+#define RESCALE_COLOR_IN_CENTER 0
+#define COLORHUE 260
+#define COLORDRIFT 0.0
+#define LUMMEAN 0.5
+#define LUMAMP 0.3
+#define HUEMEAN 180.0
+#define HUEAMP -180.0
+#define ROTATE_COLOR_SCHEME 0
+
+#include "global_pdes.c"        /* constants and global variables */
+#include "sub_wave.c"           /* common functions for wave_billiard, heat and schrodinger */
+#include "wave_common.c"        /* common functions for wave_billiard, wave_comparison, etc */
+#include "sub_wave_archive.c"   /* compressed archive of wave fields */
+#include "sub_wave_eigen.c"     /* sparse eigenvalue solver */
+
+
+void save_modes(double *mode[NEV], double eigenvalue[NEV], double residual[NEV], short int *xy_in[NX])
+/* write modes to archive, by increasing eigenvalue, with maximal amplitude 1, and list of eigenvalues */
+{
+    int i, j, k, n, u, order[NEV];
+    double *phi[NX], dx, max, kx;
+    FILE *modes_file;
+
+    for (i=0; i<NX; i++) phi[i] = (double *)malloc(NY*sizeof(double));
+    dx = (XMAX - XMIN)/(double)NX;
+
+    for (k=0; k<NEV; k++) order[k] = k;
+    for (k=0; k<NEV; k++)
+        for (n=k+1; n<NEV; n++) if (eigenvalue[order[n]] < eigenvalue[order[k]])
+        {
+            u = order[k];
+            order[k] = order[n];
+            order[n] = u;
+        }
+
+    open_wave_archive(ARCHIVE_FILE, xy_in);
+    modes_file = fopen(MODES_FILE, "w");
+    fprintf(modes_file, "# mode, wave number, eigenvalue of Laplacian, period in time steps, relative residual\n");
+
+    for (n=0; n<NEV; n++)
+    {
+        k = order[n];
+        for (i=0; i<NX; i++)
+            for (j=0; j<NY; j++) phi[i][j] = 0.0;
+        max = 0.0;
+        for (u=0; u<eig_n; u++) if (fabs(mode[k][u]) > fabs(max)) max = mode[k][u];
+        for (u=0; u<eig_n; u++) phi[eig_cell[u]/NY][eig_cell[u]%NY] = mode[k][u]/max;
+
+        /* the velocity phi - psi vanishes */
+        write_wave_archive_frame(n, phi, phi);
+
+        kx = sqrt(fabs(eigenvalue[k]))/dx;
+        fprintf(modes_file, "%i %.10lg %.10lg %.6lg %.3lg\n", n, kx, kx*kx, DPI/(COURANT*sqrt(fabs(eigenvalue[k]))), residual[k]);
+        printf("Mode %i: wave number %.6lg, period %.6lg time steps\n", n, kx, DPI/(COURANT*sqrt(fabs(eigenvalue[k]))));
+    }
+
+    fclose(modes_file);
+    close_wave_archive();
+    for (i=0; i<NX; i++) free(phi[i]);
+}
+
+
+int main(int argc, char** argv)
+{
+    int i, k;
+    double *mode[NEV], eigenvalue[NEV], residual[NEV], dx;
+    short int *xy_in[NX];
+
+    for (i=0; i<NX; i++) xy_in[i] = (short int *)malloc(NY*sizeof(short int));
+
+    /* initialise positions and radii of circles */
+    if ((B_DOMAIN == D_CIRCLES)||(B_DOMAIN == D_CIRCLES_IN_RECT)) init_circle_config(circles);
+    else if (B_DOMAIN == D_POLYGONS) init_polygon_config(polygons);
+
+    /* initialise polyline for von Koch and similar domains */
+    npolyline = init_polyline(MDEPTH, polyline);
+
+    init_xyin_cached(xy_in);
+    init_eigen(xy_in);
+
+    for (k=0; k<NEV; k++) mode[k] = (double *)malloc(eig_n*sizeof(double));
+    dx = (XMAX - XMIN)/(double)NX;
+
+    compute_eigenmodes(NEV, EIGEN_GUARD, EIGEN_TARGET*EIGEN_TARGET*dx*dx, EIGEN_TOLERANCE, EIGEN_MAXITER,
+                       mode, eigenvalue, residual);
+    save_modes(mode, eigenvalue, residual, xy_in);
+
+    for (k=0; k<NEV; k++) free(mode[k]);
+    free_eigen();
+    for (i=0; i<NX; i++) free(xy_in[i]);
+
+    return 0;
+}
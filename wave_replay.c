@@ -0,0 +1,432 @@
+/*********************************************************************************/
+/*                                                                               */
+/*  Re-rendering of wave fields saved by wave_billiard                           */
+/*                                                                               */
+/*  october 2026, based on wave_billiard.c by N. Berglund                        */
+/*                                                                               */
+/*  Reads the archive written by wave_billiard with SAVE_FIELD_ARCHIVE set to 1, */
+/*  and produces the movie frames without solving the wave equation again.      */
+/*  Parameters defining the geometry (grid size, domain, window) have to agree   */
+/*  with those of the simulation, while PLOT, color scheme, palettes and         */
+/*  DOUBLE_MOVIE can be changed freely.                                          */
+/*  Frames are split into RENDER_PROCESSES contiguous blocks, each rendered by   */
+/*  its own process and window. The still frames at the end of the movie show    */
+/*  the last archived field.                                                     */
+/*                                                                               */
+/*  compile with                                                                 */
+/*  gcc -o wave_replay wave_replay.c                                             */
+/* -L/usr/X11R6/lib -ltiff -lm -lGL -lGLU -lX11 -lXmu -lglut -O3 -fopenmp        */
+/*                                                                               */
+/*  create subfolder tif_wave, and create movie using                            */
+/*  ffmpeg -i wave.%05d.tif -vcodec libx264 wave.mp4                             */
+/*                                                                               */
+/*********************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <GL/glut.h>
+#include <GL/glu.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <tiffio.h>     /* Sam Leffler's libtiff library. */
+#include <omp.h>
+
+#define DOUBLE_MOVIE 0  /* set to 1 to produce movies for wave height and energy simultaneously */
+
+#define ARCHIVE_FILE "wave_archive.bin"   /* file containing fields, saved by wave_billiard */
+#define RENDER_PROCESSES 4      /* number of processes rendering frames in parallel */
+
+/* General geometrical parameters */
+
+#define WINWIDTH 	1920  /* window width */
+#define WINHEIGHT 	1000  /* window height */
+// #define NX 1920          /* number of grid points on x axis */
+// #define NY 1000          /* number of grid points on y axis */
+#define NX 3840          /* number of grid points on x axis */
+#define NY 2000          /* number of grid points on y axis */
+
+#define XMIN -1.25
+#define XMAX 2.75	/* x interval  */
+#define YMIN -1.041666667
+#define YMAX 1.041666667	/* y interval for 9/16 aspect ratio */
+
+#define HIGHRES 1        /* set to 1 if resolution of grid differs from that of displayed image */
+#define RESAMPLING R_BILINEAR   /* interpolation from grid to window for HIGHRES, see list in global_pdes.c */
+
+// #define WINWIDTH 	1280  /* window width */
+// #define WINHEIGHT 	720   /* window height */
+// 
+// // #define NX 1280          /* number of grid points on x axis */
+// // #define NY 720          /* number of grid points on y axis */
+// #define NX 2560          /* number of grid points on x axis */
+// #define NY 1440          /* number of grid points on y axis */
+// 
+// #define XMIN -1.25
+// #define XMAX 2.75	/* x interval  */
+// #define YMIN -1.125
+// #define YMAX 1.125	/* y interval for 9/16 aspect ratio */
+
+#define JULIA_SCALE 1.0 /* scaling for Julia sets */
+
+/* Choice of the billiard table */
+
+#define B_DOMAIN 3       /* choice of domain shape, see list in global_pdes.c */
+
+#define CIRCLE_PATTERN 201   /* pattern of circles or polygons, see list in global_pdes.c */
+
+#define P_PERCOL 0.25       /* probability of having a circle in C_RAND_PERCOL arrangement */
+#define NPOISSON 300        /* number of points for Poisson C_RAND_POISSON arrangement */
+#define RANDOM_POLY_ANGLE 1 /* set to 1 to randomize angle of polygons */
+
+#define LAMBDA 0.75	    /* parameter controlling the dimensions of domain */
+#define MU 0.2              /* parameter controlling the dimensions of domain */
+#define NPOLY 3             /* number of sides of polygon */
+#define APOLY 0.3333333333333333           /* angle by which to turn polygon, in units of Pi/2 */ 
+#define MDEPTH 6            /* depth of computation of Menger gasket */
+#define MRATIO 3            /* ratio defining Menger gasket */
+#define MANDELLEVEL 1000    /* iteration level for Mandelbrot set */
+#define MANDELLIMIT 10.0    /* limit value for approximation of Mandelbrot set */
+#define FOCI 1              /* set to 1 to draw focal points of ellipse */
+#define NGRIDX 36           /* number of grid point for grid of disks */
+#define NGRIDY 6           /* number of grid point for grid of disks */
+
+#define X_SHOOTER -0.2
+#define Y_SHOOTER -0.6
+#define X_TARGET 0.4
+#define Y_TARGET 0.7        /* shooter and target positions in laser fight */
+
+#define ISO_XSHIFT_LEFT -2.9
+#define ISO_XSHIFT_RIGHT 1.4
+#define ISO_YSHIFT_LEFT -0.15
+#define ISO_YSHIFT_RIGHT -0.15 
+#define ISO_SCALE 0.5           /* coordinates for isospectral billiards */
+
+/* You can add more billiard tables by adapting the functions */
+/* xy_in_billiard and draw_billiard below */
+
+/* Physical parameters of wave equation */
+
+#define TWOSPEEDS 1          /* set to 1 to replace hardcore boundary by medium with different speed */
+#define OSCILLATE_LEFT 1     /* set to 1 to add oscilating boundary condition on the left */
+#define OSCILLATE_TOPBOT 0   /* set to 1 to enforce a planar wave on top and bottom boundary */
+
+#define OMEGA 0.005        /* frequency of periodic excitation */
+#define AMPLITUDE 0.8      /* amplitude of periodic excitation */ 
+#define DAMPING 2.5e-5     /* damping of periodic excitation */
+#define COURANT 0.05       /* Courant number */
+#define COURANTB 0.0375      /* Courant number in medium B */
+// #define COURANTB 0.016363636     /* Courant number in medium B */
+#define GAMMA 0.0          /* damping factor in wave equation */
+#define GAMMAB 0.0          /* damping factor in wave equation */
+#define GAMMA_SIDES 1.0e-4      /* damping factor on boundary */
+#define GAMMA_TOPBOT 1.0e-7     /* damping factor on boundary */
+#define KAPPA 0.0           /* "elasticity" term enforcing oscillations */
+#define KAPPA_SIDES 5.0e-4  /* "elasticity" term on absorbing boundary */
+#define KAPPA_TOPBOT 0.0    /* "elasticity" term on absorbing boundary */
+/* The Courant number is given by c*DT/DX, where DT is the time step and DX the lattice spacing */
+/* The physical damping coefficient is given by GAMMA/(DT)^2 */
+/* Increasing COURANT speeds up the simulation, but decreases accuracy */
+/* For similar wave forms, COURANT^2*GAMMA should be kept constant */
+
+#define ADD_OSCILLATING_SOURCE 0        /* set to 1 to add an oscillating wave source */
+#define OSCILLATING_SOURCE_PERIOD 100    /* period of oscillating source */
+
+/* Boundary conditions, see list in global_pdes.c  */
+
+#define B_COND 3
+// #define B_COND 2
+
+/* Parameters for length and speed of simulation */
+
+#define NSTEPS 2700        /* number of frames of movie */
+// #define NSTEPS 100      /* number of frames of movie */
+#define NVID 30          /* number of iterations between images displayed on screen */
+#define NSEG 1000         /* number of segments of boundary */
+#define INITIAL_TIME 0      /* time after which to start saving frames */
+#define BOUNDARY_WIDTH 1    /* width of billiard boundary */
+
+#define PAUSE 200       /* number of frames after which to pause */
+#define PSLEEP 2         /* sleep time during pause */
+#define SLEEP1  1        /* initial sleeping time */
+#define SLEEP2  1        /* final sleeping time */
+#define MID_FRAMES 20    /* number of still frames between parts of two-part movie */
+#define END_FRAMES 100    /* number of still frames at end of movie */
+
+/* Parameters of initial condition */
+
+#define INITIAL_AMP 0.75         /* amplitude of initial condition */
+#define INITIAL_VARIANCE 0.00025  /* variance of initial condition */
+#define INITIAL_WAVELENGTH  0.015  /* wavelength of initial condition */
+
+/* Plot type, see list in global_pdes.c  */
+
+#define PLOT 0
+// #define PLOT 3
+// #define PLOT 1
+
+#define PLOT_B 3        /* plot type for second movie */
+
+/* Color schemes */
+
+#define COLOR_PALETTE 18     /* Color palette, see list in global_pdes.c  */
+#define COLOR_PALETTE_B 13     /* Color palette, see list in global_pdes.c  */
+
+#define BLACK 1          /* background */
+
+#define COLOR_SCHEME 3   /* choice of color scheme, see list in global_pdes.c  */
+
+#define SCALE 0          /* set to 1 to adjust color scheme to variance of field */
+#define SLOPE 1.0        /* sensitivity of color on wave amplitude */
+#define PHASE_FACTOR 1.0       /* factor in computation of phase in color scheme P_3D_PHASE */
+#define PHASE_SHIFT 0.0      /* shift of phase in color scheme P_3D_PHASE */
+#define ATTENUATION 0.0  /* exponential attenuation coefficient of contrast with time */
+#define E_SCALE 300.0     /* scaling factor for energy representation */
+#define LOG_SCALE 1.0     /* scaling factor for energy log representation */
+#define LOG_SHIFT 1.0     /* shift of colors on log scale */
+#define RESCALE_COLOR_IN_CENTER 0   /* set to 1 to decrease color intentiy in the center (for wave escaping ring) */
+
+#define COLORHUE 260     /* initial hue of water color for scheme C_LUM */
+#define COLORDRIFT 0.0   /* how much the color hue drifts during the whole simulation */
+#define LUMMEAN 0.5      /* amplitude of luminosity variation for scheme C_LUM */
+#define LUMAMP 0.3       /* amplitude of luminosity variation for scheme C_LUM */
+#define HUEMEAN 180.0    /* mean value of hue for color scheme C_HUE */
+#define HUEAMP -180.0      /* amplitude of variation of hue for color scheme C_HUE */
+
+#define DRAW_COLOR_SCHEME 1     /* set to 1 to plot the color scheme */
+#define COLORBAR_RANGE 1.0     /* scale of color scheme bar */
+#define COLORBAR_RANGE_B 5.0    /* scale of color scheme bar for 2nd part */
+#define ROTATE_COLOR_SCHEME 0   /* set to 1 to draw color scheme horizontally */
+
+/* For debugging purposes only */
+#define FLOOR 0         /* set to 1 to limit wave amplitude to VMAX */
+#define VMAX 10.0       /* max value of wave amplitude */
+
+#include "global_pdes.c"        /* constants and global variables */
+#include "sub_wave.c"           /* common functions for wave_billiard, heat and schrodinger */
+#include "wave_common.c"        /* common functions for wave_billiard, wave_comparison, etc */
+#include "sub_wave_archive.c"   /* compressed archive of wave fields */
+
+t_archive_reader reader;
+int process_number = 0;
+
+/*********************/
+/* animation part    */
+/*********************/
+
+void draw_color_bar_palette(int plot, double range, int palette)
+{
+    if (ROTATE_COLOR_SCHEME) draw_color_scheme_palette(-1.0, -0.8, XMAX - 0.1, -1.0, plot, -range, range, palette);
+    else draw_color_scheme_palette(XMAX - 0.3, YMIN + 0.1, XMAX - 0.1, YMAX - 0.1, plot, -range, range, palette);
+}
+
+int mean_energy_plot(int plot)
+/* whether plot accumulates energy over time */
+{
+    return((plot == P_MEAN_ENERGY)||(plot == P_LOG_MEAN_ENERGY));
+}
+
+int mean_energy_views(int time)
+/* whether the views drawn by wave_billiard at given time accumulate the energy */
+{
+    return((mean_energy_plot(PLOT))||((DOUBLE_MOVIE)&&(time >= INITIAL_TIME)&&(mean_energy_plot(PLOT_B))));
+}
+
+void add_mean_energy(double *phi[NX], double *psi[NX], short int *xy_in[NX], double *total_energy[NX], int weight)
+/* add energy of a frame to total_energy, as the drawing functions do for mean energy plots */
+{
+    int i, j;
+
+    #pragma omp parallel for private(i, j)
+    for (i=0; i<NX; i++)
+        for (j=0; j<NY; j++)
+            if ((TWOSPEEDS)||(xy_in[i][j]))
+                total_energy[i][j] += (double)weight*compute_energy(phi, psi, xy_in, i, j);
+}
+
+void draw_frame(float view[], short int *xy_in[NX], int plot, int palette, double colorbar_range)
+/* draw view computed by compute_wave_views, billiard and color bar, as in wave_billiard */
+{
+    if (HIGHRES) draw_wave_view_resampled(view, xy_in, RESAMPLING);
+    else draw_wave_view(view, xy_in);
+    draw_billiard();
+    if (DRAW_COLOR_SCHEME) draw_color_bar_palette(plot, colorbar_range, palette);
+    glutSwapBuffers();
+}
+
+void render_frames(int nmin, int nmax)
+/* render archived frames nmin to nmax-1, and the final still frames if nmax is the last frame */
+{
+    double scale = 1.0, r2, xy[2];
+    double *phi[NX], *psi[NX], *total_energy[NX], *color_scale[NX];
+    short int *xy_in[NX];
+    int i, j, n, k, time = 0, nsaved, counter, weight, nviews;
+    int view_plot[2] = {PLOT, PLOT_B}, view_palette[2] = {COLOR_PALETTE, COLOR_PALETTE_B};
+    float *view_rgb[2];
+
+    for (i=0; i<NX; i++)
+    {
+        phi[i] = (double *)malloc(NY*sizeof(double));
+        psi[i] = (double *)malloc(NY*sizeof(double));
+        total_energy[i] = (double *)malloc(NY*sizeof(double));
+        xy_in[i] = (short int *)malloc(NY*sizeof(short int));
+        color_scale[i] = (double *)malloc(NY*sizeof(double));
+        for (j=0; j<NY; j++) total_energy[i][j] = 0.0;
+    }
+    view_rgb[0] = allocate_wave_view();
+    if (DOUBLE_MOVIE) view_rgb[1] = allocate_wave_view();
+
+    /* initialise positions and radii of circles */
+    if ((B_DOMAIN == D_CIRCLES)||(B_DOMAIN == D_CIRCLES_IN_RECT)) init_circle_config(circles);
+    else if (B_DOMAIN == D_POLYGONS) init_polygon_config(polygons);
+
+    /* initialise polyline for von Koch and similar domains */
+    npolyline = init_polyline(MDEPTH, polyline);
+
+    read_wave_archive_mask(&reader, xy_in);
+
+    /* initialize color scale, for option RESCALE_COLOR_IN_CENTER */
+    if (RESCALE_COLOR_IN_CENTER)
+    {
+        for (i=0; i<NX; i++)
+            for (j=0; j<NY; j++)
+            {
+                ij_to_xy(i, j, xy);
+                r2 = xy[0]*xy[0] + xy[1]*xy[1];
+                color_scale[i][j] = 1.0 - exp(-4.0*r2/LAMBDA*LAMBDA);
+            }
+    }
+
+    /* mean energy plots need the energy of all previous frames, including the initial picture */
+    if ((mean_energy_plot(PLOT))||((DOUBLE_MOVIE)&&(mean_energy_plot(PLOT_B))))
+        for (n=0; n<nmin; n++)
+        {
+            time = read_wave_archive_frame(&reader, n, phi, psi);
+            weight = mean_energy_views(time);
+            if (n == 0) weight += mean_energy_plot(PLOT);
+            if (weight > 0) add_mean_energy(phi, psi, xy_in, total_energy, weight);
+        }
+    if ((nmin == 0)&&(mean_energy_plot(PLOT)))
+    {
+        read_wave_archive_frame(&reader, 0, phi, psi);
+        add_mean_energy(phi, psi, xy_in, total_energy, 1);
+    }
+
+    for (n=nmin; n<nmax; n++)
+    {
+        time = read_wave_archive_frame(&reader, n, phi, psi);
+
+        if (SCALE) scale = sqrt(1.0 + compute_variance(phi,psi, xy_in));
+        else scale = 1.0;
+
+        nviews = 1 + ((DOUBLE_MOVIE)&&(time >= INITIAL_TIME));
+        compute_wave_views(phi, psi, total_energy, color_scale, xy_in, scale, time, nviews, view_plot, view_palette, view_rgb);
+        draw_frame(view_rgb[0], xy_in, PLOT, COLOR_PALETTE, COLORBAR_RANGE);
+
+        if (time >= INITIAL_TIME)
+        {
+            save_frame_counter(time - INITIAL_TIME + 1);
+            if (DOUBLE_MOVIE)
+            {
+                draw_frame(view_rgb[1], xy_in, PLOT_B, COLOR_PALETTE_B, COLORBAR_RANGE_B);
+                save_frame_counter(NSTEPS + MID_FRAMES + 1 + time - INITIAL_TIME);
+            }
+        }
+        else printf("Initial phase time %i of %i\n", time, INITIAL_TIME);
+    }
+
+    /* still frames at the end of the movie, numbered as in wave_billiard */
+    if (nmax == reader.nframes)
+    {
+        nsaved = time - INITIAL_TIME + 1;
+        if (DOUBLE_MOVIE)
+        {
+            compute_wave_views(phi, psi, total_energy, color_scale, xy_in, scale, NSTEPS, 2, view_plot, view_palette, view_rgb);
+            draw_frame(view_rgb[0], xy_in, PLOT, COLOR_PALETTE, COLORBAR_RANGE);
+        }
+        for (k=0; k<MID_FRAMES; k++) save_frame_counter(nsaved + 1 + k);
+        if (DOUBLE_MOVIE)
+        {
+            draw_frame(view_rgb[1], xy_in, PLOT_B, COLOR_PALETTE_B, COLORBAR_RANGE_B);
+            counter = nsaved;
+        }
+        else counter = 0;
+        for (k=0; k<END_FRAMES; k++) save_frame_counter(NSTEPS + MID_FRAMES + 1 + counter + k);
+    }
+
+    for (i=0; i<NX; i++)
+    {
+        free(phi[i]);
+        free(psi[i]);
+        free(total_energy[i]);
+        free(xy_in[i]);
+        free(color_scale[i]);
+    }
+    free(view_rgb[0]);
+    if (DOUBLE_MOVIE) free(view_rgb[1]);
+}
+
+
+void display(void)
+{
+    int block, nmin, nmax;
+
+    glPushMatrix();
+
+    blank();
+    glutSwapBuffers();
+    blank();
+    glutSwapBuffers();
+
+    block = (reader.nframes + RENDER_PROCESSES - 1)/RENDER_PROCESSES;
+    nmin = process_number*block;
+    nmax = nmin + block;
+    if (nmax > reader.nframes) nmax = reader.nframes;
+    if (nmin < nmax) render_frames(nmin, nmax);
+
+    glPopMatrix();
+
+    glutDestroyWindow(glutGetWindow());
+    exit(0);
+}
+
+
+int main(int argc, char** argv)
+{
+    int p, status;
+    pid_t pid = 0;
+
+    open_wave_archive_for_reading(ARCHIVE_FILE, &reader);
+
+    /* each process opens its own window */
+    for (p=0; p<RENDER_PROCESSES; p++)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            process_number = p;
+            break;
+        }
+    }
+
+    if (pid != 0)
+    {
+        for (p=0; p<RENDER_PROCESSES; p++) wait(&status);
+        close_wave_archive_for_reading(&reader);
+        if (system("mv wave*.tif tif_wave/") != 0) printf("Warning: could not move frames to tif_wave/\n");
+        return 0;
+    }
+
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(WINWIDTH,WINHEIGHT);
+    glutCreateWindow("Re-rendering of wave equation in a planar domain");
+
+    init();
+
+    glutDisplayFunc(display);
+
+    glutMainLoop();
+
+    return 0;
+}